@@ -816,6 +816,11 @@ AnimationServer::AnimationServer(int &argc, char **argv) :
     connect(silentNodeTimer, SIGNAL(timeout()), nodeList, SLOT(removeSilentNodes()));
     silentNodeTimer->start(NODE_SILENCE_THRESHOLD_USECS / 1000);
     
+    // our voxel edits go out on a reliable channel, which retransmits from here
+    QTimer* channelTimeoutTimer = new QTimer(this);
+    connect(channelTimeoutTimer, SIGNAL(timeout()), nodeList, SLOT(processChannelTimeouts()));
+    channelTimeoutTimer->start(CHANNEL_TIMEOUT_CHECK_INTERVAL_MSECS);
+    
     connect(&nodeList->getNodeSocket(), SIGNAL(readyRead()), SLOT(readPendingDatagrams()));
 }
 
@@ -826,10 +831,7 @@ void AnimationServer::readPendingDatagrams() {
     static HifiSockAddr nodeSockAddr;
     
     // Nodes sending messages to us...
-    while (nodeList->getNodeSocket().hasPendingDatagrams()) {
-        receivedPacket.resize(nodeList->getNodeSocket().pendingDatagramSize());
-        nodeList->getNodeSocket().readDatagram(receivedPacket.data(), receivedPacket.size(),
-                                               nodeSockAddr.getAddressPointer(), nodeSockAddr.getPortPointer());
+    while (nodeList->readDatagram(receivedPacket, nodeSockAddr)) {
         if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
             if (packetTypeForPacket(receivedPacket) == PacketTypeJurisdiction) {
                 int headerBytes = numBytesForPacketHeader(receivedPacket);
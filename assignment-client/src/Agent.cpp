@@ -22,6 +22,8 @@
 
 #include "Agent.h"
 
+const char AGENT_LOGGING_NAME[] = "agent";
+
 Agent::Agent(const QByteArray& packet) :
     ThreadedAssignment(packet),
     _voxelEditSender(),
@@ -99,13 +101,7 @@ void Agent::run() {
     timeval startTime;
     gettimeofday(&startTime, NULL);
     
-    QTimer* domainServerTimer = new QTimer(this);
-    connect(domainServerTimer, SIGNAL(timeout()), this, SLOT(checkInWithDomainServerOrExit()));
-    domainServerTimer->start(DOMAIN_SERVER_CHECK_IN_USECS / 1000);
-    
-    QTimer* silentNodeTimer = new QTimer(this);
-    connect(silentNodeTimer, SIGNAL(timeout()), nodeList, SLOT(removeSilentNodes()));
-    silentNodeTimer->start(NODE_SILENCE_THRESHOLD_USECS / 1000);
+    commonInit(AGENT_LOGGING_NAME, NodeType::Agent);
     
     // tell our script engine about our local particle tree
     _scriptEngine.getParticlesScriptingInterface()->setParticleTree(&_particleTree);
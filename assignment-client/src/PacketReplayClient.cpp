@@ -0,0 +1,103 @@
+//
+//  PacketReplayClient.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <QtCore/QDataStream>
+#include <QtCore/QThread>
+#include <QtCore/QTimer>
+
+#include <Logging.h>
+#include <NodeList.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+
+#include "AssignmentFactory.h"
+
+#include "PacketReplayClient.h"
+
+const char* PACKET_REPLAY_PARAMETER = "--replay";
+
+const char PACKET_REPLAY_TARGET_NAME[] = "packet-replay";
+
+PacketReplayClient::PacketReplayClient(int &argc, char **argv) :
+    QCoreApplication(argc, argv),
+    _assignment(NULL),
+    _workerThread(NULL)
+{
+    Logging::setTargetName(PACKET_REPLAY_TARGET_NAME);
+    
+    const char* captureFilename = getCmdOption(argc, (const char**) argv, PACKET_REPLAY_PARAMETER);
+    
+    const char ASSIGNMENT_TYPE_OPTION[] = "-t";
+    const char* assignmentTypeString = getCmdOption(argc, (const char**) argv, ASSIGNMENT_TYPE_OPTION);
+    
+    const char REPLAY_SPEED_OPTION[] = "--replaySpeed";
+    const char* replaySpeedString = getCmdOption(argc, (const char**) argv, REPLAY_SPEED_OPTION);
+    
+    // the options the assignment would have been given by the domain server, --replayPayload "--receiveThread ..."
+    const char REPLAY_PAYLOAD_OPTION[] = "--replayPayload";
+    const char* replayPayload = getCmdOption(argc, (const char**) argv, REPLAY_PAYLOAD_OPTION);
+    
+    if (!captureFilename || !assignmentTypeString) {
+        qDebug() << "Replaying a capture takes --replay <capture file> -t <assignment type>,"
+            << "with --replaySpeed <multiple> (0 for as fast as possible) and --replayPayload <options> if needed.";
+        QTimer::singleShot(0, this, SLOT(quit()));
+        return;
+    }
+    
+    float replaySpeed = replaySpeedString ? atof(replaySpeedString) : 1.0f;
+    
+    // the assignment is unpacked from a create packet, the same as one sent by the domain server
+    Assignment createAssignment(Assignment::CreateCommand, (Assignment::Type) atoi(assignmentTypeString));
+    
+    if (replayPayload) {
+        createAssignment.setPayload(replayPayload);
+    }
+    
+    QByteArray assignmentPacket = byteArrayWithPopluatedHeader(PacketTypeCreateAssignment);
+    QDataStream packetStream(&assignmentPacket, QIODevice::Append);
+    packetStream << createAssignment;
+    
+    NodeList* nodeList = NodeList::createInstance(NodeType::Unassigned);
+    
+    if (!nodeList->startPacketReplay(captureFilename, replaySpeed)) {
+        QTimer::singleShot(0, this, SLOT(quit()));
+        return;
+    }
+    
+    _assignment = AssignmentFactory::unpackAssignment(assignmentPacket);
+    
+    if (!_assignment) {
+        qDebug() << "There is no assignment of type" << assignmentTypeString << "to replay the capture against.";
+        QTimer::singleShot(0, this, SLOT(quit()));
+        return;
+    }
+    
+    qDebug() << "Replaying" << captureFilename << "against" << *_assignment;
+    
+    nodeList->setSessionUUID(_assignment->getUUID());
+    
+    // the assignment runs on its own thread like it does under the AssignmentClient, but reads from the replay - the
+    // node socket is never listened to
+    _workerThread = new QThread(this);
+    
+    connect(_workerThread, SIGNAL(started()), _assignment, SLOT(run()));
+    connect(_assignment, SIGNAL(finished()), _workerThread, SLOT(quit()));
+    connect(_assignment, SIGNAL(finished()), _assignment, SLOT(deleteLater()));
+    connect(_assignment, SIGNAL(finished()), this, SLOT(assignmentCompleted()));
+    
+    _assignment->moveToThread(_workerThread);
+    nodeList->moveToThread(_workerThread);
+    
+    _workerThread->start();
+}
+
+void PacketReplayClient::assignmentCompleted() {
+    // the report has been logged by the assignment, let its thread wind down before going
+    _workerThread->wait();
+    quit();
+}
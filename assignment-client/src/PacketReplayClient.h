@@ -0,0 +1,32 @@
+//
+//  PacketReplayClient.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  Runs one assignment against a packet capture instead of a domain, and reports how long its frames took and what it
+//  sent once the capture has been replayed.
+//
+
+#ifndef __hifi__PacketReplayClient__
+#define __hifi__PacketReplayClient__
+
+#include <QtCore/QCoreApplication>
+
+#include "ThreadedAssignment.h"
+
+extern const char* PACKET_REPLAY_PARAMETER;
+
+class PacketReplayClient : public QCoreApplication {
+    Q_OBJECT
+public:
+    PacketReplayClient(int &argc, char **argv);
+private slots:
+    void assignmentCompleted();
+private:
+    ThreadedAssignment* _assignment;
+    QThread* _workerThread;
+};
+
+#endif /* defined(__hifi__PacketReplayClient__) */
@@ -0,0 +1,120 @@
+//
+//  AudioMixKernels.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <limits>
+
+#include "AudioMixKernels.h"
+
+#if defined(HIFI_AUDIO_MIX_AVX2)
+#include <immintrin.h>
+#elif defined(HIFI_AUDIO_MIX_SSE2)
+#include <emmintrin.h>
+#endif
+
+const int32_t MIN_MIX_SAMPLE_VALUE = std::numeric_limits<int16_t>::min();
+const int32_t MAX_MIX_SAMPLE_VALUE = std::numeric_limits<int16_t>::max();
+
+namespace AudioMixKernels {
+
+const char* getVectorizedKernelName() {
+#if defined(HIFI_AUDIO_MIX_AVX2)
+    return "AVX2";
+#elif defined(HIFI_AUDIO_MIX_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void accumulateScaledSamplesScalar(int32_t* accumulator, const int16_t* source, float gain, int numSamples) {
+    for (int i = 0; i < numSamples; i++) {
+        accumulator[i] += (int32_t) (source[i] * gain);
+    }
+}
+
+void saturateAndInterleaveScalar(const int32_t* left, const int32_t* right, int16_t* destination,
+                                 int numSamplesPerChannel) {
+    for (int i = 0; i < numSamplesPerChannel; i++) {
+        int32_t leftSample = left[i];
+        int32_t rightSample = right[i];
+
+        destination[i * 2] = (int16_t) (leftSample < MIN_MIX_SAMPLE_VALUE ? MIN_MIX_SAMPLE_VALUE
+                                        : (leftSample > MAX_MIX_SAMPLE_VALUE ? MAX_MIX_SAMPLE_VALUE : leftSample));
+        destination[(i * 2) + 1] = (int16_t) (rightSample < MIN_MIX_SAMPLE_VALUE ? MIN_MIX_SAMPLE_VALUE
+                                              : (rightSample > MAX_MIX_SAMPLE_VALUE ? MAX_MIX_SAMPLE_VALUE : rightSample));
+    }
+}
+
+void accumulateScaledSamples(int32_t* accumulator, const int16_t* source, float gain, int numSamples) {
+    int i = 0;
+
+#if defined(HIFI_AUDIO_MIX_AVX2)
+    const int SAMPLES_PER_STEP = 8;
+    __m256 gainVector = _mm256_set1_ps(gain);
+
+    for (; i + SAMPLES_PER_STEP <= numSamples; i += SAMPLES_PER_STEP) {
+        // widen eight int16 samples to int32, scale them as floats and truncate back like the scalar cast does
+        __m128i sourceSamples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        __m256 scaledSamples = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(sourceSamples)), gainVector);
+
+        __m256i* accumulatorPointer = reinterpret_cast<__m256i*>(accumulator + i);
+        _mm256_storeu_si256(accumulatorPointer, _mm256_add_epi32(_mm256_loadu_si256(accumulatorPointer),
+                                                                 _mm256_cvttps_epi32(scaledSamples)));
+    }
+#elif defined(HIFI_AUDIO_MIX_SSE2)
+    const int SAMPLES_PER_STEP = 8;
+    __m128 gainVector = _mm_set1_ps(gain);
+
+    for (; i + SAMPLES_PER_STEP <= numSamples; i += SAMPLES_PER_STEP) {
+        __m128i sourceSamples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+
+        // SSE2 has no sign-extending widen, so unpack each sample into the high half and shift it back down
+        __m128i lowSamples = _mm_srai_epi32(_mm_unpacklo_epi16(sourceSamples, sourceSamples), 16);
+        __m128i highSamples = _mm_srai_epi32(_mm_unpackhi_epi16(sourceSamples, sourceSamples), 16);
+
+        __m128i scaledLow = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(lowSamples), gainVector));
+        __m128i scaledHigh = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(highSamples), gainVector));
+
+        __m128i* lowPointer = reinterpret_cast<__m128i*>(accumulator + i);
+        __m128i* highPointer = reinterpret_cast<__m128i*>(accumulator + i + 4);
+        _mm_storeu_si128(lowPointer, _mm_add_epi32(_mm_loadu_si128(lowPointer), scaledLow));
+        _mm_storeu_si128(highPointer, _mm_add_epi32(_mm_loadu_si128(highPointer), scaledHigh));
+    }
+#endif
+
+    // pick up whatever is left over (or everything, if there is no vectorized kernel)
+    if (i < numSamples) {
+        accumulateScaledSamplesScalar(accumulator + i, source + i, gain, numSamples - i);
+    }
+}
+
+void saturateAndInterleave(const int32_t* left, const int32_t* right, int16_t* destination, int numSamplesPerChannel) {
+    int i = 0;
+
+#if defined(HIFI_AUDIO_MIX_SSE2) || defined(HIFI_AUDIO_MIX_AVX2)
+    const int SAMPLES_PER_STEP = 8;
+
+    for (; i + SAMPLES_PER_STEP <= numSamplesPerChannel; i += SAMPLES_PER_STEP) {
+        // packs saturates int32 to int16, which is exactly the clamp the scalar kernel performs
+        __m128i leftSamples = _mm_packs_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i)),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + i + 4)));
+        __m128i rightSamples = _mm_packs_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i)),
+                                               _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + i + 4)));
+
+        __m128i* destinationPointer = reinterpret_cast<__m128i*>(destination + (i * 2));
+        _mm_storeu_si128(destinationPointer, _mm_unpacklo_epi16(leftSamples, rightSamples));
+        _mm_storeu_si128(destinationPointer + 1, _mm_unpackhi_epi16(leftSamples, rightSamples));
+    }
+#endif
+
+    if (i < numSamplesPerChannel) {
+        saturateAndInterleaveScalar(left + i, right + i, destination + (i * 2), numSamplesPerChannel - i);
+    }
+}
+
+}
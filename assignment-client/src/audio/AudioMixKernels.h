@@ -0,0 +1,41 @@
+//
+//  AudioMixKernels.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  Accumulate/attenuate/saturate kernels used by the AudioMixer. Sources are accumulated into planar int32 channels
+//  and saturated back to interleaved int16 once per listener, so the result does not depend on mix order.
+//
+
+#ifndef __hifi__AudioMixKernels__
+#define __hifi__AudioMixKernels__
+
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#define HIFI_AUDIO_MIX_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HIFI_AUDIO_MIX_SSE2
+#endif
+
+namespace AudioMixKernels {
+    /// name of the kernel set compiled into this build, for logging
+    const char* getVectorizedKernelName();
+
+    /// adds (int) (source[i] * gain) to accumulator[i] for numSamples samples, using the best vectorized kernel available
+    void accumulateScaledSamples(int32_t* accumulator, const int16_t* source, float gain, int numSamples);
+
+    /// saturates the planar left and right accumulators to int16 and interleaves them into destination
+    void saturateAndInterleave(const int32_t* left, const int32_t* right, int16_t* destination, int numSamplesPerChannel);
+
+    /// portable versions of the kernels above - the vectorized kernels must produce bit identical output
+    void accumulateScaledSamplesScalar(int32_t* accumulator, const int16_t* source, float gain, int numSamples);
+    void saturateAndInterleaveScalar(const int32_t* left, const int32_t* right, int16_t* destination,
+                                     int numSamplesPerChannel);
+}
+
+#endif /* defined(__hifi__AudioMixKernels__) */
@@ -6,6 +6,7 @@
 //  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
 #include <fstream>
@@ -32,6 +33,10 @@
 #include <glm/gtx/vector_angle.hpp>
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QRunnable>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
 #include <QtCore/QTimer>
 
 #include <Logging.h>
@@ -43,6 +48,7 @@
 #include <UUID.h>
 
 #include "AudioRingBuffer.h"
+#include "AudioMixKernels.h"
 #include "AudioMixerClientData.h"
 #include "AvatarAudioRingBuffer.h"
 #include "InjectedAudioRingBuffer.h"
@@ -54,158 +60,792 @@ const short JITTER_BUFFER_SAMPLES = JITTER_BUFFER_MSECS * (SAMPLE_RATE / 1000.0)
 
 const char AUDIO_MIXER_LOGGING_TARGET_NAME[] = "audio-mixer";
 
+const int MIX_STATS_REPORT_INTERVAL_FRAMES = 1000;
+
+// the grid cells used to find audible sources are never made smaller than this
+const float MIN_SOURCE_GRID_CELL_SIZE = 1.0f;
+
+const float DEFAULT_CLUSTER_CELL_SIZE = 2.0f;
+const float MAX_CLUSTER_MIX_TOLERANCE = 60.0f;
+
+// the cluster cell coordinates and yaw bucket are each packed into 16 bits of the cluster key
+const int CLUSTER_KEY_FIELD_BITS = 16;
+const int CLUSTER_KEY_FIELD_OFFSET = 1 << (CLUSTER_KEY_FIELD_BITS - 1);
+
 void attachNewBufferToNode(Node *newNode) {
     if (!newNode->getLinkedData()) {
         newNode->setLinkedData(new AudioMixerClientData());
     }
 }
 
+/// runs every stride-th piece of the current frame phase on a thread from the AudioMixer worker pool
+class AudioMixerJob : public QRunnable {
+public:
+    AudioMixerJob(AudioMixer* mixer, int firstIndex, int stride, QSemaphore* finishedSemaphore) :
+        _mixer(mixer),
+        _firstIndex(firstIndex),
+        _stride(stride),
+        _finishedSemaphore(finishedSemaphore)
+    {
+        // the mixer re-uses its jobs every frame
+        setAutoDelete(false);
+    }
+
+    void run() {
+        _mixer->runWorkerJob(_firstIndex, _stride);
+        _finishedSemaphore->release();
+    }
+private:
+    AudioMixer* _mixer;
+    int _firstIndex;
+    int _stride;
+    QSemaphore* _finishedSemaphore;
+};
+
 AudioMixer::AudioMixer(const QByteArray& packet) :
-    ThreadedAssignment(packet)
+    ThreadedAssignment(packet),
+    _spatializer(),
+    _useReferenceMix(false),
+    _shouldVerifyMix(false),
+    _verboseDebug(false),
+    _numWorkerThreads(QThread::idealThreadCount()),
+    _workerPool(),
+    _finishedJobsSemaphore(),
+    _workerJobs(),
+    _numMismatchedMixes(0),
+    _numSilentSourcesSkipped(0),
+    _numSilentMixesSent(0),
+    _isJitterBufferAdaptive(true),
+    _shouldLogJitterBufferStats(false),
+    _audibilityThreshold(0.0f),
+    _maxSourcesPerListener(0),
+    _sourceGrid(),
+    _isSourceGridActive(false),
+    _unbucketedSourceIndices(),
+    _numSourcesKept(0),
+    _numSourcesCulledByDistance(0),
+    _numSourcesCulledByThreshold(0),
+    _numSourcesCulledByBudget(0),
+    _workerPhase(ListenerPhase),
+    _clusterMixTolerance(0.0f),
+    _clusterCellSize(DEFAULT_CLUSTER_CELL_SIZE),
+    _clusterNearFieldDistance(0.0f),
+    _numClusterYawBuckets(0),
+    _listenerClusterKeys(),
+    _frameClusters(),
+    _numFarFieldSourcesMixed(0),
+    _numClusteredListeners(0),
+    _numClusters(0),
+    _frameSources(),
+    _frameListeners()
 {
+    // with a receive thread the queued datagrams are read at the top of each frame
+    _isDrainingDatagramsEachFrame = true;
+}
+
+AudioMixer::~AudioMixer() {
+    _workerPool.waitForDone();
 
+    for (unsigned int i = 0; i < _workerJobs.size(); i++) {
+        delete _workerJobs[i];
+    }
 }
 
-void AudioMixer::addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuffer* bufferToAdd,
-                                                          AvatarAudioRingBuffer* listeningNodeBuffer) {
-    float bearingRelativeAngleToSource = 0.0f;
-    float attenuationCoefficient = 1.0f;
-    int numSamplesDelay = 0;
-    float weakChannelAmplitudeRatio = 1.0f;
+void AudioMixer::parsePayload() {
+    QStringList payloadOptions = QString(getPayload()).split(" ", QString::SkipEmptyParts);
 
-    const int PHASE_DELAY_AT_90 = 20;
+    // the reference mix is the original single threaded mix that clamps every sample as it is added
+    const QString REFERENCE_MIX_OPTION = "--referenceMix";
+    _useReferenceMix = payloadOptions.contains(REFERENCE_MIX_OPTION);
 
-    if (bufferToAdd != listeningNodeBuffer) {
-        // if the two buffer pointers do not match then these are different buffers
+    // verifying the mix re-mixes each listener with the scalar kernels and compares the two mixes bit for bit
+    const QString VERIFY_MIX_OPTION = "--verifyMix";
+    _shouldVerifyMix = payloadOptions.contains(VERIFY_MIX_OPTION);
 
-        glm::vec3 listenerPosition = listeningNodeBuffer->getPosition();
-        glm::vec3 relativePosition = bufferToAdd->getPosition() - listeningNodeBuffer->getPosition();
-        glm::quat inverseOrientation = glm::inverse(listeningNodeBuffer->getOrientation());
+    const QString MIX_THREADS_OPTION = "--mixThreads";
+    QString mixThreads = payloadOptionValue(payloadOptions, MIX_THREADS_OPTION);
+    if (!mixThreads.isEmpty()) {
+        _numWorkerThreads = mixThreads.toInt();
+    }
 
-        float distanceSquareToSource = glm::dot(relativePosition, relativePosition);
-        float radius = 0.0f;
+    if (_numWorkerThreads < 1) {
+        _numWorkerThreads = 1;
+    }
 
-        if (bufferToAdd->getType() == PositionalAudioRingBuffer::Injector) {
-            InjectedAudioRingBuffer* injectedBuffer = (InjectedAudioRingBuffer*) bufferToAdd;
-            radius = injectedBuffer->getRadius();
-            attenuationCoefficient *= injectedBuffer->getAttenuationRatio();
-        }
+    qDebug("referenceMix=%s verifyMix=%s mixThreads=%d kernels=%s", debug::valueOf(_useReferenceMix),
+           debug::valueOf(_shouldVerifyMix), _numWorkerThreads, AudioMixKernels::getVectorizedKernelName());
 
-        if (radius == 0 || (distanceSquareToSource > radius * radius)) {
-            // this is either not a spherical source, or the listener is outside the sphere
+    const QString VERBOSE_DEBUG_OPTION = "--verboseDebug";
+    _verboseDebug = payloadOptions.contains(VERBOSE_DEBUG_OPTION);
+    qDebug("verboseDebug=%s", debug::valueOf(_verboseDebug));
 
-            if (radius > 0) {
-                // this is a spherical source - the distance used for the coefficient
-                // needs to be the closest point on the boundary to the source
+    // each stream's jitter buffer follows its measured jitter, unless the fixed depth is asked for - the reference mix
+    // reads frames straight out of the ring, so it always uses the fixed depth
+    const QString FIXED_JITTER_BUFFER_OPTION = "--fixedJitterBuffer";
+    _isJitterBufferAdaptive = !payloadOptions.contains(FIXED_JITTER_BUFFER_OPTION) && !_useReferenceMix;
 
-                // ovveride the distance to the node with the distance to the point on the
-                // boundary of the sphere
-                distanceSquareToSource -= (radius * radius);
+    const QString JITTER_BUFFER_STATS_OPTION = "--jitterBufferStats";
+    _shouldLogJitterBufferStats = payloadOptions.contains(JITTER_BUFFER_STATS_OPTION);
 
-            } else {
-                // calculate the angle delivery for off-axis attenuation
-                glm::vec3 rotatedListenerPosition = glm::inverse(bufferToAdd->getOrientation()) * relativePosition;
+    qDebug("adaptiveJitterBuffer=%s jitterBufferStats=%s", debug::valueOf(_isJitterBufferAdaptive),
+           debug::valueOf(_shouldLogJitterBufferStats));
 
-                float angleOfDelivery = glm::angle(glm::vec3(0.0f, 0.0f, -1.0f),
-                                                   glm::normalize(rotatedListenerPosition));
+    // sources whose average attenuated amplitude for a listener is below the threshold are left out of that mix
+    const QString AUDIBILITY_THRESHOLD_OPTION = "--audibilityThreshold";
+    _audibilityThreshold = payloadOptionValue(payloadOptions, AUDIBILITY_THRESHOLD_OPTION).toFloat();
 
-                const float MAX_OFF_AXIS_ATTENUATION = 0.2f;
-                const float OFF_AXIS_ATTENUATION_FORMULA_STEP = (1 - MAX_OFF_AXIS_ATTENUATION) / 2.0f;
+    // only the loudest sources (after attenuation) are mixed for each listener
+    const QString MAX_SOURCES_PER_LISTENER_OPTION = "--maxSourcesPerListener";
+    _maxSourcesPerListener = payloadOptionValue(payloadOptions, MAX_SOURCES_PER_LISTENER_OPTION).toInt();
 
-                float offAxisCoefficient = MAX_OFF_AXIS_ATTENUATION +
-                    (OFF_AXIS_ATTENUATION_FORMULA_STEP * (angleOfDelivery / 90.0f));
+    qDebug("audibilityThreshold=%f maxSourcesPerListener=%d", _audibilityThreshold, _maxSourcesPerListener);
 
-                // multiply the current attenuation coefficient by the calculated off axis coefficient
-                attenuationCoefficient *= offAxisCoefficient;
-            }
+    // listeners in the same cell facing the same way share a mix of the sources far enough away that no listener in
+    // the cluster hears them more than the tolerance (in degrees) off their true bearing
+    const QString CLUSTER_MIX_TOLERANCE_OPTION = "--clusterMixTolerance";
+    _clusterMixTolerance = payloadOptionValue(payloadOptions, CLUSTER_MIX_TOLERANCE_OPTION).toFloat();
+
+    const QString CLUSTER_CELL_SIZE_OPTION = "--clusterCellSize";
+    QString clusterCellSize = payloadOptionValue(payloadOptions, CLUSTER_CELL_SIZE_OPTION);
+    if (!clusterCellSize.isEmpty() && clusterCellSize.toFloat() > 0.0f) {
+        _clusterCellSize = clusterCellSize.toFloat();
+    }
 
-            glm::vec3 rotatedSourcePosition = inverseOrientation * relativePosition;
+    if (_clusterMixTolerance > 0.0f) {
+        _clusterMixTolerance = std::min(_clusterMixTolerance, MAX_CLUSTER_MIX_TOLERANCE);
 
-            const float DISTANCE_SCALE = 2.5f;
-            const float GEOMETRIC_AMPLITUDE_SCALAR = 0.3f;
-            const float DISTANCE_LOG_BASE = 2.5f;
-            const float DISTANCE_SCALE_LOG = logf(DISTANCE_SCALE) / logf(DISTANCE_LOG_BASE);
+        // half of the tolerance goes to position - a source this far from the cell center is heard within half the
+        // tolerance of its true bearing by a listener anywhere in the cell
+        float cellHalfDiagonal = _clusterCellSize * SQUARE_ROOT_OF_3 / 2.0f;
+        _clusterNearFieldDistance = cellHalfDiagonal / sinf(glm::radians(_clusterMixTolerance / 2.0f));
 
-            // calculate the distance coefficient using the distance to this node
-            float distanceCoefficient = powf(GEOMETRIC_AMPLITUDE_SCALAR,
-                                             DISTANCE_SCALE_LOG +
-                                             (0.5f * logf(distanceSquareToSource) / logf(DISTANCE_LOG_BASE)) - 1);
-            distanceCoefficient = std::min(1.0f, distanceCoefficient);
+        // the other half goes to orientation - no listener's yaw is more than half the tolerance from their bucket's center
+        _numClusterYawBuckets = (int) ceilf(360.0f / _clusterMixTolerance);
 
-            // multiply the current attenuation coefficient by the distance coefficient
-            attenuationCoefficient *= distanceCoefficient;
+        qDebug("clusterMixTolerance=%f clusterCellSize=%f nearFieldDistance=%f yawBuckets=%d", _clusterMixTolerance,
+               _clusterCellSize, _clusterNearFieldDistance, _numClusterYawBuckets);
+    }
 
-            // project the rotated source position vector onto the XZ plane
-            rotatedSourcePosition.y = 0.0f;
+    qDebug("Spatialization tables max error - distance: %f%% relative, off-axis: %f absolute",
+           _spatializer.getMaxDistanceRelativeError() * 100.0f, _spatializer.getMaxOffAxisError());
 
-            // produce an oriented angle about the y-axis
-            bearingRelativeAngleToSource = glm::orientedAngle(glm::vec3(0.0f, 0.0f, -1.0f),
-                                                              glm::normalize(rotatedSourcePosition),
-                                                              glm::vec3(0.0f, 1.0f, 0.0f));
+    // times the spatialization formulas against the tables for 100 listeners and 100 sources
+    const QString BENCHMARK_SPATIALIZATION_OPTION = "--benchmarkSpatialization";
+    if (payloadOptions.contains(BENCHMARK_SPATIALIZATION_OPTION)) {
+        benchmarkSpatialization();
+    }
+}
 
-            const float PHASE_AMPLITUDE_RATIO_AT_90 = 0.5;
+AudioSpatialSource spatialSourceForBuffer(PositionalAudioRingBuffer* ringBuffer) {
+    AudioSpatialSource spatialSource;
+    spatialSource.position = ringBuffer->getPosition();
+    spatialSource.orientation = ringBuffer->getOrientation();
+    spatialSource.radius = 0.0f;
+    spatialSource.attenuationRatio = 1.0f;
+
+    if (ringBuffer->getType() == PositionalAudioRingBuffer::Injector) {
+        InjectedAudioRingBuffer* injectedBuffer = (InjectedAudioRingBuffer*) ringBuffer;
+        spatialSource.radius = injectedBuffer->getRadius();
+        spatialSource.attenuationRatio = injectedBuffer->getAttenuationRatio();
+    }
+
+    return spatialSource;
+}
+
+AudioMixerSpatialization AudioMixer::spatializationForBuffer(PositionalAudioRingBuffer* bufferToAdd,
+                                                             AvatarAudioRingBuffer* listeningNodeBuffer) {
+    if (bufferToAdd == listeningNodeBuffer) {
+        // this is the listener's own buffer, looped back without any spatialization
+        AudioMixerSpatialization loopbackSpatialization;
+        loopbackSpatialization.attenuationCoefficient = 1.0f;
+        loopbackSpatialization.weakChannelAmplitudeRatio = 1.0f;
+        loopbackSpatialization.numSamplesDelay = 0;
+        loopbackSpatialization.isDelayedChannelRight = false;
+
+        return loopbackSpatialization;
+    }
+
+    if (_useReferenceMix) {
+        return AudioSpatializer::spatializeWithFormulas(spatialSourceForBuffer(bufferToAdd),
+                                                        spatialSourceForBuffer(listeningNodeBuffer));
+    } else {
+        return _spatializer.spatialize(spatialSourceForBuffer(bufferToAdd), spatialSourceForBuffer(listeningNodeBuffer));
+    }
+}
 
-            // figure out the number of samples of delay and the ratio of the amplitude
-            // in the weak channel for audio spatialization
-            float sinRatio = fabsf(sinf(glm::radians(bearingRelativeAngleToSource)));
-            numSamplesDelay = PHASE_DELAY_AT_90 * sinRatio;
-            weakChannelAmplitudeRatio = 1 - (PHASE_AMPLITUDE_RATIO_AT_90 * sinRatio);
+void AudioMixer::benchmarkSpatialization() {
+    const int NUM_BENCHMARK_SOURCES = 100;
+    const int NUM_BENCHMARK_LISTENERS = 100;
+    const int NUM_BENCHMARK_ITERATIONS = 100;
+    const float BENCHMARK_AREA_SIZE = 50.0f;
+
+    std::vector<AudioSpatialSource> sources(NUM_BENCHMARK_SOURCES);
+    std::vector<AudioSpatialSource> listeners(NUM_BENCHMARK_LISTENERS);
+
+    for (int i = 0; i < NUM_BENCHMARK_SOURCES + NUM_BENCHMARK_LISTENERS; i++) {
+        AudioSpatialSource& spatialSource = (i < NUM_BENCHMARK_SOURCES)
+            ? sources[i] : listeners[i - NUM_BENCHMARK_SOURCES];
+
+        spatialSource.position = glm::vec3(randFloat(), randFloat(), randFloat()) * BENCHMARK_AREA_SIZE;
+        spatialSource.orientation = glm::normalize(glm::quat(randFloat() - 0.5f, randFloat() - 0.5f,
+                                                             randFloat() - 0.5f, randFloat() - 0.5f));
+        spatialSource.radius = 0.0f;
+        spatialSource.attenuationRatio = 1.0f;
+    }
+
+    // sum the results so the optimizer can't throw the work away
+    float formulaSum = 0.0f;
+    float tableSum = 0.0f;
+    float maxAttenuationError = 0.0f;
+
+    QElapsedTimer benchmarkTimer;
+    benchmarkTimer.start();
+
+    for (int iteration = 0; iteration < NUM_BENCHMARK_ITERATIONS; iteration++) {
+        for (int l = 0; l < NUM_BENCHMARK_LISTENERS; l++) {
+            for (int s = 0; s < NUM_BENCHMARK_SOURCES; s++) {
+                formulaSum += AudioSpatializer::spatializeWithFormulas(sources[s], listeners[l]).attenuationCoefficient;
+            }
         }
     }
 
-    // if the bearing relative angle to source is > 0 then the delayed channel is the right one
-    int delayedChannelOffset = (bearingRelativeAngleToSource > 0.0f) ? 1 : 0;
+    qint64 formulaNsecs = benchmarkTimer.nsecsElapsed();
+    benchmarkTimer.restart();
+
+    for (int iteration = 0; iteration < NUM_BENCHMARK_ITERATIONS; iteration++) {
+        for (int l = 0; l < NUM_BENCHMARK_LISTENERS; l++) {
+            for (int s = 0; s < NUM_BENCHMARK_SOURCES; s++) {
+                tableSum += _spatializer.spatialize(sources[s], listeners[l]).attenuationCoefficient;
+            }
+        }
+    }
+
+    qint64 tableNsecs = benchmarkTimer.nsecsElapsed();
+
+    for (int l = 0; l < NUM_BENCHMARK_LISTENERS; l++) {
+        for (int s = 0; s < NUM_BENCHMARK_SOURCES; s++) {
+            float attenuationError = fabsf(_spatializer.spatialize(sources[s], listeners[l]).attenuationCoefficient
+                - AudioSpatializer::spatializeWithFormulas(sources[s], listeners[l]).attenuationCoefficient);
+            maxAttenuationError = std::max(maxAttenuationError, attenuationError);
+        }
+    }
+
+    float numPairs = (float) NUM_BENCHMARK_ITERATIONS * NUM_BENCHMARK_LISTENERS * NUM_BENCHMARK_SOURCES;
+
+    qDebug("Spatialization of %d listeners x %d sources - formulas: %.1f ns/pair, tables: %.1f ns/pair,"
+           " max attenuation difference %f (sums %f, %f)", NUM_BENCHMARK_LISTENERS, NUM_BENCHMARK_SOURCES,
+           formulaNsecs / numPairs, tableNsecs / numPairs, maxAttenuationError, formulaSum, tableSum);
+}
+
+void AudioMixer::addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuffer* bufferToAdd,
+                                                          AvatarAudioRingBuffer* listeningNodeBuffer,
+                                                          int16_t* clientSamples) {
+    AudioMixerSpatialization spatialization = spatializationForBuffer(bufferToAdd, listeningNodeBuffer);
+
+    float attenuationCoefficient = spatialization.attenuationCoefficient;
+    float weakChannelAmplitudeRatio = spatialization.weakChannelAmplitudeRatio;
+    int numSamplesDelay = spatialization.numSamplesDelay;
+
+    int delayedChannelOffset = spatialization.isDelayedChannelRight ? 1 : 0;
     int goodChannelOffset = delayedChannelOffset == 0 ? 1 : 0;
 
     for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s += 2) {
         if ((s / 2) < numSamplesDelay) {
             // pull the earlier sample for the delayed channel
             int earlierSample = (*bufferToAdd)[(s / 2) - numSamplesDelay] * attenuationCoefficient * weakChannelAmplitudeRatio;
-            _clientSamples[s + delayedChannelOffset] = glm::clamp(_clientSamples[s + delayedChannelOffset] + earlierSample,
-                                                                    MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
+            clientSamples[s + delayedChannelOffset] = glm::clamp(clientSamples[s + delayedChannelOffset] + earlierSample,
+                                                                 MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
         }
 
         // pull the current sample for the good channel
         int16_t currentSample = (*bufferToAdd)[s / 2] * attenuationCoefficient;
-        _clientSamples[s + goodChannelOffset] = glm::clamp(_clientSamples[s + goodChannelOffset] + currentSample,
-                                                           MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
+        clientSamples[s + goodChannelOffset] = glm::clamp(clientSamples[s + goodChannelOffset] + currentSample,
+                                                          MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
 
         if ((s / 2) + numSamplesDelay < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL) {
             // place the current sample at the right spot in the delayed channel
-            int16_t clampedSample = glm::clamp((int) (_clientSamples[s + (numSamplesDelay * 2) + delayedChannelOffset]
+            int16_t clampedSample = glm::clamp((int) (clientSamples[s + (numSamplesDelay * 2) + delayedChannelOffset]
                                                + (currentSample * weakChannelAmplitudeRatio)),
                                                MIN_SAMPLE_VALUE, MAX_SAMPLE_VALUE);
-            _clientSamples[s + (numSamplesDelay * 2) + delayedChannelOffset] = clampedSample;
+            clientSamples[s + (numSamplesDelay * 2) + delayedChannelOffset] = clampedSample;
+        }
+    }
+}
+
+void AudioMixer::addSourceToMixForListener(const AudioMixerSource& source, const AudioMixerSpatialization& spatialization,
+                                           int32_t* leftChannel, int32_t* rightChannel, bool useScalarKernels) {
+    int32_t* delayedChannel = spatialization.isDelayedChannelRight ? rightChannel : leftChannel;
+    int32_t* goodChannel = spatialization.isDelayedChannelRight ? leftChannel : rightChannel;
+
+    // the source samples are preceded by PHASE_DELAY_AT_90 samples of history for the delayed channel
+    const int16_t* currentSamples = source.samples + PHASE_DELAY_AT_90;
+    const int16_t* delayedSamples = currentSamples - spatialization.numSamplesDelay;
+    float delayedChannelGain = spatialization.attenuationCoefficient * spatialization.weakChannelAmplitudeRatio;
+
+    if (useScalarKernels) {
+        AudioMixKernels::accumulateScaledSamplesScalar(goodChannel, currentSamples, spatialization.attenuationCoefficient,
+                                                       NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+        AudioMixKernels::accumulateScaledSamplesScalar(delayedChannel, delayedSamples, delayedChannelGain,
+                                                       NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+    } else {
+        AudioMixKernels::accumulateScaledSamples(goodChannel, currentSamples, spatialization.attenuationCoefficient,
+                                                 NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+        AudioMixKernels::accumulateScaledSamples(delayedChannel, delayedSamples, delayedChannelGain,
+                                                 NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+    }
+}
+
+void AudioMixer::collectMixedSourcesForListener(AudioMixerListener& listener,
+                                                std::vector<AudioMixerMixedSource>& mixedSources,
+                                                std::vector<int>& candidateSourceIndices) {
+    mixedSources.clear();
+    candidateSourceIndices.clear();
+
+    if (_isSourceGridActive) {
+        // only the sources in the cells around the listener can be loud enough to hear
+        _sourceGrid.findSourcesNear(listener.ringBuffer->getPosition(), candidateSourceIndices);
+        candidateSourceIndices.insert(candidateSourceIndices.end(),
+                                      _unbucketedSourceIndices.begin(), _unbucketedSourceIndices.end());
+    } else {
+        for (unsigned int i = 0; i < _frameSources.size(); i++) {
+            candidateSourceIndices.push_back(i);
+        }
+    }
+
+    int numCulledByThreshold = 0;
+
+    for (unsigned int i = 0; i < candidateSourceIndices.size(); i++) {
+        const AudioMixerSource& source = _frameSources[candidateSourceIndices[i]];
+
+        if (listener.clusterIndex != -1 && isFarFieldSourceForCluster(source, listener.clusterIndex)) {
+            // this source is already in the far-field mix of the listener's cluster
+            continue;
         }
+
+        if (source.node != listener.node.data() || source.ringBuffer->shouldLoopbackForNode()) {
+            AudioMixerMixedSource mixedSource;
+            mixedSource.source = &source;
+            mixedSource.spatialization = spatializationForBuffer(source.ringBuffer, listener.ringBuffer);
+            mixedSource.audibleLoudness = source.loudness * mixedSource.spatialization.attenuationCoefficient;
+
+            if (_audibilityThreshold > 0.0f && mixedSource.audibleLoudness < _audibilityThreshold) {
+                numCulledByThreshold++;
+            } else {
+                mixedSources.push_back(mixedSource);
+            }
+        }
+    }
+
+    int numCulledByBudget = 0;
+
+    if (_maxSourcesPerListener > 0 && (int) mixedSources.size() > _maxSourcesPerListener) {
+        // move the loudest sources to the front and drop the rest
+        std::nth_element(mixedSources.begin(), mixedSources.begin() + _maxSourcesPerListener, mixedSources.end());
+
+        numCulledByBudget = mixedSources.size() - _maxSourcesPerListener;
+        mixedSources.resize(_maxSourcesPerListener);
+    }
+
+    if (isCullingEnabled()) {
+        _numSourcesKept.fetchAndAddRelaxed(mixedSources.size());
+        _numSourcesCulledByDistance.fetchAndAddRelaxed(_frameSources.size() - candidateSourceIndices.size());
+        _numSourcesCulledByThreshold.fetchAndAddRelaxed(numCulledByThreshold);
+        _numSourcesCulledByBudget.fetchAndAddRelaxed(numCulledByBudget);
     }
 }
 
-void AudioMixer::prepareMixForListeningNode(Node* node) {
-    AvatarAudioRingBuffer* nodeRingBuffer = ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer();
+void AudioMixer::prepareMixForListener(AudioMixerListener& listener, std::vector<AudioMixerMixedSource>& mixedSources,
+                                       std::vector<int>& candidateSourceIndices) {
+    if (_useReferenceMix) {
+        // zero out the client mix for this node
+        memset(listener.clientSamples, 0, sizeof(listener.clientSamples));
+
+        for (unsigned int i = 0; i < _frameSources.size(); i++) {
+            const AudioMixerSource& source = _frameSources[i];
+
+            if (source.node != listener.node.data() || source.ringBuffer->shouldLoopbackForNode()) {
+                addBufferToMixForListeningNodeWithBuffer(source.ringBuffer, listener.ringBuffer, listener.clientSamples);
+            }
+        }
 
-    // zero out the client mix for this node
-    memset(_clientSamples, 0, sizeof(_clientSamples));
+        return;
+    }
 
-    // loop through all other nodes that have sufficient audio to mix
-    foreach (const SharedNodePointer& otherNode, NodeList::getInstance()->getNodeHash()) {
-        if (otherNode->getLinkedData()) {
+    collectMixedSourcesForListener(listener, mixedSources, candidateSourceIndices);
 
-            AudioMixerClientData* otherNodeClientData = (AudioMixerClientData*) otherNode->getLinkedData();
+    int32_t leftChannel[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+    int32_t rightChannel[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
 
-            // enumerate the ARBs attached to the otherNode and add all that should be added to mix
-            for (unsigned int i = 0; i < otherNodeClientData->getRingBuffers().size(); i++) {
-                PositionalAudioRingBuffer* otherNodeBuffer = otherNodeClientData->getRingBuffers()[i];
+    for (int pass = 0; pass < (_shouldVerifyMix ? 2 : 1); pass++) {
+        // the second pass (when verifying) re-mixes with the scalar kernels
+        bool useScalarKernels = (pass == 1);
 
-                if ((*otherNode != *node
-                     || otherNodeBuffer->shouldLoopbackForNode())
-                    && otherNodeBuffer->willBeAddedToMix()) {
-                    addBufferToMixForListeningNodeWithBuffer(otherNodeBuffer, nodeRingBuffer);
+        if (listener.clusterIndex != -1) {
+            // start from the far-field mix shared by the listener's cluster
+            memcpy(leftChannel, _frameClusters[listener.clusterIndex].farFieldLeft, sizeof(leftChannel));
+            memcpy(rightChannel, _frameClusters[listener.clusterIndex].farFieldRight, sizeof(rightChannel));
+        } else {
+            memset(leftChannel, 0, sizeof(leftChannel));
+            memset(rightChannel, 0, sizeof(rightChannel));
+        }
+
+        for (unsigned int i = 0; i < mixedSources.size(); i++) {
+            addSourceToMixForListener(*mixedSources[i].source, mixedSources[i].spatialization,
+                                      leftChannel, rightChannel, useScalarKernels);
+        }
+
+        if (!useScalarKernels) {
+            AudioMixKernels::saturateAndInterleave(leftChannel, rightChannel, listener.clientSamples,
+                                                   NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+        } else {
+            int16_t scalarSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+            AudioMixKernels::saturateAndInterleaveScalar(leftChannel, rightChannel, scalarSamples,
+                                                         NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+
+            if (memcmp(scalarSamples, listener.clientSamples, sizeof(scalarSamples)) != 0) {
+                _numMismatchedMixes.ref();
+            }
+        }
+    }
+}
+
+bool AudioMixer::isFarFieldSourceForCluster(const AudioMixerSource& source, int clusterIndex) const {
+    if (source.ringBuffer->getType() == PositionalAudioRingBuffer::Injector
+        && ((InjectedAudioRingBuffer*) source.ringBuffer)->getRadius() > 0.0f) {
+        // spherical sources are heard from their boundary, so they are always mixed per listener
+        return false;
+    }
+
+    if (source.listenerIndex != -1 && _frameListeners[source.listenerIndex].clusterIndex == clusterIndex
+        && !source.ringBuffer->shouldLoopbackForNode()) {
+        // one of the listeners in this cluster should not hear this source, so it can't be shared
+        return false;
+    }
+
+    glm::vec3 offsetFromCluster = source.ringBuffer->getPosition() - _frameClusters[clusterIndex].virtualListener.position;
+    return glm::dot(offsetFromCluster, offsetFromCluster) > _clusterNearFieldDistance * _clusterNearFieldDistance;
+}
+
+bool AudioMixer::isSourceAudibleInCluster(const AudioMixerSource& source, const AudioMixerSpatialization& spatialization,
+                                          float cellHalfDiagonal, int clusterIndex) const {
+    if (source.loudness * spatialization.attenuationCoefficient >= _audibilityThreshold) {
+        return true;
+    }
+
+    // a listener at the edge of the cell can be up to the half diagonal closer to the source than the center is, and
+    // attenuation is never more than the distance coefficient, so this is the loudest any of them could hear it
+    glm::vec3 offsetFromCluster = source.ringBuffer->getPosition() - _frameClusters[clusterIndex].virtualListener.position;
+    float nearestDistance = std::max(glm::length(offsetFromCluster) - cellHalfDiagonal, 0.0f);
+    return source.loudness * _spatializer.distanceCoefficient(nearestDistance * nearestDistance) >= _audibilityThreshold;
+}
+
+void AudioMixer::prepareFarFieldMixes(int firstClusterIndex, int stride) {
+    std::vector<int> candidateSourceIndices;
+
+    // every listener in a cluster is within this distance of the cluster's virtual listener
+    float cellHalfDiagonal = _clusterCellSize * SQUARE_ROOT_OF_3 / 2.0f;
+
+    for (unsigned int c = firstClusterIndex; c < _frameClusters.size(); c += stride) {
+        AudioMixerCluster& cluster = _frameClusters[c];
+
+        memset(cluster.farFieldLeft, 0, sizeof(cluster.farFieldLeft));
+        memset(cluster.farFieldRight, 0, sizeof(cluster.farFieldRight));
+
+        candidateSourceIndices.clear();
+
+        if (_isSourceGridActive) {
+            // a source any listener in the cluster can hear is within the half diagonal of the cell of where it can be
+            // heard from the center
+            _sourceGrid.findSourcesNear(cluster.virtualListener.position, candidateSourceIndices, cellHalfDiagonal);
+            candidateSourceIndices.insert(candidateSourceIndices.end(),
+                                          _unbucketedSourceIndices.begin(), _unbucketedSourceIndices.end());
+        } else {
+            for (unsigned int i = 0; i < _frameSources.size(); i++) {
+                candidateSourceIndices.push_back(i);
+            }
+        }
+
+        int numFarFieldSourcesMixed = 0;
+
+        for (unsigned int i = 0; i < candidateSourceIndices.size(); i++) {
+            const AudioMixerSource& source = _frameSources[candidateSourceIndices[i]];
+
+            if (isFarFieldSourceForCluster(source, c)) {
+                AudioMixerSpatialization spatialization = _spatializer.spatialize(spatialSourceForBuffer(source.ringBuffer),
+                                                                                  cluster.virtualListener);
+
+                if (_audibilityThreshold <= 0.0f || isSourceAudibleInCluster(source, spatialization, cellHalfDiagonal, c)) {
+                    addSourceToMixForListener(source, spatialization, cluster.farFieldLeft, cluster.farFieldRight, false);
+                    numFarFieldSourcesMixed++;
                 }
             }
         }
+
+        _numFarFieldSourcesMixed.fetchAndAddRelaxed(numFarFieldSourcesMixed);
     }
 }
 
+void AudioMixer::runWorkerJob(int firstIndex, int stride) {
+    if (_workerPhase == FarFieldPhase) {
+        prepareFarFieldMixes(firstIndex, stride);
+    } else {
+        prepareMixesForListeners(firstIndex, stride);
+    }
+}
+
+void AudioMixer::prepareMixesForListeners(int firstListenerIndex, int stride) {
+    // scratch space re-used for every listener this call mixes
+    std::vector<AudioMixerMixedSource> mixedSources;
+    std::vector<int> candidateSourceIndices;
+
+    for (unsigned int i = firstListenerIndex; i < _frameListeners.size(); i += stride) {
+        prepareMixForListener(_frameListeners[i], mixedSources, candidateSourceIndices);
+    }
+}
+
+void AudioMixer::prepareFrame(const NodeHash& nodeHash) {
+    _frameSources.clear();
+    _frameListeners.clear();
+
+    foreach (const SharedNodePointer& node, nodeHash) {
+        AudioMixerClientData* nodeClientData = (AudioMixerClientData*) node->getLinkedData();
+
+        if (!nodeClientData) {
+            continue;
+        }
+
+        // enumerate the ARBs attached to the node and grab all that should be added to the mix
+        const std::vector<PositionalAudioRingBuffer*>& ringBuffers = nodeClientData->getRingBuffers();
+        unsigned int firstNodeSourceIndex = _frameSources.size();
+
+        for (unsigned int i = 0; i < ringBuffers.size(); i++) {
+            PositionalAudioRingBuffer* ringBuffer = ringBuffers[i];
+
+            if (ringBuffer->willBeAddedToMix()) {
+                _frameSources.resize(_frameSources.size() + 1);
+                AudioMixerSource& source = _frameSources.back();
+
+                source.node = node.data();
+                source.ringBuffer = ringBuffer;
+                source.listenerIndex = -1;
+
+                // copy the samples for this frame, and the history needed for the delayed channel, out of the ring
+                ringBuffer->readFrameForMix(source.samples, PHASE_DELAY_AT_90);
+
+                int totalAmplitude = 0;
+                for (int s = PHASE_DELAY_AT_90; s < PHASE_DELAY_AT_90 + NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL; s++) {
+                    totalAmplitude += abs(source.samples[s]);
+                }
+
+                source.loudness = totalAmplitude / (float) NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+
+                if (totalAmplitude == 0) {
+                    int historyAmplitude = 0;
+                    for (int s = 0; s < PHASE_DELAY_AT_90; s++) {
+                        historyAmplitude += abs(source.samples[s]);
+                    }
+
+                    if (historyAmplitude == 0) {
+                        // a silent source (usually one that sent silent frames) adds nothing to any mix
+                        _frameSources.pop_back();
+                        _numSilentSourcesSkipped++;
+                    }
+                }
+            }
+        }
+
+        AvatarAudioRingBuffer* nodeRingBuffer = nodeClientData->getAvatarAudioRingBuffer();
+
+        if (node->getType() == NodeType::Agent && node->getActiveSocket() && nodeRingBuffer) {
+            _frameListeners.resize(_frameListeners.size() + 1);
+            AudioMixerListener& listener = _frameListeners.back();
+
+            listener.node = node;
+            listener.ringBuffer = nodeRingBuffer;
+            listener.clusterIndex = -1;
+
+            // remember which listener these sources belong to, so clusters know who shouldn't hear them
+            for (unsigned int i = firstNodeSourceIndex; i < _frameSources.size(); i++) {
+                _frameSources[i].listenerIndex = _frameListeners.size() - 1;
+            }
+        }
+    }
+
+    buildSourceGrid();
+    buildListenerClusters();
+}
+
+int clusterKeyField(int value) {
+    return glm::clamp(value, -CLUSTER_KEY_FIELD_OFFSET, CLUSTER_KEY_FIELD_OFFSET - 1) + CLUSTER_KEY_FIELD_OFFSET;
+}
+
+void AudioMixer::buildListenerClusters() {
+    _frameClusters.clear();
+    _listenerClusterKeys.clear();
+
+    _numClusters = 0;
+    _numClusteredListeners = 0;
+
+    if (_clusterMixTolerance <= 0.0f || _useReferenceMix) {
+        return;
+    }
+
+    float yawBucketWidth = PI_TIMES_TWO / _numClusterYawBuckets;
+
+    for (unsigned int i = 0; i < _frameListeners.size(); i++) {
+        const glm::vec3& position = _frameListeners[i].ringBuffer->getPosition();
+
+        // the yaw of the listener is the heading of their -z axis about the y-axis
+        glm::vec3 front = _frameListeners[i].ringBuffer->getOrientation() * glm::vec3(0.0f, 0.0f, -1.0f);
+        float yaw = atan2f(-front.x, -front.z);
+        int yawBucket = (int) floorf((yaw + PIE) / yawBucketWidth) % _numClusterYawBuckets;
+
+        quint64 clusterKey = ((quint64) clusterKeyField((int) floorf(position.x / _clusterCellSize)) << 48)
+            | ((quint64) clusterKeyField((int) floorf(position.y / _clusterCellSize)) << 32)
+            | ((quint64) clusterKeyField((int) floorf(position.z / _clusterCellSize)) << 16)
+            | (quint64) glm::max(yawBucket, 0);
+
+        _listenerClusterKeys.push_back(std::pair<quint64, int>(clusterKey, i));
+    }
+
+    // sorting puts the listeners that share a cell and a yaw bucket next to each other
+    std::sort(_listenerClusterKeys.begin(), _listenerClusterKeys.end());
+
+    unsigned int runStart = 0;
+
+    while (runStart < _listenerClusterKeys.size()) {
+        unsigned int runEnd = runStart + 1;
+
+        while (runEnd < _listenerClusterKeys.size() && _listenerClusterKeys[runEnd].first == _listenerClusterKeys[runStart].first) {
+            runEnd++;
+        }
+
+        if (runEnd - runStart > 1) {
+            // there is no point sharing a mix with one listener, so only groups become clusters
+            quint64 clusterKey = _listenerClusterKeys[runStart].first;
+            int cellX = (int) ((clusterKey >> 48) & 0xFFFF) - CLUSTER_KEY_FIELD_OFFSET;
+            int cellY = (int) ((clusterKey >> 32) & 0xFFFF) - CLUSTER_KEY_FIELD_OFFSET;
+            int cellZ = (int) ((clusterKey >> 16) & 0xFFFF) - CLUSTER_KEY_FIELD_OFFSET;
+            int yawBucket = (int) (clusterKey & 0xFFFF);
+
+            _frameClusters.resize(_frameClusters.size() + 1);
+            AudioMixerCluster& cluster = _frameClusters.back();
+
+            // the shared mix is heard from the center of the cell, facing the center of the yaw bucket
+            float bucketYaw = -PIE + ((yawBucket + 0.5f) * yawBucketWidth);
+            cluster.virtualListener.position = (glm::vec3(cellX, cellY, cellZ) + glm::vec3(0.5f)) * _clusterCellSize;
+            cluster.virtualListener.orientation = glm::quat(cosf(bucketYaw / 2.0f), 0.0f, sinf(bucketYaw / 2.0f), 0.0f);
+            cluster.virtualListener.radius = 0.0f;
+            cluster.virtualListener.attenuationRatio = 1.0f;
+
+            for (unsigned int i = runStart; i < runEnd; i++) {
+                _frameListeners[_listenerClusterKeys[i].second].clusterIndex = _frameClusters.size() - 1;
+            }
+
+            _numClusteredListeners += runEnd - runStart;
+        }
+
+        runStart = runEnd;
+    }
+
+    _numClusters = _frameClusters.size();
+}
+
+void AudioMixer::buildSourceGrid() {
+    _isSourceGridActive = false;
+
+    if (_audibilityThreshold <= 0.0f || _frameSources.empty()) {
+        // without a threshold there is no distance past which a source can't be heard
+        return;
+    }
+
+    float maxLoudness = 0.0f;
+    for (unsigned int i = 0; i < _frameSources.size(); i++) {
+        maxLoudness = std::max(maxLoudness, _frameSources[i].loudness);
+    }
+
+    // attenuation is never more than the distance coefficient, so no source can be heard further out than where
+    // the distance coefficient takes the loudest source down to the threshold
+    float maxAudibleDistance = AudioSpatializer::distanceForCoefficient(_audibilityThreshold / maxLoudness);
+
+    _sourceGrid.reset(std::max(maxAudibleDistance, MIN_SOURCE_GRID_CELL_SIZE));
+    _unbucketedSourceIndices.clear();
+
+    for (unsigned int i = 0; i < _frameSources.size(); i++) {
+        PositionalAudioRingBuffer* ringBuffer = _frameSources[i].ringBuffer;
+
+        if (ringBuffer->getType() == PositionalAudioRingBuffer::Injector
+            && ((InjectedAudioRingBuffer*) ringBuffer)->getRadius() > 0.0f) {
+            // spherical sources are heard from their boundary, so they are checked by every listener
+            _unbucketedSourceIndices.push_back(i);
+        } else {
+            _sourceGrid.insert(i, ringBuffer->getPosition());
+        }
+    }
+
+    _sourceGrid.finalize();
+    _isSourceGridActive = true;
+}
+
+void AudioMixer::runWorkerPhase() {
+    if (_useReferenceMix || _workerJobs.size() <= 1) {
+        // run the whole phase right here on the mixer thread
+        runWorkerJob(0, 1);
+    } else {
+        for (unsigned int i = 0; i < _workerJobs.size(); i++) {
+            _workerPool.start(_workerJobs[i]);
+        }
+
+        // block until every job has released the semaphore for this phase
+        _finishedJobsSemaphore.acquire(_workerJobs.size());
+    }
+}
+
+void AudioMixer::prepareMixesForFrame() {
+    if (!_frameClusters.empty()) {
+        // the far-field mixes have to be ready before any listener in a cluster is mixed
+        _workerPhase = FarFieldPhase;
+        runWorkerPhase();
+    }
+
+    _workerPhase = ListenerPhase;
+    runWorkerPhase();
+}
+
+bool AudioMixer::isSilentMix(const int16_t* clientSamples) {
+    for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_STEREO; s++) {
+        if (clientSamples[s] != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void AudioMixer::logJitterBufferStats(const NodeHash& nodeHash) {
+    const float SAMPLES_PER_MSEC = SAMPLE_RATE / 1000.0f;
+
+    foreach (const SharedNodePointer& node, nodeHash) {
+        AudioMixerClientData* nodeClientData = (AudioMixerClientData*) node->getLinkedData();
+
+        if (nodeClientData) {
+            const std::vector<PositionalAudioRingBuffer*>& ringBuffers = nodeClientData->getRingBuffers();
+
+            for (unsigned int i = 0; i < ringBuffers.size(); i++) {
+                PositionalAudioRingBuffer* ringBuffer = ringBuffers[i];
+
+                qDebug() << "Jitter buffer for" << uuidStringWithoutCurlyBraces(node->getUUID())
+                    << (ringBuffer->getType() == PositionalAudioRingBuffer::Microphone ? "microphone" : "injector")
+                    << "- target ms:" << ringBuffer->getTargetJitterBufferSamples() / SAMPLES_PER_MSEC
+                    << "buffered ms:" << ringBuffer->samplesAvailable() / SAMPLES_PER_MSEC
+                    << "jitter ms:" << ringBuffer->getMeasuredJitterUsecs() / 1000.0f
+                    << "compressed:" << ringBuffer->getNumCompressedSamples()
+                    << "stretched:" << ringBuffer->getNumStretchedSamples()
+                    << "overflowed:" << ringBuffer->getNumOverflowedSamples();
+            }
+        }
+    }
+}
 
 void AudioMixer::readPendingDatagrams() {
     QByteArray receivedPacket;
@@ -218,6 +858,7 @@ void AudioMixer::readPendingDatagrams() {
             PacketType mixerPacketType = packetTypeForPacket(receivedPacket);
             if (mixerPacketType == PacketTypeMicrophoneAudioNoEcho
                 || mixerPacketType == PacketTypeMicrophoneAudioWithEcho
+                || mixerPacketType == PacketTypeSilentAudioFrame
                 || mixerPacketType == PacketTypeInjectAudio) {
                 
                 nodeList->findNodeAndUpdateWithDataFromPacket(receivedPacket);
@@ -239,11 +880,26 @@ void AudioMixer::run() {
 
     nodeList->linkedDataCreateCallback = attachNewBufferToNode;
 
+    parsePayload();
+
+    // setup the fixed pool of workers that will prepare the listener mixes, one job per worker
+    _workerPool.setMaxThreadCount(_numWorkerThreads);
+    _workerPool.setExpiryTimeout(-1);
+
+    for (int i = 0; i < _numWorkerThreads; i++) {
+        _workerJobs.push_back(new AudioMixerJob(this, i, _numWorkerThreads, &_finishedJobsSemaphore));
+    }
+
     int nextFrame = 0;
     timeval startTime;
 
     gettimeofday(&startTime, NULL);
 
+    // listeners whose mix is all zeros are sent the number of silent samples instead of the samples themselves
+    QByteArray silentFramePacket = byteArrayWithPopluatedHeader(PacketTypeSilentAudioFrame);
+    quint16 numSilentSamples = NETWORK_BUFFER_LENGTH_SAMPLES_STEREO;
+    silentFramePacket.append(reinterpret_cast<const char*>(&numSilentSamples), sizeof(numSilentSamples));
+
     int numBytesPacketHeader = numBytesForPacketHeaderGivenPacketType(PacketTypeMixedAudio);
     // note: Visual Studio 2010 doesn't support variable sized local arrays
     #ifdef _WIN32
@@ -255,35 +911,97 @@ void AudioMixer::run() {
 
     while (!_isFinished) {
 
+        quint64 frameStartUsecs = usecTimestampNow();
+
         QCoreApplication::processEvents();
 
         if (_isFinished) {
             break;
         }
 
-        foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+        if (_datagramReceiver) {
+            readPendingDatagrams();
+        }
+
+        // hold one snapshot of the nodes for the whole frame
+        NodeSnapshotPointer nodeSnapshot = nodeList->getNodeSnapshot();
+        const NodeHash& nodeHash = nodeSnapshot->getNodeHash();
+
+        foreach (const SharedNodePointer& node, nodeHash) {
             if (node->getLinkedData()) {
-                ((AudioMixerClientData*) node->getLinkedData())->checkBuffersBeforeFrameSend(JITTER_BUFFER_SAMPLES);
+                ((AudioMixerClientData*) node->getLinkedData())->checkBuffersBeforeFrameSend(JITTER_BUFFER_SAMPLES,
+                                                                                              _isJitterBufferAdaptive);
             }
         }
 
-        foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
-            if (node->getType() == NodeType::Agent && node->getActiveSocket() && node->getLinkedData()
-                && ((AudioMixerClientData*) node->getLinkedData())->getAvatarAudioRingBuffer()) {
-                prepareMixForListeningNode(node.data());
+        prepareFrame(nodeHash);
+        prepareMixesForFrame();
+
+        // the socket belongs to this thread, so the prepared mixes are sent from here - in batches, if they are enabled
+        nodeList->beginDatagramBatch();
+
+        for (unsigned int i = 0; i < _frameListeners.size(); i++) {
+            AudioMixerListener& listener = _frameListeners[i];
 
-                memcpy(clientPacket + numBytesPacketHeader, _clientSamples, sizeof(_clientSamples));
-                nodeList->writeDatagram((char*) clientPacket, sizeof(clientPacket), node);
+            if (isSilentMix(listener.clientSamples)) {
+                nodeList->writeDatagram(silentFramePacket, listener.node);
+                _numSilentMixesSent++;
+            } else {
+                memcpy(clientPacket + numBytesPacketHeader, listener.clientSamples, sizeof(listener.clientSamples));
+                nodeList->writeDatagram((char*) clientPacket, sizeof(clientPacket), listener.node);
             }
         }
 
+        nodeList->endDatagramBatch();
+
         // push forward the next output pointers for any audio buffers we used
-        foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+        foreach (const SharedNodePointer& node, nodeHash) {
             if (node->getLinkedData()) {
                 ((AudioMixerClientData*) node->getLinkedData())->pushBuffersAfterFrameSend();
             }
         }
 
+        if (nextFrame % MIX_STATS_REPORT_INTERVAL_FRAMES == 0) {
+            if (_shouldVerifyMix) {
+                qDebug() << "AudioMixer vectorized mix mismatched the scalar mix"
+                    << _numMismatchedMixes.fetchAndStoreOrdered(0)
+                    << "times in the last" << MIX_STATS_REPORT_INTERVAL_FRAMES << "frames.";
+            }
+
+            if (_clusterMixTolerance > 0.0f) {
+                qDebug() << "AudioMixer clusters - listeners clustered:" << _numClusteredListeners
+                    << "clusters:" << _numClusters << "far-field sources mixed per frame:"
+                    << _numFarFieldSourcesMixed.fetchAndStoreOrdered(0) / (float) MIX_STATS_REPORT_INTERVAL_FRAMES;
+            }
+
+            if (_verboseDebug) {
+                qDebug() << "AudioMixer silent sources skipped:" << _numSilentSourcesSkipped
+                    << "silent mixes sent:" << _numSilentMixesSent << "in the last" << MIX_STATS_REPORT_INTERVAL_FRAMES
+                    << "frames.";
+            }
+            _numSilentSourcesSkipped = 0;
+            _numSilentMixesSent = 0;
+
+            if (_shouldLogJitterBufferStats) {
+                logJitterBufferStats(nodeHash);
+            }
+
+            logDatagramQueueStats();
+
+            if (isCullingEnabled()) {
+                qDebug() << "AudioMixer sources per frame - kept:"
+                    << _numSourcesKept.fetchAndStoreOrdered(0) / (float) MIX_STATS_REPORT_INTERVAL_FRAMES
+                    << "cut by distance:"
+                    << _numSourcesCulledByDistance.fetchAndStoreOrdered(0) / (float) MIX_STATS_REPORT_INTERVAL_FRAMES
+                    << "cut by threshold:"
+                    << _numSourcesCulledByThreshold.fetchAndStoreOrdered(0) / (float) MIX_STATS_REPORT_INTERVAL_FRAMES
+                    << "cut by budget:"
+                    << _numSourcesCulledByBudget.fetchAndStoreOrdered(0) / (float) MIX_STATS_REPORT_INTERVAL_FRAMES;
+            }
+        }
+
+        recordFrameTime(usecTimestampNow() - frameStartUsecs);
+
         int usecToSleep = usecTimestamp(&startTime) + (++nextFrame * BUFFER_SEND_INTERVAL_USECS) - usecTimestampNow();
 
         if (usecToSleep > 0) {
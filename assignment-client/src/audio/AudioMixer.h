@@ -9,33 +9,181 @@
 #ifndef __hifi__AudioMixer__
 #define __hifi__AudioMixer__
 
+#include <vector>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+
 #include <AudioRingBuffer.h>
 
 #include <ThreadedAssignment.h>
 
+#include "AudioSourceGrid.h"
+#include "AudioSpatializer.h"
+
 class PositionalAudioRingBuffer;
 class AvatarAudioRingBuffer;
+class AudioMixerJob;
+
+/// a buffer that will be added to the mix this frame, copied out of its ring once so every listener reads contiguous samples
+struct AudioMixerSource {
+    Node* node;
+    PositionalAudioRingBuffer* ringBuffer;
+    int listenerIndex;
+    float loudness;
+    int16_t samples[PHASE_DELAY_AT_90 + NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+};
+
+/// a node that will be sent a mix this frame, and the mix that is prepared for it
+struct AudioMixerListener {
+    SharedNodePointer node;
+    AvatarAudioRingBuffer* ringBuffer;
+    int clusterIndex;
+    int16_t clientSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+};
+
+/// listeners in the same cell, facing the same way, share one mix of the sources that are far from all of them
+struct AudioMixerCluster {
+    AudioSpatialSource virtualListener;
+    int32_t farFieldLeft[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+    int32_t farFieldRight[NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL];
+};
+
+/// a source that made it into a listener's mix, and how loud it is for that listener
+struct AudioMixerMixedSource {
+    const AudioMixerSource* source;
+    AudioMixerSpatialization spatialization;
+    float audibleLoudness;
+
+    /// orders louder sources first
+    bool operator<(const AudioMixerMixedSource& otherSource) const { return audibleLoudness > otherSource.audibleLoudness; }
+};
 
 /// Handles assignments of type AudioMixer - mixing streams of audio and re-distributing to various clients.
 class AudioMixer : public ThreadedAssignment {
     Q_OBJECT
 public:
     AudioMixer(const QByteArray& packet);
+    ~AudioMixer();
+
+    /// runs the work for the current phase of the frame on every stride-th item from firstIndex on - called by the worker pool
+    void runWorkerJob(int firstIndex, int stride);
 public slots:
     /// threaded run of assignment
     void run();
-    
+
     void readPendingDatagrams();
 private:
-    /// adds one buffer to the mix for a listening node
+    /// reads the mixer options passed in the assignment payload
+    void parsePayload();
+
+    /// collects the buffers that will be mixed and the nodes that will be sent a mix this frame
+    void prepareFrame(const NodeHash& nodeHash);
+
+    /// buckets this frame's sources by position, when an audibility threshold bounds how far they can be heard
+    void buildSourceGrid();
+
+    /// groups this frame's listeners into clusters that share a far-field mix
+    void buildListenerClusters();
+
+    /// true when the source is far enough from the cluster to be mixed once for every listener in it
+    bool isFarFieldSourceForCluster(const AudioMixerSource& source, int clusterIndex) const;
+
+    /// true when some listener in the cluster, all of them within cellHalfDiagonal of its center, could hear the source
+    bool isSourceAudibleInCluster(const AudioMixerSource& source, const AudioMixerSpatialization& spatialization,
+                                  float cellHalfDiagonal, int clusterIndex) const;
+
+    /// prepares the far-field mix for every stride-th cluster from firstClusterIndex on
+    void prepareFarFieldMixes(int firstClusterIndex, int stride);
+
+    /// prepares the mix for every stride-th listener from firstListenerIndex on
+    void prepareMixesForListeners(int firstListenerIndex, int stride);
+
+    /// runs the current phase of the frame on the worker pool and waits for it to finish
+    void runWorkerPhase();
+
+    /// prepares the mixes for all listeners of this frame, spread across the worker pool
+    void prepareMixesForFrame();
+
+    /// true when every sample of the mix is zero, so a silent frame can be sent instead
+    static bool isSilentMix(const int16_t* clientSamples);
+
+    /// logs the depth and measured jitter of every stream the mixer is receiving
+    void logJitterBufferStats(const NodeHash& nodeHash);
+
+    /// times the spatialization formulas against the spatializer tables and logs the cost per source/listener pair
+    void benchmarkSpatialization();
+
+    /// calculates the attenuation, phase delay and weak channel ratio for one buffer heard by one listener
+    AudioMixerSpatialization spatializationForBuffer(PositionalAudioRingBuffer* bufferToAdd,
+                                                     AvatarAudioRingBuffer* listeningNodeBuffer);
+
+    /// adds one buffer to the mix for a listening node, clamping every sample - kept as the reference mix
     void addBufferToMixForListeningNodeWithBuffer(PositionalAudioRingBuffer* bufferToAdd,
-                                                  AvatarAudioRingBuffer* listeningNodeBuffer);
-    
-    /// prepares and sends a mix to one Node
-    void prepareMixForListeningNode(Node* node);
-    
-    
-    int16_t _clientSamples[NETWORK_BUFFER_LENGTH_SAMPLES_STEREO];
+                                                  AvatarAudioRingBuffer* listeningNodeBuffer,
+                                                  int16_t* clientSamples);
+
+    /// adds one source to the int32 planar accumulators for a listener
+    void addSourceToMixForListener(const AudioMixerSource& source, const AudioMixerSpatialization& spatialization,
+                                   int32_t* leftChannel, int32_t* rightChannel, bool useScalarKernels);
+
+    /// finds the sources that will be mixed for one listener, leaving out those that are culled
+    void collectMixedSourcesForListener(AudioMixerListener& listener, std::vector<AudioMixerMixedSource>& mixedSources,
+                                        std::vector<int>& candidateSourceIndices);
+
+    /// prepares a mix for one listener, using the passed vectors as scratch space
+    void prepareMixForListener(AudioMixerListener& listener, std::vector<AudioMixerMixedSource>& mixedSources,
+                               std::vector<int>& candidateSourceIndices);
+
+    bool isCullingEnabled() const { return _audibilityThreshold > 0.0f || _maxSourcesPerListener > 0; }
+
+    AudioSpatializer _spatializer;
+
+    bool _useReferenceMix;
+    bool _shouldVerifyMix;
+    bool _verboseDebug;
+    int _numWorkerThreads;
+    QThreadPool _workerPool;
+    QSemaphore _finishedJobsSemaphore;
+    std::vector<AudioMixerJob*> _workerJobs;
+    QAtomicInt _numMismatchedMixes;
+
+    int _numSilentSourcesSkipped;
+    int _numSilentMixesSent;
+
+    bool _isJitterBufferAdaptive;
+    bool _shouldLogJitterBufferStats;
+
+    float _audibilityThreshold;
+    int _maxSourcesPerListener;
+    AudioSourceGrid _sourceGrid;
+    bool _isSourceGridActive;
+    std::vector<int> _unbucketedSourceIndices;
+    QAtomicInt _numSourcesKept;
+    QAtomicInt _numSourcesCulledByDistance;
+    QAtomicInt _numSourcesCulledByThreshold;
+    QAtomicInt _numSourcesCulledByBudget;
+
+    enum WorkerPhase {
+        FarFieldPhase,
+        ListenerPhase
+    };
+
+    WorkerPhase _workerPhase;
+
+    float _clusterMixTolerance;
+    float _clusterCellSize;
+    float _clusterNearFieldDistance;
+    int _numClusterYawBuckets;
+    std::vector<std::pair<quint64, int> > _listenerClusterKeys;
+    std::vector<AudioMixerCluster> _frameClusters;
+    QAtomicInt _numFarFieldSourcesMixed;
+    int _numClusteredListeners;
+    int _numClusters;
+
+    std::vector<AudioMixerSource> _frameSources;
+    std::vector<AudioMixerListener> _frameListeners;
 };
 
 #endif /* defined(__hifi__AudioMixer__) */
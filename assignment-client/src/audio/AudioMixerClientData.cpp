@@ -11,6 +11,8 @@
 
 #include "InjectedAudioRingBuffer.h"
 
+#include "AudioSpatializer.h"
+
 #include "AudioMixerClientData.h"
 
 AudioMixerClientData::~AudioMixerClientData() {
@@ -34,7 +36,8 @@ AvatarAudioRingBuffer* AudioMixerClientData::getAvatarAudioRingBuffer() const {
 int AudioMixerClientData::parseData(const QByteArray& packet) {
     PacketType packetType = packetTypeForPacket(packet);
     if (packetType == PacketTypeMicrophoneAudioWithEcho
-        || packetType == PacketTypeMicrophoneAudioNoEcho) {
+        || packetType == PacketTypeMicrophoneAudioNoEcho
+        || packetType == PacketTypeSilentAudioFrame) {
 
         // grab the AvatarAudioRingBuffer from the vector (or create it if it doesn't exist)
         AvatarAudioRingBuffer* avatarRingBuffer = getAvatarAudioRingBuffer();
@@ -42,6 +45,7 @@ int AudioMixerClientData::parseData(const QByteArray& packet) {
         if (!avatarRingBuffer) {
             // we don't have an AvatarAudioRingBuffer yet, so add it
             avatarRingBuffer = new AvatarAudioRingBuffer();
+            avatarRingBuffer->setNumHistorySamples(PHASE_DELAY_AT_90);
             _ringBuffers.push_back(avatarRingBuffer);
         }
 
@@ -65,6 +69,7 @@ int AudioMixerClientData::parseData(const QByteArray& packet) {
         if (!matchingInjectedRingBuffer) {
             // we don't have a matching injected audio ring buffer, so add it
             matchingInjectedRingBuffer = new InjectedAudioRingBuffer(streamIdentifier);
+            matchingInjectedRingBuffer->setNumHistorySamples(PHASE_DELAY_AT_90);
             _ringBuffers.push_back(matchingInjectedRingBuffer);
         }
 
@@ -74,8 +79,10 @@ int AudioMixerClientData::parseData(const QByteArray& packet) {
     return 0;
 }
 
-void AudioMixerClientData::checkBuffersBeforeFrameSend(int jitterBufferLengthSamples) {
+void AudioMixerClientData::checkBuffersBeforeFrameSend(int jitterBufferLengthSamples, bool isJitterBufferAdaptive) {
     for (unsigned int i = 0; i < _ringBuffers.size(); i++) {
+        _ringBuffers[i]->setIsJitterBufferAdaptive(isJitterBufferAdaptive);
+
         if (_ringBuffers[i]->shouldBeAddedToMix(jitterBufferLengthSamples)) {
             // this is a ring buffer that is ready to go
             // set its flag so we know to push its buffer when all is said and done
@@ -90,7 +97,8 @@ void AudioMixerClientData::pushBuffersAfterFrameSend() {
         PositionalAudioRingBuffer* audioBuffer = _ringBuffers[i];
 
         if (audioBuffer->willBeAddedToMix()) {
-            audioBuffer->shiftReadPosition(NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL);
+            // the jitter buffer may have compressed or stretched this frame out of more or fewer samples
+            audioBuffer->shiftReadPosition(audioBuffer->getNumFrameSamplesToRead());
 
             audioBuffer->setWillBeAddedToMix(false);
         } else if (audioBuffer->getType() == PositionalAudioRingBuffer::Injector
@@ -0,0 +1,90 @@
+//
+//  AudioSourceGrid.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <algorithm>
+#include <math.h>
+
+#include "AudioSourceGrid.h"
+
+// each cell coordinate is packed into 21 bits of the cell key
+const int CELL_COORDINATE_BITS = 21;
+const int CELL_COORDINATE_OFFSET = 1 << (CELL_COORDINATE_BITS - 1);
+const int MAX_CELL_COORDINATE = CELL_COORDINATE_OFFSET - 1;
+
+AudioSourceGrid::AudioSourceGrid() :
+    _cellSize(1.0f),
+    _entries()
+{
+
+}
+
+void AudioSourceGrid::reset(float cellSize) {
+    _cellSize = cellSize;
+    _entries.clear();
+}
+
+int AudioSourceGrid::cellCoordinate(float value) const {
+    float cell = floorf(value / _cellSize);
+
+    // anything that far out shares the edge cells, which only costs extra candidates
+    if (cell < -CELL_COORDINATE_OFFSET) {
+        return -CELL_COORDINATE_OFFSET;
+    } else if (cell > MAX_CELL_COORDINATE) {
+        return MAX_CELL_COORDINATE;
+    } else {
+        return (int) cell;
+    }
+}
+
+quint64 AudioSourceGrid::keyForCell(int x, int y, int z) const {
+    return ((quint64) (x + CELL_COORDINATE_OFFSET) << (CELL_COORDINATE_BITS * 2))
+        | ((quint64) (y + CELL_COORDINATE_OFFSET) << CELL_COORDINATE_BITS)
+        | (quint64) (z + CELL_COORDINATE_OFFSET);
+}
+
+void AudioSourceGrid::insert(int sourceIndex, const glm::vec3& position) {
+    Entry newEntry;
+    newEntry.cellKey = keyForCell(cellCoordinate(position.x), cellCoordinate(position.y), cellCoordinate(position.z));
+    newEntry.sourceIndex = sourceIndex;
+
+    _entries.push_back(newEntry);
+}
+
+void AudioSourceGrid::finalize() {
+    // sorting by cell key puts every cell's sources next to each other so a cell is found with a binary search
+    std::sort(_entries.begin(), _entries.end());
+}
+
+void AudioSourceGrid::findSourcesNear(const glm::vec3& position, std::vector<int>& sourceIndices,
+                                      float extraDistance) const {
+    int centerX = cellCoordinate(position.x);
+    int centerY = cellCoordinate(position.y);
+    int centerZ = cellCoordinate(position.z);
+
+    // one ring of cells covers cellSize, and each further ring another cellSize of the extra distance
+    int rings = 1 + (int) ceilf(std::max(extraDistance, 0.0f) / _cellSize);
+
+    for (int x = std::max(centerX - rings, -CELL_COORDINATE_OFFSET); x <= std::min(centerX + rings, MAX_CELL_COORDINATE);
+         x++) {
+        for (int y = std::max(centerY - rings, -CELL_COORDINATE_OFFSET);
+             y <= std::min(centerY + rings, MAX_CELL_COORDINATE); y++) {
+            for (int z = std::max(centerZ - rings, -CELL_COORDINATE_OFFSET);
+                 z <= std::min(centerZ + rings, MAX_CELL_COORDINATE); z++) {
+                Entry cellEntry;
+                cellEntry.cellKey = keyForCell(x, y, z);
+
+                std::vector<Entry>::const_iterator entry = std::lower_bound(_entries.begin(), _entries.end(), cellEntry);
+
+                while (entry != _entries.end() && entry->cellKey == cellEntry.cellKey) {
+                    sourceIndices.push_back(entry->sourceIndex);
+                    ++entry;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,53 @@
+//
+//  AudioSourceGrid.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#ifndef __hifi__AudioSourceGrid__
+#define __hifi__AudioSourceGrid__
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <QtCore/QtGlobal>
+
+/// Buckets audio source positions into a uniform grid so the sources near a listener can be found without a full scan.
+/// The grid is rebuilt every frame and re-uses its storage, so it does not allocate once it has grown to the source count.
+class AudioSourceGrid {
+public:
+    AudioSourceGrid();
+
+    /// empties the grid and sets the edge length of its cells for the next batch of inserts
+    void reset(float cellSize);
+
+    /// adds the source at sourceIndex to the cell containing position
+    void insert(int sourceIndex, const glm::vec3& position);
+
+    /// must be called after the last insert and before any lookups
+    void finalize();
+
+    /// appends the index of every source in the cell containing position and in the cells around it, which is every
+    /// source within cellSize + extraDistance of position
+    void findSourcesNear(const glm::vec3& position, std::vector<int>& sourceIndices, float extraDistance = 0.0f) const;
+
+    float getCellSize() const { return _cellSize; }
+private:
+    struct Entry {
+        quint64 cellKey;
+        int sourceIndex;
+
+        bool operator<(const Entry& otherEntry) const { return cellKey < otherEntry.cellKey; }
+    };
+
+    quint64 keyForCell(int x, int y, int z) const;
+    int cellCoordinate(float value) const;
+
+    float _cellSize;
+    std::vector<Entry> _entries;
+};
+
+#endif /* defined(__hifi__AudioSourceGrid__) */
@@ -0,0 +1,248 @@
+//
+//  AudioSpatializer.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <math.h>
+#include <stdint.h>
+
+#include <glm/gtx/vector_angle.hpp>
+
+#include "AudioSpatializer.h"
+
+const float DISTANCE_SCALE = 2.5f;
+const float GEOMETRIC_AMPLITUDE_SCALAR = 0.3f;
+const float DISTANCE_LOG_BASE = 2.5f;
+
+const float MAX_OFF_AXIS_ATTENUATION = 0.2f;
+const float OFF_AXIS_ATTENUATION_FORMULA_STEP = (1 - MAX_OFF_AXIS_ATTENUATION) / 2.0f;
+
+const float PHASE_AMPLITUDE_RATIO_AT_90 = 0.5;
+
+// the distance table is indexed by the bits of the squared distance, starting at 1.0f
+const uint32_t FLOAT_ONE_BITS = 0x3f800000;
+const int DISTANCE_TABLE_FRACTION_BITS = 23 - DISTANCE_TABLE_MANTISSA_BITS;
+const uint32_t DISTANCE_TABLE_FRACTION_MASK = (1 << DISTANCE_TABLE_FRACTION_BITS) - 1;
+const float DISTANCE_TABLE_FRACTION_SCALE = 1.0f / (1 << DISTANCE_TABLE_FRACTION_BITS);
+
+const int NUM_ERROR_MEASUREMENT_SAMPLES = 1 << 20;
+
+float floatFromBits(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint32_t bitsFromFloat(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+AudioSpatializer::AudioSpatializer() :
+    _maxDistanceRelativeError(0.0f),
+    _maxOffAxisError(0.0f)
+{
+    for (int i = 0; i <= DISTANCE_TABLE_SIZE; i++) {
+        // each entry is 1/64th of an octave past the last, so the spacing grows with the distance
+        float distanceSquared = floatFromBits(FLOAT_ONE_BITS + (i << DISTANCE_TABLE_FRACTION_BITS));
+        _distanceTable[i] = distanceCoefficientFormula(distanceSquared);
+    }
+
+    for (int i = 0; i <= OFF_AXIS_TABLE_SIZE; i++) {
+        float cosineOfDelivery = -1.0f + (2.0f * i / OFF_AXIS_TABLE_SIZE);
+        _offAxisTable[i] = offAxisCoefficientFormula(glm::degrees(acosf(cosineOfDelivery)));
+    }
+
+    measureTableError();
+}
+
+float AudioSpatializer::distanceCoefficientFormula(float distanceSquared) {
+    const float DISTANCE_SCALE_LOG = logf(DISTANCE_SCALE) / logf(DISTANCE_LOG_BASE);
+
+    // calculate the distance coefficient using the distance to this node
+    float distanceCoefficient = powf(GEOMETRIC_AMPLITUDE_SCALAR,
+                                     DISTANCE_SCALE_LOG +
+                                     (0.5f * logf(distanceSquared) / logf(DISTANCE_LOG_BASE)) - 1);
+    return std::min(1.0f, distanceCoefficient);
+}
+
+float AudioSpatializer::offAxisCoefficientFormula(float angleOfDelivery) {
+    return MAX_OFF_AXIS_ATTENUATION + (OFF_AXIS_ATTENUATION_FORMULA_STEP * (angleOfDelivery / 90.0f));
+}
+
+float AudioSpatializer::distanceForCoefficient(float distanceCoefficient) {
+    if (distanceCoefficient >= 1.0f) {
+        return 1.0f;
+    }
+
+    // the distance coefficient is distance ^ (log(0.3) / log(2.5)) past a distance of one
+    float distanceExponent = logf(GEOMETRIC_AMPLITUDE_SCALAR) / logf(DISTANCE_LOG_BASE);
+    return powf(distanceCoefficient, 1.0f / distanceExponent);
+}
+
+float AudioSpatializer::distanceCoefficient(float distanceSquared) const {
+    if (!(distanceSquared > 1.0f)) {
+        // the coefficient is clamped to one for anything this close
+        return 1.0f;
+    }
+
+    uint32_t tableOffset = bitsFromFloat(distanceSquared) - FLOAT_ONE_BITS;
+    uint32_t index = tableOffset >> DISTANCE_TABLE_FRACTION_BITS;
+
+    if (index >= (uint32_t) DISTANCE_TABLE_SIZE) {
+        return _distanceTable[DISTANCE_TABLE_SIZE];
+    }
+
+    // the low mantissa bits are linear in the distance between two table entries
+    float fraction = (tableOffset & DISTANCE_TABLE_FRACTION_MASK) * DISTANCE_TABLE_FRACTION_SCALE;
+    return _distanceTable[index] + ((_distanceTable[index + 1] - _distanceTable[index]) * fraction);
+}
+
+float AudioSpatializer::offAxisCoefficient(float cosineOfDelivery) const {
+    float tablePosition = (cosineOfDelivery + 1.0f) * (0.5f * OFF_AXIS_TABLE_SIZE);
+    int index = (int) tablePosition;
+
+    if (index < 0) {
+        return _offAxisTable[0];
+    } else if (index >= OFF_AXIS_TABLE_SIZE) {
+        return _offAxisTable[OFF_AXIS_TABLE_SIZE];
+    }
+
+    float fraction = tablePosition - index;
+    return _offAxisTable[index] + ((_offAxisTable[index + 1] - _offAxisTable[index]) * fraction);
+}
+
+void AudioSpatializer::measureTableError() {
+    _maxDistanceRelativeError = 0.0f;
+    _maxOffAxisError = 0.0f;
+
+    for (int i = 0; i < NUM_ERROR_MEASUREMENT_SAMPLES; i++) {
+        // sweep the squared distance logarithmically across every octave the table covers
+        float distanceSquared = powf(2.0f, (float) DISTANCE_TABLE_NUM_OCTAVES * i / NUM_ERROR_MEASUREMENT_SAMPLES);
+        float expectedCoefficient = distanceCoefficientFormula(distanceSquared);
+        float relativeError = fabsf(distanceCoefficient(distanceSquared) - expectedCoefficient) / expectedCoefficient;
+        _maxDistanceRelativeError = std::max(_maxDistanceRelativeError, relativeError);
+
+        float cosineOfDelivery = -1.0f + (2.0f * i / NUM_ERROR_MEASUREMENT_SAMPLES);
+        float offAxisError = fabsf(offAxisCoefficient(cosineOfDelivery)
+                                   - offAxisCoefficientFormula(glm::degrees(acosf(cosineOfDelivery))));
+        _maxOffAxisError = std::max(_maxOffAxisError, offAxisError);
+    }
+}
+
+AudioMixerSpatialization AudioSpatializer::spatialize(const AudioSpatialSource& source,
+                                                      const AudioSpatialSource& listener) const {
+    AudioMixerSpatialization spatialization;
+    spatialization.attenuationCoefficient = source.attenuationRatio;
+    spatialization.weakChannelAmplitudeRatio = 1.0f;
+    spatialization.numSamplesDelay = 0;
+    spatialization.isDelayedChannelRight = false;
+
+    glm::vec3 relativePosition = source.position - listener.position;
+    float distanceSquareToSource = glm::dot(relativePosition, relativePosition);
+
+    if (source.radius == 0 || (distanceSquareToSource > source.radius * source.radius)) {
+        // this is either not a spherical source, or the listener is outside the sphere
+
+        if (source.radius > 0) {
+            // the distance used for the coefficient is the distance to the boundary of the sphere
+            distanceSquareToSource -= (source.radius * source.radius);
+        } else {
+            // orientations are unit quaternions, so the conjugate is the inverse
+            glm::vec3 rotatedListenerPosition = glm::conjugate(source.orientation) * relativePosition;
+            float rotatedLength = glm::length(rotatedListenerPosition);
+
+            // the cosine of the angle between -z and the rotated vector is its normalized -z component
+            float cosineOfDelivery = (rotatedLength > 0.0f) ? -rotatedListenerPosition.z / rotatedLength : 1.0f;
+            spatialization.attenuationCoefficient *= offAxisCoefficient(cosineOfDelivery);
+        }
+
+        spatialization.attenuationCoefficient *= distanceCoefficient(distanceSquareToSource);
+
+        glm::vec3 rotatedSourcePosition = glm::conjugate(listener.orientation) * relativePosition;
+
+        // the sine of the bearing about the y-axis is the x component of the source vector projected onto the XZ plane,
+        // and the bearing is positive (so the right channel is delayed) when the source is to the left
+        float planarLength = sqrtf((rotatedSourcePosition.x * rotatedSourcePosition.x)
+                                   + (rotatedSourcePosition.z * rotatedSourcePosition.z));
+        float sinRatio = (planarLength > 0.0f) ? fabsf(rotatedSourcePosition.x) / planarLength : 0.0f;
+
+        spatialization.numSamplesDelay = PHASE_DELAY_AT_90 * sinRatio;
+        spatialization.weakChannelAmplitudeRatio = 1 - (PHASE_AMPLITUDE_RATIO_AT_90 * sinRatio);
+        spatialization.isDelayedChannelRight = rotatedSourcePosition.x < 0.0f;
+    }
+
+    return spatialization;
+}
+
+AudioMixerSpatialization AudioSpatializer::spatializeWithFormulas(const AudioSpatialSource& source,
+                                                                  const AudioSpatialSource& listener) {
+    float bearingRelativeAngleToSource = 0.0f;
+    float attenuationCoefficient = source.attenuationRatio;
+    int numSamplesDelay = 0;
+    float weakChannelAmplitudeRatio = 1.0f;
+
+    glm::vec3 relativePosition = source.position - listener.position;
+    glm::quat inverseOrientation = glm::inverse(listener.orientation);
+
+    float distanceSquareToSource = glm::dot(relativePosition, relativePosition);
+    float radius = source.radius;
+
+    if (radius == 0 || (distanceSquareToSource > radius * radius)) {
+        // this is either not a spherical source, or the listener is outside the sphere
+
+        if (radius > 0) {
+            // this is a spherical source - the distance used for the coefficient
+            // needs to be the closest point on the boundary to the source
+
+            // ovveride the distance to the node with the distance to the point on the
+            // boundary of the sphere
+            distanceSquareToSource -= (radius * radius);
+
+        } else {
+            // calculate the angle delivery for off-axis attenuation
+            glm::vec3 rotatedListenerPosition = glm::inverse(source.orientation) * relativePosition;
+
+            float angleOfDelivery = glm::angle(glm::vec3(0.0f, 0.0f, -1.0f),
+                                               glm::normalize(rotatedListenerPosition));
+
+            // multiply the current attenuation coefficient by the calculated off axis coefficient
+            attenuationCoefficient *= offAxisCoefficientFormula(angleOfDelivery);
+        }
+
+        glm::vec3 rotatedSourcePosition = inverseOrientation * relativePosition;
+
+        // multiply the current attenuation coefficient by the distance coefficient
+        attenuationCoefficient *= distanceCoefficientFormula(distanceSquareToSource);
+
+        // project the rotated source position vector onto the XZ plane
+        rotatedSourcePosition.y = 0.0f;
+
+        // produce an oriented angle about the y-axis
+        bearingRelativeAngleToSource = glm::orientedAngle(glm::vec3(0.0f, 0.0f, -1.0f),
+                                                          glm::normalize(rotatedSourcePosition),
+                                                          glm::vec3(0.0f, 1.0f, 0.0f));
+
+        // figure out the number of samples of delay and the ratio of the amplitude
+        // in the weak channel for audio spatialization
+        float sinRatio = fabsf(sinf(glm::radians(bearingRelativeAngleToSource)));
+        numSamplesDelay = PHASE_DELAY_AT_90 * sinRatio;
+        weakChannelAmplitudeRatio = 1 - (PHASE_AMPLITUDE_RATIO_AT_90 * sinRatio);
+    }
+
+    AudioMixerSpatialization spatialization;
+    spatialization.attenuationCoefficient = attenuationCoefficient;
+    spatialization.weakChannelAmplitudeRatio = weakChannelAmplitudeRatio;
+    spatialization.numSamplesDelay = numSamplesDelay;
+
+    // if the bearing relative angle to source is > 0 then the delayed channel is the right one
+    spatialization.isDelayedChannelRight = bearingRelativeAngleToSource > 0.0f;
+
+    return spatialization;
+}
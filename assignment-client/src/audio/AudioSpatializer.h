@@ -0,0 +1,87 @@
+//
+//  AudioSpatializer.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  Calculates how a positional source is spatialized into a listener's mix. The distance and off-axis attenuation
+//  curves are sampled into tables once, when the spatializer is created. The bearing terms (phase delay and weak
+//  channel ratio) only depend on the sine of the bearing, which is read straight off the rotated source vector, so
+//  they need neither a table nor any trig.
+//
+//  Accuracy against spatializeWithFormulas(), measured by measureTableError() over the whole input range:
+//      distance coefficient - linear interpolation between 64 log-spaced samples per octave, under 0.005% relative error
+//      off-axis coefficient - linear interpolation between 4096 samples of the cosine of the delivery angle,
+//                             under 0.0025 absolute error (the coefficient itself is between 0.2 and 1)
+//      phase delay, weak channel ratio and delayed channel - closed form, equal to the formulas up to float rounding
+//
+
+#ifndef __hifi__AudioSpatializer__
+#define __hifi__AudioSpatializer__
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+const int PHASE_DELAY_AT_90 = 20;
+
+/// the per source/listener parameters used to spatialize one buffer into a listener's mix
+struct AudioMixerSpatialization {
+    float attenuationCoefficient;
+    float weakChannelAmplitudeRatio;
+    int numSamplesDelay;
+    bool isDelayedChannelRight;
+};
+
+/// the state of a source or listener that spatialization depends on
+struct AudioSpatialSource {
+    glm::vec3 position;
+    glm::quat orientation;
+    float radius;
+    float attenuationRatio;
+};
+
+const int DISTANCE_TABLE_MANTISSA_BITS = 6;
+const int DISTANCE_TABLE_NUM_OCTAVES = 32;
+const int DISTANCE_TABLE_SIZE = DISTANCE_TABLE_NUM_OCTAVES << DISTANCE_TABLE_MANTISSA_BITS;
+
+const int OFF_AXIS_TABLE_SIZE = 4096;
+
+class AudioSpatializer {
+public:
+    AudioSpatializer();
+
+    /// spatializes the source for the listener using the coefficient tables
+    AudioMixerSpatialization spatialize(const AudioSpatialSource& source, const AudioSpatialSource& listener) const;
+
+    /// spatializes the source for the listener using the original powf/logf/acos/sinf formulas
+    static AudioMixerSpatialization spatializeWithFormulas(const AudioSpatialSource& source,
+                                                           const AudioSpatialSource& listener);
+
+    /// distance attenuation for a squared distance to the source, from the table
+    float distanceCoefficient(float distanceSquared) const;
+
+    /// off-axis attenuation for the cosine of the angle between the source's facing and the listener, from the table
+    float offAxisCoefficient(float cosineOfDelivery) const;
+
+    static float distanceCoefficientFormula(float distanceSquared);
+    static float offAxisCoefficientFormula(float angleOfDelivery);
+
+    /// the distance at which the distance attenuation falls to the passed coefficient
+    static float distanceForCoefficient(float distanceCoefficient);
+
+    /// the largest error found by measureTableError
+    float getMaxDistanceRelativeError() const { return _maxDistanceRelativeError; }
+    float getMaxOffAxisError() const { return _maxOffAxisError; }
+private:
+    /// densely samples both tables against the formulas, so the accuracy bound can be reported
+    void measureTableError();
+
+    float _distanceTable[DISTANCE_TABLE_SIZE + 1];
+    float _offAxisTable[OFF_AXIS_TABLE_SIZE + 1];
+
+    float _maxDistanceRelativeError;
+    float _maxOffAxisError;
+};
+
+#endif /* defined(__hifi__AudioSpatializer__) */
@@ -16,6 +16,12 @@ AvatarAudioRingBuffer::AvatarAudioRingBuffer() :
 }
 
 int AvatarAudioRingBuffer::parseData(const QByteArray& packet) {
-    _shouldLoopbackForNode = (packetTypeForPacket(packet) == PacketTypeMicrophoneAudioWithEcho);
+    PacketType packetType = packetTypeForPacket(packet);
+
+    if (packetType != PacketTypeSilentAudioFrame) {
+        // silent frames don't say whether the node wants its audio echoed, so keep what the last frame asked for
+        _shouldLoopbackForNode = (packetType == PacketTypeMicrophoneAudioWithEcho);
+    }
+
     return PositionalAudioRingBuffer::parseData(packet);
 }
\ No newline at end of file
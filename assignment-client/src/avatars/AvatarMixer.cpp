@@ -10,12 +10,16 @@
 //  The avatar mixer receives head, hand and positional data from all connected
 //  nodes, and broadcasts that data back to them, every BROADCAST_INTERVAL ms.
 
+#include <algorithm>
+
 #include <QtCore/QCoreApplication>
 #include <QtCore/QElapsedTimer>
+#include <QtCore/QStringList>
 #include <QtCore/QTimer>
 
 #include <Logging.h>
 #include <NodeList.h>
+#include <OctreeConstants.h>
 #include <PacketHeaders.h>
 #include <SharedUtil.h>
 #include <UUID.h>
@@ -28,11 +32,41 @@ const char AVATAR_MIXER_LOGGING_NAME[] = "avatar-mixer";
 
 const unsigned int AVATAR_DATA_SEND_INTERVAL_USECS = (1 / 60.0) * 1000 * 1000;
 
+// avatars closer than this are sent every frame, past it their rate falls off with distance
+const float DEFAULT_FULL_RATE_DISTANCE = 10.0f;
+
+// no avatar is sent less often than this many times a second
+const float DEFAULT_MIN_UPDATE_RATE = 2.0f;
+
+// avatars outside of this cone around where a listener is looking are sent at half their rate
+const float VIEW_CONE_COSINE = 0.5f;
+
+const int STATS_REPORT_INTERVAL_FRAMES = 1000;
+
 AvatarMixer::AvatarMixer(const QByteArray& packet) :
-    ThreadedAssignment(packet)
+    ThreadedAssignment(packet),
+    _frameArena(),
+    _frameArenaSize(0),
+    _frameAvatars(),
+    _mixedAvatarPacket(),
+    _fullRateDistance(DEFAULT_FULL_RATE_DISTANCE),
+    _minUpdateRate(DEFAULT_MIN_UPDATE_RATE),
+    _maxBytesPerListenerPerFrame(0),
+    _candidates(),
+    _numAvatarsSent(0),
+    _numAvatarsDeferred(0),
+    _numAvatarsOverBudget(0),
+    _numAvatarsUnchanged(0),
+    _numFullStatesSent(0),
+    _numFullStateBytes(0),
+    _numDeltasSent(0),
+    _numDeltaBytes(0)
 {
     // make sure we hear about node kills so we can tell the other nodes
     connect(NodeList::getInstance(), &NodeList::nodeKilled, this, &AvatarMixer::nodeKilled);
+
+    // with a receive thread the queued datagrams are read at the top of each frame
+    _isDrainingDatagramsEachFrame = true;
 }
 
 void attachAvatarDataToNode(Node* newNode) {
@@ -41,52 +75,323 @@ void attachAvatarDataToNode(Node* newNode) {
     }
 }
 
-// NOTE: some additional optimizations to consider.
-//    1) use the view frustum to cull those avatars that are out of view. Since avatar data doesn't need to be present
-//       if the avatar is not in view or in the keyhole.
-//    2) after culling for view frustum, sort order the avatars by distance, send the closest ones first.
-//    3) if we need to rate limit the amount of data we send, we can use a distance weighted "semi-random" function to
-//       determine which avatars are included in the packet stream
-//    4) we should optimize the avatar data format to be more compact (100 bytes is pretty wasteful).
-void broadcastAvatarData() {
-    static QByteArray mixedAvatarByteArray;
-    
-    int numPacketHeaderBytes = populatePacketHeader(mixedAvatarByteArray, PacketTypeBulkAvatarData);
-    
+void AvatarMixer::parsePayload() {
+    QStringList payloadOptions = QString(getPayload()).split(" ", QString::SkipEmptyParts);
+
+    const QString FULL_RATE_DISTANCE_OPTION = "--fullRateDistance";
+    QString fullRateDistance = payloadOptionValue(payloadOptions, FULL_RATE_DISTANCE_OPTION);
+    if (!fullRateDistance.isEmpty() && fullRateDistance.toFloat() > 0.0f) {
+        _fullRateDistance = fullRateDistance.toFloat();
+    }
+
+    const QString MIN_UPDATE_RATE_OPTION = "--minUpdateRate";
+    QString minUpdateRate = payloadOptionValue(payloadOptions, MIN_UPDATE_RATE_OPTION);
+    if (!minUpdateRate.isEmpty() && minUpdateRate.toFloat() > 0.0f) {
+        _minUpdateRate = minUpdateRate.toFloat();
+    }
+
+    // the budget is given per second, but spent per frame
+    const QString MAX_BYTES_PER_LISTENER_OPTION = "--maxBytesPerSecondPerListener";
+    int maxBytesPerSecond = payloadOptionValue(payloadOptions, MAX_BYTES_PER_LISTENER_OPTION).toInt();
+    _maxBytesPerListenerPerFrame = maxBytesPerSecond * (AVATAR_DATA_SEND_INTERVAL_USECS / (1000.0f * 1000.0f));
+
+    qDebug("fullRateDistance=%f minUpdateRate=%f maxBytesPerListenerPerFrame=%d", _fullRateDistance, _minUpdateRate,
+           _maxBytesPerListenerPerFrame);
+
+    const QString BENCHMARK_AVATAR_CODEC_OPTION = "--benchmarkAvatarCodec";
+    if (payloadOptions.contains(BENCHMARK_AVATAR_CODEC_OPTION)) {
+        benchmarkAvatarCodec();
+    }
+}
+
+void AvatarMixer::benchmarkAvatarCodec() {
+    const int NUM_BENCHMARK_AVATARS = 100;
+    const int NUM_BENCHMARK_ITERATIONS = 1000;
+    const float BENCHMARK_AREA_SIZE = 50.0f;
+    const glm::vec3 BENCHMARK_AREA_CORNER = glm::vec3(TREE_SCALE / 2.0f);
+
+    std::vector<AvatarWireState> states(NUM_BENCHMARK_AVATARS);
+    std::vector<AvatarWireState> movedStates(NUM_BENCHMARK_AVATARS);
+
+    for (int i = 0; i < NUM_BENCHMARK_AVATARS; i++) {
+        AvatarData avatar;
+        avatar.setHeadData(new HeadData(&avatar));
+        avatar.setPosition(BENCHMARK_AREA_CORNER + glm::vec3(randFloat(), 0.0f, randFloat()) * BENCHMARK_AREA_SIZE);
+        avatar.setBodyYaw(randFloat() * 360.0f);
+        avatar.setHeadPitch(randFloat() * 30.0f);
+        avatar.setChatMessage(QString("hello"));
+        states[i] = avatar.toWireState();
+
+        // the next frame of an avatar walking forward and turning its head, which is what most updates look like
+        avatar.setPosition(avatar.getPosition() + avatar.getOrientation() * glm::vec3(0.0f, 0.0f, -0.02f));
+        avatar.setBodyYaw(avatar.getBodyYaw() + 1.0f);
+        avatar.setHeadPitch(avatar.getHeadPitch() + 1.0f);
+        movedStates[i] = avatar.toWireState();
+    }
+
+    unsigned char encodedState[MAX_AVATAR_WIRE_STATE_BYTES];
+    AvatarWireState decodedState;
+
+    // sum the results so the optimizer can't throw the work away
+    int fullBytes = 0;
+    int deltaBytes = 0;
+    int unchangedBytes = 0;
+    int decodedBytes = 0;
+
+    QElapsedTimer benchmarkTimer;
+    benchmarkTimer.start();
+
+    for (int iteration = 0; iteration < NUM_BENCHMARK_ITERATIONS; iteration++) {
+        for (int i = 0; i < NUM_BENCHMARK_AVATARS; i++) {
+            fullBytes += states[i].encode(encodedState, NULL);
+        }
+    }
+
+    qint64 fullEncodeNsecs = benchmarkTimer.nsecsElapsed();
+    benchmarkTimer.restart();
+
+    for (int iteration = 0; iteration < NUM_BENCHMARK_ITERATIONS; iteration++) {
+        for (int i = 0; i < NUM_BENCHMARK_AVATARS; i++) {
+            deltaBytes += movedStates[i].encode(encodedState, &states[i]);
+        }
+    }
+
+    qint64 deltaEncodeNsecs = benchmarkTimer.nsecsElapsed();
+    benchmarkTimer.restart();
+
+    for (int iteration = 0; iteration < NUM_BENCHMARK_ITERATIONS; iteration++) {
+        for (int i = 0; i < NUM_BENCHMARK_AVATARS; i++) {
+            int numBytes = movedStates[i].encode(encodedState, &states[i]);
+            decodedBytes += decodedState.decode(encodedState, numBytes, &states[i]);
+        }
+    }
+
+    qint64 deltaRoundTripNsecs = benchmarkTimer.nsecsElapsed();
+
+    for (int i = 0; i < NUM_BENCHMARK_AVATARS; i++) {
+        unchangedBytes += states[i].encode(encodedState, &states[i]);
+    }
+
+    float numEncodes = (float) NUM_BENCHMARK_ITERATIONS * NUM_BENCHMARK_AVATARS;
+
+    qDebug("Avatar codec for %d avatars - full state: %.1f bytes, %.1f ns to encode;"
+           " moving avatar delta: %.1f bytes, %.1f ns to encode, %.1f ns to encode and decode;"
+           " unchanged avatar: %.1f bytes (%d decoded)", NUM_BENCHMARK_AVATARS,
+           fullBytes / numEncodes, fullEncodeNsecs / numEncodes,
+           deltaBytes / numEncodes, deltaEncodeNsecs / numEncodes, deltaRoundTripNsecs / numEncodes,
+           unchangedBytes / (float) NUM_BENCHMARK_AVATARS, decodedBytes);
+}
+
+quint64 AvatarMixer::updateIntervalUsecs(const glm::vec3& offsetToAvatar, const glm::vec3& viewDirection) const {
+    float distance = glm::length(offsetToAvatar);
+    float updateInterval = AVATAR_DATA_SEND_INTERVAL_USECS;
+
+    if (distance > _fullRateDistance) {
+        // the rate falls off linearly with distance past the full rate distance
+        updateInterval *= distance / _fullRateDistance;
+    }
+
+    if (distance > 0.0f && glm::dot(offsetToAvatar, viewDirection) < VIEW_CONE_COSINE * distance) {
+        // this avatar isn't in front of the listener
+        updateInterval *= 2.0f;
+    }
+
+    return std::min(updateInterval, 1000.0f * 1000.0f / _minUpdateRate);
+}
+
+void AvatarMixer::collectCandidatesForListener(const SharedNodePointer& listenerNode, quint64 now) {
+    _candidates.clear();
+
+    AvatarMixerClientData* listenerData = reinterpret_cast<AvatarMixerClientData*>(listenerNode->getLinkedData());
+    glm::vec3 viewDirection = listenerData->getViewDirection();
+
+    for (unsigned int i = 0; i < _frameAvatars.size(); i++) {
+        const AvatarMixerEncodedAvatar& encodedAvatar = _frameAvatars[i];
+
+        if (encodedAvatar.node == listenerNode) {
+            continue;
+        }
+
+        AvatarMixerClientData* avatarData = reinterpret_cast<AvatarMixerClientData*>(encodedAvatar.node->getLinkedData());
+        quint64 updateInterval = updateIntervalUsecs(avatarData->getPosition() - listenerData->getPosition(), viewDirection);
+
+        // an avatar that has never been sent is as overdue as it can be
+        quint64 lastSentUsecs = listenerData->getLastSentUsecs(encodedAvatar.node->getSlot());
+        quint64 usecsSinceLastSent = lastSentUsecs ? now - lastSentUsecs : 1000 * 1000 * 1000;
+
+        // allow half a frame of slack so avatars at the full rate are sent every frame
+        if (usecsSinceLastSent + (AVATAR_DATA_SEND_INTERVAL_USECS / 2) >= updateInterval) {
+            // the longer an avatar waits past its interval the higher it climbs, so nobody starves under the budget
+            AvatarMixerCandidate candidate;
+            candidate.avatarIndex = i;
+            candidate.priority = usecsSinceLastSent / (float) updateInterval;
+            _candidates.push_back(candidate);
+        } else {
+            _numAvatarsDeferred++;
+        }
+    }
+
+    std::sort(_candidates.begin(), _candidates.end());
+}
+
+void AvatarMixer::snapshotAvatars(const NodeHash& nodeHash) {
+    _frameAvatars.clear();
+    _frameArenaSize = 0;
+
+    foreach (const SharedNodePointer& node, nodeHash) {
+        if (node->getLinkedData()) {
+            // make sure there is room for the largest avatar we could encode - the arena only ever grows, so after
+            // the first few frames this never allocates
+            int requiredArenaSize = _frameArenaSize + sizeof(_deltaRecord);
+            if (_frameArena.size() < requiredArenaSize) {
+                _frameArena.resize(requiredArenaSize * 2);
+            }
+
+            AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData());
+
+            AvatarMixerEncodedAvatar encodedAvatar;
+            encodedAvatar.node = node;
+            encodedAvatar.wireState = &nodeData->getWireState();
+            encodedAvatar.arenaOffset = _frameArenaSize;
+
+            // the full state goes out as a record with no baseline - UUID, a zero baseline sequence and every field
+            char* arenaPosition = _frameArena.data() + _frameArenaSize;
+            memcpy(arenaPosition, node->getUUID().toRfc4122().constData(), NUM_BYTES_RFC4122_UUID);
+            memset(arenaPosition + NUM_BYTES_RFC4122_UUID, 0, sizeof(quint16));
+
+            encodedAvatar.numBytes = NUM_BYTES_RFC4122_UUID + sizeof(quint16)
+                + encodedAvatar.wireState->encode(reinterpret_cast<unsigned char*>(arenaPosition + NUM_BYTES_RFC4122_UUID
+                                                                                   + sizeof(quint16)), NULL);
+
+            _frameArenaSize += encodedAvatar.numBytes;
+            _frameAvatars.push_back(encodedAvatar);
+        }
+    }
+}
+
+int AvatarMixer::encodeDeltaRecord(const AvatarMixerEncodedAvatar& encodedAvatar,
+                                   const AvatarWireStateHistory& sentStates) {
+    const AvatarWireState* baseline = sentStates.getBaseline();
+    if (!baseline) {
+        return 0;
+    }
+
+    // the UUID is the same as in the full record in the arena
+    memcpy(_deltaRecord, _frameArena.constData() + encodedAvatar.arenaOffset, NUM_BYTES_RFC4122_UUID);
+
+    quint16 baselineSequence = sentStates.getBaselineSequence();
+    memcpy(_deltaRecord + NUM_BYTES_RFC4122_UUID, &baselineSequence, sizeof(baselineSequence));
+
+    return NUM_BYTES_RFC4122_UUID + sizeof(baselineSequence)
+        + encodedAvatar.wireState->encode(_deltaRecord + NUM_BYTES_RFC4122_UUID + sizeof(baselineSequence), baseline);
+}
+
+void AvatarMixer::broadcastAvatarData() {
     NodeList* nodeList = NodeList::getInstance();
+
+    // hold one snapshot of the nodes and encode every avatar in it once for the whole frame
+    NodeSnapshotPointer nodeSnapshot = nodeList->getNodeSnapshot();
+    const NodeHash& nodeHash = nodeSnapshot->getNodeHash();
+    snapshotAvatars(nodeHash);
+
+    int numPacketHeaderBytes = populatePacketHeader(_mixedAvatarPacket, PacketTypeBulkAvatarData);
     
-    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+    quint64 now = usecTimestampNow();
+
+    // the packets for every listener go out together, in batches if they are enabled
+    nodeList->beginDatagramBatch();
+
+    foreach (const SharedNodePointer& node, nodeHash) {
         if (node->getLinkedData() && node->getType() == NodeType::Agent && node->getActiveSocket()) {
+            AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData());
             
-            // reset packet pointers for this node
-            mixedAvatarByteArray.resize(numPacketHeaderBytes);
+            // reset packet pointers for this node, every packet carries its own sequence number for acknowledgement
+            quint16 sequence = nodeData->nextBulkSequence();
+            _mixedAvatarPacket.resize(numPacketHeaderBytes);
+            _mixedAvatarPacket.append(reinterpret_cast<const char*>(&sequence), sizeof(sequence));
             
             // this is an AGENT we have received head data from
-            // send back a packet with other active node data to this node
-            foreach (const SharedNodePointer& otherNode, nodeList->getNodeHash()) {
-                if (otherNode->getLinkedData() && otherNode->getUUID() != node->getUUID()) {
-                    
-                    QByteArray avatarByteArray;
-                    avatarByteArray.append(otherNode->getUUID().toRfc4122());
-                    
-                    AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(otherNode->getLinkedData());
-                    avatarByteArray.append(nodeData->toByteArray());
-                    
-                    if (avatarByteArray.size() + mixedAvatarByteArray.size() > MAX_PACKET_SIZE) {
-                        nodeList->writeDatagram(mixedAvatarByteArray, node);
-                        
-                        // reset the packet
-                        mixedAvatarByteArray.resize(numPacketHeaderBytes);
-                    }
+            // send back a packet with the other avatars that are due, most overdue first, until the budget is spent
+            collectCandidatesForListener(node, now);
+
+            // what was left over last frame, or overdrawn by it, carries into this one
+            int budgetBytes = _maxBytesPerListenerPerFrame + nodeData->getCarriedBudgetBytes();
+            int numBytesSent = 0;
+
+            for (unsigned int i = 0; i < _candidates.size(); i++) {
+                const AvatarMixerEncodedAvatar& encodedAvatar = _frameAvatars[_candidates[i].avatarIndex];
+                AvatarWireStateHistory& sentStates = nodeData->getSentWireStates(encodedAvatar.node->getSlot());
+
+                if (sentStates.isBaselineLatest() && *sentStates.getBaseline() == *encodedAvatar.wireState) {
+                    // the listener acknowledged exactly this state and nothing newer went out since, so it is current
+                    nodeData->setLastSentUsecs(encodedAvatar.node->getSlot(), now);
+                    _numAvatarsUnchanged++;
+                    continue;
+                }
+
+                if (_maxBytesPerListenerPerFrame > 0 && numBytesSent >= budgetBytes) {
+                    // nothing left this frame, or still paying back an overdraft - it stays overdue and will be
+                    // ahead of the pack next frame
+                    _numAvatarsOverBudget++;
+                    continue;
+                }
+
+                // send only what changed since the state this listener last acknowledged, if it has one
+                const char* record = reinterpret_cast<const char*>(_deltaRecord);
+                int numRecordBytes = encodeDeltaRecord(encodedAvatar, sentStates);
+                bool isFullState = numRecordBytes == 0;
+
+                if (isFullState) {
+                    record = _frameArena.constData() + encodedAvatar.arenaOffset;
+                    numRecordBytes = encodedAvatar.numBytes;
+                }
+
+                if (_maxBytesPerListenerPerFrame > 0 && numBytesSent > 0 && numBytesSent + numRecordBytes > budgetBytes) {
+                    // too big for what is left, but a smaller one further down may still fit - the first one always
+                    // goes out, so a record bigger than the whole budget is sent by overdrawing it
+                    _numAvatarsOverBudget++;
+                    continue;
+                }
+
+                if (numRecordBytes + _mixedAvatarPacket.size() > MAX_PACKET_SIZE) {
+                    nodeList->writeDatagram(_mixedAvatarPacket, node);
                     
-                    // copy the avatar into the mixedAvatarByteArray packet
-                    mixedAvatarByteArray.append(avatarByteArray);
+                    // reset the packet
+                    sequence = nodeData->nextBulkSequence();
+                    _mixedAvatarPacket.resize(numPacketHeaderBytes);
+                    _mixedAvatarPacket.append(reinterpret_cast<const char*>(&sequence), sizeof(sequence));
+                }
+                
+                _mixedAvatarPacket.append(record, numRecordBytes);
+
+                // remember what went out in which packet, so it can become the baseline once it is acknowledged
+                sentStates.append(sequence, *encodedAvatar.wireState);
+
+                numBytesSent += numRecordBytes;
+                nodeData->setLastSentUsecs(encodedAvatar.node->getSlot(), now);
+                _numAvatarsSent++;
+
+                if (isFullState) {
+                    _numFullStatesSent++;
+                    _numFullStateBytes += numRecordBytes;
+                } else {
+                    _numDeltasSent++;
+                    _numDeltaBytes += numRecordBytes;
                 }
             }
             
-            nodeList->writeDatagram(mixedAvatarByteArray, node);
+            if (_mixedAvatarPacket.size() > numPacketHeaderBytes + (int) sizeof(sequence)) {
+                nodeList->writeDatagram(_mixedAvatarPacket, node);
+            }
+
+            if (_maxBytesPerListenerPerFrame > 0) {
+                // at most a frame's worth is saved up, so a quiet stretch doesn't turn into a burst
+                nodeData->setCarriedBudgetBytes(std::min(budgetBytes - numBytesSent, _maxBytesPerListenerPerFrame));
+            }
         }
     }
+
+    nodeList->endDatagramBatch();
 }
 
 void broadcastIdentityPacket() {
@@ -96,16 +401,19 @@ void broadcastIdentityPacket() {
     QByteArray avatarIdentityPacket = byteArrayWithPopluatedHeader(PacketTypeAvatarIdentity);
     int numPacketHeaderBytes = avatarIdentityPacket.size();
     
-    foreach (const SharedNodePointer& node, nodeList->getNodeHash()) {
+    NodeSnapshotPointer nodeSnapshot = nodeList->getNodeSnapshot();
+
+    foreach (const SharedNodePointer& node, nodeSnapshot->getNodeHash()) {
         if (node->getLinkedData() && node->getType() == NodeType::Agent) {
             
             AvatarMixerClientData* nodeData = reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData());
             QByteArray individualData = nodeData->identityByteArray();
             individualData.replace(0, NUM_BYTES_RFC4122_UUID, node->getUUID().toRfc4122());
             
-            if (avatarIdentityPacket.size() + individualData.size() > MAX_PACKET_SIZE) {
+            if (avatarIdentityPacket.size() + individualData.size() > maxChannelPayloadBytes()) {
                 // we've hit MTU, send out the current packet before appending
-                nodeList->broadcastToNodes(avatarIdentityPacket, NodeSet() << NodeType::Agent);
+                nodeList->broadcastToNodesOnChannel(avatarIdentityPacket, NodeSet() << NodeType::Agent,
+                                                    ChannelID::AvatarIdentity, ChannelMode::Reliable);
                 avatarIdentityPacket.resize(numPacketHeaderBytes);
             }
             
@@ -119,7 +427,8 @@ void broadcastIdentityPacket() {
     
     // send out the final packet
     if (avatarIdentityPacket.size() > numPacketHeaderBytes) {
-        nodeList->broadcastToNodes(avatarIdentityPacket, NodeSet() << NodeType::Agent);
+        nodeList->broadcastToNodesOnChannel(avatarIdentityPacket, NodeSet() << NodeType::Agent,
+                                            ChannelID::AvatarIdentity, ChannelMode::Reliable);
     }
 }
 
@@ -133,6 +442,15 @@ void AvatarMixer::nodeKilled(SharedNodePointer killedNode) {
         
         NodeList::getInstance()->broadcastToNodes(killPacket,
                                                   NodeSet() << NodeType::Agent);
+
+        // nobody needs to remember what they were sent of this avatar, the next node in its slot starts fresh
+        NodeSnapshotPointer nodeSnapshot = NodeList::getInstance()->getNodeSnapshot();
+
+        foreach (const SharedNodePointer& node, nodeSnapshot->getNodeHash()) {
+            if (node->getLinkedData()) {
+                reinterpret_cast<AvatarMixerClientData*>(node->getLinkedData())->forgetAvatar(killedNode->getSlot());
+            }
+        }
     }
 }
 
@@ -167,7 +485,8 @@ void AvatarMixer::readPendingDatagrams() {
                             identityPacket.append(individualByteArray);
                             
                             nodeData->setHasSentIdentityBetweenKeyFrames(true);
-                            nodeList->broadcastToNodes(identityPacket, NodeSet() << NodeType::Agent);
+                            nodeList->broadcastToNodesOnChannel(identityPacket, NodeSet() << NodeType::Agent,
+                                                                ChannelID::AvatarIdentity, ChannelMode::Reliable);
                         }
                     }
                 }
@@ -193,6 +512,8 @@ void AvatarMixer::run() {
     nodeList->addNodeTypeToInterestSet(NodeType::Agent);
     
     nodeList->linkedDataCreateCallback = attachAvatarDataToNode;
+
+    parsePayload();
     
     int nextFrame = 0;
     timeval startTime;
@@ -204,13 +525,44 @@ void AvatarMixer::run() {
     
     while (!_isFinished) {
         
+        quint64 frameStartUsecs = usecTimestampNow();
+        
         QCoreApplication::processEvents();
         
         if (_isFinished) {
             break;
         }
         
+        if (_datagramReceiver) {
+            readPendingDatagrams();
+        }
+        
         broadcastAvatarData();
+
+        if (nextFrame % STATS_REPORT_INTERVAL_FRAMES == 0) {
+            qDebug() << "AvatarMixer avatars per frame - sent:" << _numAvatarsSent / (float) STATS_REPORT_INTERVAL_FRAMES
+                << "not yet due:" << _numAvatarsDeferred / (float) STATS_REPORT_INTERVAL_FRAMES
+                << "over budget:" << _numAvatarsOverBudget / (float) STATS_REPORT_INTERVAL_FRAMES
+                << "unchanged:" << _numAvatarsUnchanged / (float) STATS_REPORT_INTERVAL_FRAMES;
+
+            qDebug() << "AvatarMixer bytes per avatar - full states:"
+                << (_numFullStatesSent > 0 ? _numFullStateBytes / (float) _numFullStatesSent : 0.0f)
+                << "deltas:" << (_numDeltasSent > 0 ? _numDeltaBytes / (float) _numDeltasSent : 0.0f)
+                << "overall:" << (_numAvatarsSent > 0 ? (_numFullStateBytes + _numDeltaBytes) / (float) _numAvatarsSent : 0.0f)
+                << "- deltas are" << (_numAvatarsSent > 0 ? 100.0f * _numDeltasSent / _numAvatarsSent : 0.0f)
+                << "% of avatars sent";
+
+            _numAvatarsSent = 0;
+            _numAvatarsDeferred = 0;
+            _numAvatarsOverBudget = 0;
+            _numAvatarsUnchanged = 0;
+            _numFullStatesSent = 0;
+            _numFullStateBytes = 0;
+            _numDeltasSent = 0;
+            _numDeltaBytes = 0;
+
+            logDatagramQueueStats();
+        }
         
         if (identityTimer.elapsed() >= AVATAR_IDENTITY_KEYFRAME_MSECS) {
             // it's time to broadcast the keyframe identity packets
@@ -220,6 +572,8 @@ void AvatarMixer::run() {
             identityTimer.restart();
         }
         
+        recordFrameTime(usecTimestampNow() - frameStartUsecs);
+        
         int usecToSleep = usecTimestamp(&startTime) + (++nextFrame * AVATAR_DATA_SEND_INTERVAL_USECS) - usecTimestampNow();
         
         if (usecToSleep > 0) {
@@ -9,7 +9,30 @@
 #ifndef __hifi__AvatarMixer__
 #define __hifi__AvatarMixer__
 
+#include <vector>
+
 #include <ThreadedAssignment.h>
+#include <UUID.h>
+
+#include <AvatarWireState.h>
+
+/// an avatar's full state encoded (with its UUID) into the frame arena, ready to be copied into any listener's packet
+/// that has no baseline for it
+struct AvatarMixerEncodedAvatar {
+    SharedNodePointer node;
+    const AvatarWireState* wireState;
+    int arenaOffset;
+    int numBytes;
+};
+
+/// an avatar that is due to be sent to a listener, and how overdue it is relative to the rate it should be sent at
+struct AvatarMixerCandidate {
+    int avatarIndex;
+    float priority;
+
+    /// orders the most overdue avatars first
+    bool operator<(const AvatarMixerCandidate& otherCandidate) const { return priority > otherCandidate.priority; }
+};
 
 /// Handles assignments of type AvatarMixer - distribution of avatar data to various clients
 class AvatarMixer : public ThreadedAssignment {
@@ -24,6 +47,48 @@ public slots:
     void nodeKilled(SharedNodePointer killedNode);
     
     void readPendingDatagrams();
+private:
+    /// reads the interest management options passed in the assignment payload
+    void parsePayload();
+
+    /// the interval at which an avatar at the passed offset from a listener looking in viewDirection is sent to them
+    quint64 updateIntervalUsecs(const glm::vec3& offsetToAvatar, const glm::vec3& viewDirection) const;
+
+    /// orders the avatars that are due to be sent to the listener, most overdue first
+    void collectCandidatesForListener(const SharedNodePointer& listenerNode, quint64 now);
+
+    /// encodes every avatar once into the frame arena
+    void snapshotAvatars(const NodeHash& nodeHash);
+
+    /// sends each agent the encoded avatars of every other node
+    void broadcastAvatarData();
+
+    /// encodes the avatar into _deltaRecord against the last state the listener acknowledged, returns the bytes
+    /// encoded or 0 when the listener has no baseline for it and needs the full state from the arena
+    int encodeDeltaRecord(const AvatarMixerEncodedAvatar& encodedAvatar, const AvatarWireStateHistory& sentStates);
+
+    /// times encoding and decoding of full and delta avatar states, and logs the bytes each takes
+    void benchmarkAvatarCodec();
+
+    QByteArray _frameArena;
+    int _frameArenaSize;
+    std::vector<AvatarMixerEncodedAvatar> _frameAvatars;
+    QByteArray _mixedAvatarPacket;
+    unsigned char _deltaRecord[NUM_BYTES_RFC4122_UUID + sizeof(quint16) + MAX_AVATAR_WIRE_STATE_BYTES];
+
+    float _fullRateDistance;
+    float _minUpdateRate;
+    int _maxBytesPerListenerPerFrame;
+    std::vector<AvatarMixerCandidate> _candidates;
+
+    int _numAvatarsSent;
+    int _numAvatarsDeferred;
+    int _numAvatarsOverBudget;
+    int _numAvatarsUnchanged;
+    int _numFullStatesSent;
+    int _numFullStateBytes;
+    int _numDeltasSent;
+    int _numDeltaBytes;
 };
 
 #endif /* defined(__hifi__AvatarMixer__) */
@@ -6,10 +6,87 @@
 //  Copyright (c) 2014 HighFidelity, Inc. All rights reserved.
 //
 
+#include <cstring>
+
 #include "AvatarMixerClientData.h"
 
 AvatarMixerClientData::AvatarMixerClientData() :
-    _hasSentIdentityBetweenKeyFrames(false)
+    _hasSentIdentityBetweenKeyFrames(false),
+    _lastSentUsecs(),
+    _wireState(),
+    _sentWireStates(),
+    _lastBulkSequence(0),
+    _carriedBudgetBytes(0)
 {
     
 }
+
+int AvatarMixerClientData::parseData(const QByteArray& packet) {
+    int numBytesRead = AvatarData::parseData(packet);
+
+    // interface follows its avatar data with the latest bulk sequence it has from us and a bit for each before it
+    quint16 latestSequence;
+    quint32 previousSequenceBits;
+
+    if (packet.size() - numBytesRead >= (int) (sizeof(latestSequence) + sizeof(previousSequenceBits))) {
+        memcpy(&latestSequence, packet.constData() + numBytesRead, sizeof(latestSequence));
+        numBytesRead += sizeof(latestSequence);
+        memcpy(&previousSequenceBits, packet.constData() + numBytesRead, sizeof(previousSequenceBits));
+        numBytesRead += sizeof(previousSequenceBits);
+
+        for (std::vector<AvatarWireStateHistory>::iterator sentStates = _sentWireStates.begin();
+             sentStates != _sentWireStates.end(); ++sentStates) {
+            sentStates->acknowledge(latestSequence, previousSequenceBits);
+        }
+    }
+
+    return numBytesRead;
+}
+
+void AvatarMixerClientData::applyWireState(const AvatarWireState& wireState) {
+    _wireState = wireState;
+    AvatarData::applyWireState(wireState);
+}
+
+quint16 AvatarMixerClientData::nextBulkSequence() {
+    if (++_lastBulkSequence == 0) {
+        ++_lastBulkSequence;
+    }
+    return _lastBulkSequence;
+}
+
+quint64 AvatarMixerClientData::getLastSentUsecs(int avatarSlot) const {
+    return avatarSlot < (int) _lastSentUsecs.size() ? _lastSentUsecs[avatarSlot] : 0;
+}
+
+void AvatarMixerClientData::setLastSentUsecs(int avatarSlot, quint64 lastSentUsecs) {
+    reserveAvatarSlot(avatarSlot);
+    _lastSentUsecs[avatarSlot] = lastSentUsecs;
+}
+
+AvatarWireStateHistory& AvatarMixerClientData::getSentWireStates(int avatarSlot) {
+    reserveAvatarSlot(avatarSlot);
+    return _sentWireStates[avatarSlot];
+}
+
+void AvatarMixerClientData::forgetAvatar(int avatarSlot) {
+    if (avatarSlot < (int) _lastSentUsecs.size()) {
+        _lastSentUsecs[avatarSlot] = 0;
+        _sentWireStates[avatarSlot] = AvatarWireStateHistory();
+    }
+}
+
+void AvatarMixerClientData::reserveAvatarSlot(int avatarSlot) {
+    if (avatarSlot >= (int) _lastSentUsecs.size()) {
+        _lastSentUsecs.resize(avatarSlot + 1, 0);
+        _sentWireStates.resize(avatarSlot + 1);
+    }
+}
+
+glm::vec3 AvatarMixerClientData::getViewDirection() const {
+    glm::quat headOrientation = _headData
+        ? glm::quat(glm::radians(glm::vec3(_headData->getPitch(), _headData->getYaw(), 0.0f)))
+        : glm::quat();
+
+    return getOrientation() * headOrientation * glm::vec3(0.0f, 0.0f, -1.0f);
+}
@@ -9,7 +9,10 @@
 #ifndef __hifi__AvatarMixerClientData__
 #define __hifi__AvatarMixerClientData__
 
+#include <vector>
+
 #include <QtCore/QUrl>
+#include <QtCore/QUuid>
 
 #include <AvatarData.h>
 
@@ -17,13 +20,47 @@ class AvatarMixerClientData : public AvatarData {
     Q_OBJECT
 public:
     AvatarMixerClientData();
+
+    /// parses the avatar data and the acknowledgement of our bulk avatar data that follows it
+    int parseData(const QByteArray& packet);
+
+    /// keeps the state as received, so it can be sent on without being quantized again
+    void applyWireState(const AvatarWireState& wireState);
+    const AvatarWireState& getWireState() const { return _wireState; }
     
     bool hasSentIdentityBetweenKeyFrames() const { return _hasSentIdentityBetweenKeyFrames; }
     void setHasSentIdentityBetweenKeyFrames(bool hasSentIdentityBetweenKeyFrames)
         { _hasSentIdentityBetweenKeyFrames = hasSentIdentityBetweenKeyFrames; }
+
+    /// the direction this avatar is looking in, from its body orientation and head yaw and pitch
+    glm::vec3 getViewDirection() const;
+
+    /// when the avatar in the passed node slot was last sent to this node, 0 if it never was
+    quint64 getLastSentUsecs(int avatarSlot) const;
+    void setLastSentUsecs(int avatarSlot, quint64 lastSentUsecs);
+
+    /// the states of the avatar in the passed node slot that were sent to this node, and the one it last acknowledged
+    AvatarWireStateHistory& getSentWireStates(int avatarSlot);
+
+    /// the sequence number for the next bulk avatar data packet sent to this node - never 0, which means no baseline
+    quint16 nextBulkSequence();
+
+    /// the bytes of the per listener budget left over from the last frame, or overdrawn by it if negative
+    int getCarriedBudgetBytes() const { return _carriedBudgetBytes; }
+    void setCarriedBudgetBytes(int carriedBudgetBytes) { _carriedBudgetBytes = carriedBudgetBytes; }
+
+    /// drops everything kept about sending the avatar in the passed node slot to this node, before the slot is reused
+    void forgetAvatar(int avatarSlot);
 private:
+    /// grows the per avatar arrays so they have an entry for the passed node slot
+    void reserveAvatarSlot(int avatarSlot);
    
     bool _hasSentIdentityBetweenKeyFrames;
+    std::vector<quint64> _lastSentUsecs;
+    AvatarWireState _wireState;
+    std::vector<AvatarWireStateHistory> _sentWireStates;
+    quint16 _lastBulkSequence;
+    int _carriedBudgetBytes;
 };
 
 #endif /* defined(__hifi__AvatarMixerClientData__) */
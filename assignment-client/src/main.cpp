@@ -12,6 +12,7 @@
 #include "Assignment.h"
 #include "AssignmentClient.h"
 #include "AssignmentClientMonitor.h"
+#include "PacketReplayClient.h"
 
 int main(int argc, char* argv[]) {
     
@@ -28,7 +29,10 @@ int main(int argc, char* argv[]) {
         numForks = atoi(numForksString);
     }
     
-    if (numForks) {
+    if (getCmdOption(argc, (const char**)argv, PACKET_REPLAY_PARAMETER)) {
+        PacketReplayClient replayClient(argc, argv);
+        return replayClient.exec();
+    } else if (numForks) {
         AssignmentClientMonitor monitor(argc, argv, numForks);
         return monitor.exec();
     } else {
@@ -36,6 +36,7 @@ void OctreeInboundPacketProcessor::resetStats() {
     _totalPackets = 0;
 
     _singleSenderStats.clear();
+    resetBufferAllocationStats();
 }
 
 
@@ -11,6 +11,7 @@
 #include "OctreeQueryNode.h"
 #include <cstring>
 #include <cstdio>
+#include "OctreeSendPool.h"
 #include "OctreeSendThread.h"
 
 OctreeQueryNode::OctreeQueryNode() :
@@ -23,7 +24,7 @@ OctreeQueryNode::OctreeQueryNode() :
     _viewFrustumJustStoppedChanging(true),
     _currentPacketIsColor(true),
     _currentPacketIsCompressed(false),
-    _octreeSendThread(NULL),
+    _octreeSendThread(),
     _lastClientBoundaryLevelAdjust(0),
     _lastClientOctreeSizeScale(DEFAULT_OCTREE_SIZE_SCALE),
     _lodChanged(false),
@@ -35,12 +36,39 @@ OctreeQueryNode::OctreeQueryNode() :
     _lastOctreePacketLength = 0;
     _duplicatePacketCount = 0;
     _sequenceNumber = 0;
+    _currentPacketSequence = 0;
+    _lastOctreeKillCount = 0;
 }
 
 void OctreeQueryNode::initializeOctreeSendThread(OctreeServer* octreeServer, const QUuid& nodeUUID) {
-    // Create octree sending thread...
-    _octreeSendThread = new OctreeSendThread(nodeUUID, octreeServer);
-    _octreeSendThread->initialize(true);
+    // Create our octree sender and hand it to the server's send threads...
+    _octreeSendThread = QSharedPointer<OctreeSendThread>(new OctreeSendThread(nodeUUID, octreeServer));
+
+    if (octreeServer->wantsPrioritySending()) {
+        nodeBag.setPriorityView(&_currentViewFrustum);
+    }
+
+    // hear about elements that change, so they're sent to this client again
+    if (octreeServer->getSentStateTracker()) {
+        octreeServer->getSentStateTracker()->addSentState(&sentState);
+    }
+
+    octreeServer->getSendPool()->addSender(_octreeSendThread);
+}
+
+void OctreeQueryNode::applyClientAcks() {
+    if (getOctreeKillCount() != _lastOctreeKillCount) {
+        // the client threw away what we sent it, so nothing it acked before then is still held
+        _lastOctreeKillCount = getOctreeKillCount();
+        sentState.reset();
+        return;
+    }
+
+    OCTREE_PACKET_SEQUENCE newestSequence = 0;
+    quint64 receivedBits = 0;
+    if (getOctreeAck(newestSequence, receivedBits)) {
+        sentState.acknowledge(newestSequence, receivedBits);
+    }
 }
 
 bool OctreeQueryNode::packetIsDuplicate() const {
@@ -126,6 +154,7 @@ void OctreeQueryNode::resetOctreePacket(bool lastWasSurpressed) {
     // pack in sequence number
     OCTREE_PACKET_SEQUENCE* sequenceAt = (OCTREE_PACKET_SEQUENCE*)_octreePacketAt;
     *sequenceAt = _sequenceNumber;
+    _currentPacketSequence = _sequenceNumber;
     _octreePacketAt += sizeof(OCTREE_PACKET_SEQUENCE);
     _octreePacketAvailableBytes -= sizeof(OCTREE_PACKET_SEQUENCE);
     if (!(lastWasSurpressed || _lastOctreePacketLength == (numBytesPacketHeader + OCTREE_PACKET_EXTRA_HEADERS_SIZE))) {
@@ -159,9 +188,9 @@ void OctreeQueryNode::writeToPacket(const unsigned char* buffer, int bytes) {
 }
 
 OctreeQueryNode::~OctreeQueryNode() {
+    // the send pool may still hold the sender, and drops it once it sees it has been terminated
     if (_octreeSendThread) {
         _octreeSendThread->terminate();
-        _octreeSendThread->deleteLater();
     }
 
     delete[] _octreePacket;
@@ -10,6 +10,9 @@
 #define __hifi__OctreeQueryNode__
 
 #include <iostream>
+
+#include <QtCore/QSharedPointer>
+
 #include <NodeData.h>
 #include <OctreePacketData.h>
 #include <OctreeQuery.h>
@@ -18,6 +21,7 @@
 #include <OctreeConstants.h>
 #include <OctreeElementBag.h>
 #include <OctreeSceneStats.h>
+#include <OctreeSentState.h>
 
 class OctreeSendThread;
 class OctreeServer;
@@ -79,9 +83,18 @@ public:
     bool hasLodChanged() const { return _lodChanged; };
     
     OctreeSceneStats stats;
+    OctreeSentState sentState;
+
+    /// the sequence number the packet being filled will go out with
+    OCTREE_PACKET_SEQUENCE getCurrentPacketSequence() const { return _currentPacketSequence; }
+
+    /// Tells the sent state what the client's latest query says it has received, or that it threw everything away. Call
+    /// this from the send thread, under the node's lock, so the sent state only changes on the thread that reads it.
+    void applyClientAcks();
     
     void initializeOctreeSendThread(OctreeServer* octreeServer, const QUuid& nodeUUID);
-    bool isOctreeSendThreadInitalized() { return _octreeSendThread; }
+    bool isOctreeSendThreadInitalized() { return !_octreeSendThread.isNull(); }
+    const QSharedPointer<OctreeSendThread>& getOctreeSendThread() const { return _octreeSendThread; }
     
     void dumpOutOfView();
     
@@ -110,7 +123,7 @@ private:
     bool _currentPacketIsColor;
     bool _currentPacketIsCompressed;
 
-    OctreeSendThread* _octreeSendThread;
+    QSharedPointer<OctreeSendThread> _octreeSendThread;
 
     // watch for LOD changes
     int _lastClientBoundaryLevelAdjust;
@@ -119,6 +132,8 @@ private:
     bool _lodInitialized;
     
     OCTREE_PACKET_SEQUENCE _sequenceNumber;
+    OCTREE_PACKET_SEQUENCE _currentPacketSequence;
+    quint8 _lastOctreeKillCount;
 };
 
 #endif /* defined(__hifi__OctreeQueryNode__) */
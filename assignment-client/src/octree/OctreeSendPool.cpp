@@ -0,0 +1,225 @@
+//
+//  OctreeSendPool.cpp
+//
+//  Created by agent on 10/16/26
+//  Copyright (c) 2026 High Fidelity, Inc. All rights reserved.
+//
+
+#include <algorithm>
+
+#include <QtCore/QDebug>
+#include <QtCore/QThread>
+
+#include <SharedUtil.h>
+
+#include "OctreeSendPool.h"
+#include "OctreeServerConsts.h"
+
+OctreeSendWorker::OctreeSendWorker(OctreeSendPool* pool) :
+    _pool(pool),
+    _queueMutex(),
+    _queueChanged(),
+    _queue(),
+    _sleepingUntil(0)
+{
+}
+
+void OctreeSendWorker::schedule(const SharedOctreeSendThread& sender, quint64 dueUsecs) {
+    _queueMutex.lock();
+    _queue.insert(dueUsecs, sender);
+    _queueMutex.unlock();
+
+    // we're not holding our own lock, so this can't deadlock with another worker waking us at the same time
+    _pool->wakeWorkersDueBy(dueUsecs);
+}
+
+bool OctreeSendWorker::takeDue(quint64 now, SharedOctreeSendThread& sender, quint64& dueUsecs, bool onlyTry) {
+    if (onlyTry) {
+        if (!_queueMutex.tryLock()) {
+            return false;
+        }
+    } else {
+        _queueMutex.lock();
+    }
+
+    bool isDue = !_queue.isEmpty() && _queue.begin().key() <= now;
+    if (isDue) {
+        QMultiMap<quint64, SharedOctreeSendThread>::iterator earliest = _queue.begin();
+        dueUsecs = earliest.key();
+        sender = earliest.value();
+        _queue.erase(earliest);
+    }
+
+    _queueMutex.unlock();
+    return isDue;
+}
+
+bool OctreeSendWorker::tryPeekEarliest(quint64& dueUsecs) {
+    if (!_queueMutex.tryLock()) {
+        return false;
+    }
+
+    bool hasQueued = !_queue.isEmpty();
+    if (hasQueued) {
+        dueUsecs = _queue.begin().key();
+    }
+
+    _queueMutex.unlock();
+    return hasQueued;
+}
+
+int OctreeSendWorker::getQueueSize() {
+    QMutexLocker locker(&_queueMutex);
+    return _queue.size();
+}
+
+void OctreeSendWorker::wakeIfSleepingPast(quint64 dueUsecs) {
+    QMutexLocker locker(&_queueMutex);
+    if (_sleepingUntil > dueUsecs) {
+        _queueChanged.wakeOne();
+    }
+}
+
+void OctreeSendWorker::waitForDueSender(quint64 now) {
+    QMutexLocker locker(&_queueMutex);
+
+    // something may have been scheduled on us since we last looked
+    if (!_queue.isEmpty() && _queue.begin().key() <= now) {
+        return;
+    }
+
+    // sleep until our own earliest sender is due, or one on another worker that we might have to take if that worker is
+    // still busy by then - anything scheduled after we look can only wake us once we're waiting, since we hold our lock
+    quint64 wakeUsecs = now + MAX_SEND_POOL_IDLE_MSECS * USECS_PER_MSEC;
+    if (!_queue.isEmpty()) {
+        wakeUsecs = std::min(wakeUsecs, _queue.begin().key());
+    }
+    quint64 elsewhereDueUsecs = 0;
+    if (_pool->peekEarliestElsewhere(this, elsewhereDueUsecs)) {
+        wakeUsecs = std::min(wakeUsecs, elsewhereDueUsecs);
+    }
+    if (wakeUsecs <= now) {
+        return;
+    }
+
+    _sleepingUntil = wakeUsecs;
+    unsigned long waitMsecs = (unsigned long) ((wakeUsecs - now + USECS_PER_MSEC - 1) / USECS_PER_MSEC);
+    _queueChanged.wait(&_queueMutex, waitMsecs);
+    _sleepingUntil = 0;
+
+    // every worker adds its idle time to the same totals at once
+    OctreeSendThread::_usleepTime.add((int) (usecTimestampNow() - now));
+    OctreeSendThread::_usleepCalls.add(1);
+}
+
+bool OctreeSendWorker::process() {
+    quint64 now = usecTimestampNow();
+    SharedOctreeSendThread sender;
+    quint64 dueUsecs = 0;
+
+    if (!takeDue(now, sender, dueUsecs, false) && !_pool->stealDue(this, now, sender, dueUsecs)) {
+        waitForDueSender(now);
+        return isStillRunning();
+    }
+
+    // a sender whose client has gone is dropped here, which lets go of the pool's reference to it
+    if (!sender->isStillRunning()) {
+        return isStillRunning();
+    }
+
+    sender->recordLag(now - dueUsecs);
+
+    if (sender->process()) {
+        // keep to the client's cadence from when it was due rather than from when we got to it, but a pass that ran
+        // over its interval is due again now, not in the past
+        schedule(sender, std::max(dueUsecs + OCTREE_SEND_INTERVAL_USECS, usecTimestampNow()));
+    } else {
+        // it couldn't get the node's lock - rescheduling it at its old due time would put it back at the front of the
+        // queue and spin on the lock ahead of every other sender, so it goes behind them and tries again shortly
+        schedule(sender, usecTimestampNow() + LOCKED_SENDER_RETRY_USECS);
+    }
+
+    return isStillRunning();
+}
+
+OctreeSendPool::OctreeSendPool(int numWorkers) :
+    _workers(),
+    _nextWorker(0)
+{
+    if (numWorkers <= 0) {
+        numWorkers = std::max(QThread::idealThreadCount(), 1);
+    }
+
+    for (int i = 0; i < numWorkers; i++) {
+        _workers.append(new OctreeSendWorker(this));
+    }
+
+    // every worker has to exist before any of them starts, since an idle worker looks through all of them
+    foreach (OctreeSendWorker* worker, _workers) {
+        worker->initialize(true);
+    }
+
+    qDebug() << "OctreeSendPool running" << numWorkers << "send threads";
+}
+
+OctreeSendPool::~OctreeSendPool() {
+    foreach (OctreeSendWorker* worker, _workers) {
+        worker->terminate();
+    }
+
+    // the threads have all stopped, so the workers and the senders still queued on them can go right away
+    foreach (OctreeSendWorker* worker, _workers) {
+        delete worker;
+    }
+    _workers.clear();
+}
+
+void OctreeSendPool::addSender(const SharedOctreeSendThread& sender) {
+    // new clients are dealt out round robin - stealing evens out whatever that gets wrong
+    unsigned int workerIndex = (unsigned int) _nextWorker.fetchAndAddRelaxed(1) % _workers.size();
+    _workers[workerIndex]->schedule(sender, usecTimestampNow());
+}
+
+bool OctreeSendPool::stealDue(OctreeSendWorker* thief, quint64 now, SharedOctreeSendThread& sender, quint64& dueUsecs) {
+    OctreeSendWorker* victim = NULL;
+    quint64 earliestDueUsecs = now;
+
+    foreach (OctreeSendWorker* worker, _workers) {
+        quint64 workerDueUsecs = 0;
+        if (worker != thief && worker->tryPeekEarliest(workerDueUsecs) && workerDueUsecs <= earliestDueUsecs) {
+            victim = worker;
+            earliestDueUsecs = workerDueUsecs;
+        }
+    }
+
+    return victim && victim->takeDue(now, sender, dueUsecs, true);
+}
+
+bool OctreeSendPool::peekEarliestElsewhere(OctreeSendWorker* idler, quint64& dueUsecs) {
+    bool hasQueued = false;
+
+    foreach (OctreeSendWorker* worker, _workers) {
+        // a queue we can't peek is being changed right now, and whoever changes it wakes us if it needs to
+        quint64 workerDueUsecs = 0;
+        if (worker != idler && worker->tryPeekEarliest(workerDueUsecs) && (!hasQueued || workerDueUsecs < dueUsecs)) {
+            dueUsecs = workerDueUsecs;
+            hasQueued = true;
+        }
+    }
+
+    return hasQueued;
+}
+
+void OctreeSendPool::wakeWorkersDueBy(quint64 dueUsecs) {
+    foreach (OctreeSendWorker* worker, _workers) {
+        worker->wakeIfSleepingPast(dueUsecs);
+    }
+}
+
+int OctreeSendPool::getNumQueuedSenders() {
+    int numQueuedSenders = 0;
+    foreach (OctreeSendWorker* worker, _workers) {
+        numQueuedSenders += worker->getQueueSize();
+    }
+    return numQueuedSenders;
+}
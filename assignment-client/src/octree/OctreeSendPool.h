@@ -0,0 +1,95 @@
+//
+//  OctreeSendPool.h
+//
+//  Created by agent on 10/16/26
+//  Copyright (c) 2026 High Fidelity, Inc. All rights reserved.
+//
+//  A fixed set of threads, one per core, that run every client's OctreeSendThread when it comes due. Each worker keeps
+//  the senders it runs in its own queue, ordered by when they are next due, so a client keeps being encoded on the
+//  same core - a worker with nothing due takes whatever is most overdue from another's queue. An idle worker sleeps until
+//  the earliest sender on any worker is due, and is woken early when something due sooner is scheduled.
+//
+
+#ifndef __octree_server__OctreeSendPool__
+#define __octree_server__OctreeSendPool__
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+
+#include <GenericThread.h>
+
+#include "OctreeSendThread.h"
+
+/// the longest an idle worker sleeps without being woken - only a backstop, since scheduling wakes any worker that
+/// would otherwise sleep past the new sender's due time
+const unsigned long MAX_SEND_POOL_IDLE_MSECS = 100;
+
+/// how long a sender that couldn't get its node's lock waits before trying again, behind anything due in the meantime
+const quint64 LOCKED_SENDER_RETRY_USECS = 1000;
+
+class OctreeSendPool;
+
+/// one thread of the pool, and the senders queued on it by the time they are next due
+class OctreeSendWorker : public GenericThread {
+public:
+    OctreeSendWorker(OctreeSendPool* pool);
+
+    void schedule(const SharedOctreeSendThread& sender, quint64 dueUsecs);
+
+    /// takes this worker's earliest sender if it is due by now - other workers only try, so they never wait on us
+    bool takeDue(quint64 now, SharedOctreeSendThread& sender, quint64& dueUsecs, bool onlyTry);
+
+    /// when the earliest queued sender is due - false if none are queued, or another thread has the queue
+    bool tryPeekEarliest(quint64& dueUsecs);
+
+    int getQueueSize();
+
+    /// wakes this worker if it is asleep until after dueUsecs
+    void wakeIfSleepingPast(quint64 dueUsecs);
+
+protected:
+    /// Runs the next due sender, or waits until one is due.
+    virtual bool process();
+
+private:
+    void waitForDueSender(quint64 now);
+
+    OctreeSendPool* _pool;
+
+    QMutex _queueMutex;
+    QWaitCondition _queueChanged;
+    QMultiMap<quint64, SharedOctreeSendThread> _queue;
+    quint64 _sleepingUntil; // 0 while awake
+};
+
+/// runs the sending for every client on a thread per core instead of a thread per client
+class OctreeSendPool {
+public:
+    /// numWorkers of 0 or less means one per core
+    OctreeSendPool(int numWorkers = 0);
+    ~OctreeSendPool();
+
+    /// queues a new client's sender to run as soon as possible
+    void addSender(const SharedOctreeSendThread& sender);
+
+    /// the most overdue sender from any worker but the thief, if any are due
+    bool stealDue(OctreeSendWorker* thief, quint64 now, SharedOctreeSendThread& sender, quint64& dueUsecs);
+
+    /// when the earliest sender queued on any worker but the idler is due - false if there are none it could see
+    bool peekEarliestElsewhere(OctreeSendWorker* idler, quint64& dueUsecs);
+
+    /// a sender was scheduled for dueUsecs, so wake every worker that is asleep until after then
+    void wakeWorkersDueBy(quint64 dueUsecs);
+
+    int getNumWorkers() const { return _workers.size(); }
+    int getNumQueuedSenders();
+
+private:
+    QVector<OctreeSendWorker*> _workers;
+    QAtomicInt _nextWorker;
+};
+
+#endif // __octree_server__OctreeSendPool__
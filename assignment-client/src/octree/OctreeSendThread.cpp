@@ -5,6 +5,9 @@
 //  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
+#include <climits>
+
 #include <NodeList.h>
 #include <PacketHeaders.h>
 #include <PerfStat.h>
@@ -14,16 +17,35 @@
 #include "OctreeServer.h"
 #include "OctreeServerConsts.h"
 
-quint64 startSceneSleepTime = 0;
-quint64 endSceneSleepTime = 0;
-
 OctreeSendThread::OctreeSendThread(const QUuid& nodeUUID, OctreeServer* myServer) :
     _nodeUUID(nodeUUID),
     _myServer(myServer),
+    _stopped(0),
+    _lastLagUsecs(0),
+    _maxLagUsecs(0),
+    _numPasses(0),
+    _numLatePasses(0),
+    _startSceneSleepTime(0),
     _packetData()
 {
 }
 
+void OctreeSendThread::recordLag(quint64 lagUsecs) {
+    int lag = (int) std::min(lagUsecs, (quint64) INT_MAX);
+    _lastLagUsecs.store(lag);
+    _numPasses.fetchAndAddRelaxed(1);
+
+    // a pass that starts more than an interval late has missed one of this client's sends altogether
+    if (lag > OCTREE_SEND_INTERVAL_USECS) {
+        _numLatePasses.fetchAndAddRelaxed(1);
+    }
+
+    // only the pool worker running this sender records its lag, so there is no race to lose here
+    if (lag > _maxLagUsecs.load()) {
+        _maxLagUsecs.store(lag);
+    }
+}
+
 bool OctreeSendThread::process() {
     quint64  start = usecTimestampNow();
     bool gotLock = false;
@@ -60,31 +82,25 @@ bool OctreeSendThread::process() {
         }
     }
 
-    // Only sleep if we're still running and we got the lock last time we tried, otherwise try to get the lock asap
-    if (isStillRunning() && gotLock) {
-        // dynamically sleep until we need to fire off the next set of octree elements
+    // the pool waits out the rest of the interval before it runs us again, or runs us again asap if we didn't get the lock
+    if (gotLock) {
         int elapsed = (usecTimestampNow() - start);
-        int usecToSleep =  OCTREE_SEND_INTERVAL_USECS - elapsed;
+        _myServer->recordFrameTime(elapsed);
 
-        if (usecToSleep > 0) {
-            PerformanceWarning warn(false,"OctreeSendThread... usleep()",false,&_usleepTime,&_usleepCalls);
-            usleep(usecToSleep);
-        } else {
-            if (_myServer->wantsDebugSending() && _myServer->wantsVerboseDebug()) {
-                std::cout << "Last send took too much time, not sleeping!\n";
-            }
+        if (elapsed > OCTREE_SEND_INTERVAL_USECS && _myServer->wantsDebugSending() && _myServer->wantsVerboseDebug()) {
+            std::cout << "Last send took too much time, next one is due now!\n";
         }
     }
 
-    return isStillRunning();  // keep running till they terminate us
+    return gotLock;
 }
 
-quint64 OctreeSendThread::_usleepTime = 0;
-quint64 OctreeSendThread::_usleepCalls = 0;
+TrafficCounter OctreeSendThread::_usleepTime;
+TrafficCounter OctreeSendThread::_usleepCalls;
 
-quint64 OctreeSendThread::_totalBytes = 0;
-quint64 OctreeSendThread::_totalWastedBytes = 0;
-quint64 OctreeSendThread::_totalPackets = 0;
+TrafficCounter OctreeSendThread::_totalBytes;
+TrafficCounter OctreeSendThread::_totalWastedBytes;
+TrafficCounter OctreeSendThread::_totalPackets;
 
 int OctreeSendThread::handlePacketSend(const SharedNodePointer& node, OctreeQueryNode* nodeData, int& trueBytesSent, int& truePacketsSent) {
     bool debug = _myServer->wantsDebugSending();
@@ -131,14 +147,14 @@ int OctreeSendThread::handlePacketSend(const SharedNodePointer& node, OctreeQuer
             // since a stats message is only included on end of scene, don't consider any of these bytes "wasted", since
             // there was nothing else to send.
             int thisWastedBytes = 0;
-            _totalWastedBytes += thisWastedBytes;
-            _totalBytes += nodeData->getPacketLength();
-            _totalPackets++;
+            _totalWastedBytes.add(thisWastedBytes);
+            _totalBytes.add(nodeData->getPacketLength());
+            _totalPackets.add(1);
             if (debug) {
-                qDebug() << "Adding stats to packet at " << now << " [" << _totalPackets <<"]: sequence: " << sequence <<
+                qDebug() << "Adding stats to packet at " << now << " [" << _totalPackets.getTotal() <<"]: sequence: " << sequence <<
                         " statsMessageLength: " << statsMessageLength <<
-                        " original size: " << nodeData->getPacketLength() << " [" << _totalBytes <<
-                        "] wasted bytes:" << thisWastedBytes << " [" << _totalWastedBytes << "]";
+                        " original size: " << nodeData->getPacketLength() << " [" << _totalBytes.getTotal() <<
+                        "] wasted bytes:" << thisWastedBytes << " [" << _totalWastedBytes.getTotal() << "]";
             }
 
             // actually send it
@@ -151,13 +167,13 @@ int OctreeSendThread::handlePacketSend(const SharedNodePointer& node, OctreeQuer
             // since a stats message is only included on end of scene, don't consider any of these bytes "wasted", since
             // there was nothing else to send.
             int thisWastedBytes = 0;
-            _totalWastedBytes += thisWastedBytes;
-            _totalBytes += statsMessageLength;
-            _totalPackets++;
+            _totalWastedBytes.add(thisWastedBytes);
+            _totalBytes.add(statsMessageLength);
+            _totalPackets.add(1);
             if (debug) {
-                qDebug() << "Sending separate stats packet at " << now << " [" << _totalPackets <<"]: sequence: " << sequence <<
-                        " size: " << statsMessageLength << " [" << _totalBytes <<
-                        "] wasted bytes:" << thisWastedBytes << " [" << _totalWastedBytes << "]";
+                qDebug() << "Sending separate stats packet at " << now << " [" << _totalPackets.getTotal() <<"]: sequence: " << sequence <<
+                        " size: " << statsMessageLength << " [" << _totalBytes.getTotal() <<
+                        "] wasted bytes:" << thisWastedBytes << " [" << _totalWastedBytes.getTotal() << "]";
             }
 
             trueBytesSent += statsMessageLength;
@@ -170,13 +186,13 @@ int OctreeSendThread::handlePacketSend(const SharedNodePointer& node, OctreeQuer
             packetSent = true;
 
             thisWastedBytes = MAX_PACKET_SIZE - nodeData->getPacketLength();
-            _totalWastedBytes += thisWastedBytes;
-            _totalBytes += nodeData->getPacketLength();
-            _totalPackets++;
+            _totalWastedBytes.add(thisWastedBytes);
+            _totalBytes.add(nodeData->getPacketLength());
+            _totalPackets.add(1);
             if (debug) {
-                qDebug() << "Sending packet at " << now << " [" << _totalPackets <<"]: sequence: " << sequence <<
-                        " size: " << nodeData->getPacketLength() << " [" << _totalBytes <<
-                        "] wasted bytes:" << thisWastedBytes << " [" << _totalWastedBytes << "]";
+                qDebug() << "Sending packet at " << now << " [" << _totalPackets.getTotal() <<"]: sequence: " << sequence <<
+                        " size: " << nodeData->getPacketLength() << " [" << _totalBytes.getTotal() <<
+                        "] wasted bytes:" << thisWastedBytes << " [" << _totalWastedBytes.getTotal() << "]";
             }
         }
         nodeData->stats.markAsSent();
@@ -189,13 +205,13 @@ int OctreeSendThread::handlePacketSend(const SharedNodePointer& node, OctreeQuer
             packetSent = true;
 
             int thisWastedBytes = MAX_PACKET_SIZE - nodeData->getPacketLength();
-            _totalWastedBytes += thisWastedBytes;
-            _totalBytes += nodeData->getPacketLength();
-            _totalPackets++;
+            _totalWastedBytes.add(thisWastedBytes);
+            _totalBytes.add(nodeData->getPacketLength());
+            _totalPackets.add(1);
             if (debug) {
-                qDebug() << "Sending packet at " << now << " [" << _totalPackets <<"]: sequence: " << sequence <<
-                        " size: " << nodeData->getPacketLength() << " [" << _totalBytes <<
-                        "] wasted bytes:" << thisWastedBytes << " [" << _totalWastedBytes << "]";
+                qDebug() << "Sending packet at " << now << " [" << _totalPackets.getTotal() <<"]: sequence: " << sequence <<
+                        " size: " << nodeData->getPacketLength() << " [" << _totalBytes.getTotal() <<
+                        "] wasted bytes:" << thisWastedBytes << " [" << _totalWastedBytes.getTotal() << "]";
             }
         }
     }
@@ -230,6 +246,14 @@ int OctreeSendThread::packetDistributor(const SharedNodePointer& node, OctreeQue
     bool wantColor = nodeData->getWantColor();
     bool wantCompression = nodeData->getWantCompression();
 
+    // every codec's packets read the same, so a change can take effect in the middle of a packet
+    _packetData.setCodec(_myServer->getCompressionCodecFor(nodeData));
+
+    // what the client has acked since the last pass decides what it still needs to be sent
+    if (_myServer->getSentStateTracker()) {
+        nodeData->applyClientAcks();
+    }
+
     // If we have a packet waiting, and our desired want color, doesn't match the current waiting packets color
     // then let's just send that waiting packet.
     if (!nodeData->getCurrentPacketFormatMatches()) {
@@ -262,6 +286,7 @@ int OctreeSendThread::packetDistributor(const SharedNodePointer& node, OctreeQue
                 debug::valueOf(wantCompression), targetSize);
         }
 
+        nodeData->sentState.discardPending();
         _packetData.changeSettings(wantCompression, targetSize);
     }
 
@@ -317,8 +342,7 @@ int OctreeSendThread::packetDistributor(const SharedNodePointer& node, OctreeQue
 
         // track completed scenes and send out the stats packet accordingly
         nodeData->stats.sceneCompleted();
-        ::endSceneSleepTime = _usleepTime;
-        unsigned long sleepTime = ::endSceneSleepTime - ::startSceneSleepTime;
+        unsigned long sleepTime = _usleepTime.getTotal() - _startSceneSleepTime;
 
         unsigned long encodeTime = nodeData->stats.getTotalEncodeTime();
         unsigned long elapsedTime = nodeData->stats.getElapsedTime();
@@ -337,9 +361,9 @@ int OctreeSendThread::packetDistributor(const SharedNodePointer& node, OctreeQue
                 << "encodeTime:" << encodeTime
                 << " sleepTime:" << sleepTime
                 << " elapsed:" << elapsedTime
-                << " Packets:" << _totalPackets
-                << " Bytes:" << _totalBytes
-                << " Wasted:" << _totalWastedBytes;
+                << " Packets:" << _totalPackets.getTotal()
+                << " Bytes:" << _totalBytes.getTotal()
+                << " Wasted:" << _totalWastedBytes.getTotal();
         }
 
         // start tracking our stats
@@ -353,12 +377,12 @@ int OctreeSendThread::packetDistributor(const SharedNodePointer& node, OctreeQue
 
         if (forceDebugging || _myServer->wantsDebugSending()) {
             qDebug() << "Scene started at " << usecTimestampNow()
-                << " Packets:" << _totalPackets
-                << " Bytes:" << _totalBytes
-                << " Wasted:" << _totalWastedBytes;
+                << " Packets:" << _totalPackets.getTotal()
+                << " Bytes:" << _totalBytes.getTotal()
+                << " Wasted:" << _totalWastedBytes.getTotal();
         }
 
-        ::startSceneSleepTime = _usleepTime;
+        _startSceneSleepTime = _usleepTime.getTotal();
         nodeData->stats.sceneStarted(isFullScene, viewFrustumChanged, _myServer->getOctree()->getRoot(), _myServer->getJurisdiction());
 
         // This is the start of "resending" the scene.
@@ -418,6 +442,10 @@ int OctreeSendThread::packetDistributor(const SharedNodePointer& node, OctreeQue
                                              wantOcclusionCulling, coverageMap, boundaryLevelAdjust, voxelSizeScale,
                                              nodeData->getLastTimeBagEmpty(),
                                              isFullScene, &nodeData->stats, _myServer->getJurisdiction());
+                params.encodeCache = _myServer->getEncodeCache();
+                if (_myServer->getSentStateTracker()) {
+                    params.sentState = &nodeData->sentState;
+                }
 
 
                 _myServer->getOctree()->lockForRead();
@@ -484,6 +512,7 @@ int OctreeSendThread::packetDistributor(const SharedNodePointer& node, OctreeQue
                                 _packetData.getUncompressedSize(), _packetData.getTargetSize());
                     }
                     nodeData->writeToPacket(_packetData.getFinalizedData(), _packetData.getFinalizedSize());
+                    nodeData->sentState.commitPending(nodeData->getCurrentPacketSequence());
                     extraPackingAttempts = 0;
                 }
 
@@ -519,6 +548,7 @@ int OctreeSendThread::packetDistributor(const SharedNodePointer& node, OctreeQue
                     qDebug("line:%d _packetData.changeSettings() wantCompression=%s targetSize=%d",__LINE__,
                         debug::valueOf(nodeData->getWantCompression()), targetSize);
                 }
+                nodeData->sentState.discardPending();
                 _packetData.changeSettings(nodeData->getWantCompression(), targetSize); // will do reset
             }
         }
@@ -4,37 +4,63 @@
 //  Created by Brad Hefta-Gaub on 8/21/13
 //  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
 //
-//  Threaded or non-threaded object for sending voxels to a client
+//  The sending for a single client - one pass at a time, run by the server's OctreeSendPool
 //
 
 #ifndef __octree_server__OctreeSendThread__
 #define __octree_server__OctreeSendThread__
 
-#include <GenericThread.h>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSharedPointer>
+
 #include <NetworkPacket.h>
 #include <OctreeElementBag.h>
+#include <TrafficStats.h>
 #include "OctreeQueryNode.h"
 #include "OctreeServer.h"
 
-/// Threaded processor for sending voxel packets to a single client
-class OctreeSendThread : public GenericThread {
+/// Sends voxel packets to a single client, one pass each time the OctreeSendPool runs it
+class OctreeSendThread {
 public:
     OctreeSendThread(const QUuid& nodeUUID, OctreeServer* myServer);
 
-    static quint64 _totalBytes;
-    static quint64 _totalWastedBytes;
-    static quint64 _totalPackets;
+    /// One send pass. Returns true if it got the node's lock, and so is done until its next interval.
+    bool process();
+
+    /// Call to stop sending - the pool drops the sender the next time it comes due
+    void terminate() { _stopped.store(1); }
+    bool isStillRunning() const { return !_stopped.load(); }
+
+    const QUuid& getNodeUUID() const { return _nodeUUID; }
+
+    /// how long after it was due the pool started a pass
+    void recordLag(quint64 lagUsecs);
 
-    static quint64 _usleepTime;
-    static quint64 _usleepCalls;
+    int getLastLagUsecs() const { return _lastLagUsecs.load(); }
+    int getMaxLagUsecs() const { return _maxLagUsecs.load(); }
+    int getNumPasses() const { return _numPasses.load(); }
+    int getNumLatePasses() const { return _numLatePasses.load(); }
 
-protected:
-    /// Implements generic processing behavior for this thread.
-    virtual bool process();
+    /// added to by every OctreeSendPool worker at once, so they are counters rather than plain totals
+    static TrafficCounter _totalBytes;
+    static TrafficCounter _totalWastedBytes;
+    static TrafficCounter _totalPackets;
+
+    /// the time the OctreeSendPool's workers spent waiting for a sender to come due
+    static TrafficCounter _usleepTime;
+    static TrafficCounter _usleepCalls;
 
 private:
     QUuid _nodeUUID;
     OctreeServer* _myServer;
+    QAtomicInt _stopped;
+
+    QAtomicInt _lastLagUsecs;
+    QAtomicInt _maxLagUsecs;
+    QAtomicInt _numPasses;
+    QAtomicInt _numLatePasses;
+
+    quint64 _startSceneSleepTime;
 
     int handlePacketSend(const SharedNodePointer& node, OctreeQueryNode* nodeData, int& trueBytesSent, int& truePacketsSent);
     int packetDistributor(const SharedNodePointer& node, OctreeQueryNode* nodeData, bool viewFrustumChanged);
@@ -42,4 +68,6 @@ private:
     OctreePacketData _packetData;
 };
 
+typedef QSharedPointer<OctreeSendThread> SharedOctreeSendThread;
+
 #endif // __octree_server__OctreeSendThread__
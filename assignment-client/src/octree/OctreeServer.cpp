@@ -6,6 +6,7 @@
 //  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
 //
 
+#include <QtCore/QJsonDocument>
 #include <QtCore/QTimer>
 #include <QtCore/QUuid>
 #include <QtNetwork/QNetworkAccessManager>
@@ -15,6 +16,7 @@
 #include <Logging.h>
 #include <UUID.h>
 
+#include "OctreeSendPool.h"
 #include "OctreeServer.h"
 #include "OctreeServerConsts.h"
 
@@ -40,10 +42,17 @@ OctreeServer::OctreeServer(const QByteArray& packet) :
     _debugSending(false),
     _debugReceiving(false),
     _verboseDebug(false),
+    _prioritySending(false),
+    _hasCompressionCodec(false),
+    _compressionCodec(DEFAULT_OCTREE_PACKET_CODEC),
     _jurisdiction(NULL),
     _jurisdictionSender(NULL),
     _octreeInboundPacketProcessor(NULL),
     _persistThread(NULL),
+    _sendPool(NULL),
+    _encodeCache(NULL),
+    _sentStateTracker(NULL),
+    _receivedPacket(),
     _started(time(0)),
     _startedUSecs(usecTimestampNow())
 {
@@ -58,6 +67,16 @@ OctreeServer::~OctreeServer() {
         delete[] _parsedArgV;
     }
 
+    // stop sending before anything the senders use goes away
+    delete _sendPool;
+    _sendPool = NULL;
+
+    delete _encodeCache;
+    _encodeCache = NULL;
+
+    delete _sentStateTracker;
+    _sentStateTracker = NULL;
+
     if (_jurisdictionSender) {
         _jurisdictionSender->terminate();
         _jurisdictionSender->deleteLater();
@@ -116,6 +135,11 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QString&
         } else if (path == "/resetStats") {
             _octreeInboundPacketProcessor->resetStats();
             showStats = true;
+        } else if (path == "/traffic.json") {
+            // packets and bytes in and out by packet type and by node
+            QJsonDocument trafficDocument(NodeList::getInstance()->getTrafficStatsJSON());
+            connection->respond(HTTPConnection::StatusCode200, trafficDocument.toJson(), "application/json");
+            return true;
         }
     }
 
@@ -226,9 +250,9 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QString&
 
         // display outbound packet stats
         statsString += QString("<b>%1 Outbound Packet Statistics...</b>\r\n").arg(getMyServerName());
-        quint64 totalOutboundPackets = OctreeSendThread::_totalPackets;
-        quint64 totalOutboundBytes = OctreeSendThread::_totalBytes;
-        quint64 totalWastedBytes = OctreeSendThread::_totalWastedBytes;
+        quint64 totalOutboundPackets = OctreeSendThread::_totalPackets.getTotal();
+        quint64 totalOutboundBytes = OctreeSendThread::_totalBytes.getTotal();
+        quint64 totalWastedBytes = OctreeSendThread::_totalWastedBytes.getTotal();
         quint64 totalBytesOfOctalCodes = OctreePacketData::getTotalBytesOfOctalCodes();
         quint64 totalBytesOfBitMasks = OctreePacketData::getTotalBytesOfBitMasks();
         quint64 totalBytesOfColor = OctreePacketData::getTotalBytesOfColor();
@@ -249,6 +273,71 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QString&
         statsString += QString().sprintf("                Total Color Bytes: %s bytes (%5.2f%%)\r\n",
             locale.toString((uint)totalBytesOfColor).rightJustified(COLUMN_WIDTH, ' ').toLocal8Bit().constData(),
             ((float)totalBytesOfColor / (float)totalOutboundBytes) * AS_PERCENT);
+        statsString += QString("               Total Compressions: %1 packets\r\n")
+            .arg(locale.toString((uint)OctreePacketData::getCompressContentCalls()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("       Total Compressions Skipped: %1 packets\r\n")
+            .arg(locale.toString((uint)OctreePacketData::getCompressContentSkips()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("           Total Compression Time: %1 usecs\r\n")
+            .arg(locale.toString((uint)OctreePacketData::getCompressContentTime()).rightJustified(COLUMN_WIDTH, ' '));
+
+        statsString += "\r\n";
+        statsString += "\r\n";
+
+        // display how much encoding the clients have shared
+        statsString += QString("<b>%1 Encode Cache Statistics...</b>\r\n").arg(getMyServerName());
+        if (_encodeCache) {
+            quint64 encodeCacheHits = _encodeCache->getHits();
+            quint64 encodeCacheLookups = encodeCacheHits + _encodeCache->getMisses();
+            statsString += QString().sprintf("                   Cache Hit Rate: %s hits (%5.2f%%)\r\n",
+                locale.toString((uint)encodeCacheHits).rightJustified(COLUMN_WIDTH, ' ').toLocal8Bit().constData(),
+                encodeCacheLookups == 0 ? 0.0f : ((float)encodeCacheHits / (float)encodeCacheLookups) * AS_PERCENT);
+            statsString += QString("               Saved Encode Time: %1 usecs\r\n")
+                .arg(locale.toString((uint)_encodeCache->getSavedEncodeUsecs()).rightJustified(COLUMN_WIDTH, ' '));
+            statsString += QString("                 Cached Subtrees: %1 elements\r\n")
+                .arg(locale.toString(_encodeCache->getNumCachedElements()).rightJustified(COLUMN_WIDTH, ' '));
+            statsString += QString("                    Cached Bytes: %1 bytes\r\n")
+                .arg(locale.toString(_encodeCache->getCachedBytes()).rightJustified(COLUMN_WIDTH, ' '));
+        } else {
+            statsString += "Encode Cache Disabled...\r\n";
+        }
+
+        statsString += "\r\n";
+        statsString += "\r\n";
+
+        // display the send threads, and how far behind its cadence each client is being sent to
+        statsString += QString("<b>%1 Send Thread Statistics...</b>\r\n").arg(getMyServerName());
+        statsString += QString("                     Send Threads: %1 threads\r\n")
+            .arg(locale.toString(_sendPool ? _sendPool->getNumWorkers() : 0).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("                  Clients Waiting: %1 clients\r\n")
+            .arg(locale.toString(_sendPool ? _sendPool->getNumQueuedSenders() : 0).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("                  Total Idle Time: %1 usecs\r\n")
+            .arg(locale.toString((uint)OctreeSendThread::_usleepTime.getTotal()).rightJustified(COLUMN_WIDTH, ' '));
+
+        int clientNumber = 0;
+        NodeSnapshotPointer nodeSnapshot = NodeList::getInstance()->getNodeSnapshot();
+        foreach (const SharedNodePointer& node, nodeSnapshot->getNodeHash()) {
+            OctreeQueryNode* nodeData = (OctreeQueryNode*) node->getLinkedData();
+            if (!nodeData || !nodeData->isOctreeSendThreadInitalized()) {
+                continue;
+            }
+
+            clientNumber++;
+            const QSharedPointer<OctreeSendThread>& sender = nodeData->getOctreeSendThread();
+
+            statsString += QString("\r\n             Send lag for client %1 uuid: %2\r\n")
+                .arg(clientNumber).arg(node->getUUID().toString());
+            statsString += QString("                    Last Send Lag: %1 usecs\r\n")
+                .arg(locale.toString(sender->getLastLagUsecs()).rightJustified(COLUMN_WIDTH, ' '));
+            statsString += QString("                     Max Send Lag: %1 usecs\r\n")
+                .arg(locale.toString(sender->getMaxLagUsecs()).rightJustified(COLUMN_WIDTH, ' '));
+            statsString += QString("                       Late Sends: %1 of %2 sends\r\n")
+                .arg(locale.toString(sender->getNumLatePasses()).rightJustified(COLUMN_WIDTH, ' '))
+                .arg(locale.toString(sender->getNumPasses()));
+            statsString += QString("                    Elements Held: %1 elements\r\n")
+                .arg(locale.toString(nodeData->sentState.getNumHeld()).rightJustified(COLUMN_WIDTH, ' '));
+            statsString += QString("                 Elements Unacked: %1 elements\r\n")
+                .arg(locale.toString(nodeData->sentState.getNumUnacked()).rightJustified(COLUMN_WIDTH, ' '));
+        }
 
         statsString += "\r\n";
         statsString += "\r\n";
@@ -281,6 +370,10 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QString&
             .arg(locale.toString((uint)averageProcessTimePerElement).rightJustified(COLUMN_WIDTH, ' '));
         statsString += QString("  Average Wait Lock Time/Element: %1 usecs\r\n")
             .arg(locale.toString((uint)averageLockWaitTimePerElement).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString("       Packet Buffer Allocations: %1 allocations\r\n")
+            .arg(locale.toString((uint)_octreeInboundPacketProcessor->getBufferAllocations()).rightJustified(COLUMN_WIDTH, ' '));
+        statsString += QString().sprintf("Packet Buffer Allocations/Second: %f allocations/second\r\n",
+            _octreeInboundPacketProcessor->getBufferAllocationsPerSecond());
 
 
         int senderNumber = 0;
@@ -419,6 +512,10 @@ bool OctreeServer::handleHTTPRequest(HTTPConnection* connection, const QString&
 
 }
 
+OctreePacketCodec OctreeServer::getCompressionCodecFor(const OctreeQuery* query) const {
+    return _hasCompressionCodec ? _compressionCodec : query->getCompressionCodec();
+}
+
 void OctreeServer::setArguments(int argc, char** argv) {
     _argc = argc;
     _argv = const_cast<const char**>(argv);
@@ -458,17 +555,36 @@ void OctreeServer::parsePayload() {
     }
 }
 
+void OctreeServer::reallocateReceivedPacketIfKept() {
+    if (_receivedPacket.isDetached() && _receivedPacket.capacity() >= MAX_PACKET_SIZE) {
+        return;
+    }
+
+    _receivedPacket = QByteArray();
+    _receivedPacket.reserve(MAX_PACKET_SIZE);
+
+    // counted with the inbound processor's, they are all allocations between receiving a packet and processing it
+    if (_octreeInboundPacketProcessor) {
+        _octreeInboundPacketProcessor->recordBufferAllocation();
+    }
+}
+
 void OctreeServer::readPendingDatagrams() {
-    QByteArray receivedPacket;
     HifiSockAddr senderSockAddr;
     
     NodeList* nodeList = NodeList::getInstance();
     
-    while (readAvailableDatagram(receivedPacket, senderSockAddr)) {
-        if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
-            PacketType packetType = packetTypeForPacket(receivedPacket);
+    // the packet is copied wherever it is queued, so the buffer is normally free again by the next read
+    forever {
+        reallocateReceivedPacketIfKept();
+        if (!readAvailableDatagram(_receivedPacket, senderSockAddr)) {
+            break;
+        }
+        
+        if (nodeList->packetVersionAndHashMatch(_receivedPacket)) {
+            PacketType packetType = packetTypeForPacket(_receivedPacket);
             
-            SharedNodePointer matchingNode = nodeList->sendingNodeForPacket(receivedPacket);
+            SharedNodePointer matchingNode = nodeList->sendingNodeForPacket(_receivedPacket);
             
             if (packetType == getMyQueryMessageType()) {
                 bool debug = false;
@@ -479,20 +595,20 @@ void OctreeServer::readPendingDatagrams() {
                 // If we got a PacketType_VOXEL_QUERY, then we're talking to an NodeType_t_AVATAR, and we
                 // need to make sure we have it in our nodeList.
                 if (matchingNode) {
-                    nodeList->updateNodeWithDataFromPacket(matchingNode, receivedPacket);
+                    nodeList->updateNodeWithDataFromPacket(matchingNode, _receivedPacket);
                     
                     OctreeQueryNode* nodeData = (OctreeQueryNode*) matchingNode->getLinkedData();
-                    if (nodeData && !nodeData->isOctreeSendThreadInitalized()) {
+                    if (nodeData && !nodeData->isOctreeSendThreadInitalized() && _sendPool) {
                         nodeData->initializeOctreeSendThread(this, matchingNode->getUUID());
                     }
                 }
             } else if (packetType == PacketTypeJurisdictionRequest) {
-                _jurisdictionSender->queueReceivedPacket(matchingNode, receivedPacket);
+                _jurisdictionSender->queueReceivedPacket(matchingNode, _receivedPacket);
             } else if (_octreeInboundPacketProcessor && getOctree()->handlesEditPacketType(packetType)) {
-                _octreeInboundPacketProcessor->queueReceivedPacket(matchingNode, receivedPacket);
+                _octreeInboundPacketProcessor->queueReceivedPacket(matchingNode, _receivedPacket);
             } else {
                 // let processNodeData handle it.
-                NodeList::getInstance()->processNodeData(senderSockAddr, receivedPacket);
+                NodeList::getInstance()->processNodeData(senderSockAddr, _receivedPacket);
             }
         }
     }
@@ -572,6 +688,41 @@ void OctreeServer::run() {
     _debugReceiving =  cmdOptionExists(_argc, _argv, DEBUG_RECEIVING);
     qDebug("debugReceiving=%s", debug::valueOf(_debugReceiving));
 
+    // send each client what will look biggest from where it is first, rather than in tree order
+    const char* PRIORITY_SENDING = "--prioritySending";
+    _prioritySending = cmdOptionExists(_argc, _argv, PRIORITY_SENDING);
+    qDebug("prioritySending=%s", debug::valueOf(_prioritySending));
+
+    // a CPU or bandwidth bound server can compress for every client the same way, whatever they asked for
+    const char* COMPRESSION_CODEC = "--compressionCodec";
+    const char* compressionCodec = getCmdOption(_argc, _argv, COMPRESSION_CODEC);
+    if (compressionCodec) {
+        _hasCompressionCodec = OctreePacketData::codecForName(compressionCodec, _compressionCodec);
+        qDebug("compressionCodec=%s%s", compressionCodec, _hasCompressionCodec ? "" : " (unknown, using the client's)");
+    }
+
+    // subtrees are encoded once for every client that sees them the same way, unless the cache is turned off with 0 -
+    // it hooks element updates, so it has to exist before the persist thread starts loading the tree
+    const char* ENCODE_CACHE_MB = "--encodeCacheMB";
+    const char* encodeCacheMB = getCmdOption(_argc, _argv, ENCODE_CACHE_MB);
+    int encodeCacheBytes = DEFAULT_ENCODE_CACHE_BYTES;
+    if (encodeCacheMB) {
+        encodeCacheBytes = atoi(encodeCacheMB) * 1024 * 1024;
+        qDebug("encodeCacheMB=%s", encodeCacheMB);
+    }
+    if (encodeCacheBytes > 0) {
+        _encodeCache = new OctreeEncodeCache(encodeCacheBytes);
+    }
+
+    // clients are only sent what they don't already have, unless that's turned off - like the encode cache, the tracker
+    // hooks element updates, so it is set up before the persist thread starts
+    const char* NO_SENT_STATE = "--noSentState";
+    if (cmdOptionExists(_argc, _argv, NO_SENT_STATE)) {
+        qDebug("noSentState=true");
+    } else {
+        _sentStateTracker = new OctreeSentStateTracker();
+    }
+
     // By default we will persist, if you want to disable this, then pass in this parameter
     const char* NO_PERSIST = "--NoPersist";
     if (cmdOptionExists(_argc, _argv, NO_PERSIST)) {
@@ -622,6 +773,16 @@ void OctreeServer::run() {
         qDebug("packetsPerSecond=%s PACKETS_PER_CLIENT_PER_INTERVAL=%d", packetsPerSecond, _packetsPerClientPerInterval);
     }
 
+    // the clients are sent to by a pool of threads, by default one for each core
+    const char* SEND_THREADS = "--sendThreads";
+    const char* sendThreads = getCmdOption(_argc, _argv, SEND_THREADS);
+    int numSendThreads = 0;
+    if (sendThreads) {
+        numSendThreads = atoi(sendThreads);
+        qDebug("sendThreads=%s", sendThreads);
+    }
+    _sendPool = new OctreeSendPool(numSendThreads);
+
     HifiSockAddr senderSockAddr;
 
     // set up our jurisdiction broadcaster...
@@ -648,11 +809,7 @@ void OctreeServer::run() {
     }
     qDebug() << "Now running... started at: " << localBuffer << utcBuffer;
 
-    QTimer* domainServerTimer = new QTimer(this);
-    connect(domainServerTimer, SIGNAL(timeout()), this, SLOT(checkInWithDomainServerOrExit()));
-    domainServerTimer->start(DOMAIN_SERVER_CHECK_IN_USECS / 1000);
-
-    QTimer* silentNodeTimer = new QTimer(this);
-    connect(silentNodeTimer, SIGNAL(timeout()), nodeList, SLOT(removeSilentNodes()));
-    silentNodeTimer->start(NODE_SILENCE_THRESHOLD_USECS / 1000);
+    // capture, replay and the domain server and node timers are set up the same way as for the other assignments,
+    // once everything a replayed datagram can reach exists
+    commonInit(getMyLoggingServerTargetName(), getMyNodeType());
 }
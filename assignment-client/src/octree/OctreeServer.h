@@ -15,6 +15,8 @@
 #include <QtCore/QCoreApplication>
 
 #include <HTTPManager.h>
+#include <OctreeEncodeCache.h>
+#include <OctreeSentState.h>
 
 #include <ThreadedAssignment.h>
 #include <EnvironmentData.h>
@@ -24,6 +26,8 @@
 #include "OctreeServerConsts.h"
 #include "OctreeInboundPacketProcessor.h"
 
+class OctreeSendPool;
+
 /// Handles assignments of type OctreeServer - sending octrees to various clients.
 class OctreeServer : public ThreadedAssignment, public HTTPRequestHandler {
     Q_OBJECT
@@ -37,12 +41,20 @@ public:
     bool wantsDebugSending() const { return _debugSending; }
     bool wantsDebugReceiving() const { return _debugReceiving; }
     bool wantsVerboseDebug() const { return _verboseDebug; }
+    bool wantsPrioritySending() const { return _prioritySending; }
+
+    /// the codec a client's compressed packets are compressed with - its own choice unless the server was given one
+    OctreePacketCodec getCompressionCodecFor(const OctreeQuery* query) const;
 
     Octree* getOctree() { return _tree; }
     JurisdictionMap* getJurisdiction() { return _jurisdiction; }
 
     int getPacketsPerClientPerInterval() const { return _packetsPerClientPerInterval; }
 
+    OctreeSendPool* getSendPool() { return _sendPool; }
+    OctreeEncodeCache* getEncodeCache() { return _encodeCache; }
+    OctreeSentStateTracker* getSentStateTracker() { return _sentStateTracker; }
+
     bool isInitialLoadComplete() const { return (_persistThread) ? _persistThread->isInitialLoadComplete() : true; }
     bool isPersistEnabled() const { return (_persistThread) ? true : false; }
     quint64 getLoadElapsedTime() const { return (_persistThread) ? _persistThread->getLoadElapsedTime() : 0; }
@@ -73,6 +85,9 @@ protected:
     void parsePayload();
     void initHTTPManager(int port);
 
+    /// gives _receivedPacket room for the largest packet again if the last packet read into it was kept
+    void reallocateReceivedPacketIfKept();
+
     int _argc;
     const char** _argv;
     char** _parsedArgV;
@@ -86,10 +101,18 @@ protected:
     bool _debugSending;
     bool _debugReceiving;
     bool _verboseDebug;
+    bool _prioritySending;
+    bool _hasCompressionCodec;
+    OctreePacketCodec _compressionCodec;
     JurisdictionMap* _jurisdiction;
     JurisdictionSender* _jurisdictionSender;
     OctreeInboundPacketProcessor* _octreeInboundPacketProcessor;
     OctreePersistThread* _persistThread;
+    OctreeSendPool* _sendPool;
+    OctreeEncodeCache* _encodeCache;
+    OctreeSentStateTracker* _sentStateTracker;
+
+    QByteArray _receivedPacket; // every datagram is read into this, so it is only allocated when a packet is kept
 
     static OctreeServer* _instance;
 
@@ -63,7 +63,9 @@ void ParticleServer::particleCreated(const Particle& newParticle, const SharedNo
     copyAt += sizeof(particleID);
     packetLength += sizeof(particleID);
 
-    NodeList::getInstance()->writeDatagram((char*) outputBuffer, packetLength, senderNode);
+    // the sender can't map its particle to the new ID without this, so it goes on a reliable channel
+    NodeList::getInstance()->writeDatagramOnChannel(QByteArray((char*) outputBuffer, packetLength), senderNode,
+                                                    ChannelID::ParticleAddResponses, ChannelMode::Reliable);
 }
 
 
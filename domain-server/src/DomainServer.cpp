@@ -235,6 +235,7 @@ void DomainServer::readAvailableDatagrams() {
         receivedPacket.resize(nodeList->getNodeSocket().pendingDatagramSize());
         nodeList->getNodeSocket().readDatagram(receivedPacket.data(), receivedPacket.size(),
                                                senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+        nodeList->recordIncomingDatagram(receivedPacket);
         
         if (nodeList->packetVersionAndHashMatch(receivedPacket)) {
             PacketType requestType = packetTypeForPacket(receivedPacket);
@@ -340,6 +341,7 @@ void DomainServer::readAvailableDatagrams() {
                     checkInNode->setLastHeardMicrostamp(timeNow);
                     
                     // send the constructed list back to this node
+                    nodeList->getTrafficStats().recordOutgoing(PacketTypeDomainList, broadcastPacket.size());
                     nodeList->getNodeSocket().writeDatagram(broadcastPacket,
                                                             senderSockAddr.getAddress(), senderSockAddr.getPort());
                 }
@@ -363,6 +365,7 @@ void DomainServer::readAvailableDatagrams() {
                     
                     assignmentStream << *assignmentToDeploy.data();
                     
+                    nodeList->getTrafficStats().recordOutgoing(PacketTypeCreateAssignment, assignmentPacket.size());
                     nodeList->getNodeSocket().writeDatagram(assignmentPacket,
                                                             senderSockAddr.getAddress(), senderSockAddr.getPort());
                 } else {
@@ -484,6 +487,12 @@ bool DomainServer::handleHTTPRequest(HTTPConnection* connection, const QString&
             
             // send the response
             connection->respond(HTTPConnection::StatusCode200, nodesDocument.toJson(), qPrintable(JSON_MIME_TYPE));
+        } else if (path == "/traffic.json") {
+            // packets and bytes in and out by packet type and by node
+            QJsonDocument trafficDocument(NodeList::getInstance()->getTrafficStatsJSON());
+            connection->respond(HTTPConnection::StatusCode200, trafficDocument.toJson(), qPrintable(JSON_MIME_TYPE));
+            
+            return true;
         }
     } else if (connection->requestOperation() == QNetworkAccessManager::PostOperation) {
         if (path == URI_ASSIGNMENT) {
@@ -246,6 +246,12 @@ Application::Application(int& argc, char** argv, timeval &startup_time) :
     silentNodeTimer->moveToThread(_nodeThread);
     silentNodeTimer->start(NODE_SILENCE_THRESHOLD_USECS / 1000);
     
+    // retransmit what the reliable channels (edits, identity) have not had acknowledged, from the _nodeThread as well
+    QTimer* channelTimeoutTimer = new QTimer();
+    connect(channelTimeoutTimer, SIGNAL(timeout()), nodeList, SLOT(processChannelTimeouts()));
+    channelTimeoutTimer->moveToThread(_nodeThread);
+    channelTimeoutTimer->start(CHANNEL_TIMEOUT_CHECK_INTERVAL_MSECS);
+    
     // send the identity packet for our avatar each second to our avatar mixer
     QTimer* identityPacketTimer = new QTimer();
     connect(identityPacketTimer, &QTimer::timeout, _myAvatar, &MyAvatar::sendIdentityPacket);
@@ -1543,6 +1549,9 @@ void Application::setRenderVoxels(bool voxelRender) {
 
 void Application::doKillLocalVoxels() {
     _wantToKillLocalVoxels = true;
+
+    // the servers think we still have what they sent, so our next queries tell them we don't
+    _voxelQuery.incrementOctreeKillCount();
 }
 
 void Application::removeVoxel(glm::vec3 position,
@@ -2360,6 +2369,7 @@ void Application::updateMyAvatar(float deltaTime) {
     // send head/hand data to the avatar mixer and voxel server
     QByteArray packet = byteArrayWithPopluatedHeader(PacketTypeAvatarData);
     packet.append(_myAvatar->toByteArray());
+    _avatarManager.appendBulkAvatarDataAck(packet);
 
     controlledBroadcastToNodes(packet, NodeSet() << NodeType::AvatarMixer);
 
@@ -2391,6 +2401,8 @@ void Application::queryOctree(NodeType_t serverType, PacketType packetType, Node
     _voxelQuery.setWantDelta(!Menu::getInstance()->isOptionChecked(MenuOption::DisableDeltaSending));
     _voxelQuery.setWantOcclusionCulling(Menu::getInstance()->isOptionChecked(MenuOption::EnableOcclusionCulling));
     _voxelQuery.setWantCompression(Menu::getInstance()->isOptionChecked(MenuOption::EnableVoxelPacketCompression));
+    _voxelQuery.setCompressionCodec(Menu::getInstance()->isOptionChecked(MenuOption::FastVoxelPacketCompression)
+                                    ? OCTREE_CODEC_ZLIB_FAST : OCTREE_CODEC_ZLIB_BEST);
 
     _voxelQuery.setCameraPosition(_viewFrustum.getPosition());
     _voxelQuery.setCameraOrientation(_viewFrustum.getOrientation());
@@ -2540,6 +2552,18 @@ void Application::queryOctree(NodeType_t serverType, PacketType packetType, Node
             } else {
                 _voxelQuery.setMaxOctreePacketsPerSecond(0);
             }
+            // tell the server which of its packets got here, so it only counts us as having what actually arrived
+            bool hasOctreeAck = false;
+            OCTREE_PACKET_SEQUENCE ackedSequence = 0;
+            quint64 ackedReceivedBits = 0;
+            _voxelSceneStatsLock.lockForRead();
+            NodeToVoxelSceneStats::const_iterator serverStats = _octreeServerSceneStats.find(nodeUUID);
+            if (serverStats != _octreeServerSceneStats.end()) {
+                hasOctreeAck = serverStats->second.getIncomingAck(ackedSequence, ackedReceivedBits);
+            }
+            _voxelSceneStatsLock.unlock();
+            _voxelQuery.setOctreeAck(hasOctreeAck, ackedSequence, ackedReceivedBits);
+
             // set up the packet for sending...
             unsigned char* endOfVoxelQueryPacket = voxelQueryPacket;
 
@@ -2552,7 +2576,7 @@ void Application::queryOctree(NodeType_t serverType, PacketType packetType, Node
             int packetLength = endOfVoxelQueryPacket - voxelQueryPacket;
 
             // make sure we still have an active socket
-            nodeList->writeDatagram(reinterpret_cast<const char*>(voxelQueryPacket), packetLength, node);
+            nodeList->writeDatagram(reinterpret_cast<char*>(voxelQueryPacket), packetLength, node);
 
             // Feed number of bytes to corresponding channel of the bandwidth meter
             _bandwidthMeter.outputStream(BandwidthMeter::VOXELS).updateValue(packetLength);
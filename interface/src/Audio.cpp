@@ -37,6 +37,17 @@ static const short JITTER_BUFFER_SAMPLES = JITTER_BUFFER_LENGTH_MSECS * NUM_AUDI
 
 static const float AUDIO_CALLBACK_MSECS = (float) NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL / (float)SAMPLE_RATE * 1000.0;
 
+// a frame is voice when it is louder than both this and the noise floor by VOICE_TO_NOISE_RATIO
+static const float MIN_VOICE_LOUDNESS = 20.0f;
+static const float VOICE_TO_NOISE_RATIO = 2.0f;
+
+// the noise floor drops straight to any quieter frame, but only creeps up towards louder frames that are not voice -
+// otherwise sustained speech or music would raise it until the gate closed on them
+static const float NOISE_FLOOR_RISE_RATE = 0.002f;
+
+// keep sending audio for this many frames after the last voice frame, so the ends of words are not cut off
+static const int VOICE_HANGOVER_FRAMES = 20;
+
 // Mute icon configration
 static const int ICON_SIZE = 24;
 static const int ICON_LEFT = 0;
@@ -65,6 +76,8 @@ Audio::Audio(Oscilloscope* scope, int16_t initialJitterBufferSamples, QObject* p
     _measuredJitter(0),
     _jitterBufferSamples(initialJitterBufferSamples),
     _lastInputLoudness(0),
+    _inputNoiseFloor(MIN_VOICE_LOUDNESS),
+    _numFramesSinceVoice(VOICE_HANGOVER_FRAMES + 1),
     _lastVelocity(0),
     _lastAcceleration(0),
     _totalPacketsReceived(0),
@@ -289,6 +302,7 @@ void Audio::start() {
 
 void Audio::handleAudioInput() {
     static char monoAudioDataPacket[MAX_PACKET_SIZE];
+    static char silentAudioFramePacket[MAX_PACKET_HEADER_BYTES + sizeof(quint16) + sizeof(glm::vec3) + sizeof(glm::quat)];
 
     static int numBytesPacketHeader = numBytesForPacketHeaderGivenPacketType(PacketTypeMicrophoneAudioNoEcho);
     static int leadingBytes = numBytesPacketHeader + sizeof(glm::vec3) + sizeof(glm::quat);
@@ -327,6 +341,7 @@ void Audio::handleAudioInput() {
     }
 
     _inputRingBuffer.writeData(inputByteArray.data(), inputByteArray.size());
+    _inputRingBuffer.consumeResetRequest();
 
     while (_inputRingBuffer.samplesAvailable() > inputSamplesRequired) {
 
@@ -385,6 +400,31 @@ void Audio::handleAudioInput() {
         
         _proceduralOutputDevice->write(proceduralOutput);
 
+        // gate the frame on voice activity - the mixer is only sent a sample count for frames with nothing worth hearing
+        float frameLoudness = 0;
+
+        for (int i = 0; i < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL; i++) {
+            frameLoudness += fabsf(monoAudioSamples[i]);
+        }
+
+        frameLoudness /= NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+
+        bool isVoiceFrame = frameLoudness > glm::max(MIN_VOICE_LOUDNESS, _inputNoiseFloor * VOICE_TO_NOISE_RATIO);
+
+        if (frameLoudness < _inputNoiseFloor) {
+            _inputNoiseFloor = frameLoudness;
+        } else if (!isVoiceFrame) {
+            _inputNoiseFloor += (frameLoudness - _inputNoiseFloor) * NOISE_FLOOR_RISE_RATE;
+        }
+
+        if (isVoiceFrame) {
+            _numFramesSinceVoice = 0;
+        } else if (_numFramesSinceVoice <= VOICE_HANGOVER_FRAMES) {
+            _numFramesSinceVoice++;
+        }
+
+        bool isSilentFrame = _numFramesSinceVoice > VOICE_HANGOVER_FRAMES;
+
         NodeList* nodeList = NodeList::getInstance();
         SharedNodePointer audioMixer = nodeList->soloNodeOfType(NodeType::AudioMixer);
         
@@ -396,6 +436,30 @@ void Audio::handleAudioInput() {
             // we need the amount of bytes in the buffer + 1 for type
             // + 12 for 3 floats for position + float for bearing + 1 attenuation byte
 
+            if (isSilentFrame) {
+                // the mixer still needs to know where we are hearing from, but not the zeros
+                char* silentPacketPtr = silentAudioFramePacket + populatePacketHeader(silentAudioFramePacket,
+                                                                                     PacketTypeSilentAudioFrame);
+
+                quint16 numSilentSamples = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+                memcpy(silentPacketPtr, &numSilentSamples, sizeof(numSilentSamples));
+                silentPacketPtr += sizeof(numSilentSamples);
+
+                memcpy(silentPacketPtr, &headPosition, sizeof(headPosition));
+                silentPacketPtr += sizeof(headPosition);
+
+                memcpy(silentPacketPtr, &headOrientation, sizeof(headOrientation));
+                silentPacketPtr += sizeof(headOrientation);
+
+                nodeList->writeDatagram(silentAudioFramePacket, silentPacketPtr - silentAudioFramePacket, audioMixer);
+
+                Application::getInstance()->getBandwidthMeter()->outputStream(BandwidthMeter::AUDIO)
+                    .updateValue(silentPacketPtr - silentAudioFramePacket);
+
+                delete[] inputAudioSamples;
+                continue;
+            }
+
             PacketType packetType = Menu::getInstance()->isOptionChecked(MenuOption::EchoServerAudio)
                 ? PacketTypeMicrophoneAudioWithEcho : PacketTypeMicrophoneAudioNoEcho;
 
@@ -449,6 +513,9 @@ void Audio::addReceivedAudioToBuffer(const QByteArray& audioByteArray) {
 
     _ringBuffer.parseData(audioByteArray);
 
+    // if that filled the ring buffer, drop what is there and start buffering again
+    _ringBuffer.consumeResetRequest();
+
     static float networkOutputToOutputRatio = (_desiredOutputFormat.sampleRate() / (float) _outputFormat.sampleRate())
         * (_desiredOutputFormat.channelCount() / (float) _outputFormat.channelCount());
     
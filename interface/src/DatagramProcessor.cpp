@@ -32,11 +32,8 @@ void DatagramProcessor::processDatagrams() {
     Application* application = Application::getInstance();
     NodeList* nodeList = NodeList::getInstance();
     
-    while (NodeList::getInstance()->getNodeSocket().hasPendingDatagrams()) {
-        incomingPacket.resize(nodeList->getNodeSocket().pendingDatagramSize());
-        nodeList->getNodeSocket().readDatagram(incomingPacket.data(), incomingPacket.size(),
-                                               senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
-        
+    // reading through the NodeList handles channel packets, and hands out the packets they carry in their place
+    while (nodeList->readDatagram(incomingPacket, senderSockAddr)) {
         _packetCount++;
         _byteCount += incomingPacket.size();
         
@@ -50,6 +47,7 @@ void DatagramProcessor::processDatagrams() {
                     
                     break;
                 case PacketTypeMixedAudio:
+                case PacketTypeSilentAudioFrame:
                     QMetaObject::invokeMethod(&application->_audio, "addReceivedAudioToBuffer", Qt::QueuedConnection,
                                               Q_ARG(QByteArray, incomingPacket));
                     break;
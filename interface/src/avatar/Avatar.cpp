@@ -346,16 +346,14 @@ void Avatar::setSkeletonModelURL(const QUrl &skeletonModelURL) {
     _skeletonModel.setURL(skeletonModelURL);
 }
 
-int Avatar::parseData(const QByteArray& packet) {
+void Avatar::applyWireState(const AvatarWireState& wireState) {
     // change in position implies movement
     glm::vec3 oldPosition = _position;
     
-    int bytesRead = AvatarData::parseData(packet);
+    AvatarData::applyWireState(wireState);
     
     const float MOVE_DISTANCE_THRESHOLD = 0.001f;
     _moving = glm::distance(oldPosition, _position) > MOVE_DISTANCE_THRESHOLD;
-    
-    return bytesRead;
 }
 
 // render a makeshift cone section that serves as a body part connecting joint spheres
@@ -116,7 +116,7 @@ public:
     virtual void setFaceModelURL(const QUrl& faceModelURL);
     virtual void setSkeletonModelURL(const QUrl& skeletonModelURL);
     
-    int parseData(const QByteArray& packet);
+    virtual void applyWireState(const AvatarWireState& wireState);
 
     static void renderJointConnectingCone(glm::vec3 position1, glm::vec3 position2, float radius1, float radius2);
 
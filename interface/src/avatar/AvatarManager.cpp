@@ -20,7 +20,9 @@
 const QUuid MY_AVATAR_KEY;  // NULL key
 
 AvatarManager::AvatarManager(QObject* parent) :
-    _avatarFades() {
+    _avatarFades(),
+    _receivedWireStates(),
+    _bulkAvatarDataAcks() {
     // register a meta type for the weak pointer we'll use for the owning avatar mixer for each avatar
     qRegisterMetaType<QWeakPointer<Node> >("NodeWeakPointer");
     _myAvatar = QSharedPointer<MyAvatar>(new MyAvatar());
@@ -139,17 +141,54 @@ void AvatarManager::processAvatarMixerDatagram(const QByteArray& datagram, const
     }
 }
 
+void AvatarManager::appendBulkAvatarDataAck(QByteArray& packet) const {
+    _bulkAvatarDataAcks.appendAck(packet);
+}
+
 void AvatarManager::processAvatarDataPacket(const QByteArray &datagram, const QWeakPointer<Node> &mixerWeakPointer) {
     int bytesRead = numBytesForPacketHeader(datagram);
     
-    QByteArray dummyAvatarByteArray = byteArrayWithPopluatedHeader(PacketTypeAvatarData);
-    int numDummyHeaderBytes = dummyAvatarByteArray.size();
-    int numDummyHeaderBytesWithoutUUID = numDummyHeaderBytes - NUM_BYTES_RFC4122_UUID;
+    quint16 sequence;
+    if (datagram.size() - bytesRead < (int) sizeof(sequence)) {
+        return;
+    }
+    memcpy(&sequence, datagram.constData() + bytesRead, sizeof(sequence));
+    bytesRead += sizeof(sequence);
+    
+    AvatarWireState wireState;
+    bool hasUndecodedAvatar = false;
     
     // enumerate over all of the avatars in this packet
     // only add them if mixerWeakPointer points to something (meaning that mixer is still around)
-    while (bytesRead < datagram.size() && mixerWeakPointer.data()) {
+    while (datagram.size() - bytesRead >= NUM_BYTES_RFC4122_UUID + (int) sizeof(quint16) && mixerWeakPointer.data()) {
         QUuid nodeUUID = QUuid::fromRfc4122(datagram.mid(bytesRead, NUM_BYTES_RFC4122_UUID));
+        bytesRead += NUM_BYTES_RFC4122_UUID;
+        
+        // each avatar is sent relative to a state we received before, or in full when the baseline sequence is 0
+        quint16 baselineSequence;
+        memcpy(&baselineSequence, datagram.constData() + bytesRead, sizeof(baselineSequence));
+        bytesRead += sizeof(baselineSequence);
+        
+        AvatarWireStateHistory& receivedStates = _receivedWireStates[nodeUUID];
+        const AvatarWireState* baseline = baselineSequence ? receivedStates.find(baselineSequence) : NULL;
+        
+        int numStateBytes = wireState.decode(reinterpret_cast<const unsigned char*>(datagram.constData()) + bytesRead,
+                                             datagram.size() - bytesRead, baseline);
+        if (numStateBytes < 0) {
+            // the rest of this packet is cut short
+            hasUndecodedAvatar = true;
+            break;
+        }
+        bytesRead += numStateBytes;
+        
+        if (baselineSequence && !baseline) {
+            // we no longer have the state this was sent against - by not acknowledging this packet the mixer keeps
+            // the old baseline until it ages out, and then falls back to sending the full state
+            hasUndecodedAvatar = true;
+            continue;
+        }
+        
+        receivedStates.append(sequence, wireState);
         
         AvatarSharedPointer matchingAvatar = _avatarHash.value(nodeUUID);
         
@@ -165,14 +204,11 @@ void AvatarManager::processAvatarDataPacket(const QByteArray &datagram, const QW
             qDebug() << "Adding avatar with UUID" << nodeUUID << "to AvatarManager hash.";
         }
         
-        // copy the rest of the packet to the avatarData holder so we can read the next Avatar from there
-        dummyAvatarByteArray.resize(numDummyHeaderBytesWithoutUUID);
-        
-        // make this Avatar's UUID the UUID in the packet and tack the remaining data onto the end
-        dummyAvatarByteArray.append(datagram.mid(bytesRead));
-        
-        // have the matching (or new) avatar parse the data from the packet
-        bytesRead += matchingAvatar->parseData(dummyAvatarByteArray) - numDummyHeaderBytesWithoutUUID;
+        matchingAvatar->applyWireState(wireState);
+    }
+    
+    if (!hasUndecodedAvatar) {
+        _bulkAvatarDataAcks.recordSequence(sequence);
     }
 
 }
@@ -219,6 +255,7 @@ void AvatarManager::processKillAvatar(const QByteArray& datagram) {
 AvatarHash::iterator AvatarManager::erase(const AvatarHash::iterator& iterator) {
     if (iterator.key() != MY_AVATAR_KEY) {
         qDebug() << "Removing Avatar with UUID" << iterator.key() << "from AvatarManager hash.";
+        _receivedWireStates.remove(iterator.key());
         _avatarFades.push_back(iterator.value());
         return AvatarHashMap::erase(iterator);
     } else {
@@ -235,4 +272,8 @@ void AvatarManager::clearOtherAvatars() {
         removeAvatar = erase(removeAvatar);
     }
     _myAvatar->clearLookAtTargetAvatar();
+
+    // the next avatar mixer numbers its bulk packets from the start, so nothing received so far can be acknowledged
+    _receivedWireStates.clear();
+    _bulkAvatarDataAcks.reset();
 }
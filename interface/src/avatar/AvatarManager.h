@@ -33,6 +33,9 @@ public:
     void renderAvatars(bool forceRenderHead, bool selfAvatarOnly = false);
     
     void clearOtherAvatars();
+    
+    /// appends the acknowledgement of the bulk avatar data we have received to our avatar data packet
+    void appendBulkAvatarDataAck(QByteArray& packet) const;
 
 public slots:
     void processAvatarMixerDatagram(const QByteArray& datagram, const QWeakPointer<Node>& mixerWeakPointer);
@@ -52,6 +55,9 @@ private:
     
     QVector<AvatarSharedPointer> _avatarFades;
     QSharedPointer<MyAvatar> _myAvatar;
+    
+    QHash<QUuid, AvatarWireStateHistory> _receivedWireStates;
+    AvatarWireAckTracker _bulkAvatarDataAcks;
 };
 
 #endif /* defined(__hifi__AvatarManager__) */
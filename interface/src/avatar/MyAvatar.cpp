@@ -651,7 +651,8 @@ void MyAvatar::sendIdentityPacket() {
     QByteArray identityPacket = byteArrayWithPopluatedHeader(PacketTypeAvatarIdentity);
     identityPacket.append(AvatarData::identityByteArray());
     
-    NodeList::getInstance()->broadcastToNodes(identityPacket, NodeSet() << NodeType::AvatarMixer);
+    NodeList::getInstance()->broadcastToNodesOnChannel(identityPacket, NodeSet() << NodeType::AvatarMixer,
+                                                       ChannelID::AvatarIdentity, ChannelMode::Reliable);
 }
 
 void MyAvatar::orbit(const glm::vec3& position, int deltaX, int deltaY) {
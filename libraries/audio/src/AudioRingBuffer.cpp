@@ -12,46 +12,99 @@
 #include <QtCore/QDebug>
 
 #include "PacketHeaders.h"
+#include "SharedUtil.h"
 
 #include "AudioRingBuffer.h"
 
+const quint32 FRAME_RECORD_INDEX_MASK = RING_BUFFER_FRAME_RECORD_CAPACITY - 1;
+
 AudioRingBuffer::AudioRingBuffer(int numFrameSamples) :
     NodeData(),
-    _sampleCapacity(numFrameSamples * RING_BUFFER_LENGTH_FRAMES),
+    _sampleCapacity(0),
+    _numHistorySamples(0),
+    _sampleIndexMask(0),
+    _buffer(NULL),
+    _readIndex(0),
+    _writeIndex(0),
+    _frameReadIndex(0),
+    _frameWriteIndex(0),
+    _isResetRequested(0),
+    _numOverflowedSamples(0),
+    _lastRetiredArrivalUsecs(0),
+    _numInterArrivalSamples(0),
+    _interArrivalSum(0.0),
+    _interArrivalSumOfSquares(0.0),
     _isStarved(true),
     _hasStarted(false)
 {
+    allocateForFrameSize(numFrameSamples);
+};
+
+AudioRingBuffer::~AudioRingBuffer() {
+    delete[] _buffer;
+}
+
+void AudioRingBuffer::allocateForFrameSize(qint64 numFrameSamples) {
+    delete[] _buffer;
+
     if (numFrameSamples) {
+        // round the capacity up to a power of two so the free running indices can be masked into the buffer
+        _sampleCapacity = 1;
+        while (_sampleCapacity < numFrameSamples * RING_BUFFER_LENGTH_FRAMES) {
+            _sampleCapacity <<= 1;
+        }
+
         _buffer = new int16_t[_sampleCapacity];
-        _nextOutput = _buffer;
-        _endOfLastWrite = _buffer;
     } else {
+        _sampleCapacity = 0;
         _buffer = NULL;
-        _nextOutput = NULL;
-        _endOfLastWrite = NULL;
     }
-};
 
-AudioRingBuffer::~AudioRingBuffer() {
-    delete[] _buffer;
+    _sampleIndexMask = _sampleCapacity - 1;
+
+    _readIndex.store(0);
+    _writeIndex.store(0);
+    _frameReadIndex.store(0);
+    _frameWriteIndex.store(0);
 }
 
 void AudioRingBuffer::reset() {
-    _endOfLastWrite = _buffer;
-    _nextOutput = _buffer;
+    // catching the read index up to the write index is the one way to empty the buffer from the reader's side
+    quint32 writeIndex = _writeIndex.loadAcquire();
+    _readIndex.storeRelease(writeIndex);
+    retireFramesBefore(writeIndex);
+
     _isStarved = true;
 }
 
+bool AudioRingBuffer::consumeResetRequest() {
+    if (_isResetRequested.testAndSetOrdered(1, 0)) {
+        reset();
+        return true;
+    } else {
+        return false;
+    }
+}
+
 void AudioRingBuffer::resizeForFrameSize(qint64 numFrameSamples) {
-    delete[] _buffer;
-    _sampleCapacity = numFrameSamples * RING_BUFFER_LENGTH_FRAMES;
-    _buffer = new int16_t[_sampleCapacity];
-    _nextOutput = _buffer;
-    _endOfLastWrite = _buffer;
+    allocateForFrameSize(numFrameSamples);
 }
 
 int AudioRingBuffer::parseData(const QByteArray& packet) {
     int numBytesPacketHeader = numBytesForPacketHeader(packet);
+
+    if (packetTypeForPacket(packet) == PacketTypeSilentAudioFrame) {
+        // a silent frame only carries the number of samples it stands in for
+        quint16 numSilentSamples = 0;
+
+        if (packet.size() >= numBytesPacketHeader + (int) sizeof(numSilentSamples)) {
+            memcpy(&numSilentSamples, packet.data() + numBytesPacketHeader, sizeof(numSilentSamples));
+            writeSilentSamples(numSilentSamples);
+        }
+
+        return numBytesPacketHeader + sizeof(numSilentSamples);
+    }
+
     return writeData(packet.data() + numBytesPacketHeader, packet.size() - numBytesPacketHeader);
 }
 
@@ -60,26 +113,29 @@ qint64 AudioRingBuffer::readSamples(int16_t* destination, qint64 maxSamples) {
 }
 
 qint64 AudioRingBuffer::readData(char *data, qint64 maxSize) {
+    quint32 readIndex = _readIndex.load();
 
     // only copy up to the number of samples we have available
     int numReadSamples = std::min((unsigned) (maxSize / sizeof(int16_t)), samplesAvailable());
 
-    if (_nextOutput + numReadSamples > _buffer + _sampleCapacity) {
+    quint32 bufferOffset = readIndex & _sampleIndexMask;
+
+    if (bufferOffset + numReadSamples > (quint32) _sampleCapacity) {
         // we're going to need to do two reads to get this data, it wraps around the edge
 
         // read to the end of the buffer
-        int numSamplesToEnd = (_buffer + _sampleCapacity) - _nextOutput;
-        memcpy(data, _nextOutput, numSamplesToEnd * sizeof(int16_t));
+        int numSamplesToEnd = _sampleCapacity - bufferOffset;
+        memcpy(data, _buffer + bufferOffset, numSamplesToEnd * sizeof(int16_t));
         
         // read the rest from the beginning of the buffer
         memcpy(data + (numSamplesToEnd * sizeof(int16_t)), _buffer, (numReadSamples - numSamplesToEnd) * sizeof(int16_t));
     } else {
         // read the data
-        memcpy(data, _nextOutput, numReadSamples * sizeof(int16_t));
+        memcpy(data, _buffer + bufferOffset, numReadSamples * sizeof(int16_t));
     }
 
-    // push the position of _nextOutput by the number of samples read
-    _nextOutput = shiftedPositionAccomodatingWrap(_nextOutput, numReadSamples);
+    // hand the samples that were read back to the writer
+    shiftReadPosition(numReadSamples);
 
     return numReadSamples * sizeof(int16_t);
 }
@@ -88,80 +144,137 @@ qint64 AudioRingBuffer::writeSamples(const int16_t* source, qint64 maxSamples) {
     return writeData((const char*) source, maxSamples * sizeof(int16_t));
 }
 
-qint64 AudioRingBuffer::writeData(const char* data, qint64 maxSize) {
-    // make sure we have enough bytes left for this to be the right amount of audio
-    // otherwise we should not copy that data, and leave the buffer pointers where they are
+qint64 AudioRingBuffer::writeSilentSamples(qint64 numSilentSamples) {
+    return writeSamplesOrSilence(NULL, std::min(numSilentSamples, (qint64) _sampleCapacity)) * sizeof(int16_t);
+}
 
+qint64 AudioRingBuffer::writeData(const char* data, qint64 maxSize) {
     int samplesToCopy = std::min((quint64)(maxSize / sizeof(int16_t)), (quint64)_sampleCapacity);
+    return writeSamplesOrSilence(reinterpret_cast<const int16_t*>(data), samplesToCopy) * sizeof(int16_t);
+}
+
+int AudioRingBuffer::writeSamplesOrSilence(const int16_t* source, int samplesToCopy) {
+    // only this side moves the write index, the read index can only move forwards while we look at it
+    quint32 writeIndex = _writeIndex.load();
+    quint32 readIndex = _readIndex.loadAcquire();
 
-    std::less<int16_t*> less;
-    std::less_equal<int16_t*> lessEqual;
-
-    if (_hasStarted
-        && (less(_endOfLastWrite, _nextOutput)
-            && lessEqual(_nextOutput, shiftedPositionAccomodatingWrap(_endOfLastWrite, samplesToCopy)))) {
-        // this read will cross the next output, so call us starved and reset the buffer
-        qDebug() << "Filled the ring buffer. Resetting.";
-        _endOfLastWrite = _buffer;
-        _nextOutput = _buffer;
-        _isStarved = true;
+    // the history behind the read index is still the reader's, so it counts against the room left
+    if (writeIndex - (readIndex - _numHistorySamples) + samplesToCopy > (quint32) _sampleCapacity) {
+        // this write would cross the oldest sample the reader can still look at - the reader owns its index,
+        // so drop these samples and have the reader call itself starved and reset the buffer
+        qDebug() << "Filled the ring buffer. Requesting reset.";
+        _numOverflowedSamples.fetchAndAddRelaxed(samplesToCopy);
+        requestReset();
+
+        return samplesToCopy;
     }
 
-    if (_endOfLastWrite + samplesToCopy <= _buffer + _sampleCapacity) {
-        memcpy(_endOfLastWrite, data, samplesToCopy * sizeof(int16_t));
+    quint32 bufferOffset = writeIndex & _sampleIndexMask;
+    int numSamplesToEnd = std::min(samplesToCopy, (int) (_sampleCapacity - bufferOffset));
+
+    if (source) {
+        memcpy(_buffer + bufferOffset, source, numSamplesToEnd * sizeof(int16_t));
+        memcpy(_buffer, source + numSamplesToEnd, (samplesToCopy - numSamplesToEnd) * sizeof(int16_t));
     } else {
-        int numSamplesToEnd = (_buffer + _sampleCapacity) - _endOfLastWrite;
-        memcpy(_endOfLastWrite, data, numSamplesToEnd * sizeof(int16_t));
-        memcpy(_buffer, data + (numSamplesToEnd * sizeof(int16_t)), (samplesToCopy - numSamplesToEnd) * sizeof(int16_t));
+        memset(_buffer + bufferOffset, 0, numSamplesToEnd * sizeof(int16_t));
+        memset(_buffer, 0, (samplesToCopy - numSamplesToEnd) * sizeof(int16_t));
+    }
+
+    // record when this write arrived, unless the reader has fallen so far behind that there is no room to
+    quint32 frameWriteIndex = _frameWriteIndex.load();
+
+    if (frameWriteIndex - (quint32) _frameReadIndex.loadAcquire() < (quint32) RING_BUFFER_FRAME_RECORD_CAPACITY) {
+        AudioRingBufferFrame& frame = _frames[frameWriteIndex & FRAME_RECORD_INDEX_MASK];
+        frame.endSampleIndex = writeIndex + samplesToCopy;
+        frame.arrivalUsecs = usecTimestampNow();
+
+        _frameWriteIndex.storeRelease(frameWriteIndex + 1);
     }
 
-    _endOfLastWrite = shiftedPositionAccomodatingWrap(_endOfLastWrite, samplesToCopy);
+    // publish the samples to the reader
+    _writeIndex.storeRelease(writeIndex + samplesToCopy);
 
-    return samplesToCopy * sizeof(int16_t);
+    return samplesToCopy;
 }
 
 int16_t& AudioRingBuffer::operator[](const int index) {
     // make sure this is a valid index
     assert(index > -_sampleCapacity && index < _sampleCapacity);
 
-    return *shiftedPositionAccomodatingWrap(_nextOutput, index);
+    return _buffer[((quint32) _readIndex.load() + index) & _sampleIndexMask];
 }
 
 void AudioRingBuffer::shiftReadPosition(unsigned int numSamples) {
-    _nextOutput = shiftedPositionAccomodatingWrap(_nextOutput, numSamples);
+    quint32 readIndex = (quint32) _readIndex.load() + numSamples;
+    _readIndex.storeRelease(readIndex);
+
+    retireFramesBefore(readIndex);
 }
 
 unsigned int AudioRingBuffer::samplesAvailable() const {
-    if (!_endOfLastWrite) {
-        return 0;
+    return (quint32) _writeIndex.loadAcquire() - (quint32) _readIndex.load();
+}
+
+bool AudioRingBuffer::isNotStarvedOrHasMinimumSamples(unsigned int numRequiredSamples) const {
+    if (!_isStarved) {
+        return true;
     } else {
-        int sampleDifference = _endOfLastWrite - _nextOutput;
+        return samplesAvailable() >= numRequiredSamples;
+    }
+}
+
+void AudioRingBuffer::retireFramesBefore(quint32 readIndex) {
+    quint32 frameReadIndex = _frameReadIndex.load();
+    quint32 frameWriteIndex = _frameWriteIndex.loadAcquire();
+
+    while (frameReadIndex != frameWriteIndex) {
+        const AudioRingBufferFrame& frame = _frames[frameReadIndex & FRAME_RECORD_INDEX_MASK];
 
-        if (sampleDifference < 0) {
-            sampleDifference += _sampleCapacity;
+        if ((qint32) (frame.endSampleIndex - readIndex) > 0) {
+            // the reader is still inside this write
+            break;
         }
 
-        return sampleDifference;
+        if (_lastRetiredArrivalUsecs != 0) {
+            double interArrivalUsecs = (qint64) (frame.arrivalUsecs - _lastRetiredArrivalUsecs);
+            _interArrivalSum += interArrivalUsecs;
+            _interArrivalSumOfSquares += interArrivalUsecs * interArrivalUsecs;
+            _numInterArrivalSamples++;
+        }
+
+        _lastRetiredArrivalUsecs = frame.arrivalUsecs;
+        frameReadIndex++;
     }
+
+    _frameReadIndex.storeRelease(frameReadIndex);
 }
 
-bool AudioRingBuffer::isNotStarvedOrHasMinimumSamples(unsigned int numRequiredSamples) const {
-    if (!_isStarved) {
-        return true;
+quint64 AudioRingBuffer::getNextOutputArrivalUsecs() const {
+    quint32 frameReadIndex = _frameReadIndex.load();
+
+    if (frameReadIndex != (quint32) _frameWriteIndex.loadAcquire()) {
+        return _frames[frameReadIndex & FRAME_RECORD_INDEX_MASK].arrivalUsecs;
     } else {
-        return samplesAvailable() >= numRequiredSamples;
+        return 0;
     }
 }
 
-int16_t* AudioRingBuffer::shiftedPositionAccomodatingWrap(int16_t* position, int numSamplesShift) const {
+float AudioRingBuffer::getInterArrivalAverageUsecs() const {
+    return (_numInterArrivalSamples > 0) ? _interArrivalSum / _numInterArrivalSamples : 0.0f;
+}
 
-    if (numSamplesShift > 0 && position + numSamplesShift >= _buffer + _sampleCapacity) {
-        // this shift will wrap the position around to the beginning of the ring
-        return position + numSamplesShift - _sampleCapacity;
-    } else if (numSamplesShift < 0 && position + numSamplesShift < _buffer) {
-        // this shift will go around to the end of the ring
-        return position + numSamplesShift + _sampleCapacity;
+float AudioRingBuffer::getInterArrivalStDevUsecs() const {
+    if (_numInterArrivalSamples > 1) {
+        double average = _interArrivalSum / _numInterArrivalSamples;
+        double variance = (_interArrivalSumOfSquares / _numInterArrivalSamples) - (average * average);
+        return variance > 0.0 ? sqrt(variance) : 0.0f;
     } else {
-        return position + numSamplesShift;
+        return 0.0f;
     }
 }
+
+void AudioRingBuffer::resetInterArrivalStats() {
+    _numInterArrivalSamples = 0;
+    _interArrivalSum = 0.0;
+    _interArrivalSumOfSquares = 0.0;
+}
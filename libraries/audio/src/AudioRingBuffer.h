@@ -14,6 +14,7 @@
 
 #include <glm/glm.hpp>
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QIODevice>
 
 #include "NodeData.h"
@@ -30,24 +31,54 @@ const unsigned int BUFFER_SEND_INTERVAL_USECS = floorf((NETWORK_BUFFER_LENGTH_SA
 
 const short RING_BUFFER_LENGTH_FRAMES = 10;
 
+// the arrival times of at most this many writes are kept - must be a power of two
+const int RING_BUFFER_FRAME_RECORD_CAPACITY = 64;
+
 const int MAX_SAMPLE_VALUE = std::numeric_limits<int16_t>::max();
 const int MIN_SAMPLE_VALUE = std::numeric_limits<int16_t>::min();
 
+/// the end of the samples added by one write, and when that write arrived
+struct AudioRingBufferFrame {
+    quint32 endSampleIndex;
+    quint64 arrivalUsecs;
+};
+
+/// Single-producer/single-consumer ring of samples. Writes (parseData, writeData, writeSamples) must all come from
+/// one thread and everything else from one other thread (or the same one). The capacity is rounded up to a power
+/// of two and the read and write indices run freely, so they are masked into the buffer and never reset while
+/// both sides are active.
 class AudioRingBuffer : public NodeData {
     Q_OBJECT
 public:
     AudioRingBuffer(int numFrameSamples);
     ~AudioRingBuffer();
 
+    /// reader side - drops every sample that has been written and marks the buffer starved
     void reset();
+
+    /// writer side - asks the reader to reset the next time it calls consumeResetRequest
+    void requestReset() { _isResetRequested.storeRelease(1); }
+
+    /// reader side - resets the buffer if the writer asked for it, returns true if it did
+    bool consumeResetRequest();
+
+    /// only safe while neither side is using the buffer
     void resizeForFrameSize(qint64 numFrameSamples);
     
     int getSampleCapacity() const { return _sampleCapacity; }
+
+    /// the reader looks back this many samples behind the read position through negative indices, so the writer
+    /// leaves them alone - only safe to change while neither side is using the buffer
+    void setNumHistorySamples(int numHistorySamples) { _numHistorySamples = numHistorySamples; }
+    int getNumHistorySamples() const { return _numHistorySamples; }
     
     int parseData(const QByteArray& packet);
 
     qint64 readSamples(int16_t* destination, qint64 maxSamples);
     qint64 writeSamples(const int16_t* source, qint64 maxSamples);
+
+    /// writes numSilentSamples zeroed samples, for a silent frame that was sent as a count instead of samples
+    qint64 writeSilentSamples(qint64 numSilentSamples);
     
     qint64 readData(char* data, qint64 maxSize);
     qint64 writeData(const char* data, qint64 maxSize);
@@ -64,17 +95,52 @@ public:
     void setIsStarved(bool isStarved) { _isStarved = isStarved; }
     
     bool hasStarted() const { return _hasStarted; }
+
+    /// reader side - when the write holding the next sample to be read arrived, 0 if that is not known
+    quint64 getNextOutputArrivalUsecs() const;
+
+    /// reader side - statistics on the time between the arrival of consecutive writes, gathered as they are read
+    int getNumInterArrivalSamples() const { return _numInterArrivalSamples; }
+    float getInterArrivalAverageUsecs() const;
+    float getInterArrivalStDevUsecs() const;
+    void resetInterArrivalStats();
+
+    /// the number of samples dropped because the writer found the buffer full
+    int getNumOverflowedSamples() const { return _numOverflowedSamples.load(); }
 protected:
     // disallow copying of AudioRingBuffer objects
     AudioRingBuffer(const AudioRingBuffer&);
     AudioRingBuffer& operator= (const AudioRingBuffer&);
-    
-    int16_t* shiftedPositionAccomodatingWrap(int16_t* position, int numSamplesShift) const;
-    
+
+    void allocateForFrameSize(qint64 numFrameSamples);
+
+    /// writer side - copies the samples in, or zeroes them if source is NULL, and publishes them to the reader
+    int writeSamplesOrSilence(const int16_t* source, int samplesToCopy);
+
+    /// reader side - lets go of the frame records for every write that has been read completely
+    void retireFramesBefore(quint32 readIndex);
+
     int _sampleCapacity;
-    int16_t* _nextOutput;
-    int16_t* _endOfLastWrite;
+    int _numHistorySamples;
+    quint32 _sampleIndexMask;
     int16_t* _buffer;
+
+    // monotonic sample counts, moved only by the reader and the writer respectively
+    QAtomicInt _readIndex;
+    QAtomicInt _writeIndex;
+
+    AudioRingBufferFrame _frames[RING_BUFFER_FRAME_RECORD_CAPACITY];
+    QAtomicInt _frameReadIndex;
+    QAtomicInt _frameWriteIndex;
+
+    QAtomicInt _isResetRequested;
+    QAtomicInt _numOverflowedSamples;
+
+    // owned by the reader
+    quint64 _lastRetiredArrivalUsecs;
+    int _numInterArrivalSamples;
+    double _interArrivalSum;
+    double _interArrivalSumOfSquares;
     bool _isStarved;
     bool _hasStarted;
 };
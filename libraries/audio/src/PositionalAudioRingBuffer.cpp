@@ -6,6 +6,8 @@
 //  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
+#include <cassert>
 #include <cstring>
 
 #include <QtCore/QDataStream>
@@ -16,6 +18,18 @@
 
 #include "PositionalAudioRingBuffer.h"
 
+// the jitter buffer depth is set to cover this many standard deviations of the time between packets
+const float JITTER_BUFFER_STANDARD_DEVIATIONS = 3.0f;
+
+// the number of inter-arrival times that make up one measurement of the jitter
+const int JITTER_MEASUREMENT_WINDOW_SAMPLES = 50;
+
+// the number of measurements the jitter average is taken over
+const int JITTER_AVERAGE_MEASUREMENTS = 8;
+
+// the depth has to be this far from the target before a frame is compressed or stretched
+const int JITTER_BUFFER_HYSTERESIS_SAMPLES = NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL / 4;
+
 #ifdef _WIN32
 int isnan(double value) { return _isnan(value); }
 #else
@@ -29,7 +43,14 @@ PositionalAudioRingBuffer::PositionalAudioRingBuffer(PositionalAudioRingBuffer::
     _orientation(0.0f, 0.0f, 0.0f, 0.0f),
     _willBeAddedToMix(false),
     _shouldLoopbackForNode(false),
-    _shouldOutputStarveDebug(true)
+    _shouldOutputStarveDebug(true),
+    _isJitterBufferAdaptive(false),
+    _targetJitterBufferSamples(-1),
+    _frameSampleAdjustment(0),
+    _measuredJitterUsecs(0.0f),
+    _jitterAverage(JITTER_AVERAGE_MEASUREMENTS),
+    _numCompressedSamples(0),
+    _numStretchedSamples(0)
 {
 
 }
@@ -42,6 +63,17 @@ int PositionalAudioRingBuffer::parseData(const QByteArray& packet) {
     
     // skip the packet header (includes the source UUID)
     packetStream.skipRawData(numBytesForPacketHeader(packet));
+
+    if (packetTypeForPacket(packet) == PacketTypeSilentAudioFrame) {
+        // the sender was silent for this frame, so it only sent the number of samples and where it is
+        quint16 numSilentSamples = 0;
+        packetStream.readRawData(reinterpret_cast<char*>(&numSilentSamples), sizeof(numSilentSamples));
+
+        packetStream.skipRawData(parsePositionalData(packet.mid(packetStream.device()->pos())));
+        writeSilentSamples(numSilentSamples);
+
+        return packetStream.device()->pos();
+    }
     
     packetStream.skipRawData(parsePositionalData(packet.mid(packetStream.device()->pos())));
     packetStream.skipRawData(writeData(packet.data() + packetStream.device()->pos(),
@@ -58,7 +90,7 @@ int PositionalAudioRingBuffer::parsePositionalData(const QByteArray& positionalB
 
     // if this node sent us a NaN for first float in orientation then don't consider this good audio and bail
     if (isnan(_orientation.x)) {
-        reset();
+        requestReset();
         return 0;
     }
 
@@ -66,6 +98,23 @@ int PositionalAudioRingBuffer::parsePositionalData(const QByteArray& positionalB
 }
 
 bool PositionalAudioRingBuffer::shouldBeAddedToMix(int numJitterBufferSamples) {
+    // the datagram side can't move our read position, so it asks us to reset when it fills the buffer or gets bad data
+    if (consumeResetRequest()) {
+        _shouldOutputStarveDebug = true;
+    }
+
+    _frameSampleAdjustment = 0;
+
+    if (_isJitterBufferAdaptive) {
+        if (_targetJitterBufferSamples < 0) {
+            // start from the fixed depth until there is a measurement of this stream's jitter
+            _targetJitterBufferSamples = numJitterBufferSamples;
+        }
+
+        updateTargetJitterBufferSamples();
+        numJitterBufferSamples = _targetJitterBufferSamples;
+    }
+
     if (!isNotStarvedOrHasMinimumSamples(NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL + numJitterBufferSamples)) {
         if (_shouldOutputStarveDebug) {
             qDebug() << "Starved and do not have minimum samples to start. Buffer held back.";
@@ -88,8 +137,76 @@ bool PositionalAudioRingBuffer::shouldBeAddedToMix(int numJitterBufferSamples) {
         // since we've read data from ring buffer at least once - we've started
         _hasStarted = true;
 
+        if (_isJitterBufferAdaptive) {
+            // move the depth left after this frame towards the target a few samples at a time, so the change is heard
+            // as a tiny shift in pitch rather than a dropped or repeated frame
+            int depthAfterFrame = samplesAvailable() - NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+
+            if (depthAfterFrame > _targetJitterBufferSamples + JITTER_BUFFER_HYSTERESIS_SAMPLES) {
+                _frameSampleAdjustment = std::min(MAX_JITTER_BUFFER_ADJUSTMENT_SAMPLES,
+                                                  depthAfterFrame - _targetJitterBufferSamples);
+                _numCompressedSamples += _frameSampleAdjustment;
+            } else if (depthAfterFrame < _targetJitterBufferSamples - JITTER_BUFFER_HYSTERESIS_SAMPLES) {
+                _frameSampleAdjustment = -std::min(MAX_JITTER_BUFFER_ADJUSTMENT_SAMPLES,
+                                                   _targetJitterBufferSamples - depthAfterFrame);
+                _numStretchedSamples -= _frameSampleAdjustment;
+            }
+        }
+
         return true;
     }
 
     return false;
 }
+
+void PositionalAudioRingBuffer::updateTargetJitterBufferSamples() {
+    if (getNumInterArrivalSamples() < JITTER_MEASUREMENT_WINDOW_SAMPLES) {
+        return;
+    }
+
+    float windowJitterUsecs = getInterArrivalStDevUsecs();
+    resetInterArrivalStats();
+
+    _jitterAverage.updateAverage(windowJitterUsecs);
+
+    // grow as soon as one window is worse than the average, shrink only as fast as the average comes down
+    _measuredJitterUsecs = std::max(windowJitterUsecs, _jitterAverage.getAverage());
+
+    const float SAMPLES_PER_USEC = SAMPLE_RATE / (1000.0f * 1000.0f);
+    int maxJitterBufferSamples = (getSampleCapacity() / 2) - NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL;
+
+    _targetJitterBufferSamples = glm::clamp((int) (JITTER_BUFFER_STANDARD_DEVIATIONS * _measuredJitterUsecs * SAMPLES_PER_USEC),
+                                            0, maxJitterBufferSamples);
+}
+
+void PositionalAudioRingBuffer::readFrameForMix(int16_t* destination, int numHistorySamples) {
+    // the writer only leaves alone the history it was told about
+    assert(numHistorySamples <= getNumHistorySamples());
+
+    for (int s = -numHistorySamples; s < 0; s++) {
+        destination[s + numHistorySamples] = (*this)[s];
+    }
+
+    int16_t* frameDestination = destination + numHistorySamples;
+    int numFrameSamples = getNumFrameSamplesToRead();
+
+    if (numFrameSamples == NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL) {
+        for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL; s++) {
+            frameDestination[s] = (*this)[s];
+        }
+    } else {
+        // linearly resample the samples this frame is made from so they fill exactly one network frame
+        float sourceStep = (numFrameSamples - 1) / (float) (NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL - 1);
+
+        for (int s = 0; s < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL; s++) {
+            float sourcePosition = s * sourceStep;
+            int sourceIndex = (int) sourcePosition;
+            float fraction = sourcePosition - sourceIndex;
+
+            int16_t sample = (*this)[sourceIndex];
+            int16_t nextSample = (sourceIndex + 1 < numFrameSamples) ? (*this)[sourceIndex + 1] : sample;
+
+            frameDestination[s] = sample + (int16_t) ((nextSample - sample) * fraction);
+        }
+    }
+}
@@ -12,8 +12,13 @@
 #include <vector>
 #include <glm/gtx/quaternion.hpp>
 
+#include <SimpleMovingAverage.h>
+
 #include "AudioRingBuffer.h"
 
+// the most a frame is compressed or stretched by when the adaptive jitter buffer is moving towards its target
+const int MAX_JITTER_BUFFER_ADJUSTMENT_SAMPLES = 12;
+
 class PositionalAudioRingBuffer : public AudioRingBuffer {
 public:
     enum Type {
@@ -28,7 +33,24 @@ public:
     int parsePositionalData(const QByteArray& positionalByteArray);
     int parseListenModeData(const QByteArray& listenModeByteArray);
     
+    /// reader side - decides if the next frame can be mixed, numJitterBufferSamples is the depth used while the
+    /// jitter buffer is fixed (or has not measured any jitter yet)
     bool shouldBeAddedToMix(int numJitterBufferSamples);
+
+    bool isJitterBufferAdaptive() const { return _isJitterBufferAdaptive; }
+    void setIsJitterBufferAdaptive(bool isJitterBufferAdaptive) { _isJitterBufferAdaptive = isJitterBufferAdaptive; }
+
+    /// the number of samples the next mixed frame is made from - more than a frame when the jitter buffer is
+    /// draining towards its target, fewer when it is filling
+    int getNumFrameSamplesToRead() const { return NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL + _frameSampleAdjustment; }
+
+    /// copies the history before the next output and the next frame (time-stretched to a network frame) out of the ring
+    void readFrameForMix(int16_t* destination, int numHistorySamples);
+
+    int getTargetJitterBufferSamples() const { return _targetJitterBufferSamples; }
+    float getMeasuredJitterUsecs() const { return _measuredJitterUsecs; }
+    int getNumCompressedSamples() const { return _numCompressedSamples; }
+    int getNumStretchedSamples() const { return _numStretchedSamples; }
     
     bool willBeAddedToMix() const { return _willBeAddedToMix; }
     void setWillBeAddedToMix(bool willBeAddedToMix) { _willBeAddedToMix = willBeAddedToMix; }
@@ -50,6 +72,17 @@ protected:
     bool _willBeAddedToMix;
     bool _shouldLoopbackForNode;
     bool _shouldOutputStarveDebug;
+
+    /// recalculates the target jitter buffer depth once a window of inter-arrival times has been gathered
+    void updateTargetJitterBufferSamples();
+
+    bool _isJitterBufferAdaptive;
+    int _targetJitterBufferSamples;
+    int _frameSampleAdjustment;
+    float _measuredJitterUsecs;
+    SimpleMovingAverage _jitterAverage;
+    int _numCompressedSamples;
+    int _numStretchedSamples;
 };
 
 #endif /* defined(__hifi__PositionalAudioRingBuffer__) */
@@ -22,8 +22,6 @@
 
 using namespace std;
 
-static const float fingerVectorRadix = 4; // bits of precision when converting from float<->fixed
-
 AvatarData::AvatarData() :
     NodeData(),
     _handPosition(0,0,0),
@@ -55,10 +53,18 @@ void AvatarData::setHandPosition(const glm::vec3& handPosition) {
 }
 
 QByteArray AvatarData::toByteArray() {
-    // TODO: DRY this up to a shared method
-    // that can pack any type given the number of bytes
-    // and return the number of bytes to push the pointer
-    
+    QByteArray avatarDataByteArray;
+    avatarDataByteArray.resize(MAX_PACKET_SIZE);
+
+    avatarDataByteArray.resize(encodeData(reinterpret_cast<unsigned char*>(avatarDataByteArray.data())));
+    return avatarDataByteArray;
+}
+
+int AvatarData::encodeData(unsigned char* destinationBuffer) {
+    return toWireState().encode(destinationBuffer, NULL);
+}
+
+AvatarWireState AvatarData::toWireState() {
     // lazily allocate memory for HeadData in case we're not an Avatar instance
     if (!_headData) {
         _headData = new HeadData(this);
@@ -68,57 +74,31 @@ QByteArray AvatarData::toByteArray() {
         _handData = new HandData(this);
     }
     
-    QByteArray avatarDataByteArray;
-    avatarDataByteArray.resize(MAX_PACKET_SIZE);
-    
-    unsigned char* destinationBuffer = reinterpret_cast<unsigned char*>(avatarDataByteArray.data());
-    unsigned char* startPosition = destinationBuffer;
-    
-    memcpy(destinationBuffer, &_position, sizeof(_position));
-    destinationBuffer += sizeof(_position);
+    AvatarWireState wireState;
     
-    // Body rotation (NOTE: This needs to become a quaternion to save two bytes)
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyYaw);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyPitch);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _bodyRoll);
-
-    // Body scale
-    destinationBuffer += packFloatRatioToTwoByte(destinationBuffer, _targetScale);
-
-    // Head rotation (NOTE: This needs to become a quaternion to save two bytes)
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->_yaw);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->_pitch);
-    destinationBuffer += packFloatAngleToTwoByte(destinationBuffer, _headData->_roll);
+    wireState.setPosition(_position);
+    wireState.setBodyOrientation(getOrientation());
+    wireState.setTargetScale(_targetScale);
     
+    // head rotation is relative to the body and stays inside the limits HeadData clamps it to
+    wireState.setHeadAngles(glm::vec3(_headData->_pitch, _headData->_yaw, _headData->_roll));
     
     // Head lean X,Z (head lateral and fwd/back motion relative to torso)
-    memcpy(destinationBuffer, &_headData->_leanSideways, sizeof(_headData->_leanSideways));
-    destinationBuffer += sizeof(_headData->_leanSideways);
-    memcpy(destinationBuffer, &_headData->_leanForward, sizeof(_headData->_leanForward));
-    destinationBuffer += sizeof(_headData->_leanForward);
-
+    wireState.setLean(_headData->_leanSideways, _headData->_leanForward);
+    
     // Hand Position - is relative to body position
-    glm::vec3 handPositionRelative = _handPosition - _position;
-    memcpy(destinationBuffer, &handPositionRelative, sizeof(float) * 3);
-    destinationBuffer += sizeof(float) * 3;
-
-    // Lookat Position
-    memcpy(destinationBuffer, &_headData->_lookAtPosition, sizeof(_headData->_lookAtPosition));
-    destinationBuffer += sizeof(_headData->_lookAtPosition);
-     
+    wireState.setHandPosition(_handPosition);
+    
+    wireState.setLookAtPosition(_headData->_lookAtPosition);
+    
     // Instantaneous audio loudness (used to drive facial animation)
-    //destinationBuffer += packFloatToByte(destinationBuffer, std::min(MAX_AUDIO_LOUDNESS, _audioLoudness), MAX_AUDIO_LOUDNESS);
-    memcpy(destinationBuffer, &_headData->_audioLoudness, sizeof(float));
-    destinationBuffer += sizeof(float);
-
-    // chat message
-    *destinationBuffer++ = _chatMessage.size();
-    memcpy(destinationBuffer, _chatMessage.data(), _chatMessage.size() * sizeof(char));
-    destinationBuffer += _chatMessage.size() * sizeof(char);
+    wireState.setAudioLoudness(_headData->_audioLoudness);
+    
+    wireState.setChatMessage(_chatMessage);
     
     // bitMask of less than byte wide items
     unsigned char bitItems = 0;
-
+    
     // key state
     setSemiNibbleAt(bitItems,KEY_STATE_START_BIT,_keyState);
     // hand state
@@ -128,40 +108,43 @@ QByteArray AvatarData::toByteArray() {
     if (_isChatCirclingEnabled) {
         setAtBit(bitItems, IS_CHAT_CIRCLING_ENABLED);
     }
-    *destinationBuffer++ = bitItems;
-
+    wireState.setFlags(bitItems);
+    
     // If it is connected, pack up the data
     if (_headData->_isFaceshiftConnected) {
-        memcpy(destinationBuffer, &_headData->_leftEyeBlink, sizeof(float));
-        destinationBuffer += sizeof(float);
-
-        memcpy(destinationBuffer, &_headData->_rightEyeBlink, sizeof(float));
-        destinationBuffer += sizeof(float);
-
-        memcpy(destinationBuffer, &_headData->_averageLoudness, sizeof(float));
-        destinationBuffer += sizeof(float);
-
-        memcpy(destinationBuffer, &_headData->_browAudioLift, sizeof(float));
-        destinationBuffer += sizeof(float);
-        
-        *destinationBuffer++ = _headData->_blendshapeCoefficients.size();
-        memcpy(destinationBuffer, _headData->_blendshapeCoefficients.data(),
-            _headData->_blendshapeCoefficients.size() * sizeof(float));
-        destinationBuffer += _headData->_blendshapeCoefficients.size() * sizeof(float);
+        wireState.setFaceshift(_headData->_leftEyeBlink, _headData->_rightEyeBlink, _headData->_averageLoudness,
+                               _headData->_browAudioLift, _headData->_blendshapeCoefficients);
     }
     
-    // pupil dilation
-    destinationBuffer += packFloatToByte(destinationBuffer, _headData->_pupilDilation, 1.0f);
+    wireState.setPupilDilation(_headData->_pupilDilation);
     
     // leap hand data
-    destinationBuffer += _handData->encodeRemoteData(destinationBuffer);
-
-    return avatarDataByteArray.left(destinationBuffer - startPosition);
+    unsigned char handDataBuffer[MAX_PACKET_SIZE];
+    int numHandDataBytes = _handData->encodeRemoteData(handDataBuffer);
+    wireState.setHandData(QByteArray(reinterpret_cast<char*>(handDataBuffer), numHandDataBytes));
+    
+    return wireState;
 }
 
 // called on the other nodes - assigns it to my views of the others
 int AvatarData::parseData(const QByteArray& packet) {
+    int numBytesPacketHeader = numBytesForPacketHeader(packet);
+    
+    AvatarWireState wireState;
+    int numBytesRead = wireState.decode(reinterpret_cast<const unsigned char*>(packet.data()) + numBytesPacketHeader,
+                                        packet.size() - numBytesPacketHeader, NULL);
+    if (numBytesRead < 0) {
+        // this packet was cut short, leave the avatar as it was
+        return packet.size();
+    }
+    
+    applyWireState(wireState);
+    
+    return numBytesPacketHeader + numBytesRead;
+}
 
+void AvatarData::applyWireState(const AvatarWireState& wireState) {
+    
     // lazily allocate memory for HeadData in case we're not an Avatar instance
     if (!_headData) {
         _headData = new HeadData(this);
@@ -172,61 +155,24 @@ int AvatarData::parseData(const QByteArray& packet) {
         _handData = new HandData(this);
     }
     
-    // increment to push past the packet header
-    const unsigned char* startPosition = reinterpret_cast<const unsigned char*>(packet.data());
-    const unsigned char* sourceBuffer = startPosition + numBytesForPacketHeader(packet);
+    _position = wireState.getPosition();
+    setOrientation(wireState.getBodyOrientation());
+    _targetScale = wireState.getTargetScale();
     
-    // Body world position
-    memcpy(&_position, sourceBuffer, sizeof(float) * 3);
-    sourceBuffer += sizeof(float) * 3;
+    glm::vec3 headAngles = wireState.getHeadAngles();
+    _headData->setPitch(headAngles.x);
+    _headData->setYaw(headAngles.y);
+    _headData->setRoll(headAngles.z);
     
-    // Body rotation (NOTE: This needs to become a quaternion to save two bytes)
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_bodyYaw);
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_bodyPitch);
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &_bodyRoll);
+    _headData->_leanSideways = wireState.getLeanSideways();
+    _headData->_leanForward = wireState.getLeanForward();
     
-    // Body scale
-    sourceBuffer += unpackFloatRatioFromTwoByte(sourceBuffer, _targetScale);
+    _handPosition = wireState.getHandPosition();
+    _headData->_lookAtPosition = wireState.getLookAtPosition();
+    _headData->_audioLoudness = wireState.getAudioLoudness();
+    _chatMessage = wireState.getChatMessage();
     
-    // Head rotation (NOTE: This needs to become a quaternion to save two bytes)
-    float headYaw, headPitch, headRoll;
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headYaw);
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headPitch);
-    sourceBuffer += unpackFloatAngleFromTwoByte((uint16_t*) sourceBuffer, &headRoll);
-    
-    _headData->setYaw(headYaw);
-    _headData->setPitch(headPitch);
-    _headData->setRoll(headRoll);
-    
-    //  Head position relative to pelvis
-    memcpy(&_headData->_leanSideways, sourceBuffer, sizeof(_headData->_leanSideways));
-    sourceBuffer += sizeof(float);
-    memcpy(&_headData->_leanForward, sourceBuffer, sizeof(_headData->_leanForward));
-    sourceBuffer += sizeof(_headData->_leanForward);
-    
-    // Hand Position - is relative to body position
-    glm::vec3 handPositionRelative;
-    memcpy(&handPositionRelative, sourceBuffer, sizeof(float) * 3);
-    _handPosition = _position + handPositionRelative;
-    sourceBuffer += sizeof(float) * 3;
-    
-    // Lookat Position
-    memcpy(&_headData->_lookAtPosition, sourceBuffer, sizeof(_headData->_lookAtPosition));
-    sourceBuffer += sizeof(_headData->_lookAtPosition);
-    
-    // Instantaneous audio loudness (used to drive facial animation)
-    //sourceBuffer += unpackFloatFromByte(sourceBuffer, _audioLoudness, MAX_AUDIO_LOUDNESS);
-    memcpy(&_headData->_audioLoudness, sourceBuffer, sizeof(float));
-    sourceBuffer += sizeof(float);
-    
-    // the rest is a chat message
-    int chatMessageSize = *sourceBuffer++;
-    _chatMessage = string((char*)sourceBuffer, chatMessageSize);
-    sourceBuffer += chatMessageSize * sizeof(char);
-    
-    // voxel sending features...
-    unsigned char bitItems = 0;
-    bitItems = (unsigned char)*sourceBuffer++;
+    unsigned char bitItems = wireState.getFlags();
     
     // key state, stored as a semi-nibble in the bitItems
     _keyState = (KeyState)getSemiNibbleAt(bitItems,KEY_STATE_START_BIT);
@@ -234,40 +180,18 @@ int AvatarData::parseData(const QByteArray& packet) {
     // hand state, stored as a semi-nibble in the bitItems
     _handState = getSemiNibbleAt(bitItems,HAND_STATE_START_BIT);
     
-    _headData->_isFaceshiftConnected = oneAtBit(bitItems, IS_FACESHIFT_CONNECTED);
-    
     _isChatCirclingEnabled = oneAtBit(bitItems, IS_CHAT_CIRCLING_ENABLED);
     
-    // If it is connected, pack up the data
-    if (_headData->_isFaceshiftConnected) {
-        memcpy(&_headData->_leftEyeBlink, sourceBuffer, sizeof(float));
-        sourceBuffer += sizeof(float);
-        
-        memcpy(&_headData->_rightEyeBlink, sourceBuffer, sizeof(float));
-        sourceBuffer += sizeof(float);
-        
-        memcpy(&_headData->_averageLoudness, sourceBuffer, sizeof(float));
-        sourceBuffer += sizeof(float);
-        
-        memcpy(&_headData->_browAudioLift, sourceBuffer, sizeof(float));
-        sourceBuffer += sizeof(float);
-        
-        _headData->_blendshapeCoefficients.resize(*sourceBuffer++);
-        memcpy(_headData->_blendshapeCoefficients.data(), sourceBuffer,
-               _headData->_blendshapeCoefficients.size() * sizeof(float));
-        sourceBuffer += _headData->_blendshapeCoefficients.size() * sizeof(float);
-    }
+    _headData->_isFaceshiftConnected = oneAtBit(bitItems, IS_FACESHIFT_CONNECTED)
+        && wireState.getFaceshift(_headData->_leftEyeBlink, _headData->_rightEyeBlink, _headData->_averageLoudness,
+                                  _headData->_browAudioLift, _headData->_blendshapeCoefficients);
     
-    // pupil dilation
-    sourceBuffer += unpackFloatFromByte(sourceBuffer, _headData->_pupilDilation, 1.0f);
+    _headData->_pupilDilation = wireState.getPupilDilation();
     
     // leap hand data
-    if (sourceBuffer - startPosition < packet.size()) {
-        // check passed, bytes match
-        sourceBuffer += _handData->decodeRemoteData(packet.mid(sourceBuffer - startPosition));
+    if (!wireState.getHandData().isEmpty()) {
+        _handData->decodeRemoteData(wireState.getHandData());
     }
-    
-    return sourceBuffer - startPosition;
 }
 
 bool AvatarData::hasIdentityChangedAfterParsing(const QByteArray &packet) {
@@ -38,6 +38,7 @@ typedef unsigned long long quint64;
 #include <RegisteredMetaTypes.h>
 #include <NodeData.h>
 
+#include "AvatarWireState.h"
 #include "HeadData.h"
 #include "HandData.h"
 
@@ -86,8 +87,18 @@ public:
     void setHandPosition(const glm::vec3& handPosition);
 
     QByteArray toByteArray();
+
+    /// packs the full avatar data into destinationBuffer, which needs MAX_PACKET_SIZE bytes free, returns the bytes packed
+    int encodeData(unsigned char* destinationBuffer);
+
     int parseData(const QByteArray& packet);
 
+    /// the quantized state of this avatar, as it would be sent
+    AvatarWireState toWireState();
+
+    /// takes on a state that was received for this avatar
+    virtual void applyWireState(const AvatarWireState& wireState);
+
     //  Body Rotation
     float getBodyYaw() const { return _bodyYaw; }
     void setBodyYaw(float bodyYaw) { _bodyYaw = bodyYaw; }
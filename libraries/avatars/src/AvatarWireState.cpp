@@ -0,0 +1,518 @@
+//
+//  AvatarWireState.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <math.h>
+
+#include <OctreeConstants.h>
+#include <SharedUtil.h>
+
+#include "AvatarData.h"
+#include "HeadData.h"
+
+#include "AvatarWireState.h"
+
+const int FIXED_FIELD_SIZES[NUM_AVATAR_WIRE_FIXED_FIELDS] = {
+    9, // position
+    4, // body orientation
+    2, // target scale
+    4, // head angles
+    4, // lean
+    6, // hand position
+    9, // look at position
+    2, // audio loudness
+    1, // flags
+    1  // pupil dilation
+};
+
+const int DOMAIN_POSITION_BITS = 24;
+const int DOMAIN_POSITION_BYTES = 3;
+
+const int QUATERNION_COMPONENT_BITS = 10;
+const int QUATERNION_COMPONENT_MAX = (1 << QUATERNION_COMPONENT_BITS) - 1;
+
+const int HEAD_YAW_BITS = 11;
+const int HEAD_PITCH_BITS = 11;
+const int HEAD_ROLL_BITS = 10;
+
+const int LEAN_RADIX = 10;
+const int HAND_POSITION_RADIX = 8;
+
+const int FACESHIFT_FIXED_BYTES = 6;
+
+// the offset of each fixed field is the sum of the sizes of the ones before it
+const int AvatarWireState::FIXED_FIELD_OFFSETS[NUM_AVATAR_WIRE_FIXED_FIELDS + 1] = {
+    0, 9, 13, 15, 19, 23, 29, 38, 40, 41, 42
+};
+
+quint32 quantizeToBits(float value, float minValue, float maxValue, int numBits) {
+    quint32 maxQuantized = (1 << numBits) - 1;
+    float ratio = (glm::clamp(value, minValue, maxValue) - minValue) / (maxValue - minValue);
+    return (quint32) floorf((ratio * maxQuantized) + 0.5f);
+}
+
+float unquantizeFromBits(quint32 quantized, float minValue, float maxValue, int numBits) {
+    quint32 maxQuantized = (1 << numBits) - 1;
+    return minValue + ((maxValue - minValue) * quantized / maxQuantized);
+}
+
+// avatars can be on either side of the origin on any axis, not just inside the voxel domain
+void packDomainPosition(unsigned char* destinationBuffer, const glm::vec3& position) {
+    for (int i = 0; i < 3; i++) {
+        quint32 quantized = quantizeToBits(position[i], -TREE_SCALE, TREE_SCALE, DOMAIN_POSITION_BITS);
+        for (int j = 0; j < DOMAIN_POSITION_BYTES; j++) {
+            *destinationBuffer++ = (quantized >> (j * 8)) & 0xFF;
+        }
+    }
+}
+
+glm::vec3 unpackDomainPosition(const unsigned char* sourceBuffer) {
+    glm::vec3 position;
+    for (int i = 0; i < 3; i++) {
+        quint32 quantized = 0;
+        for (int j = 0; j < DOMAIN_POSITION_BYTES; j++) {
+            quantized |= ((quint32) *sourceBuffer++) << (j * 8);
+        }
+        position[i] = unquantizeFromBits(quantized, -TREE_SCALE, TREE_SCALE, DOMAIN_POSITION_BITS);
+    }
+    return position;
+}
+
+void packTwoByteValue(unsigned char* destinationBuffer, quint32 value) {
+    quint16 twoByteValue = value;
+    memcpy(destinationBuffer, &twoByteValue, sizeof(twoByteValue));
+}
+
+quint16 unpackTwoByteValue(const unsigned char* sourceBuffer) {
+    quint16 twoByteValue;
+    memcpy(&twoByteValue, sourceBuffer, sizeof(twoByteValue));
+    return twoByteValue;
+}
+
+AvatarWireState::AvatarWireState() :
+    _variableFields()
+{
+    memset(_fixedFields, 0, sizeof(_fixedFields));
+}
+
+void AvatarWireState::setPosition(const glm::vec3& position) {
+    packDomainPosition(fixedField(AvatarWirePosition), position);
+}
+
+glm::vec3 AvatarWireState::getPosition() const {
+    return unpackDomainPosition(fixedField(AvatarWirePosition));
+}
+
+void AvatarWireState::setBodyOrientation(const glm::quat& orientation) {
+    float components[4] = { orientation.x, orientation.y, orientation.z, orientation.w };
+
+    // drop the largest component, it can be recovered from the other three since the quaternion is normalized
+    int largestIndex = 0;
+    for (int i = 1; i < 4; i++) {
+        if (fabsf(components[i]) > fabsf(components[largestIndex])) {
+            largestIndex = i;
+        }
+    }
+
+    // q and -q are the same rotation, so flip it to make the dropped component positive
+    float sign = components[largestIndex] < 0.0f ? -1.0f : 1.0f;
+
+    // none of the other three can be bigger than 1 / sqrt(2)
+    const float MAX_SMALLEST_COMPONENT = 1.0f / sqrtf(2.0f);
+
+    quint32 packed = largestIndex;
+    for (int i = 0; i < 4; i++) {
+        if (i != largestIndex) {
+            packed = (packed << QUATERNION_COMPONENT_BITS)
+                | quantizeToBits(sign * components[i], -MAX_SMALLEST_COMPONENT, MAX_SMALLEST_COMPONENT,
+                                 QUATERNION_COMPONENT_BITS);
+        }
+    }
+
+    memcpy(fixedField(AvatarWireBodyOrientation), &packed, sizeof(packed));
+}
+
+glm::quat AvatarWireState::getBodyOrientation() const {
+    quint32 packed;
+    memcpy(&packed, fixedField(AvatarWireBodyOrientation), sizeof(packed));
+
+    const float MAX_SMALLEST_COMPONENT = 1.0f / sqrtf(2.0f);
+    int largestIndex = packed >> (3 * QUATERNION_COMPONENT_BITS);
+
+    float components[4];
+    float sumOfSquares = 0.0f;
+    int shift = 2 * QUATERNION_COMPONENT_BITS;
+
+    for (int i = 0; i < 4; i++) {
+        if (i != largestIndex) {
+            components[i] = unquantizeFromBits((packed >> shift) & QUATERNION_COMPONENT_MAX,
+                                               -MAX_SMALLEST_COMPONENT, MAX_SMALLEST_COMPONENT, QUATERNION_COMPONENT_BITS);
+            sumOfSquares += components[i] * components[i];
+            shift -= QUATERNION_COMPONENT_BITS;
+        }
+    }
+    components[largestIndex] = sqrtf(std::max(0.0f, 1.0f - sumOfSquares));
+
+    return glm::normalize(glm::quat(components[3], components[0], components[1], components[2]));
+}
+
+void AvatarWireState::setTargetScale(float targetScale) {
+    packFloatRatioToTwoByte(fixedField(AvatarWireTargetScale), targetScale);
+}
+
+float AvatarWireState::getTargetScale() const {
+    float targetScale;
+    unpackFloatRatioFromTwoByte(fixedField(AvatarWireTargetScale), targetScale);
+    return targetScale;
+}
+
+void AvatarWireState::setHeadAngles(const glm::vec3& headAngles) {
+    quint32 packed = quantizeToBits(headAngles.y, MIN_HEAD_YAW, MAX_HEAD_YAW, HEAD_YAW_BITS);
+    packed = (packed << HEAD_PITCH_BITS) | quantizeToBits(headAngles.x, MIN_HEAD_PITCH, MAX_HEAD_PITCH, HEAD_PITCH_BITS);
+    packed = (packed << HEAD_ROLL_BITS) | quantizeToBits(headAngles.z, MIN_HEAD_ROLL, MAX_HEAD_ROLL, HEAD_ROLL_BITS);
+    memcpy(fixedField(AvatarWireHeadAngles), &packed, sizeof(packed));
+}
+
+glm::vec3 AvatarWireState::getHeadAngles() const {
+    quint32 packed;
+    memcpy(&packed, fixedField(AvatarWireHeadAngles), sizeof(packed));
+
+    glm::vec3 headAngles;
+    headAngles.z = unquantizeFromBits(packed & ((1 << HEAD_ROLL_BITS) - 1), MIN_HEAD_ROLL, MAX_HEAD_ROLL, HEAD_ROLL_BITS);
+    packed >>= HEAD_ROLL_BITS;
+    headAngles.x = unquantizeFromBits(packed & ((1 << HEAD_PITCH_BITS) - 1), MIN_HEAD_PITCH, MAX_HEAD_PITCH,
+                                      HEAD_PITCH_BITS);
+    packed >>= HEAD_PITCH_BITS;
+    headAngles.y = unquantizeFromBits(packed, MIN_HEAD_YAW, MAX_HEAD_YAW, HEAD_YAW_BITS);
+    return headAngles;
+}
+
+void AvatarWireState::setLean(float leanSideways, float leanForward) {
+    // the fixed point range is +/- 32 at this radix
+    const float MAX_LEAN = 31.0f;
+    unsigned char* leanField = fixedField(AvatarWireLean);
+    leanField += packFloatScalarToSignedTwoByteFixed(leanField, glm::clamp(leanSideways, -MAX_LEAN, MAX_LEAN), LEAN_RADIX);
+    packFloatScalarToSignedTwoByteFixed(leanField, glm::clamp(leanForward, -MAX_LEAN, MAX_LEAN), LEAN_RADIX);
+}
+
+float AvatarWireState::getLeanSideways() const {
+    return (qint16) unpackTwoByteValue(fixedField(AvatarWireLean)) / (float) (1 << LEAN_RADIX);
+}
+
+float AvatarWireState::getLeanForward() const {
+    return (qint16) unpackTwoByteValue(fixedField(AvatarWireLean) + sizeof(qint16)) / (float) (1 << LEAN_RADIX);
+}
+
+void AvatarWireState::setHandPosition(const glm::vec3& handPosition) {
+    // the fixed point range is +/- 128 at this radix
+    const float MAX_HAND_DISTANCE = 127.0f;
+    packFloatVec3ToSignedTwoByteFixed(fixedField(AvatarWireHandPosition),
+                                      glm::clamp(handPosition, -MAX_HAND_DISTANCE, MAX_HAND_DISTANCE), HAND_POSITION_RADIX);
+}
+
+glm::vec3 AvatarWireState::getHandPosition() const {
+    glm::vec3 handPosition;
+    unpackFloatVec3FromSignedTwoByteFixed(fixedField(AvatarWireHandPosition), handPosition, HAND_POSITION_RADIX);
+    return handPosition;
+}
+
+void AvatarWireState::setLookAtPosition(const glm::vec3& lookAtPosition) {
+    packDomainPosition(fixedField(AvatarWireLookAtPosition), lookAtPosition);
+}
+
+glm::vec3 AvatarWireState::getLookAtPosition() const {
+    return unpackDomainPosition(fixedField(AvatarWireLookAtPosition));
+}
+
+void AvatarWireState::setAudioLoudness(float audioLoudness) {
+    packTwoByteValue(fixedField(AvatarWireAudioLoudness), quantizeToBits(audioLoudness, 0.0f, MAX_AUDIO_LOUDNESS, 16));
+}
+
+float AvatarWireState::getAudioLoudness() const {
+    return unquantizeFromBits(unpackTwoByteValue(fixedField(AvatarWireAudioLoudness)), 0.0f, MAX_AUDIO_LOUDNESS, 16);
+}
+
+void AvatarWireState::setFlags(unsigned char flags) {
+    *fixedField(AvatarWireFlags) = flags;
+}
+
+unsigned char AvatarWireState::getFlags() const {
+    return *fixedField(AvatarWireFlags);
+}
+
+void AvatarWireState::setPupilDilation(float pupilDilation) {
+    *fixedField(AvatarWirePupilDilation) = quantizeToBits(pupilDilation, 0.0f, 1.0f, 8);
+}
+
+float AvatarWireState::getPupilDilation() const {
+    return unquantizeFromBits(*fixedField(AvatarWirePupilDilation), 0.0f, 1.0f, 8);
+}
+
+void AvatarWireState::setVariableField(AvatarWireField field, const QByteArray& value) {
+    // the count is a single byte, so anything longer is cut short
+    _variableFields[field - NUM_AVATAR_WIRE_FIXED_FIELDS] = value.left(MAX_AVATAR_WIRE_VARIABLE_FIELD_BYTES);
+}
+
+void AvatarWireState::setChatMessage(const std::string& chatMessage) {
+    setVariableField(AvatarWireChatMessage, QByteArray(chatMessage.data(), chatMessage.size()));
+}
+
+std::string AvatarWireState::getChatMessage() const {
+    const QByteArray& chatMessage = _variableFields[AvatarWireChatMessage - NUM_AVATAR_WIRE_FIXED_FIELDS];
+    return std::string(chatMessage.constData(), chatMessage.size());
+}
+
+void AvatarWireState::setFaceshift(float leftEyeBlink, float rightEyeBlink, float averageLoudness, float browAudioLift,
+                                   const std::vector<float>& blendshapeCoefficients) {
+    // the blink, brow and blendshape values are all between 0 and 1, so a byte each does
+    int numBlendshapes = std::min((int) blendshapeCoefficients.size(),
+                                  MAX_AVATAR_WIRE_VARIABLE_FIELD_BYTES - FACESHIFT_FIXED_BYTES);
+    QByteArray faceshift(FACESHIFT_FIXED_BYTES + numBlendshapes, 0);
+    unsigned char* faceshiftData = reinterpret_cast<unsigned char*>(faceshift.data());
+
+    *faceshiftData++ = quantizeToBits(leftEyeBlink, 0.0f, 1.0f, 8);
+    *faceshiftData++ = quantizeToBits(rightEyeBlink, 0.0f, 1.0f, 8);
+    packTwoByteValue(faceshiftData, quantizeToBits(averageLoudness, 0.0f, MAX_AUDIO_LOUDNESS, 16));
+    faceshiftData += sizeof(quint16);
+    *faceshiftData++ = quantizeToBits(browAudioLift, 0.0f, 1.0f, 8);
+    *faceshiftData++ = numBlendshapes;
+
+    for (int i = 0; i < numBlendshapes; i++) {
+        *faceshiftData++ = quantizeToBits(blendshapeCoefficients[i], 0.0f, 1.0f, 8);
+    }
+
+    setVariableField(AvatarWireFaceshift, faceshift);
+}
+
+void AvatarWireState::clearFaceshift() {
+    setVariableField(AvatarWireFaceshift, QByteArray());
+}
+
+bool AvatarWireState::getFaceshift(float& leftEyeBlink, float& rightEyeBlink, float& averageLoudness,
+                                   float& browAudioLift, std::vector<float>& blendshapeCoefficients) const {
+    const QByteArray& faceshift = _variableFields[AvatarWireFaceshift - NUM_AVATAR_WIRE_FIXED_FIELDS];
+    if (faceshift.size() < FACESHIFT_FIXED_BYTES) {
+        return false;
+    }
+
+    const unsigned char* faceshiftData = reinterpret_cast<const unsigned char*>(faceshift.constData());
+    leftEyeBlink = unquantizeFromBits(*faceshiftData++, 0.0f, 1.0f, 8);
+    rightEyeBlink = unquantizeFromBits(*faceshiftData++, 0.0f, 1.0f, 8);
+    averageLoudness = unquantizeFromBits(unpackTwoByteValue(faceshiftData), 0.0f, MAX_AUDIO_LOUDNESS, 16);
+    faceshiftData += sizeof(quint16);
+    browAudioLift = unquantizeFromBits(*faceshiftData++, 0.0f, 1.0f, 8);
+
+    int numBlendshapes = std::min((int) *faceshiftData++, faceshift.size() - FACESHIFT_FIXED_BYTES);
+    blendshapeCoefficients.resize(numBlendshapes);
+    for (int i = 0; i < numBlendshapes; i++) {
+        blendshapeCoefficients[i] = unquantizeFromBits(*faceshiftData++, 0.0f, 1.0f, 8);
+    }
+
+    return true;
+}
+
+void AvatarWireState::setHandData(const QByteArray& handData) {
+    setVariableField(AvatarWireHandData, handData);
+}
+
+quint16 AvatarWireState::changedFieldsFrom(const AvatarWireState* baseline) const {
+    static const AvatarWireState DEFAULT_STATE;
+    if (!baseline) {
+        baseline = &DEFAULT_STATE;
+    }
+
+    quint16 changedFields = 0;
+
+    for (int i = 0; i < NUM_AVATAR_WIRE_FIXED_FIELDS; i++) {
+        if (memcmp(_fixedFields + FIXED_FIELD_OFFSETS[i], baseline->_fixedFields + FIXED_FIELD_OFFSETS[i],
+                   FIXED_FIELD_SIZES[i]) != 0) {
+            changedFields |= (1 << i);
+        }
+    }
+
+    for (int i = NUM_AVATAR_WIRE_FIXED_FIELDS; i < NUM_AVATAR_WIRE_FIELDS; i++) {
+        if (_variableFields[i - NUM_AVATAR_WIRE_FIXED_FIELDS] != baseline->_variableFields[i - NUM_AVATAR_WIRE_FIXED_FIELDS]) {
+            changedFields |= (1 << i);
+        }
+    }
+
+    return changedFields;
+}
+
+int AvatarWireState::encode(unsigned char* destinationBuffer, const AvatarWireState* baseline) const {
+    unsigned char* startPosition = destinationBuffer;
+
+    quint16 changedFields = changedFieldsFrom(baseline);
+    memcpy(destinationBuffer, &changedFields, sizeof(changedFields));
+    destinationBuffer += sizeof(changedFields);
+
+    for (int i = 0; i < NUM_AVATAR_WIRE_FIXED_FIELDS; i++) {
+        if (changedFields & (1 << i)) {
+            memcpy(destinationBuffer, _fixedFields + FIXED_FIELD_OFFSETS[i], FIXED_FIELD_SIZES[i]);
+            destinationBuffer += FIXED_FIELD_SIZES[i];
+        }
+    }
+
+    for (int i = NUM_AVATAR_WIRE_FIXED_FIELDS; i < NUM_AVATAR_WIRE_FIELDS; i++) {
+        if (changedFields & (1 << i)) {
+            const QByteArray& value = _variableFields[i - NUM_AVATAR_WIRE_FIXED_FIELDS];
+            *destinationBuffer++ = value.size();
+            memcpy(destinationBuffer, value.constData(), value.size());
+            destinationBuffer += value.size();
+        }
+    }
+
+    return destinationBuffer - startPosition;
+}
+
+int AvatarWireState::decode(const unsigned char* sourceBuffer, int numBytes, const AvatarWireState* baseline) {
+    if (baseline) {
+        *this = *baseline;
+    } else {
+        *this = AvatarWireState();
+    }
+
+    const unsigned char* startPosition = sourceBuffer;
+    const unsigned char* endPosition = sourceBuffer + numBytes;
+
+    quint16 changedFields;
+    if (numBytes < (int) sizeof(changedFields)) {
+        return -1;
+    }
+    memcpy(&changedFields, sourceBuffer, sizeof(changedFields));
+    sourceBuffer += sizeof(changedFields);
+
+    for (int i = 0; i < NUM_AVATAR_WIRE_FIXED_FIELDS; i++) {
+        if (changedFields & (1 << i)) {
+            if (endPosition - sourceBuffer < FIXED_FIELD_SIZES[i]) {
+                return -1;
+            }
+            memcpy(_fixedFields + FIXED_FIELD_OFFSETS[i], sourceBuffer, FIXED_FIELD_SIZES[i]);
+            sourceBuffer += FIXED_FIELD_SIZES[i];
+        }
+    }
+
+    for (int i = NUM_AVATAR_WIRE_FIXED_FIELDS; i < NUM_AVATAR_WIRE_FIELDS; i++) {
+        if (changedFields & (1 << i)) {
+            if (sourceBuffer >= endPosition || endPosition - (sourceBuffer + 1) < *sourceBuffer) {
+                return -1;
+            }
+            int valueSize = *sourceBuffer++;
+            _variableFields[i - NUM_AVATAR_WIRE_FIXED_FIELDS] = QByteArray(reinterpret_cast<const char*>(sourceBuffer),
+                                                                           valueSize);
+            sourceBuffer += valueSize;
+        }
+    }
+
+    return sourceBuffer - startPosition;
+}
+
+AvatarWireStateHistory::AvatarWireStateHistory() :
+    _numAppended(0),
+    _baselineIndex(0),
+    _baselineOrdinal(0),
+    _hasBaseline(false)
+{
+    memset(_sequences, 0, sizeof(_sequences));
+    memset(_appendOrdinals, 0, sizeof(_appendOrdinals));
+}
+
+void AvatarWireStateHistory::append(quint16 sequence, const AvatarWireState& state) {
+    int index = _numAppended % AVATAR_WIRE_HISTORY_LENGTH;
+    _sequences[index] = sequence;
+    _states[index] = state;
+    _appendOrdinals[index] = _numAppended++;
+}
+
+const AvatarWireState* AvatarWireStateHistory::find(quint16 sequence) const {
+    int numKept = std::min(_numAppended, (quint64) AVATAR_WIRE_HISTORY_LENGTH);
+
+    // look from the newest back, so a sequence number that has wrapped around finds the recent state
+    for (int i = 1; i <= numKept; i++) {
+        int index = (_numAppended - i) % AVATAR_WIRE_HISTORY_LENGTH;
+        if (_sequences[index] == sequence) {
+            return &_states[index];
+        }
+    }
+
+    return NULL;
+}
+
+void AvatarWireStateHistory::acknowledge(quint16 latestSequence, quint32 previousSequenceBits) {
+    int numKept = std::min(_numAppended, (quint64) AVATAR_WIRE_HISTORY_LENGTH);
+
+    for (int i = 1; i <= numKept; i++) {
+        int index = (_numAppended - i) % AVATAR_WIRE_HISTORY_LENGTH;
+
+        if (_hasBaseline && _appendOrdinals[index] <= _baselineOrdinal) {
+            // everything from here back is no newer than the baseline we have
+            return;
+        }
+
+        quint16 sequencesBeforeLatest = latestSequence - _sequences[index];
+        if (sequencesBeforeLatest == 0
+            || (sequencesBeforeLatest <= AVATAR_WIRE_ACK_BITS
+                && (previousSequenceBits & ((quint32) 1 << (sequencesBeforeLatest - 1))))) {
+            _baselineIndex = index;
+            _baselineOrdinal = _appendOrdinals[index];
+            _hasBaseline = true;
+            return;
+        }
+    }
+}
+
+const AvatarWireState* AvatarWireStateHistory::getBaseline() const {
+    // the receiver keeps as many states as we do, so once the baseline is overwritten here it may be gone there too
+    if (!_hasBaseline || _numAppended - _baselineOrdinal > AVATAR_WIRE_HISTORY_LENGTH) {
+        return NULL;
+    }
+
+    return &_states[_baselineIndex];
+}
+
+AvatarWireAckTracker::AvatarWireAckTracker() :
+    _hasReceivedSequence(false),
+    _latestSequence(0),
+    _previousSequenceBits(0)
+{
+}
+
+void AvatarWireAckTracker::recordSequence(quint16 sequence) {
+    qint16 sequencesAfterLatest = sequence - _latestSequence;
+
+    if (!_hasReceivedSequence || sequencesAfterLatest > 0 || -sequencesAfterLatest > AVATAR_WIRE_ACK_BITS) {
+        // this is newer than anything we had - or so far behind that the mixer must have started over
+        if (_hasReceivedSequence && sequencesAfterLatest > 0 && sequencesAfterLatest <= AVATAR_WIRE_ACK_BITS) {
+            _previousSequenceBits = (sequencesAfterLatest == AVATAR_WIRE_ACK_BITS ? 0
+                                     : _previousSequenceBits << sequencesAfterLatest)
+                | ((quint32) 1 << (sequencesAfterLatest - 1));
+        } else {
+            _previousSequenceBits = 0;
+        }
+
+        _latestSequence = sequence;
+        _hasReceivedSequence = true;
+    } else if (sequencesAfterLatest < 0) {
+        // this packet arrived out of order
+        _previousSequenceBits |= (quint32) 1 << (-sequencesAfterLatest - 1);
+    }
+}
+
+void AvatarWireAckTracker::appendAck(QByteArray& packet) const {
+    if (_hasReceivedSequence) {
+        packet.append(reinterpret_cast<const char*>(&_latestSequence), sizeof(_latestSequence));
+        packet.append(reinterpret_cast<const char*>(&_previousSequenceBits), sizeof(_previousSequenceBits));
+    }
+}
+
+void AvatarWireAckTracker::reset() {
+    _hasReceivedSequence = false;
+    _latestSequence = 0;
+    _previousSequenceBits = 0;
+}
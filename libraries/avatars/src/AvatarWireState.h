@@ -0,0 +1,186 @@
+//
+//  AvatarWireState.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  The quantized state of an avatar, as it is sent on the wire. Every field is quantized when it is set, so two states
+//  can be compared exactly and only the fields that differ from a baseline the receiver already has need to be sent.
+//
+//  An encoded state is a 16 bit mask of the fields that follow, then each of those fields in mask order:
+//      position, look at position - 24 bits per axis from -TREE_SCALE to TREE_SCALE, about 2mm
+//      body orientation - smallest three quaternion, 2 bit index of the dropped component and 10 bits for each other
+//      head yaw, pitch, roll - 11, 11 and 10 bits across the range HeadData clamps them to
+//      everything else - at most two bytes per value, with the variable length fields prefixed by a byte count
+//  A receiver decodes on top of the same baseline the sender encoded against, or on top of a default constructed
+//  state when there is no baseline, which makes a full state nothing more than a delta against the default.
+//
+
+#ifndef __hifi__AvatarWireState__
+#define __hifi__AvatarWireState__
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <QtCore/QByteArray>
+
+enum AvatarWireField {
+    AvatarWirePosition,
+    AvatarWireBodyOrientation,
+    AvatarWireTargetScale,
+    AvatarWireHeadAngles,
+    AvatarWireLean,
+    AvatarWireHandPosition,
+    AvatarWireLookAtPosition,
+    AvatarWireAudioLoudness,
+    AvatarWireFlags,
+    AvatarWirePupilDilation,
+    AvatarWireChatMessage,
+    AvatarWireFaceshift,
+    AvatarWireHandData,
+    NUM_AVATAR_WIRE_FIELDS
+};
+
+const int NUM_AVATAR_WIRE_FIXED_FIELDS = AvatarWireChatMessage;
+const int AVATAR_WIRE_FIXED_FIELDS_BYTES = 42;
+
+/// the largest a variable length field can be, since it is prefixed by a one byte count
+const int MAX_AVATAR_WIRE_VARIABLE_FIELD_BYTES = 255;
+
+/// the most bytes an encoded state can take up
+const int MAX_AVATAR_WIRE_STATE_BYTES = sizeof(quint16) + AVATAR_WIRE_FIXED_FIELDS_BYTES
+    + ((NUM_AVATAR_WIRE_FIELDS - NUM_AVATAR_WIRE_FIXED_FIELDS) * (1 + MAX_AVATAR_WIRE_VARIABLE_FIELD_BYTES));
+
+class AvatarWireState {
+public:
+    AvatarWireState();
+
+    void setPosition(const glm::vec3& position);
+    glm::vec3 getPosition() const;
+
+    void setBodyOrientation(const glm::quat& orientation);
+    glm::quat getBodyOrientation() const;
+
+    void setTargetScale(float targetScale);
+    float getTargetScale() const;
+
+    /// head angles are in degrees, relative to the body, and stored as pitch, yaw, roll like glm's euler angles
+    void setHeadAngles(const glm::vec3& headAngles);
+    glm::vec3 getHeadAngles() const;
+
+    void setLean(float leanSideways, float leanForward);
+    float getLeanSideways() const;
+    float getLeanForward() const;
+
+    void setHandPosition(const glm::vec3& handPosition);
+    glm::vec3 getHandPosition() const;
+
+    void setLookAtPosition(const glm::vec3& lookAtPosition);
+    glm::vec3 getLookAtPosition() const;
+
+    void setAudioLoudness(float audioLoudness);
+    float getAudioLoudness() const;
+
+    void setFlags(unsigned char flags);
+    unsigned char getFlags() const;
+
+    void setPupilDilation(float pupilDilation);
+    float getPupilDilation() const;
+
+    void setChatMessage(const std::string& chatMessage);
+    std::string getChatMessage() const;
+
+    /// the faceshift values are only sent while faceshift is connected, so an empty field means it is not
+    void setFaceshift(float leftEyeBlink, float rightEyeBlink, float averageLoudness, float browAudioLift,
+                      const std::vector<float>& blendshapeCoefficients);
+    void clearFaceshift();
+    bool getFaceshift(float& leftEyeBlink, float& rightEyeBlink, float& averageLoudness, float& browAudioLift,
+                      std::vector<float>& blendshapeCoefficients) const;
+
+    /// hand data is kept as encoded by HandData::encodeRemoteData
+    void setHandData(const QByteArray& handData);
+    const QByteArray& getHandData() const { return _variableFields[AvatarWireHandData - NUM_AVATAR_WIRE_FIXED_FIELDS]; }
+
+    /// the mask of the fields that differ between this state and the baseline (or the default state, if there is none)
+    quint16 changedFieldsFrom(const AvatarWireState* baseline) const;
+
+    /// packs the fields that differ from the baseline into destinationBuffer, which needs MAX_AVATAR_WIRE_STATE_BYTES
+    /// free, and returns the number of bytes packed
+    int encode(unsigned char* destinationBuffer, const AvatarWireState* baseline) const;
+
+    /// unpacks a state encoded against the baseline, returns the bytes read or -1 when the data is cut short
+    int decode(const unsigned char* sourceBuffer, int numBytes, const AvatarWireState* baseline);
+
+    bool operator==(const AvatarWireState& otherState) const { return changedFieldsFrom(&otherState) == 0; }
+private:
+    unsigned char* fixedField(AvatarWireField field) { return _fixedFields + FIXED_FIELD_OFFSETS[field]; }
+    const unsigned char* fixedField(AvatarWireField field) const { return _fixedFields + FIXED_FIELD_OFFSETS[field]; }
+
+    void setVariableField(AvatarWireField field, const QByteArray& value);
+
+    static const int FIXED_FIELD_OFFSETS[NUM_AVATAR_WIRE_FIXED_FIELDS + 1];
+
+    unsigned char _fixedFields[AVATAR_WIRE_FIXED_FIELDS_BYTES];
+    QByteArray _variableFields[NUM_AVATAR_WIRE_FIELDS - NUM_AVATAR_WIRE_FIXED_FIELDS];
+};
+
+/// how many states of one avatar a history keeps, which bounds how far behind an acknowledged baseline can fall
+const int AVATAR_WIRE_HISTORY_LENGTH = 16;
+
+/// the number of sequence numbers before the latest that an acknowledgement carries a bit for
+const int AVATAR_WIRE_ACK_BITS = 32;
+
+/// the last few states of one avatar sent to, or received by, one node - keyed by the sequence number of their packet
+class AvatarWireStateHistory {
+public:
+    AvatarWireStateHistory();
+
+    void append(quint16 sequence, const AvatarWireState& state);
+
+    /// the state that was sent or received in the packet with the passed sequence number, NULL if it is not kept
+    const AvatarWireState* find(quint16 sequence) const;
+
+    /// moves the baseline up to the newest state in a packet the receiver says it has - bit i of previousSequenceBits
+    /// is set when the packet latestSequence - 1 - i was received as well
+    void acknowledge(quint16 latestSequence, quint32 previousSequenceBits);
+
+    /// the newest acknowledged state, NULL if there is none or the receiver may no longer have it
+    const AvatarWireState* getBaseline() const;
+    quint16 getBaselineSequence() const { return _sequences[_baselineIndex]; }
+
+    /// true when nothing was appended after the acknowledged baseline, so the receiver has no state newer than it
+    bool isBaselineLatest() const { return _hasBaseline && _baselineOrdinal + 1 == _numAppended; }
+private:
+    quint16 _sequences[AVATAR_WIRE_HISTORY_LENGTH];
+    AvatarWireState _states[AVATAR_WIRE_HISTORY_LENGTH];
+    quint64 _appendOrdinals[AVATAR_WIRE_HISTORY_LENGTH];
+    quint64 _numAppended;
+    int _baselineIndex;
+    quint64 _baselineOrdinal;
+    bool _hasBaseline;
+};
+
+/// the bulk avatar packets a node has received from its mixer, kept the way it acknowledges them - the latest sequence
+/// number and a bit for each of the AVATAR_WIRE_ACK_BITS before it, which AvatarWireStateHistory::acknowledge reads
+class AvatarWireAckTracker {
+public:
+    AvatarWireAckTracker();
+
+    void recordSequence(quint16 sequence);
+
+    /// appends the latest sequence number and the bits before it, or nothing until a packet has been received
+    void appendAck(QByteArray& packet) const;
+
+    /// forgets everything received, for when the next mixer will number its packets from the start
+    void reset();
+private:
+    bool _hasReceivedSequence;
+    quint16 _latestSequence;
+    quint32 _previousSequenceBits;
+};
+
+#endif /* defined(__hifi__AvatarWireState__) */
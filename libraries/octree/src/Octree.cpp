@@ -32,6 +32,8 @@
 #include "ViewFrustum.h"
 #include "OctreeConstants.h"
 #include "OctreeElementBag.h"
+#include "OctreeEncodeCache.h"
+#include "OctreeSentState.h"
 #include "Octree.h"
 
 float boundaryDistanceForRenderLevel(unsigned int renderLevel, float voxelSizeScale) {
@@ -709,6 +711,7 @@ int Octree::encodeTreeBitstream(OctreeElement* node,
 
     bytesWritten += codeLength; // keep track of byte count
 
+    int pendingCount = params.sentState ? params.sentState->getPendingCount() : 0;
     int currentEncodeLevel = 0;
 
     // record some stats, this is the one node that we won't record below in the recursion function, so we need to
@@ -717,7 +720,7 @@ int Octree::encodeTreeBitstream(OctreeElement* node,
         params.stats->traversed(node);
     }
 
-    int childBytesWritten = encodeTreeBitstreamRecursion(node, packetData, bag, params, currentEncodeLevel);
+    int childBytesWritten = encodeTreeBitstreamRecursionCached(node, packetData, bag, params, currentEncodeLevel);
 
     // if childBytesWritten == 1 then something went wrong... that's not possible
     assert(childBytesWritten != 1);
@@ -740,6 +743,9 @@ int Octree::encodeTreeBitstream(OctreeElement* node,
 
     if (bytesWritten == 0) {
         packetData->discardSubTree();
+        if (params.sentState) {
+            params.sentState->discardPendingAfter(pendingCount);
+        }
     } else {
         packetData->endSubTree();
     }
@@ -897,9 +903,11 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* node,
     unsigned char childrenExistInTreeBits = 0;
     unsigned char childrenExistInPacketBits = 0;
     unsigned char childrenColoredBits = 0;
+    unsigned char childrenHeldBits = 0;
 
     // Make our local buffer large enough to handle writing at this level in case we need to.
     LevelDetails thisLevelKey = packetData->startLevel();
+    int pendingCount = params.sentState ? params.sentState->getPendingCount() : 0;
 
     int inViewCount = 0;
     int inViewNotLeafCount = 0;
@@ -1050,10 +1058,20 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* node,
                         }
                     }
 
+                    // A client that already has the child's current color doesn't need it again, wherever it has been
+                    // looking since. We treat it like a colored child below, and don't dig any deeper into it.
+                    bool childIsHeld = params.sentState && params.includeColor && params.sentState->isHeld(childNode);
+
                     // If our child wasn't in view (or we're ignoring wasInView) then we add it to our sending items.
                     // Or if we were previously in the view, but this node has changed since it was last sent, then we do
                     // need to send it.
-                    if (!childWasInView ||
+                    if (childIsHeld) {
+                        childrenHeldBits += (1 << (7 - originalIndex));
+                        params.skippedHeldCount++;
+                        if (params.stats) {
+                            params.stats->skippedWasInView(childNode);
+                        }
+                    } else if (!childWasInView ||
                         (params.deltaViewFrustum &&
                          childNode->hasChangedSince(params.lastViewFrustumSent - CHANGE_FUDGE))){
 
@@ -1101,6 +1119,10 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* node,
 
                     bytesAtThisLevel += (bytesAfterChild - bytesBeforeChild); // keep track of byte count for this child
 
+                    if (params.sentState) {
+                        params.sentState->markPending(childNode);
+                    }
+
                     // don't need to check childNode here, because we can't get here with no childNode
                     if (params.stats) {
                         params.stats->colorSent(childNode);
@@ -1181,8 +1203,20 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* node,
                 //
                 // This only applies in the view frustum case, in other cases, like file save and copy/past where
                 // no viewFrustum was requested, we still want to recurse the child tree.
-                if (!params.viewFrustum || !oneAtBit(childrenColoredBits, originalIndex)) {
-                    childTreeBytesOut = encodeTreeBitstreamRecursion(childNode, packetData, bag, params, thisLevel);
+                if (!params.viewFrustum || !oneAtBit(childrenColoredBits | childrenHeldBits, originalIndex)) {
+                    // A prioritized bag wants deeper levels back, so they're sent in the order of how big they will look
+                    // along with everything else in the bag. There's no point deferring what wouldn't be sent anyway.
+                    bool deferChild = bag.isPrioritized() && params.viewFrustum && thisLevel >= PRIORITY_ENCODE_LEVELS
+                            && !childNode->isLeaf()
+                            && childNode->distanceToCamera(*params.viewFrustum)
+                                < boundaryDistanceForRenderLevel(childNode->getLevel() + params.boundaryLevelAdjust,
+                                                                 params.octreeElementSizeScale);
+                    if (deferChild) {
+                        bag.insert(childNode);
+                        params.deferredCount++;
+                    } else {
+                        childTreeBytesOut = encodeTreeBitstreamRecursionCached(childNode, packetData, bag, params, thisLevel);
+                    }
                 }
 
                 // remember this for reshuffling
@@ -1286,6 +1320,12 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* node,
 
     if (!continueThisLevel) {
         bag.insert(node);
+        params.didntFitCount++;
+
+        // nothing written at this level or below made it into the packet
+        if (params.sentState) {
+            params.sentState->discardPendingAfter(pendingCount);
+        }
 
         // don't need to check node here, because we can't get here with no node
         if (params.stats) {
@@ -1299,6 +1339,79 @@ int Octree::encodeTreeBitstreamRecursion(OctreeElement* node,
     return bytesAtThisLevel;
 }
 
+int Octree::encodeTreeBitstreamRecursionCached(OctreeElement* node,
+                                                OctreePacketData* packetData, OctreeElementBag& bag,
+                                                EncodeBitstreamParams& params, int& currentEncodeLevel) const {
+    OctreeEncodeCache* encodeCache = params.encodeCache;
+    int lodLevel = (encodeCache && node) ? encodeCache->lodLevelForEncode(node, params) : NOT_ENCODE_CACHEABLE;
+    if (lodLevel == NOT_ENCODE_CACHEABLE) {
+        return encodeTreeBitstreamRecursion(node, packetData, bag, params, currentEncodeLevel);
+    }
+
+    // If another client has seen this subtree the same way, its bytes are already known - as long as they fit. A client
+    // that has already been sent the subtree's root has likely been sent much of the rest, and is better off with just
+    // what it doesn't have.
+    OctreeEncodedSubtree encodedSubtree;
+    bool wantCachedSubtree = !(params.sentState && params.sentState->isHeld(node));
+    if (wantCachedSubtree && encodeCache->findSubtree(node, lodLevel, params, encodedSubtree)
+            && packetData->appendRawData((const unsigned char*) encodedSubtree.bytes.constData(),
+                                         encodedSubtree.bytes.size())) {
+        encodeCache->recordHit(encodedSubtree);
+        if (params.stats) {
+            params.stats->colorsSent(encodedSubtree.leavesColorSent, encodedSubtree.internalColorSent);
+        }
+        if (params.sentState) {
+            params.sentState->markPending(encodedSubtree.sentElementIDs);
+        }
+        currentEncodeLevel++;
+        params.maxLevelReached = std::max(currentEncodeLevel + encodedSubtree.levelsBelow, params.maxLevelReached);
+        return encodedSubtree.bytesWritten;
+    }
+    encodeCache->recordMiss();
+
+    // Encode it, and keep what was written unless some of the subtree was left in the bag for later, or left out because
+    // this client already had it.
+    int startOffset = packetData->getUncompressedByteOffset();
+    int pendingCount = params.sentState ? params.sentState->getPendingCount() : 0;
+    int didntFitCountBefore = params.didntFitCount;
+    int skippedHeldCountBefore = params.skippedHeldCount;
+    int deferredCountBefore = params.deferredCount;
+    int maxLevelReachedBefore = params.maxLevelReached;
+    int startEncodeLevel = currentEncodeLevel;
+    unsigned long leavesColorSentBefore = params.stats ? params.stats->getLeavesColorSent() : 0;
+    unsigned long internalColorSentBefore = params.stats ? params.stats->getInternalColorSent() : 0;
+    params.maxLevelReached = 0;
+    quint64 encodeStart = usecTimestampNow();
+
+    int bytesWritten = encodeTreeBitstreamRecursion(node, packetData, bag, params, currentEncodeLevel);
+
+    quint64 encodeUsecs = usecTimestampNow() - encodeStart;
+    int levelsBelow = std::max(params.maxLevelReached - (startEncodeLevel + 1), 0);
+    params.maxLevelReached = std::max(maxLevelReachedBefore, params.maxLevelReached);
+
+    if (params.didntFitCount == didntFitCountBefore && params.skippedHeldCount == skippedHeldCountBefore
+            && params.deferredCount == deferredCountBefore) {
+        encodedSubtree.lodLevel = lodLevel;
+        encodedSubtree.includeColor = params.includeColor;
+        encodedSubtree.includeExistsBits = params.includeExistsBits;
+        encodedSubtree.lastChanged = node->getLastChanged();
+        encodedSubtree.bytes = QByteArray((const char*) packetData->getUncompressedData() + startOffset,
+                                          packetData->getUncompressedByteOffset() - startOffset);
+        encodedSubtree.bytesWritten = bytesWritten;
+        encodedSubtree.levelsBelow = levelsBelow;
+        encodedSubtree.encodeUsecs = encodeUsecs;
+        encodedSubtree.leavesColorSent = params.stats ? params.stats->getLeavesColorSent() - leavesColorSentBefore : 0;
+        encodedSubtree.internalColorSent = params.stats
+            ? params.stats->getInternalColorSent() - internalColorSentBefore : 0;
+        if (params.sentState) {
+            encodedSubtree.sentElementIDs = params.sentState->getPending().mid(pendingCount);
+        }
+        encodeCache->storeSubtree(node, encodedSubtree);
+    }
+
+    return bytesWritten;
+}
+
 bool Octree::readFromSVOFile(const char* fileName) {
     bool fileOk = false;
     std::ifstream file(fileName, std::ios::in|std::ios::binary|std::ios::ate);
@@ -1331,7 +1444,7 @@ bool Octree::readFromSVOFile(const char* fileName) {
             if (gotType == expectedType) {
                 dataAt += sizeof(expectedType);
                 dataLength -= sizeof(expectedType);
-                PacketVersion expectedVersion = versionForPacketType(expectedType);
+                PacketVersion expectedVersion = dataVersionForPacketType(expectedType);
                 PacketVersion gotVersion = *dataAt;
                 if (gotVersion == expectedVersion) {
                     dataAt += sizeof(expectedVersion);
@@ -1370,7 +1483,7 @@ void Octree::writeToSVOFile(const char* fileName, OctreeElement* node) {
         if (getWantSVOfileVersions()) {
             // if so, read the first byte of the file and see if it matches the expected version code
             PacketType expectedType = expectedDataPacketType();
-            PacketVersion expectedVersion = versionForPacketType(expectedType);
+            PacketVersion expectedVersion = dataVersionForPacketType(expectedType);
             file.write(reinterpret_cast<char*>(&expectedType), sizeof(expectedType));
             file.write(&expectedVersion, sizeof(expectedVersion));
         }
@@ -18,7 +18,9 @@ class ReadBitstreamToTreeParams;
 class Octree;
 class OctreeElement;
 class OctreeElementBag;
+class OctreeEncodeCache;
 class OctreePacketData;
+class OctreeSentState;
 
 
 #include "JurisdictionMap.h"
@@ -49,6 +51,10 @@ const int NO_BOUNDARY_ADJUST     = 0;
 const int LOW_RES_MOVING_ADJUST  = 1;
 const quint64 IGNORE_LAST_SENT  = 0;
 
+/// with a prioritized bag, how many levels of a subtree are encoded before the rest goes back in the bag to be sent in
+/// priority order with everything else
+const int PRIORITY_ENCODE_LEVELS = 3;
+
 #define IGNORE_SCENE_STATS       NULL
 #define IGNORE_VIEW_FRUSTUM      NULL
 #define IGNORE_COVERAGE_MAP      NULL
@@ -72,6 +78,8 @@ public:
     OctreeSceneStats* stats;
     CoverageMap* map;
     JurisdictionMap* jurisdictionMap;
+    OctreeEncodeCache* encodeCache;
+    OctreeSentState* sentState;
 
     // output hints from the encode process
     typedef enum {
@@ -87,6 +95,9 @@ public:
         OCCLUDED
     } reason;
     reason stopReason;
+    int didntFitCount;
+    int skippedHeldCount;
+    int deferredCount;
 
     EncodeBitstreamParams(
         int maxEncodeLevel = INT_MAX,
@@ -120,7 +131,12 @@ public:
             stats(stats),
             map(map),
             jurisdictionMap(jurisdictionMap),
-            stopReason(UNKNOWN)
+            encodeCache(NULL),
+            sentState(NULL),
+            stopReason(UNKNOWN),
+            didntFitCount(0),
+            skippedHeldCount(0),
+            deferredCount(0)
     {}
 
     void displayStopReason() {
@@ -276,6 +292,11 @@ protected:
                                      OctreePacketData* packetData, OctreeElementBag& bag,
                                      EncodeBitstreamParams& params, int& currentEncodeLevel) const;
 
+    /// encodeTreeBitstreamRecursion(), or the bytes it wrote for the subtree last time if params.encodeCache has them
+    int encodeTreeBitstreamRecursionCached(OctreeElement* node,
+                                           OctreePacketData* packetData, OctreeElementBag& bag,
+                                           EncodeBitstreamParams& params, int& currentEncodeLevel) const;
+
     static bool countOctreeElementsOperation(OctreeElement* node, void* extraData);
 
     OctreeElement* nodeForOctalCode(OctreeElement* ancestorNode, const unsigned char* needleCode, OctreeElement** parentOfFoundNode) const;
@@ -44,4 +44,13 @@ const int DANGEROUSLY_DEEP_RECURSION = 200; // use this for something that needs
 
 const int DEFAULT_MAX_OCTREE_PPS = 600; // the default maximum PPS we think any octree based server should send to a client
 
+// How compressed octree packets are compressed. Every codec writes a stream that qUncompress() reads, so clients can read
+// whichever one the server uses - a client asks for the one that suits it in its query.
+enum OctreePacketCodec {
+    OCTREE_CODEC_ZLIB_BEST = 0, // smallest packets, for bandwidth bound servers and clients
+    OCTREE_CODEC_ZLIB_FAST,     // much less CPU for slightly bigger packets, for CPU bound servers
+    OCTREE_CODEC_COUNT
+};
+const OctreePacketCodec DEFAULT_OCTREE_PACKET_CODEC = OCTREE_CODEC_ZLIB_BEST;
+
 #endif
\ No newline at end of file
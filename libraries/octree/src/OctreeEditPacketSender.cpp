@@ -34,7 +34,9 @@ OctreeEditPacketSender::OctreeEditPacketSender() :
     _releaseQueuedMessagesPending(false),
     _serverJurisdictions(NULL),
     _sequenceNumber(0),
-    _maxPacketSize(MAX_PACKET_SIZE) {
+    _maxPacketSize(maxChannelPayloadBytes()) {
+    // edits go out on a reliable channel, so a lost one is retransmitted and a duplicate is never applied twice
+    setChannel(ChannelID::OctreeEdits, ChannelMode::Reliable);
     //printf("OctreeEditPacketSender::OctreeEditPacketSender() [%p] created... \n", this);
 }
 
@@ -178,6 +180,12 @@ void OctreeEditPacketSender::queuePacketToNodes(unsigned char* buffer, ssize_t l
             const JurisdictionMap& map = (*_serverJurisdictions)[nodeUUID];
             isMyJurisdiction = (map.isMyJurisdiction(octCode, CHECK_NODE_ONLY) == JurisdictionMap::WITHIN);
             if (isMyJurisdiction) {
+                // edits to a node must arrive in the order they were made, so send any batch still being packed for
+                // this node first and queue the single edit behind it
+                std::map<QUuid, EditPacketBuffer>::iterator pending = _pendingEditPackets.find(nodeUUID);
+                if (pending != _pendingEditPackets.end()) {
+                    releaseQueuedPacket(pending->second);
+                }
                 queuePacketToNode(nodeUUID, buffer, length);
             }
         }
@@ -6,6 +6,7 @@
 //  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <stdio.h>
@@ -28,6 +29,26 @@ quint64 OctreeElement::_octcodeMemoryUsage = 0;
 quint64 OctreeElement::_externalChildrenMemoryUsage = 0;
 quint64 OctreeElement::_voxelNodeCount = 0;
 quint64 OctreeElement::_voxelNodeLeafCount = 0;
+QAtomicInt OctreeElement::_nextElementID(0);
+QMutex OctreeElement::_freeElementIDsMutex;
+std::vector<quint32> OctreeElement::_freeElementIDs;
+
+const int ELEMENT_ID_BATCH_SIZE = 256;
+
+/// the ids of the elements a thread has deleted and not yet handed back to the shared list
+class OctreeElement::LocalFreeElementIDs {
+public:
+    ~LocalFreeElementIDs() {
+        // the thread is going away, and nobody else would reuse these
+        QMutexLocker locker(&_freeElementIDsMutex);
+        _freeElementIDs.insert(_freeElementIDs.end(), ids.begin(), ids.end());
+    }
+
+    std::vector<quint32> ids;
+};
+
+// defined after the shared list, so that it is destroyed first
+QThreadStorage<OctreeElement::LocalFreeElementIDs*> OctreeElement::_localFreeElementIDs;
 
 OctreeElement::OctreeElement() {
     // Note: you must call init() from your subclass, otherwise the OctreeElement will not be properly
@@ -43,6 +64,26 @@ void OctreeElement::init(unsigned char * octalCode) {
     _voxelNodeCount++;
     _voxelNodeLeafCount++; // all nodes start as leaf nodes
 
+    // take the id of an element that has gone if there is one, so the ids stay about as dense as the tree
+    if (!_localFreeElementIDs.hasLocalData()) {
+        _localFreeElementIDs.setLocalData(new LocalFreeElementIDs());
+    }
+    std::vector<quint32>& freeElementIDs = _localFreeElementIDs.localData()->ids;
+
+    if (freeElementIDs.empty()) {
+        QMutexLocker locker(&_freeElementIDsMutex);
+        int batchSize = std::min((int) _freeElementIDs.size(), ELEMENT_ID_BATCH_SIZE);
+        freeElementIDs.insert(freeElementIDs.end(), _freeElementIDs.end() - batchSize, _freeElementIDs.end());
+        _freeElementIDs.resize(_freeElementIDs.size() - batchSize);
+    }
+
+    if (freeElementIDs.empty()) {
+        _elementID = (quint32) _nextElementID.fetchAndAddRelaxed(1);
+    } else {
+        _elementID = freeElementIDs.back();
+        freeElementIDs.pop_back();
+    }
+
 
     int octalCodeLength = bytesRequiredForCodeLength(numberOfThreeBitSectionsInCode(octalCode));
     if (octalCodeLength > sizeof(_octalCode)) {
@@ -91,6 +132,19 @@ void OctreeElement::init(unsigned char * octalCode) {
 
 OctreeElement::~OctreeElement() {
     notifyDeleteHooks();
+
+    if (!_localFreeElementIDs.hasLocalData()) {
+        _localFreeElementIDs.setLocalData(new LocalFreeElementIDs());
+    }
+    std::vector<quint32>& freeElementIDs = _localFreeElementIDs.localData()->ids;
+    freeElementIDs.push_back(_elementID);
+
+    // a thread that deletes more than it creates hands its ids on for the others to reuse
+    if ((int) freeElementIDs.size() > ELEMENT_ID_BATCH_SIZE) {
+        QMutexLocker locker(&_freeElementIDsMutex);
+        _freeElementIDs.insert(_freeElementIDs.end(), freeElementIDs.begin(), freeElementIDs.end());
+        freeElementIDs.clear();
+    }
     _voxelNodeCount--;
     if (isLeaf()) {
         _voxelNodeLeafCount--;
@@ -1275,25 +1329,32 @@ void OctreeElement::notifyDeleteHooks() {
     _deleteHooksLock.unlock();
 }
 
+QReadWriteLock OctreeElement::_updateHooksLock;
 std::vector<OctreeElementUpdateHook*> OctreeElement::_updateHooks;
 
 void OctreeElement::addUpdateHook(OctreeElementUpdateHook* hook) {
+    _updateHooksLock.lockForWrite();
     _updateHooks.push_back(hook);
+    _updateHooksLock.unlock();
 }
 
 void OctreeElement::removeUpdateHook(OctreeElementUpdateHook* hook) {
+    _updateHooksLock.lockForWrite();
     for (unsigned int i = 0; i < _updateHooks.size(); i++) {
         if (_updateHooks[i] == hook) {
             _updateHooks.erase(_updateHooks.begin() + i);
-            return;
+            break;
         }
     }
+    _updateHooksLock.unlock();
 }
 
 void OctreeElement::notifyUpdateHooks() {
+    _updateHooksLock.lockForRead();
     for (unsigned int i = 0; i < _updateHooks.size(); i++) {
         _updateHooks[i]->elementUpdated(this);
     }
+    _updateHooksLock.unlock();
 }
 
 bool OctreeElement::findSpherePenetration(const glm::vec3& center, float radius,
@@ -13,7 +13,10 @@
 //#define SIMPLE_CHILD_ARRAY
 #define SIMPLE_EXTERNAL_CHILDREN
 
+#include <QAtomicInt>
+#include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
 
 #include <SharedUtil.h>
 #include "AABox.h"
@@ -132,6 +135,9 @@ public:
     bool isDirty() const { return _isDirty; }
     void clearDirtyBit() { _isDirty = false; }
     void setDirtyBit() { _isDirty = true; }
+    /// Dense id that no other existing element has, reused once the element is deleted - for per-client bitsets
+    quint32 getElementID() const { return _elementID; }
+
     bool hasChangedSince(quint64 time) const { return (_lastChanged > time); }
     void markWithChangedTime();
     quint64 getLastChanged() const { return _lastChanged; }
@@ -228,6 +234,7 @@ protected:
     } _octalCode;  
 
     quint64 _lastChanged; /// Client and server, timestamp this node was last changed, 8 bytes
+    quint32 _elementID; /// Client and server, dense id reused after the element is deleted, 4 bytes
 
     /// Client and server, pointers to child nodes, various encodings
 #ifdef SIMPLE_CHILD_ARRAY
@@ -275,9 +282,19 @@ protected:
     static QReadWriteLock _deleteHooksLock;
     static std::vector<OctreeElementDeleteHook*> _deleteHooks;
 
-    //static QReadWriteLock _updateHooksLock;
+    static QReadWriteLock _updateHooksLock;
     static std::vector<OctreeElementUpdateHook*> _updateHooks;
 
+    // the voxel and particle trees make elements on different threads, so new ids come from an atomic counter and each
+    // thread first reuses the ids of the elements it deleted, without a lock. A thread that has freed more than
+    // ELEMENT_ID_BATCH_SIZE hands them to the shared list, as it does when it exits, and a thread with none of its own
+    // takes a batch from there before counting up - so the ids stay about as dense as the trees
+    class LocalFreeElementIDs;
+    static QAtomicInt _nextElementID;
+    static QMutex _freeElementIDsMutex;
+    static std::vector<quint32> _freeElementIDs;
+    static QThreadStorage<LocalFreeElementIDs*> _localFreeElementIDs;
+
     static quint64 _voxelNodeCount;
     static quint64 _voxelNodeLeafCount;
 
@@ -6,13 +6,21 @@
 //  Copyright (c) 2013 High Fidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
+
 #include "OctreeElementBag.h"
 #include <OctalCode.h>
 
+// elements the viewer is inside of or right on top of are all about as close as each other
+const float MIN_PRIORITY_DISTANCE = 0.1f;
+
 OctreeElementBag::OctreeElementBag() : 
     _bagElements(NULL),
     _elementsInUse(0),
-    _sizeOfElementsArray(0) {
+    _sizeOfElementsArray(0),
+    _priorityView(NULL),
+    _prioritizedElements(),
+    _elementPriorities() {
     OctreeElement::addDeleteHook(this);
 };
 
@@ -28,6 +36,28 @@ void OctreeElementBag::deleteAll() {
     _bagElements = NULL;
     _elementsInUse = 0;
     _sizeOfElementsArray = 0;
+    _prioritizedElements.clear();
+    _elementPriorities.clear();
+}
+
+void OctreeElementBag::setPriorityView(const ViewFrustum* viewFrustum) {
+    // whatever is already in the bag goes back in the new way
+    std::vector<OctreeElement*> elements;
+    while (!isEmpty()) {
+        elements.push_back(extract());
+    }
+
+    _priorityView = viewFrustum;
+
+    for (size_t i = 0; i < elements.size(); i++) {
+        insert(elements[i]);
+    }
+}
+
+float OctreeElementBag::priorityFor(const OctreeElement* element) const {
+    // the size of the element over its distance is about how big it will look
+    float distance = element->distanceToCamera(*_priorityView);
+    return (element->getScale() * TREE_SCALE) / std::max(distance, MIN_PRIORITY_DISTANCE);
 }
 
 
@@ -35,6 +65,14 @@ const int GROW_BAG_BY = 100;
 
 // put a node into the bag
 void OctreeElementBag::insert(OctreeElement* element) {
+    if (isPrioritized()) {
+        if (!_elementPriorities.contains(element)) {
+            float priority = priorityFor(element);
+            _elementPriorities.insert(element, priority);
+            _prioritizedElements.insert(priority, element);
+        }
+        return;
+    }
 
     // Search for where we should live in the bag (sorted)
     // Note: change this to binary search... instead of linear!
@@ -77,6 +115,19 @@ void OctreeElementBag::insert(OctreeElement* element) {
  
 // pull a node out of the bag (could come in any order)
 OctreeElement* OctreeElementBag::extract() {
+    if (isPrioritized()) {
+        if (_prioritizedElements.isEmpty()) {
+            return NULL;
+        }
+
+        // the map is ordered lowest priority first
+        QMultiMap<float, OctreeElement*>::iterator highest = _prioritizedElements.end() - 1;
+        OctreeElement* element = highest.value();
+        _prioritizedElements.erase(highest);
+        _elementPriorities.remove(element);
+        return element;
+    }
+
     // pull the last node out, and shrink our list...
     if (_elementsInUse) {
         
@@ -92,6 +143,10 @@ OctreeElement* OctreeElementBag::extract() {
 }
 
 bool OctreeElementBag::contains(OctreeElement* element) {
+    if (isPrioritized()) {
+        return _elementPriorities.contains(element);
+    }
+
     for (int i = 0; i < _elementsInUse; i++) {
         // just compare the pointers... that's good enough
         if (_bagElements[i] == element) {
@@ -107,6 +162,15 @@ bool OctreeElementBag::contains(OctreeElement* element) {
 }
 
 void OctreeElementBag::remove(OctreeElement* element) {
+    if (isPrioritized()) {
+        QHash<OctreeElement*, float>::iterator found = _elementPriorities.find(element);
+        if (found != _elementPriorities.end()) {
+            _prioritizedElements.remove(found.value(), element);
+            _elementPriorities.erase(found);
+        }
+        return;
+    }
+
     int foundAt = -1;
     for (int i = 0; i < _elementsInUse; i++) {
         // just compare the pointers... that's good enough
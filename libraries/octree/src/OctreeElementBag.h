@@ -10,11 +10,18 @@
 //  more than once (in other words, it de-dupes automatically), also, it supports collapsing it's several peer nodes
 //  into a parent node in cases where you add enough peers that it makes more sense to just add the parent.
 //
+//  Given a view to prioritize for, it instead hands out the elements that will look biggest from that view first, so
+//  what's right in front of the viewer is sent before far away detail.
+//
 
 #ifndef __hifi__OctreeElementBag__
 #define __hifi__OctreeElementBag__
 
+#include <QtCore/QHash>
+#include <QtCore/QMultiMap>
+
 #include "OctreeElement.h"
+#include "ViewFrustum.h"
 
 class OctreeElementBag : public OctreeElementDeleteHook {
 
@@ -23,21 +30,31 @@ public:
     ~OctreeElementBag();
     
     void insert(OctreeElement* element); // put a element into the bag
-    OctreeElement* extract(); // pull a element out of the bag (could come in any order)
+    OctreeElement* extract(); // pull a element out of the bag (in priority order if prioritized, otherwise any order)
     bool contains(OctreeElement* element); // is this element in the bag?
     void remove(OctreeElement* element); // remove a specific element from the bag
     
-    bool isEmpty() const { return (_elementsInUse == 0); }
-    int count() const { return _elementsInUse; }
+    bool isEmpty() const { return (count() == 0); }
+    int count() const { return isPrioritized() ? _elementPriorities.size() : _elementsInUse; }
+
+    /// Extract the elements that will look biggest from this view first, nearest and largest before far and small.
+    /// The view is only looked at as elements are inserted. Pass NULL to go back to extracting in any order.
+    void setPriorityView(const ViewFrustum* viewFrustum);
+    bool isPrioritized() const { return (_priorityView != NULL); }
 
     void deleteAll();
     virtual void elementDeleted(OctreeElement* element);
 
 private:
+    float priorityFor(const OctreeElement* element) const;
     
     OctreeElement** _bagElements;
     int _elementsInUse;
     int _sizeOfElementsArray;
+
+    const ViewFrustum* _priorityView;
+    QMultiMap<float, OctreeElement*> _prioritizedElements;
+    QHash<OctreeElement*, float> _elementPriorities;
     //int _hookID;
 };
 
@@ -0,0 +1,199 @@
+//
+//  OctreeEncodeCache.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 High Fidelity, Inc. All rights reserved.
+//
+
+#include <climits>
+
+#include <glm/glm.hpp>
+
+#include <OctalCode.h>
+
+#include "Octree.h"
+#include "OctreeEncodeCache.h"
+
+// the cache is keyed by octal code rather than by element, so that the elements a subtree is part of can be found from
+// the octal code of an element in it - these are the first numberOfSections sections of the code, with the unused bits
+// of the last byte cleared
+static QByteArray octalCodeKey(const unsigned char* octalCode, int numberOfSections) {
+    int numberOfBytes = bytesRequiredForCodeLength(numberOfSections);
+    QByteArray key(numberOfBytes, 0);
+    key[0] = (char) numberOfSections;
+
+    for (int i = 1; i < numberOfBytes; i++) {
+        key[i] = octalCode[i];
+    }
+
+    int bitsInLastByte = (numberOfSections * 3) % 8;
+    if (bitsInLastByte > 0) {
+        key[numberOfBytes - 1] = key[numberOfBytes - 1] & (char) (0xFF << (8 - bitsInLastByte));
+    }
+    return key;
+}
+
+OctreeEncodeCache::OctreeEncodeCache(int maxBytes) :
+    _mutex(),
+    _subtrees(maxBytes),
+    _hits(0),
+    _misses(0),
+    _savedEncodeUsecs(0)
+{
+    OctreeElement::addUpdateHook(this);
+    OctreeElement::addDeleteHook(this);
+}
+
+OctreeEncodeCache::~OctreeEncodeCache() {
+    OctreeElement::removeUpdateHook(this);
+    OctreeElement::removeDeleteHook(this);
+}
+
+int OctreeEncodeCache::lodLevelForEncode(const OctreeElement* element, const EncodeBitstreamParams& params) const {
+    // occlusion depends on what else is in the packet, a depth limit on how deep the subtree starts, and skipping
+    // unchanged elements on when this client was last sent them
+    if (!params.viewFrustum || params.wantOcclusionCulling || params.maxEncodeLevel != INT_MAX
+            || (!params.forceSendScene && !params.deltaViewFrustum)) {
+        return NOT_ENCODE_CACHEABLE;
+    }
+
+    // nothing in the subtree can have been in the last view if we're sending the difference from it
+    if (params.deltaViewFrustum && params.lastViewFrustum
+            && element->inFrustum(*params.lastViewFrustum) != ViewFrustum::OUTSIDE) {
+        return NOT_ENCODE_CACHEABLE;
+    }
+
+    // and all of it has to be in this view
+    if (element->inFrustum(*params.viewFrustum) != ViewFrustum::INSIDE) {
+        return NOT_ENCODE_CACHEABLE;
+    }
+
+    // Every LOD decision in the subtree compares a distance from the camera to somewhere in the element's box against
+    // the boundary for the level being decided. If none of those boundaries falls between the nearest and furthest
+    // points of the box, then every decision comes down to whether its level is above the deepest level the client
+    // sees all of - which is then the only thing about the view the encoding depends on.
+    AABox box = element->getAABox();
+    box.scale(TREE_SCALE);
+    glm::vec3 nearestPoint = glm::clamp(params.viewFrustum->getPosition(), box.getCorner(), box.calcTopFarLeft());
+    float nearestDistance = glm::distance(params.viewFrustum->getPosition(), nearestPoint);
+    float furthestDistance = element->furthestDistanceToCamera(*params.viewFrustum);
+
+    // from inside the box some boundary always falls in between
+    if (nearestDistance <= 0.0f) {
+        return NOT_ENCODE_CACHEABLE;
+    }
+
+    // the boundaries halve with each level, so one soon falls below the nearest point
+    int lodLevel = element->getLevel() - 1;
+    for (int level = element->getLevel(); ; level++) {
+        float boundaryDistance = boundaryDistanceForRenderLevel(level + params.boundaryLevelAdjust,
+                                                                params.octreeElementSizeScale);
+        if (boundaryDistance > furthestDistance) {
+            lodLevel = level;
+        } else if (boundaryDistance < nearestDistance) {
+            return lodLevel;
+        } else {
+            return NOT_ENCODE_CACHEABLE;
+        }
+    }
+}
+
+bool OctreeEncodeCache::findSubtree(const OctreeElement* element, int lodLevel, const EncodeBitstreamParams& params,
+                                    OctreeEncodedSubtree& encodedSubtree) {
+    QByteArray key = octalCodeKey(element->getOctalCode(), numberOfThreeBitSectionsInCode(element->getOctalCode()));
+
+    QMutexLocker locker(&_mutex);
+    QVector<OctreeEncodedSubtree>* encodings = _subtrees.object(key);
+    if (encodings) {
+        for (int i = 0; i < encodings->size(); i++) {
+            const OctreeEncodedSubtree& encoding = encodings->at(i);
+            if (encoding.lodLevel == lodLevel && encoding.includeColor == params.includeColor
+                    && encoding.includeExistsBits == params.includeExistsBits
+                    && encoding.lastChanged == element->getLastChanged()) {
+                encodedSubtree = encoding;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void OctreeEncodeCache::storeSubtree(const OctreeElement* element, const OctreeEncodedSubtree& encodedSubtree) {
+    if (encodedSubtree.bytes.size() < MIN_ENCODE_CACHE_SUBTREE_BYTES) {
+        return;
+    }
+
+    QByteArray key = octalCodeKey(element->getOctalCode(), numberOfThreeBitSectionsInCode(element->getOctalCode()));
+
+    QMutexLocker locker(&_mutex);
+
+    // the cost of an element is all of its encodings, so they come out to be added to and go back in at the new cost
+    QVector<OctreeEncodedSubtree>* encodings = _subtrees.take(key);
+    if (!encodings) {
+        encodings = new QVector<OctreeEncodedSubtree>();
+    }
+
+    int cost = 0;
+    for (int i = encodings->size() - 1; i >= 0; i--) {
+        const OctreeEncodedSubtree& encoding = encodings->at(i);
+        if (encoding.lastChanged != encodedSubtree.lastChanged
+                || (encoding.lodLevel == encodedSubtree.lodLevel && encoding.includeColor == encodedSubtree.includeColor
+                    && encoding.includeExistsBits == encodedSubtree.includeExistsBits)) {
+            // stale, or the one this replaces
+            encodings->remove(i);
+        } else {
+            cost += encoding.bytes.size();
+        }
+    }
+
+    encodings->append(encodedSubtree);
+    cost += encodedSubtree.bytes.size();
+
+    // QCache deletes the encodings itself if they cost more than the whole cache
+    _subtrees.insert(key, encodings, cost);
+}
+
+void OctreeEncodeCache::recordHit(const OctreeEncodedSubtree& encodedSubtree) {
+    QMutexLocker locker(&_mutex);
+    _hits++;
+    _savedEncodeUsecs += encodedSubtree.encodeUsecs;
+}
+
+void OctreeEncodeCache::recordMiss() {
+    QMutexLocker locker(&_mutex);
+    _misses++;
+}
+
+void OctreeEncodeCache::elementUpdated(OctreeElement* element) {
+    invalidateSubtreesContaining(element);
+}
+
+void OctreeEncodeCache::elementDeleted(OctreeElement* element) {
+    invalidateSubtreesContaining(element);
+}
+
+void OctreeEncodeCache::invalidateSubtreesContaining(const OctreeElement* element) {
+    QMutexLocker locker(&_mutex);
+
+    // every element is marked as changed while the tree is loaded, before anything could have been cached
+    if (_subtrees.isEmpty()) {
+        return;
+    }
+
+    const unsigned char* octalCode = element->getOctalCode();
+    int numberOfSections = numberOfThreeBitSectionsInCode(octalCode);
+    for (int sections = numberOfSections; sections >= 0; sections--) {
+        _subtrees.remove(octalCodeKey(octalCode, sections));
+    }
+}
+
+int OctreeEncodeCache::getNumCachedElements() {
+    QMutexLocker locker(&_mutex);
+    return _subtrees.size();
+}
+
+int OctreeEncodeCache::getCachedBytes() {
+    QMutexLocker locker(&_mutex);
+    return _subtrees.totalCost();
+}
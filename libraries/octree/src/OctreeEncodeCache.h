@@ -0,0 +1,96 @@
+//
+//  OctreeEncodeCache.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 High Fidelity, Inc. All rights reserved.
+//
+//  Subtrees that encode to the same bytes for every client that sees them the same way - entirely in view, and with
+//  the same levels of them inside the client's LOD - are kept once for the whole server, so the next client that sees
+//  them that way gets those bytes copied into its packet instead of the subtree being encoded again.
+//
+
+#ifndef __hifi__OctreeEncodeCache__
+#define __hifi__OctreeEncodeCache__
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCache>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+
+#include "OctreeElement.h"
+
+class EncodeBitstreamParams;
+
+/// the most bytes of encoded subtrees the cache keeps before it lets the least recently used go
+const int DEFAULT_ENCODE_CACHE_BYTES = 16 * 1024 * 1024;
+
+/// subtrees smaller than this are cheaper to encode again than to keep
+const int MIN_ENCODE_CACHE_SUBTREE_BYTES = 32;
+
+/// the LOD level of a subtree that would not encode the same way for every client that sees it from that level
+const int NOT_ENCODE_CACHEABLE = -1;
+
+/// one encoding of a subtree, and what encoding it did to the encode params
+class OctreeEncodedSubtree {
+public:
+    int lodLevel;
+    bool includeColor;
+    bool includeExistsBits;
+    quint64 lastChanged;
+    QByteArray bytes;
+    int bytesWritten;
+    int levelsBelow;
+    quint64 encodeUsecs;
+
+    /// the colors in the bytes, counted again in the scene stats of every client they are copied to
+    unsigned long leavesColorSent;
+    unsigned long internalColorSent;
+
+    /// the elements whose content is in the bytes, for the sent state of the clients they are copied to
+    QVector<quint32> sentElementIDs;
+};
+
+class OctreeEncodeCache : public OctreeElementUpdateHook, public OctreeElementDeleteHook {
+public:
+    OctreeEncodeCache(int maxBytes = DEFAULT_ENCODE_CACHE_BYTES);
+    ~OctreeEncodeCache();
+
+    /// the deepest level of the element's subtree the client sees all of, or NOT_ENCODE_CACHEABLE if how the subtree
+    /// encodes depends on more than that
+    int lodLevelForEncode(const OctreeElement* element, const EncodeBitstreamParams& params) const;
+
+    /// a cached encoding of the element's subtree for this LOD level and these params, if there is a current one
+    bool findSubtree(const OctreeElement* element, int lodLevel, const EncodeBitstreamParams& params,
+                     OctreeEncodedSubtree& encodedSubtree);
+
+    void storeSubtree(const OctreeElement* element, const OctreeEncodedSubtree& encodedSubtree);
+
+    /// a subtree that was copied into a packet instead of being encoded
+    void recordHit(const OctreeEncodedSubtree& encodedSubtree);
+
+    /// a subtree that had to be encoded - not cached, or too big for what was left of the packet
+    void recordMiss();
+
+    /// drops the encodings of an element that changed or went away, and of every element it is part of the subtree of
+    virtual void elementUpdated(OctreeElement* element);
+    virtual void elementDeleted(OctreeElement* element);
+
+    quint64 getHits() const { return _hits; }
+    quint64 getMisses() const { return _misses; }
+    quint64 getSavedEncodeUsecs() const { return _savedEncodeUsecs; }
+    int getNumCachedElements();
+    int getCachedBytes();
+
+private:
+    void invalidateSubtreesContaining(const OctreeElement* element);
+
+    QMutex _mutex;
+    QCache<QByteArray, QVector<OctreeEncodedSubtree> > _subtrees;
+
+    quint64 _hits;
+    quint64 _misses;
+    quint64 _savedEncodeUsecs;
+};
+
+#endif /* defined(__hifi__OctreeEncodeCache__) */
@@ -6,6 +6,12 @@
 //  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
+
+#include <zlib.h>
+
+#include <QtCore/QDebug>
+
 #include <PerfStat.h>
 #include "OctreePacketData.h"
 
@@ -19,7 +25,19 @@ quint64 OctreePacketData::_totalBytesOfRawData = 0;
 
 
 
-OctreePacketData::OctreePacketData(bool enableCompression, int targetSize) {
+// Packets are smaller than the smallest window zlib has, so a bigger one would only be more to set up. Streams made
+// with it are read the same as any other.
+const int DEFLATE_WINDOW_BITS = 11;
+const int DEFLATE_MEMORY_LEVEL = 8;
+
+// qCompress() puts the uncompressed size in front of the stream, and qUncompress() expects it there
+const int COMPRESSED_SIZE_HEADER_BYTES = 4;
+
+OctreePacketData::OctreePacketData(bool enableCompression, int targetSize) :
+    _codec(DEFAULT_OCTREE_PACKET_CODEC),
+    _deflateStream(NULL),
+    _deflateStreamLevel(Z_DEFAULT_COMPRESSION)
+{
     changeSettings(enableCompression, targetSize); // does reset...
 }
 
@@ -36,6 +54,8 @@ void OctreePacketData::reset() {
     _compressedBytes = 0;
     _bytesInUseLastCheck = 0;
     _dirty = false;
+    _compressedUpTo = -1;
+    _dirtyFrom = 0;
 
     _bytesOfOctalCodes = 0;
     _bytesOfBitMasks = 0;
@@ -44,12 +64,17 @@ void OctreePacketData::reset() {
 }
 
 OctreePacketData::~OctreePacketData() {
+    if (_deflateStream) {
+        deflateEnd(_deflateStream);
+        delete _deflateStream;
+    }
 }
 
 bool OctreePacketData::append(const unsigned char* data, int length) {
     bool success = false;
 
     if (length <= _bytesAvailable) {
+        _dirtyFrom = std::min(_dirtyFrom, _bytesInUse);
         memcpy(&_uncompressed[_bytesInUse], data, length);
         _bytesInUse += length;
         _bytesAvailable -= length;
@@ -62,6 +87,7 @@ bool OctreePacketData::append(const unsigned char* data, int length) {
 bool OctreePacketData::append(unsigned char byte) {
     bool success = false;
     if (_bytesAvailable > 0) {
+        _dirtyFrom = std::min(_dirtyFrom, _bytesInUse);
         _uncompressed[_bytesInUse] = byte;
         _bytesInUse++;
         _bytesAvailable--; 
@@ -74,6 +100,7 @@ bool OctreePacketData::append(unsigned char byte) {
 bool OctreePacketData::updatePriorBitMask(int offset, unsigned char bitmask) {
     bool success = false;
     if (offset >= 0 && offset < _bytesInUse) {
+        _dirtyFrom = std::min(_dirtyFrom, offset);
         _uncompressed[offset] = bitmask;
         success = true;
         _dirty = true;
@@ -84,6 +111,7 @@ bool OctreePacketData::updatePriorBitMask(int offset, unsigned char bitmask) {
 bool OctreePacketData::updatePriorBytes(int offset, const unsigned char* replacementBytes, int length) {
     bool success = false;
     if (length >= 0 && offset >= 0 && ((offset + length) <= _bytesInUse)) {
+        _dirtyFrom = std::min(_dirtyFrom, offset);
         memcpy(&_uncompressed[offset], replacementBytes, length); // copy new content
         success = true;
         _dirty = true;
@@ -349,33 +377,95 @@ bool OctreePacketData::appendRawData(const unsigned char* data, int length) {
 
 quint64 OctreePacketData::_compressContentTime = 0;
 quint64 OctreePacketData::_compressContentCalls = 0;
+quint64 OctreePacketData::_compressContentSkips = 0;
+
+const char* OctreePacketData::getCodecName(OctreePacketCodec codec) {
+    switch (codec) {
+        case OCTREE_CODEC_ZLIB_BEST:
+            return "zlibBest";
+        case OCTREE_CODEC_ZLIB_FAST:
+            return "zlibFast";
+        default:
+            return "unknown";
+    }
+}
+
+bool OctreePacketData::codecForName(const QString& name, OctreePacketCodec& codec) {
+    for (int i = 0; i < OCTREE_CODEC_COUNT; i++) {
+        if (name == getCodecName((OctreePacketCodec)i)) {
+            codec = (OctreePacketCodec)i;
+            return true;
+        }
+    }
+    return false;
+}
 
 bool OctreePacketData::compressContent() { 
-    PerformanceWarning warn(false, "OctreePacketData::compressContent()", false, &_compressContentTime, &_compressContentCalls);
-    
     // without compression, we always pass...
     if (!_enableCompression) {
         return true;
     }
 
+    // Content that has only been written past and rewound since it was last compressed is still what was compressed, so
+    // the finalized size can be checked as often as the packer likes without compressing the same bytes again.
+    if (_compressedUpTo == _bytesInUse && _dirtyFrom >= _bytesInUse) {
+        _compressContentSkips++;
+        _dirty = false;
+        return true;
+    }
+
+    PerformanceWarning warn(false, "OctreePacketData::compressContent()", false, &_compressContentTime, &_compressContentCalls);
+
     _bytesInUseLastCheck = _bytesInUse;
 
-    bool success = false;
     const int MAX_COMPRESSION = 9;
+    const int FAST_COMPRESSION = 1;
+    int level = (_codec == OCTREE_CODEC_ZLIB_FAST) ? FAST_COMPRESSION : MAX_COMPRESSION;
+
+    // reuse the stream we have unless the codec changed
+    if (_deflateStream && _deflateStreamLevel != level) {
+        deflateEnd(_deflateStream);
+        delete _deflateStream;
+        _deflateStream = NULL;
+    }
+    if (_deflateStream) {
+        deflateReset(_deflateStream);
+    } else {
+        _deflateStream = new z_stream;
+        memset(_deflateStream, 0, sizeof(z_stream));
+        if (deflateInit2(_deflateStream, level, Z_DEFLATED, DEFLATE_WINDOW_BITS, DEFLATE_MEMORY_LEVEL,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            qDebug() << "OctreePacketData::compressContent() couldn't set up zlib" << _deflateStream->msg;
+            delete _deflateStream;
+            _deflateStream = NULL;
+            _compressedUpTo = -1;
+            return false;
+        }
+        _deflateStreamLevel = level;
+    }
 
-    // we only want to compress the data payload, not the message header
-    const uchar* uncompressedData = &_uncompressed[0];
-    int uncompressedSize = _bytesInUse;
+    // the same layout qCompress() writes: the uncompressed size, big endian, then the stream
+    unsigned char compressedData[MAX_OCTREE_PACKET_DATA_SIZE];
+    compressedData[0] = (_bytesInUse >> 24) & 0xFF;
+    compressedData[1] = (_bytesInUse >> 16) & 0xFF;
+    compressedData[2] = (_bytesInUse >> 8) & 0xFF;
+    compressedData[3] = _bytesInUse & 0xFF;
 
-    QByteArray compressedData = qCompress(uncompressedData, uncompressedSize, MAX_COMPRESSION);
+    _deflateStream->next_in = &_uncompressed[0];
+    _deflateStream->avail_in = _bytesInUse;
+    _deflateStream->next_out = &compressedData[COMPRESSED_SIZE_HEADER_BYTES];
+    // leave out the last byte, so compressed content is always smaller than MAX_OCTREE_PACKET_DATA_SIZE
+    _deflateStream->avail_out = MAX_OCTREE_PACKET_DATA_SIZE - COMPRESSED_SIZE_HEADER_BYTES - 1;
 
-    if (compressedData.size() < MAX_OCTREE_PACKET_DATA_SIZE) {
-        _compressedBytes = compressedData.size();
-        for (int i = 0; i < _compressedBytes; i++) {
-            _compressed[i] = compressedData[i];
-        }
+    bool success = (deflate(_deflateStream, Z_FINISH) == Z_STREAM_END);
+    if (success) {
+        _compressedBytes = COMPRESSED_SIZE_HEADER_BYTES + _deflateStream->total_out;
+        memcpy(_compressed, compressedData, _compressedBytes);
+        _compressedUpTo = _bytesInUse;
+        _dirtyFrom = _bytesInUse;
         _dirty = false;
-        success = true;
+    } else {
+        _compressedUpTo = -1;
     }
     return success;
 }
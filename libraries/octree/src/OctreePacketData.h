@@ -19,14 +19,21 @@
 #ifndef __hifi__OctreePacketData__
 #define __hifi__OctreePacketData__
 
+#include <QtCore/QString>
+
 #include <SharedUtil.h>
 #include "OctreeConstants.h"
 #include "OctreeElement.h"
 
+struct z_stream_s;
+
 typedef unsigned char OCTREE_PACKET_FLAGS;
 typedef uint16_t OCTREE_PACKET_SEQUENCE;
 typedef quint64 OCTREE_PACKET_SENT_TIME;
 typedef uint16_t OCTREE_PACKET_INTERNAL_SECTION_SIZE;
+
+/// how many octree packets before the newest a client's ack says it has or hasn't received
+const int OCTREE_ACK_WINDOW = 64;
 const int MAX_OCTREE_PACKET_SIZE = MAX_PACKET_SIZE;
 
 // this is overly conservative - sizeof(PacketType) is 8 bytes but a packed PacketType could be as small as one byte
@@ -166,6 +173,15 @@ public:
     
     /// returns whether or not zlib compression enabled on finalization
     bool isCompressed() const { return _enableCompression; }
+
+    /// change the codec content is compressed with, takes effect from the next finalization
+    void setCodec(OctreePacketCodec codec) { _codec = codec; }
+    OctreePacketCodec getCodec() const { return _codec; }
+
+    static const char* getCodecName(OctreePacketCodec codec);
+
+    /// looks up a codec by the name getCodecName() gives it, returns false if there isn't one by that name
+    static bool codecForName(const QString& name, OctreePacketCodec& codec);
     
     /// returns the target uncompressed size
     int getTargetSize() const { return _targetSize; }
@@ -175,6 +191,7 @@ public:
     
     static quint64 getCompressContentTime() { return _compressContentTime; } /// total time spent compressing content
     static quint64 getCompressContentCalls() { return _compressContentCalls; } /// total calls to compress content
+    static quint64 getCompressContentSkips() { return _compressContentSkips; } /// total times content was already compressed
     static quint64 getTotalBytesOfOctalCodes() { return _totalBytesOfOctalCodes; }  /// total bytes for octal codes
     static quint64 getTotalBytesOfBitMasks() { return _totalBytesOfBitMasks; }  /// total bytes of bitmasks
     static quint64 getTotalBytesOfColor() { return _totalBytesOfColor; } /// total bytes of color
@@ -201,6 +218,12 @@ private:
     int _bytesInUseLastCheck;
     bool _dirty;
 
+    OctreePacketCodec _codec;
+    z_stream_s* _deflateStream; // kept from packet to packet, since setting one up costs more than compressing a packet
+    int _deflateStreamLevel;
+    int _compressedUpTo; // the uncompressed bytes in use when _compressed was made from them, or -1 if it wasn't
+    int _dirtyFrom; // the lowest offset written to since then
+
     // statistics...
     int _bytesOfOctalCodes;
     int _bytesOfBitMasks;
@@ -215,6 +238,7 @@ private:
 
     static quint64 _compressContentTime;
     static quint64 _compressContentCalls;
+    static quint64 _compressContentSkips;
 
     static quint64 _totalBytesOfOctalCodes;
     static quint64 _totalBytesOfBitMasks;
@@ -36,7 +36,12 @@ OctreeQuery::OctreeQuery() :
     _wantOcclusionCulling(false), // disabled by default
     _wantCompression(false), // disabled by default
     _maxOctreePPS(DEFAULT_MAX_OCTREE_PPS),
-    _octreeElementSizeScale(DEFAULT_OCTREE_SIZE_SCALE)
+    _octreeElementSizeScale(DEFAULT_OCTREE_SIZE_SCALE),
+    _compressionCodec(DEFAULT_OCTREE_PACKET_CODEC),
+    _hasOctreeAck(false),
+    _ackedSequence(0),
+    _ackedReceivedBits(0),
+    _octreeKillCount(0)
 {
     
 }
@@ -70,6 +75,7 @@ int OctreeQuery::getBroadcastData(unsigned char* destinationBuffer) {
     if (_wantDelta)            { setAtBit(bitItems, WANT_DELTA_AT_BIT); }
     if (_wantOcclusionCulling) { setAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT); }
     if (_wantCompression)      { setAtBit(bitItems, WANT_COMPRESSION); }
+    if (_hasOctreeAck)         { setAtBit(bitItems, HAS_OCTREE_ACK_BIT); }
 
     *destinationBuffer++ = bitItems;
 
@@ -84,7 +90,19 @@ int OctreeQuery::getBroadcastData(unsigned char* destinationBuffer) {
     // desired boundaryLevelAdjust
     memcpy(destinationBuffer, &_boundaryLevelAdjust, sizeof(_boundaryLevelAdjust));
     destinationBuffer += sizeof(_boundaryLevelAdjust);
-    
+
+    // desired compression codec
+    *destinationBuffer++ = (unsigned char)_compressionCodec;
+
+    // the octree packets we've received
+    memcpy(destinationBuffer, &_ackedSequence, sizeof(_ackedSequence));
+    destinationBuffer += sizeof(_ackedSequence);
+    memcpy(destinationBuffer, &_ackedReceivedBits, sizeof(_ackedReceivedBits));
+    destinationBuffer += sizeof(_ackedReceivedBits);
+
+    // how many times we've thrown away what we were sent
+    *destinationBuffer++ = _octreeKillCount;
+
     return destinationBuffer - bufferStart;
 }
 
@@ -116,6 +134,7 @@ int OctreeQuery::parseData(const QByteArray& packet) {
     _wantDelta = oneAtBit(bitItems, WANT_DELTA_AT_BIT);
     _wantOcclusionCulling = oneAtBit(bitItems, WANT_OCCLUSION_CULLING_BIT);
     _wantCompression = oneAtBit(bitItems, WANT_COMPRESSION);
+    _hasOctreeAck = oneAtBit(bitItems, HAS_OCTREE_ACK_BIT);
 
     // desired Max Octree PPS
     memcpy(&_maxOctreePPS, sourceBuffer, sizeof(_maxOctreePPS));
@@ -129,9 +148,35 @@ int OctreeQuery::parseData(const QByteArray& packet) {
     memcpy(&_boundaryLevelAdjust, sourceBuffer, sizeof(_boundaryLevelAdjust));
     sourceBuffer += sizeof(_boundaryLevelAdjust);
 
+    // desired compression codec, or the default if it's one we don't know
+    unsigned char compressionCodec = (unsigned char)*sourceBuffer++;
+    _compressionCodec = compressionCodec < OCTREE_CODEC_COUNT
+        ? (OctreePacketCodec)compressionCodec : DEFAULT_OCTREE_PACKET_CODEC;
+
+    // the octree packets the client has received
+    memcpy(&_ackedSequence, sourceBuffer, sizeof(_ackedSequence));
+    sourceBuffer += sizeof(_ackedSequence);
+    memcpy(&_ackedReceivedBits, sourceBuffer, sizeof(_ackedReceivedBits));
+    sourceBuffer += sizeof(_ackedReceivedBits);
+
+    // how many times the client has thrown away what it was sent
+    _octreeKillCount = *sourceBuffer++;
+
     return sourceBuffer - startPosition;
 }
 
+bool OctreeQuery::getOctreeAck(OCTREE_PACKET_SEQUENCE& newestSequence, quint64& receivedBits) const {
+    newestSequence = _ackedSequence;
+    receivedBits = _ackedReceivedBits;
+    return _hasOctreeAck;
+}
+
+void OctreeQuery::setOctreeAck(bool hasOctreeAck, OCTREE_PACKET_SEQUENCE newestSequence, quint64 receivedBits) {
+    _hasOctreeAck = hasOctreeAck;
+    _ackedSequence = hasOctreeAck ? newestSequence : 0;
+    _ackedReceivedBits = hasOctreeAck ? receivedBits : 0;
+}
+
 glm::vec3 OctreeQuery::calculateCameraDirection() const {
     glm::vec3 direction = glm::vec3(_cameraOrientation * glm::vec4(IDENTITY_FRONT, 0.0f));
     return direction;
@@ -40,12 +40,16 @@ typedef unsigned long long quint64;
 
 #include <NodeData.h>
 
+#include "OctreeConstants.h"
+#include "OctreePacketData.h"
+
 // First bitset
 const int WANT_LOW_RES_MOVING_BIT = 0;
 const int WANT_COLOR_AT_BIT = 1;
 const int WANT_DELTA_AT_BIT = 2;
 const int WANT_OCCLUSION_CULLING_BIT = 3;
 const int WANT_COMPRESSION = 4; // 5th bit
+const int HAS_OCTREE_ACK_BIT = 5;
 
 class OctreeQuery : public NodeData {
     Q_OBJECT
@@ -87,6 +91,19 @@ public:
     float getOctreeSizeScale() const { return _octreeElementSizeScale; }
     int getBoundaryLevelAdjust() const { return _boundaryLevelAdjust; }
 
+    /// the codec the client would like compressed packets compressed with
+    OctreePacketCodec getCompressionCodec() const { return _compressionCodec; }
+    void setCompressionCodec(OctreePacketCodec compressionCodec) { _compressionCodec = compressionCodec; }
+
+    /// the newest octree packet the client has received from the server, and which of the ones before it - see
+    /// OctreeSceneStats::getIncomingAck() - false if it hasn't received any yet
+    bool getOctreeAck(OCTREE_PACKET_SEQUENCE& newestSequence, quint64& receivedBits) const;
+    void setOctreeAck(bool hasOctreeAck, OCTREE_PACKET_SEQUENCE newestSequence, quint64 receivedBits);
+
+    /// goes up each time the client throws away the octree it has been sent, so the server knows to send it all again
+    quint8 getOctreeKillCount() const { return _octreeKillCount; }
+    void incrementOctreeKillCount() { _octreeKillCount++; }
+
 public slots:
     void setWantLowResMoving(bool wantLowResMoving) { _wantLowResMoving = wantLowResMoving; }
     void setWantColor(bool wantColor) { _wantColor = wantColor; }
@@ -116,6 +133,13 @@ protected:
     int _maxOctreePPS;
     float _octreeElementSizeScale; /// used for LOD calculations
     int _boundaryLevelAdjust; /// used for LOD calculations
+    OctreePacketCodec _compressionCodec;
+
+    // what the client has received, and what it has thrown away
+    bool _hasOctreeAck;
+    OCTREE_PACKET_SEQUENCE _ackedSequence;
+    quint64 _ackedReceivedBits;
+    quint8 _octreeKillCount;
 
 private:
     // privatize the copy constructor and assignment operator so they cannot be called
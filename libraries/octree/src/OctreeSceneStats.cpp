@@ -19,6 +19,9 @@
 
 
 const int samples = 100;
+
+// the share of a scene's colors that have to go out before the time to most colors sent is taken
+const float MOST_COLORS_SENT = 0.9f;
 OctreeSceneStats::OctreeSceneStats() : 
     _elapsedAverage(samples), 
     _bitsPerOctreeAverage(samples),
@@ -36,7 +39,9 @@ OctreeSceneStats::OctreeSceneStats() :
     _incomingLastSequence = 0;
     _incomingOutOfOrder = 0;
     _incomingLikelyLost = 0;
-    
+    _hasIncomingAck = false;
+    _incomingNewestSequence = 0;
+    _incomingReceivedBits = 0;
 }
 
 // copy constructor
@@ -61,6 +66,7 @@ void OctreeSceneStats::copyFromOther(const OctreeSceneStats& other) {
     _packets = other._packets;
     _bytes = other._bytes;
     _passes = other._passes;
+    _timeToMostColorsSent = other._timeToMostColorsSent;
 
     _totalElements = other._totalElements;
     _totalInternal = other._totalInternal;
@@ -137,6 +143,9 @@ void OctreeSceneStats::copyFromOther(const OctreeSceneStats& other) {
     _incomingLastSequence = other._incomingLastSequence;
     _incomingOutOfOrder = other._incomingOutOfOrder;
     _incomingLikelyLost = other._incomingLikelyLost;
+    _hasIncomingAck = other._hasIncomingAck;
+    _incomingNewestSequence = other._incomingNewestSequence;
+    _incomingReceivedBits = other._incomingReceivedBits;
 }
 
 
@@ -195,6 +204,16 @@ void OctreeSceneStats::sceneCompleted() {
         _end = usecTimestampNow();
         _elapsed = _end - _start;
         _elapsedAverage.updateAverage((float)_elapsed);
+
+        // the first packet that brought the colors sent up to most of the scene's
+        _timeToMostColorsSent = _elapsed;
+        unsigned long mostColorsSent = (unsigned long)(_colorSent * MOST_COLORS_SENT);
+        for (size_t i = 0; i < _colorsSentByPacket.size(); i++) {
+            if (_colorsSentByPacket[i].second >= mostColorsSent) {
+                _timeToMostColorsSent = _colorsSentByPacket[i].first;
+                break;
+            }
+        }
         
         if (_isFullScene) {
             _lastFullElapsed = _elapsed;
@@ -222,6 +241,8 @@ void OctreeSceneStats::reset() {
     _packets = 0;
     _bytes = 0;
     _passes = 0;
+    _colorsSentByPacket.clear();
+    _timeToMostColorsSent = 0;
 
     _totalElements = 0;
     _totalInternal = 0;
@@ -279,6 +300,9 @@ void OctreeSceneStats::reset() {
 void OctreeSceneStats::packetSent(int bytes) {
     _packets++;
     _bytes += bytes;
+    if (_isStarted) {
+        _colorsSentByPacket.push_back(std::make_pair(usecTimestampNow() - _start, _colorSent));
+    }
 }
 
 void OctreeSceneStats::traversed(const OctreeElement* element) {
@@ -344,6 +368,12 @@ void OctreeSceneStats::colorSent(const OctreeElement* element) {
     }
 }
 
+void OctreeSceneStats::colorsSent(unsigned long leaves, unsigned long internal) {
+    _colorSent += leaves + internal;
+    _leavesColorSent += leaves;
+    _internalColorSent += internal;
+}
+
 void OctreeSceneStats::didntFit(const OctreeElement* element) {
     _didntFit++;
     if (element->isLeaf()) {
@@ -443,6 +473,8 @@ int OctreeSceneStats::packIntoMessage(unsigned char* destinationBuffer, int avai
     destinationBuffer += sizeof(_existsInPacketBitsWritten);
     memcpy(destinationBuffer, &_treesRemoved, sizeof(_treesRemoved));
     destinationBuffer += sizeof(_treesRemoved);
+    memcpy(destinationBuffer, &_timeToMostColorsSent, sizeof(_timeToMostColorsSent));
+    destinationBuffer += sizeof(_timeToMostColorsSent);
 
     // add the root jurisdiction
     if (_jurisdictionRoot) {
@@ -569,6 +601,8 @@ int OctreeSceneStats::unpackFromMessage(const unsigned char* sourceBuffer, int a
     sourceBuffer += sizeof(_existsInPacketBitsWritten);
     memcpy(&_treesRemoved, sourceBuffer, sizeof(_treesRemoved));
     sourceBuffer += sizeof(_treesRemoved);
+    memcpy(&_timeToMostColorsSent, sourceBuffer, sizeof(_timeToMostColorsSent));
+    sourceBuffer += sizeof(_timeToMostColorsSent);
 
     // before allocating new juridiction, clean up existing ones
     if (_jurisdictionRoot) {
@@ -688,6 +722,7 @@ OctreeSceneStats::ItemInfo OctreeSceneStats::_ITEMS[] = {
     { "Skipped - Occluded"   , YELLOWISH , 3 , "Total,Internal,Leaves" },
     { "Didn't fit in packet" , GREYISH   , 4 , "Total,Internal,Leaves,Removed" },
     { "Mode"                 , GREENISH  , 4 , "Moving,Stationary,Partial,Full" },
+    { "Time to 90% Colors"   , YELLOWISH , 1 , "Time" },
 };
 
 const char* OctreeSceneStats::getItemValue(Item item) {
@@ -785,6 +820,11 @@ const char* OctreeSceneStats::getItemValue(Item item) {
                     _colorBitsWritten, _existsBitsWritten, _existsInPacketBitsWritten);
             break;
         }
+        case ITEM_TIME_TO_MOST_COLORS: {
+            sprintf(_itemValueBuffer, "%llu usecs (%.0f%% of elapsed)", (long long unsigned int)_timeToMostColorsSent,
+                    _elapsed == 0 ? 0.0f : (100.0f * _timeToMostColorsSent) / _elapsed);
+            break;
+        }
         case ITEM_MODE: {
             sprintf(_itemValueBuffer, "%s - %s", (_isFullScene ? "Full Scene" : "Partial Scene"), 
                     (_isMoving ? "Moving" : "Stationary"));
@@ -838,5 +878,29 @@ void OctreeSceneStats::trackIncomingOctreePacket(const QByteArray& packet,
     }
 
     _incomingLastSequence = sequence;
+
+    // remember what we've received for the acks we send the server with our queries
+    if (!_hasIncomingAck) {
+        _hasIncomingAck = true;
+        _incomingNewestSequence = sequence;
+        _incomingReceivedBits = 0;
+    } else {
+        int ahead = (qint16)(OCTREE_PACKET_SEQUENCE)(sequence - _incomingNewestSequence);
+        if (ahead > 0) {
+            _incomingReceivedBits = (ahead < OCTREE_ACK_WINDOW) ? (_incomingReceivedBits << ahead) : 0;
+            if (ahead <= OCTREE_ACK_WINDOW) {
+                _incomingReceivedBits |= (quint64)1 << (ahead - 1);
+            }
+            _incomingNewestSequence = sequence;
+        } else if (ahead < 0 && -ahead <= OCTREE_ACK_WINDOW) {
+            _incomingReceivedBits |= (quint64)1 << (-ahead - 1);
+        }
+    }
+}
+
+bool OctreeSceneStats::getIncomingAck(OCTREE_PACKET_SEQUENCE& newestSequence, quint64& receivedBits) const {
+    newestSequence = _incomingNewestSequence;
+    receivedBits = _incomingReceivedBits;
+    return _hasIncomingAck;
 }
 
@@ -11,9 +11,12 @@
 #define __hifi__OctreeSceneStats__
 
 #include <stdint.h>
+#include <utility>
+#include <vector>
 #include <NodeList.h>
 #include <SharedUtil.h>
 #include "JurisdictionMap.h"
+#include "OctreePacketData.h"
 
 #define GREENISH  0x40ff40d0
 #define YELLOWISH 0xffef40c0
@@ -70,6 +73,9 @@ public:
     /// Track that a element's color was was sent as part of computation of a scene
     void colorSent(const OctreeElement* element);
 
+    /// Track the colors of a cached subtree that was copied into a packet instead of being encoded
+    void colorsSent(unsigned long leaves, unsigned long internal);
+
     /// Track that a element was due to be sent, but didn't fit in the packet and was moved to next packet
     void didntFit(const OctreeElement* element);
 
@@ -118,6 +124,7 @@ public:
         ITEM_SKIPPED_OCCLUDED,
         ITEM_DIDNT_FIT,
         ITEM_MODE,
+        ITEM_TIME_TO_MOST_COLORS,
         ITEM_COUNT
     };
 
@@ -149,6 +156,12 @@ public:
     unsigned long getTotalLeaves() const { return _totalLeaves; }
     unsigned long getTotalEncodeTime() const { return _totalEncodeTime; }
     unsigned long getElapsedTime() const { return _elapsed; }
+    unsigned long getLeavesColorSent() const { return _leavesColorSent; }
+    unsigned long getInternalColorSent() const { return _internalColorSent; }
+
+    /// How long after the scene started the packet went out that brought the colors sent up to 90% of the scene's.
+    /// Elements skipped as unchanged or occluded send no color, so this is not the time until 90% is visible
+    quint64 getTimeToMostColorsSent() const { return _timeToMostColorsSent; }
 
     unsigned long getLastFullTotalEncodeTime() const { return _lastFullTotalEncodeTime; }
     unsigned long getLastFullElapsedTime() const { return _lastFullElapsed; }
@@ -163,6 +176,10 @@ public:
     unsigned int getIncomingLikelyLost() const { return _incomingLikelyLost; }
     float getIncomingFlightTimeAverage() { return _incomingFlightTimeAverage.getAverage(); }
 
+    /// the newest octree packet sequence received, and a bit for each of the OCTREE_ACK_WINDOW before it that says whether
+    /// it was received too - the first bit is the one just before the newest - false if no packets have been received
+    bool getIncomingAck(OCTREE_PACKET_SEQUENCE& newestSequence, quint64& receivedBits) const;
+
 private:
 
     void copyFromOther(const OctreeSceneStats& other);
@@ -246,6 +263,10 @@ private:
     unsigned int  _packets;
     unsigned long _bytes;
     unsigned int  _passes;
+
+    // usecs into the scene and colors sent so far, as of each packet sent
+    std::vector<std::pair<quint64, unsigned long> > _colorsSentByPacket;
+    quint64 _timeToMostColorsSent;
     
     // incoming packets stats
     unsigned int _incomingPacket;
@@ -255,6 +276,9 @@ private:
     unsigned int _incomingOutOfOrder;
     unsigned int _incomingLikelyLost;
     SimpleMovingAverage _incomingFlightTimeAverage;
+    bool _hasIncomingAck;
+    OCTREE_PACKET_SEQUENCE _incomingNewestSequence;
+    quint64 _incomingReceivedBits;
     
     // features related items
     bool _isMoving;
@@ -0,0 +1,187 @@
+//
+//  OctreeSentState.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 High Fidelity, Inc. All rights reserved.
+//
+
+#include "OctreeSentState.h"
+
+// the bits grow in steps, so a tree that is still growing doesn't resize them with every new element
+const int SENT_STATE_GROW_BITS = 64 * 1024;
+
+OctreeSentState::OctreeSentState() :
+    _mutex(),
+    _held(),
+    _pending(),
+    _unackedPackets(),
+    _unackedElements(),
+    _tracker(NULL)
+{
+}
+
+OctreeSentState::~OctreeSentState() {
+    if (_tracker) {
+        _tracker->removeSentState(this);
+    }
+}
+
+bool OctreeSentState::isHeld(const OctreeElement* element) const {
+    quint32 elementID = element->getElementID();
+    return ((int) elementID < _held.size() && _held.testBit(elementID)) || _unackedElements.contains(elementID);
+}
+
+void OctreeSentState::markPending(const OctreeElement* element) {
+    _pending.append(element->getElementID());
+}
+
+void OctreeSentState::markPending(const QVector<quint32>& elementIDs) {
+    _pending += elementIDs;
+}
+
+void OctreeSentState::discardPendingAfter(int pendingCount) {
+    QMutexLocker locker(&_mutex);
+    if (pendingCount < _pending.size()) {
+        _pending.resize(pendingCount);
+    }
+}
+
+void OctreeSentState::commitPending(OCTREE_PACKET_SEQUENCE sequence) {
+    QMutexLocker locker(&_mutex);
+    if (_pending.isEmpty()) {
+        return;
+    }
+
+    // a packet can be added to after it's been committed once, and goes out with the same sequence number
+    if (_unackedPackets.isEmpty() || _unackedPackets.last().sequence != sequence) {
+        UnackedPacket packet;
+        packet.sequence = sequence;
+        _unackedPackets.append(packet);
+    }
+    _unackedPackets.last().elementIDs += _pending;
+
+    foreach (quint32 elementID, _pending) {
+        _unackedElements.insert(elementID, sequence);
+    }
+    _pending.clear();
+
+    while (_unackedPackets.size() > SENT_STATE_MAX_UNACKED_PACKETS) {
+        packetLost(_unackedPackets.takeFirst());
+    }
+}
+
+void OctreeSentState::acknowledge(OCTREE_PACKET_SEQUENCE newestSequence, quint64 receivedBits) {
+    QMutexLocker locker(&_mutex);
+
+    QList<UnackedPacket>::iterator packet = _unackedPackets.begin();
+    while (packet != _unackedPackets.end()) {
+        // how many packets older than the newest this one is - negative if the client hasn't got that far yet
+        int behind = (qint16)(OCTREE_PACKET_SEQUENCE)(newestSequence - packet->sequence);
+
+        if (behind == 0 || (behind > 0 && behind <= OCTREE_ACK_WINDOW && (receivedBits & ((quint64)1 << (behind - 1))))) {
+            packetAcked(*packet);
+        } else if (behind > SENT_STATE_REORDER_PACKETS) {
+            packetLost(*packet);
+        } else {
+            ++packet;
+            continue;
+        }
+        packet = _unackedPackets.erase(packet);
+    }
+}
+
+void OctreeSentState::packetAcked(const UnackedPacket& packet) {
+    foreach (quint32 elementID, packet.elementIDs) {
+        // the element may have changed since, and be on its way again in a later packet
+        QHash<quint32, OCTREE_PACKET_SEQUENCE>::iterator unacked = _unackedElements.find(elementID);
+        if (unacked != _unackedElements.end() && unacked.value() == packet.sequence) {
+            _unackedElements.erase(unacked);
+            if ((int) elementID >= _held.size()) {
+                _held.resize(elementID + SENT_STATE_GROW_BITS);
+            }
+            _held.setBit(elementID);
+        }
+    }
+}
+
+void OctreeSentState::packetLost(const UnackedPacket& packet) {
+    foreach (quint32 elementID, packet.elementIDs) {
+        QHash<quint32, OCTREE_PACKET_SEQUENCE>::iterator unacked = _unackedElements.find(elementID);
+        if (unacked != _unackedElements.end() && unacked.value() == packet.sequence) {
+            _unackedElements.erase(unacked);
+        }
+    }
+}
+
+void OctreeSentState::forget(const OctreeElement* element) {
+    quint32 elementID = element->getElementID();
+
+    QMutexLocker locker(&_mutex);
+    if ((int) elementID < _held.size()) {
+        _held.clearBit(elementID);
+    }
+    _unackedElements.remove(elementID);
+
+    // content written before the change, in a packet that hasn't gone yet, is already out of date
+    _pending.removeAll(elementID);
+}
+
+void OctreeSentState::reset() {
+    QMutexLocker locker(&_mutex);
+    _held.fill(false);
+    _unackedPackets.clear();
+    _unackedElements.clear();
+}
+
+int OctreeSentState::getNumHeld() {
+    QMutexLocker locker(&_mutex);
+    return _held.count(true);
+}
+
+int OctreeSentState::getNumUnacked() {
+    QMutexLocker locker(&_mutex);
+    return _unackedElements.size();
+}
+
+OctreeSentStateTracker::OctreeSentStateTracker() :
+    _mutex(),
+    _sentStates()
+{
+    OctreeElement::addUpdateHook(this);
+    OctreeElement::addDeleteHook(this);
+}
+
+OctreeSentStateTracker::~OctreeSentStateTracker() {
+    OctreeElement::removeUpdateHook(this);
+    OctreeElement::removeDeleteHook(this);
+
+    // any clients still around have nothing left to tell them what changed
+    QMutexLocker locker(&_mutex);
+    foreach (OctreeSentState* sentState, _sentStates) {
+        sentState->_tracker = NULL;
+    }
+}
+
+void OctreeSentStateTracker::addSentState(OctreeSentState* sentState) {
+    QMutexLocker locker(&_mutex);
+    _sentStates.insert(sentState);
+    sentState->_tracker = this;
+}
+
+void OctreeSentStateTracker::removeSentState(OctreeSentState* sentState) {
+    QMutexLocker locker(&_mutex);
+    _sentStates.remove(sentState);
+    sentState->_tracker = NULL;
+}
+
+void OctreeSentStateTracker::elementUpdated(OctreeElement* element) {
+    QMutexLocker locker(&_mutex);
+    foreach (OctreeSentState* sentState, _sentStates) {
+        sentState->forget(element);
+    }
+}
+
+void OctreeSentStateTracker::elementDeleted(OctreeElement* element) {
+    elementUpdated(element);
+}
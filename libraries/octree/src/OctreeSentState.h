@@ -0,0 +1,114 @@
+//
+//  OctreeSentState.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 High Fidelity, Inc. All rights reserved.
+//
+//  Which elements a client already has the current content of - a bit per element id, set once the client acks the
+//  packet with the content, and cleared by the element hooks when the element changes or goes away - so that encoding
+//  for the client can leave out whatever it already has, wherever it has been looking since. Content in a packet that
+//  hasn't been acked yet is left out too, unless the packet turns out to have been lost.
+//
+
+#ifndef __hifi__OctreeSentState__
+#define __hifi__OctreeSentState__
+
+#include <QtCore/QBitArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+#include <SharedUtil.h>
+
+#include "OctreeElement.h"
+#include "OctreePacketData.h"
+
+/// a packet the client hasn't acked is taken as lost once it has acked one this many packets newer
+const int SENT_STATE_REORDER_PACKETS = 3;
+
+/// the most packets waiting for an ack - past this the oldest is taken as lost, for a client that stopped acking
+const int SENT_STATE_MAX_UNACKED_PACKETS = 512;
+
+class OctreeSentStateTracker;
+
+/// what one client has been sent. Elements written to the packet being encoded are pending until that packet goes out,
+/// then unacked until the client acks it.
+class OctreeSentState {
+public:
+    OctreeSentState();
+    ~OctreeSentState();
+
+    /// Does the client have the current content of the element, or is it on the way? Only call this under the tree's read
+    /// lock, which keeps the element hooks from changing what the client holds while you look.
+    bool isHeld(const OctreeElement* element) const;
+
+    void markPending(const OctreeElement* element);
+    void markPending(const QVector<quint32>& elementIDs);
+    int getPendingCount() const { return _pending.size(); }
+    const QVector<quint32>& getPending() const { return _pending; }
+
+    /// drops what was marked after getPendingCount() returned pendingCount - that part of the packet was discarded
+    void discardPendingAfter(int pendingCount);
+
+    /// the packet with the pending elements in it was sent with this sequence number
+    void commitPending(OCTREE_PACKET_SEQUENCE sequence);
+
+    /// The client has received the newest sequence, and those before it that have their bit set in receivedBits - see
+    /// OctreeSceneStats::getIncomingAck(). What was in them is held, and what was in the packets it has clearly missed
+    /// is sent again.
+    void acknowledge(OCTREE_PACKET_SEQUENCE newestSequence, quint64 receivedBits);
+
+    /// the packet with the pending elements in it was thrown away
+    void discardPending() { discardPendingAfter(0); }
+
+    /// the element changed or went away, so whatever the client has of it is out of date
+    void forget(const OctreeElement* element);
+
+    /// forgets everything, so the client is sent it all again
+    void reset();
+
+    int getNumHeld();
+    int getNumUnacked();
+
+private:
+    friend class OctreeSentStateTracker;
+
+    /// the elements in a sent packet the client hasn't acked yet
+    class UnackedPacket {
+    public:
+        OCTREE_PACKET_SEQUENCE sequence;
+        QVector<quint32> elementIDs;
+    };
+
+    void packetAcked(const UnackedPacket& packet);
+    void packetLost(const UnackedPacket& packet);
+
+    QMutex _mutex;
+    QBitArray _held;
+    QVector<quint32> _pending;
+    QList<UnackedPacket> _unackedPackets; // oldest first
+    QHash<quint32, OCTREE_PACKET_SEQUENCE> _unackedElements; // the packet with the element's current content in it
+    OctreeSentStateTracker* _tracker;
+};
+
+/// tells every client's sent state on the server when an element changes or goes away
+class OctreeSentStateTracker : public OctreeElementUpdateHook, public OctreeElementDeleteHook {
+public:
+    OctreeSentStateTracker();
+    ~OctreeSentStateTracker();
+
+    void addSentState(OctreeSentState* sentState);
+    void removeSentState(OctreeSentState* sentState);
+
+    virtual void elementUpdated(OctreeElement* element);
+    virtual void elementDeleted(OctreeElement* element);
+
+private:
+    QMutex _mutex;
+    QSet<OctreeSentState*> _sentStates;
+};
+
+#endif /* defined(__hifi__OctreeSentState__) */
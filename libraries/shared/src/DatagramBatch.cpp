@@ -0,0 +1,265 @@
+//
+//  DatagramBatch.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <cstring>
+#include <errno.h>
+
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+
+#include "DatagramBatch.h"
+
+DatagramReceiveBatch::DatagramReceiveBatch() :
+    _numReceived(0),
+    _nextDatagram(0),
+    _numTruncated(0)
+{
+#ifdef HAS_DATAGRAM_BATCHES
+    memset(_headers, 0, sizeof(_headers));
+
+    for (int i = 0; i < MAX_DATAGRAMS_PER_BATCH; i++) {
+        _vectors[i].iov_base = _buffers[i];
+        _vectors[i].iov_len = MAX_PACKET_SIZE;
+
+        _headers[i].msg_hdr.msg_name = &_senderAddresses[i];
+        _headers[i].msg_hdr.msg_iov = &_vectors[i];
+        _headers[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+}
+
+bool DatagramReceiveBatch::isSupported() {
+#ifdef HAS_DATAGRAM_BATCHES
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool DatagramReceiveBatch::readDatagram(QUdpSocket& socket, QByteArray& destinationByteArray,
+                                        HifiSockAddr& senderSockAddr) {
+#ifdef HAS_DATAGRAM_BATCHES
+    forever {
+        if (_nextDatagram == _numReceived) {
+            _numReceived = 0;
+            _nextDatagram = 0;
+
+            for (int i = 0; i < MAX_DATAGRAMS_PER_BATCH; i++) {
+                // the kernel writes back the size of each sender address, so it is reset before every call
+                _headers[i].msg_hdr.msg_namelen = sizeof(_senderAddresses[i]);
+            }
+
+            int numReceived = recvmmsg(socket.socketDescriptor(), _headers, MAX_DATAGRAMS_PER_BATCH, MSG_DONTWAIT, NULL);
+
+            if (numReceived <= 0) {
+                // QUdpSocket turns its read notifier off before it emits readyRead and only turns it back on in
+                // readDatagram, so the read that finds the socket drained has to go through it - it either picks up a
+                // datagram that arrived since the batch was received, or finds nothing and re-arms readyRead
+                destinationByteArray.resize(MAX_PACKET_SIZE + 1);
+                qint64 numBytesRead = socket.readDatagram(destinationByteArray.data(), destinationByteArray.size(),
+                                                          senderSockAddr.getAddressPointer(),
+                                                          senderSockAddr.getPortPointer());
+                if (numBytesRead > MAX_PACKET_SIZE) {
+                    // one more byte than any packet was read, so the rest of this datagram was cut off
+                    _numTruncated++;
+                    continue;
+                } else if (numBytesRead >= 0) {
+                    destinationByteArray.resize(numBytesRead);
+                    return true;
+                } else {
+                    return false;
+                }
+            }
+
+            _numReceived = numReceived;
+        }
+
+        const mmsghdr& header = _headers[_nextDatagram];
+        const sockaddr_in& senderAddress = _senderAddresses[_nextDatagram];
+        const char* buffer = _buffers[_nextDatagram];
+        _nextDatagram++;
+
+        if (header.msg_hdr.msg_flags & MSG_TRUNC) {
+            // the datagram was larger than any packet and only the start of it fit in the buffer
+            _numTruncated++;
+            continue;
+        }
+
+        destinationByteArray.resize(header.msg_len);
+        memcpy(destinationByteArray.data(), buffer, header.msg_len);
+
+        senderSockAddr.setAddress(QHostAddress(ntohl(senderAddress.sin_addr.s_addr)));
+        senderSockAddr.setPort(ntohs(senderAddress.sin_port));
+
+        return true;
+    }
+#else
+    if (socket.hasPendingDatagrams()) {
+        destinationByteArray.resize(socket.pendingDatagramSize());
+        socket.readDatagram(destinationByteArray.data(), destinationByteArray.size(),
+                            senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+        return true;
+    } else {
+        return false;
+    }
+#endif
+}
+
+DatagramSendBatch::DatagramSendBatch() :
+    _isOpen(false),
+    _numQueued(0)
+{
+#ifdef HAS_DATAGRAM_BATCHES
+    memset(_headers, 0, sizeof(_headers));
+    memset(_destinationAddresses, 0, sizeof(_destinationAddresses));
+
+    for (int i = 0; i < MAX_DATAGRAMS_PER_BATCH; i++) {
+        _vectors[i].iov_base = _buffers[i];
+
+        _destinationAddresses[i].sin_family = AF_INET;
+
+        _headers[i].msg_hdr.msg_name = &_destinationAddresses[i];
+        _headers[i].msg_hdr.msg_namelen = sizeof(_destinationAddresses[i]);
+        _headers[i].msg_hdr.msg_iov = &_vectors[i];
+        _headers[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+}
+
+bool DatagramSendBatch::isSupported() {
+    return DatagramReceiveBatch::isSupported();
+}
+
+void DatagramSendBatch::close(QUdpSocket& socket) {
+    flush(socket);
+    _isOpen = false;
+}
+
+qint64 DatagramSendBatch::queueDatagram(QUdpSocket& socket, const char* data, qint64 size,
+                                        const HifiSockAddr& destinationSockAddr) {
+#ifdef HAS_DATAGRAM_BATCHES
+    if (size > MAX_PACKET_SIZE || destinationSockAddr.getAddress().protocol() != QAbstractSocket::IPv4Protocol) {
+        // this does not fit a batch buffer, send what is queued so the order is kept and then send it on its own
+        flush(socket);
+        return socket.writeDatagram(data, size, destinationSockAddr.getAddress(), destinationSockAddr.getPort());
+    }
+
+    if (_numQueued == MAX_DATAGRAMS_PER_BATCH) {
+        flush(socket);
+    }
+
+    memcpy(_buffers[_numQueued], data, size);
+    _vectors[_numQueued].iov_len = size;
+
+    _destinationAddresses[_numQueued].sin_addr.s_addr = htonl(destinationSockAddr.getAddress().toIPv4Address());
+    _destinationAddresses[_numQueued].sin_port = htons(destinationSockAddr.getPort());
+
+    _numQueued++;
+    return size;
+#else
+    return socket.writeDatagram(data, size, destinationSockAddr.getAddress(), destinationSockAddr.getPort());
+#endif
+}
+
+int DatagramSendBatch::flush(QUdpSocket& socket) {
+    int numSent = 0;
+
+#ifdef HAS_DATAGRAM_BATCHES
+    int numAttempted = 0;
+
+    while (numAttempted < _numQueued) {
+        int result = sendmmsg(socket.socketDescriptor(), _headers + numAttempted, _numQueued - numAttempted, 0);
+
+        if (result > 0) {
+            numAttempted += result;
+            numSent += result;
+        } else if (result < 0 && errno == EINTR) {
+            continue;
+        } else {
+            // the socket refused the first datagram left in the batch - drop it like a failed writeDatagram would be
+            // dropped, and carry on with the rest
+            numAttempted++;
+        }
+    }
+#endif
+
+    _numQueued = 0;
+    return numSent;
+}
+
+void benchmarkDatagramBatches() {
+    if (!DatagramSendBatch::isSupported()) {
+        qDebug() << "Datagram batch benchmark: batches are not supported on this platform.";
+        return;
+    }
+
+    const int NUM_DATAGRAMS = 100000;
+    const int DATAGRAM_SIZE = 256;
+
+    QUdpSocket sendingSocket;
+    QUdpSocket receivingSocket;
+    sendingSocket.bind(QHostAddress::LocalHost, 0);
+    receivingSocket.bind(QHostAddress::LocalHost, 0);
+
+    HifiSockAddr receiverSockAddr(QHostAddress::LocalHost, receivingSocket.localPort());
+
+    char datagram[DATAGRAM_SIZE];
+    memset(datagram, 0, sizeof(datagram));
+
+    QByteArray receivedDatagram;
+    HifiSockAddr senderSockAddr;
+
+    // datagrams are sent in bursts no bigger than a batch and read back before the next burst, so the receive buffer
+    // never overflows - loopback delivers each datagram before its send call returns
+    QElapsedTimer benchmarkTimer;
+    benchmarkTimer.start();
+
+    int numReceivedOneAtATime = 0;
+    for (int numSent = 0; numSent < NUM_DATAGRAMS; numSent += MAX_DATAGRAMS_PER_BATCH) {
+        for (int i = 0; i < MAX_DATAGRAMS_PER_BATCH; i++) {
+            sendingSocket.writeDatagram(datagram, DATAGRAM_SIZE, receiverSockAddr.getAddress(), receiverSockAddr.getPort());
+        }
+
+        while (receivingSocket.hasPendingDatagrams()) {
+            receivedDatagram.resize(receivingSocket.pendingDatagramSize());
+            receivingSocket.readDatagram(receivedDatagram.data(), receivedDatagram.size(),
+                                         senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+            numReceivedOneAtATime++;
+        }
+    }
+
+    qint64 oneAtATimeNsecs = benchmarkTimer.nsecsElapsed();
+
+    // the batches are about 100KB each, so they go on the heap
+    DatagramSendBatch* sendBatch = new DatagramSendBatch();
+    DatagramReceiveBatch* receiveBatch = new DatagramReceiveBatch();
+
+    benchmarkTimer.restart();
+
+    int numReceivedInBatches = 0;
+    for (int numSent = 0; numSent < NUM_DATAGRAMS; numSent += MAX_DATAGRAMS_PER_BATCH) {
+        for (int i = 0; i < MAX_DATAGRAMS_PER_BATCH; i++) {
+            sendBatch->queueDatagram(sendingSocket, datagram, DATAGRAM_SIZE, receiverSockAddr);
+        }
+        sendBatch->flush(sendingSocket);
+
+        while (receiveBatch->readDatagram(receivingSocket, receivedDatagram, senderSockAddr)) {
+            numReceivedInBatches++;
+        }
+    }
+
+    qint64 batchedNsecs = benchmarkTimer.nsecsElapsed();
+
+    delete sendBatch;
+    delete receiveBatch;
+
+    qDebug("Datagram batch benchmark: %d byte datagrams over loopback - one at a time %.0f packets/s (%d received),"
+           " in batches of %d %.0f packets/s (%d received).", DATAGRAM_SIZE,
+           numReceivedOneAtATime / (oneAtATimeNsecs / 1000000000.0), numReceivedOneAtATime,
+           MAX_DATAGRAMS_PER_BATCH, numReceivedInBatches / (batchedNsecs / 1000000000.0), numReceivedInBatches);
+}
@@ -0,0 +1,92 @@
+//
+//  DatagramBatch.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  Moves datagrams to and from a UDP socket a batch at a time, with one recvmmsg or sendmmsg call per batch into and
+//  out of buffers that are allocated once. Only built on Linux - everywhere else isSupported() is false and the
+//  NodeList keeps reading and writing one datagram at a time through QUdpSocket.
+//
+
+#ifndef __hifi__DatagramBatch__
+#define __hifi__DatagramBatch__
+
+#ifdef __linux__
+#define HAS_DATAGRAM_BATCHES
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#include <QtCore/QByteArray>
+#include <QtNetwork/QUdpSocket>
+
+#include "HifiSockAddr.h"
+#include "SharedUtil.h"
+
+/// the most datagrams moved by one system call
+const int MAX_DATAGRAMS_PER_BATCH = 64;
+
+/// datagrams received from a socket a batch at a time - used from one thread only
+class DatagramReceiveBatch {
+public:
+    DatagramReceiveBatch();
+
+    static bool isSupported();
+
+    /// hands out the next datagram, receiving a new batch when the last one is used up - false once the socket is drained
+    bool readDatagram(QUdpSocket& socket, QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
+
+    /// the datagrams too large for a packet buffer, which were dropped instead of being handed out cut short
+    int getNumTruncatedDatagrams() const { return _numTruncated; }
+private:
+    int _numReceived;
+    int _nextDatagram;
+    int _numTruncated;
+
+#ifdef HAS_DATAGRAM_BATCHES
+    char _buffers[MAX_DATAGRAMS_PER_BATCH][MAX_PACKET_SIZE];
+    iovec _vectors[MAX_DATAGRAMS_PER_BATCH];
+    sockaddr_in _senderAddresses[MAX_DATAGRAMS_PER_BATCH];
+    mmsghdr _headers[MAX_DATAGRAMS_PER_BATCH];
+#endif
+};
+
+/// datagrams copied into a batch and sent with one call when the batch is full or flushed - used from one thread only
+class DatagramSendBatch {
+public:
+    DatagramSendBatch();
+
+    static bool isSupported();
+
+    bool isOpen() const { return _isOpen; }
+
+    /// starts queueing datagrams instead of sending them straight away
+    void open() { _isOpen = true; }
+
+    /// sends whatever is queued and goes back to sending datagrams straight away
+    void close(QUdpSocket& socket);
+
+    /// copies the datagram into the batch, sending the batch first if it is full - returns the size queued
+    qint64 queueDatagram(QUdpSocket& socket, const char* data, qint64 size, const HifiSockAddr& destinationSockAddr);
+
+    /// sends every queued datagram, returns the number the socket took
+    int flush(QUdpSocket& socket);
+private:
+    bool _isOpen;
+    int _numQueued;
+
+#ifdef HAS_DATAGRAM_BATCHES
+    char _buffers[MAX_DATAGRAMS_PER_BATCH][MAX_PACKET_SIZE];
+    iovec _vectors[MAX_DATAGRAMS_PER_BATCH];
+    sockaddr_in _destinationAddresses[MAX_DATAGRAMS_PER_BATCH];
+    mmsghdr _headers[MAX_DATAGRAMS_PER_BATCH];
+#endif
+};
+
+/// sends and receives datagrams over loopback one at a time through QUdpSocket and then in batches, and logs the
+/// packets per second of each
+void benchmarkDatagramBatches();
+
+#endif /* defined(__hifi__DatagramBatch__) */
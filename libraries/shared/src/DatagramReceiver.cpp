@@ -0,0 +1,225 @@
+//
+//  DatagramReceiver.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#ifdef _WIN32
+#include "Syssocket.h"
+#define poll WSAPoll
+#else
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#endif
+
+#include <algorithm>
+
+#include <QtCore/QDebug>
+
+#include "NodeList.h"
+#include "SharedUtil.h"
+
+#include "DatagramReceiver.h"
+
+// the ring indices run over twice the capacity, so a full queue and an empty one have different depths
+const int DATAGRAM_QUEUE_INDEX_MASK = (2 * DATAGRAM_QUEUE_CAPACITY) - 1;
+
+DatagramQueue::DatagramQueue() :
+    _head(0),
+    _tail(0),
+    _maxDepth(0),
+    _numDropped(0),
+    _numPopped(0),
+    _totalLatencyUsecs(0),
+    _maxLatencyUsecs(0)
+{
+}
+
+QueuedDatagram* DatagramQueue::beginPush() {
+    int tail = _tail.load();
+
+    if (((tail - _head.loadAcquire()) & DATAGRAM_QUEUE_INDEX_MASK) == DATAGRAM_QUEUE_CAPACITY) {
+        return NULL;
+    }
+
+    return &_slots[tail % DATAGRAM_QUEUE_CAPACITY];
+}
+
+void DatagramQueue::endPush() {
+    int tail = (_tail.load() + 1) & DATAGRAM_QUEUE_INDEX_MASK;
+    _tail.storeRelease(tail);
+
+    // the consumer may reset the maximum in between, which only costs the statistic one sample
+    int depth = (tail - _head.loadAcquire()) & DATAGRAM_QUEUE_INDEX_MASK;
+    if (depth > _maxDepth.load()) {
+        _maxDepth.fetchAndStoreRelaxed(depth);
+    }
+}
+
+bool DatagramQueue::pop(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr) {
+    int head = _head.load();
+
+    if (head == _tail.loadAcquire()) {
+        return false;
+    }
+
+    // the slot keeps the caller's old buffer, which the receive thread reuses for a later datagram
+    QueuedDatagram& slot = _slots[head % DATAGRAM_QUEUE_CAPACITY];
+    destinationByteArray.swap(slot.datagram);
+    senderSockAddr = slot.senderSockAddr;
+
+    quint64 latencyUsecs = usecTimestampNow() - slot.receivedUsecs;
+    _totalLatencyUsecs += latencyUsecs;
+    _maxLatencyUsecs = std::max(_maxLatencyUsecs, latencyUsecs);
+    _numPopped++;
+
+    _head.storeRelease((head + 1) & DATAGRAM_QUEUE_INDEX_MASK);
+    return true;
+}
+
+void DatagramQueue::takeStats(int& maxDepth, int& numDropped, int& numPopped, float& averageLatencyUsecs,
+                              quint64& maxLatencyUsecs) {
+    maxDepth = _maxDepth.fetchAndStoreRelaxed(0);
+    numDropped = _numDropped.fetchAndStoreRelaxed(0);
+    numPopped = _numPopped;
+    averageLatencyUsecs = _numPopped > 0 ? (float) _totalLatencyUsecs / _numPopped : 0.0f;
+    maxLatencyUsecs = _maxLatencyUsecs;
+
+    _numPopped = 0;
+    _totalLatencyUsecs = 0;
+    _maxLatencyUsecs = 0;
+}
+
+DatagramReceiver::DatagramReceiver(int socketDescriptor) :
+    _socketDescriptor(socketDescriptor),
+    _numQueuesInUse(0),
+    _isWakePending(0),
+    _receiveBuffer(),
+    _nextQueueIndex(0)
+{
+}
+
+DatagramReceiver::~DatagramReceiver() {
+    terminate();
+
+    for (int i = 0; i < NUM_DATAGRAM_QUEUES; i++) {
+        delete _queues[i].load();
+    }
+}
+
+bool DatagramReceiver::process() {
+    pollfd socketPoll;
+    socketPoll.fd = _socketDescriptor;
+    socketPoll.events = POLLIN;
+    socketPoll.revents = 0;
+
+    if (poll(&socketPoll, 1, DATAGRAM_RECEIVER_POLL_MSECS) > 0) {
+        // take everything that is waiting before going back to poll
+        forever {
+            _receiveBuffer.resize(MAX_PACKET_SIZE);
+
+            sockaddr_in senderAddress;
+            socklen_t senderAddressLength = sizeof(senderAddress);
+
+            int numBytesReceived = recvfrom(_socketDescriptor, _receiveBuffer.data(), _receiveBuffer.size(), MSG_DONTWAIT,
+                                            reinterpret_cast<sockaddr*>(&senderAddress), &senderAddressLength);
+            if (numBytesReceived < 0) {
+                break;
+            } else if (numBytesReceived == 0) {
+                // nothing to route an empty datagram by
+                continue;
+            }
+
+            _receiveBuffer.resize(numBytesReceived);
+
+            int queueIndex = std::min((int) packetTypeForPacket(_receiveBuffer), NUM_DATAGRAM_QUEUES - 1);
+            DatagramQueue* queue = _queues[queueIndex].loadAcquire();
+
+            if (!queue) {
+                // this is the only thread that adds queues, so it can publish them without racing anyone
+                queue = new DatagramQueue();
+                _queues[queueIndex].storeRelease(queue);
+
+                if (queueIndex >= _numQueuesInUse.load()) {
+                    _numQueuesInUse.storeRelease(queueIndex + 1);
+                }
+            }
+
+            QueuedDatagram* slot = queue->beginPush();
+
+            if (!slot) {
+                queue->recordDrop();
+                NodeList::getInstance()->getTrafficStats().recordDrop();
+                continue;
+            }
+
+            slot->datagram.swap(_receiveBuffer);
+            slot->senderSockAddr.setAddress(QHostAddress(ntohl(senderAddress.sin_addr.s_addr)));
+            slot->senderSockAddr.setPort(ntohs(senderAddress.sin_port));
+            slot->receivedUsecs = usecTimestampNow();
+
+            // the slot is the reader's once it is pushed
+            NodeList::getInstance()->recordIncomingDatagram(slot->datagram);
+            NodeList::getInstance()->captureDatagram(slot->datagram, slot->senderSockAddr);
+            queue->endPush();
+
+            if (_isWakePending.testAndSetOrdered(0, 1)) {
+                emit datagramsQueued();
+            }
+        }
+    }
+
+    return isStillRunning();
+}
+
+bool DatagramReceiver::readDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr) {
+    if (popFromAnyQueue(destinationByteArray, senderSockAddr)) {
+        return true;
+    }
+
+    // every queue is empty - the next datagram queued should wake the consumer again, and one that was queued before
+    // the flag was cleared is picked up by looking once more
+    _isWakePending.fetchAndStoreOrdered(0);
+    return popFromAnyQueue(destinationByteArray, senderSockAddr);
+}
+
+bool DatagramReceiver::popFromAnyQueue(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr) {
+    int numQueuesInUse = _numQueuesInUse.loadAcquire();
+
+    for (int i = 0; i < numQueuesInUse; i++) {
+        int queueIndex = (_nextQueueIndex + i) % numQueuesInUse;
+        DatagramQueue* queue = _queues[queueIndex].loadAcquire();
+        if (queue && queue->pop(destinationByteArray, senderSockAddr)) {
+            // the next read starts with the type after this one, so a steady stream of one type can't hold up the rest
+            _nextQueueIndex = (queueIndex + 1) % numQueuesInUse;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void DatagramReceiver::logQueueStats() {
+    int numQueuesInUse = _numQueuesInUse.loadAcquire();
+
+    for (int i = 0; i < numQueuesInUse; i++) {
+        DatagramQueue* queue = _queues[i].loadAcquire();
+        if (!queue) {
+            continue;
+        }
+
+        int maxDepth, numDropped, numPopped;
+        float averageLatencyUsecs;
+        quint64 maxLatencyUsecs;
+        queue->takeStats(maxDepth, numDropped, numPopped, averageLatencyUsecs, maxLatencyUsecs);
+
+        if (numPopped > 0 || numDropped > 0) {
+            qDebug() << "Datagram queue for packet type" << i << "- read:" << numPopped << "dropped:" << numDropped
+                << "max depth:" << maxDepth << "latency usecs average:" << averageLatencyUsecs
+                << "max:" << maxLatencyUsecs;
+        }
+    }
+}
@@ -0,0 +1,110 @@
+//
+//  DatagramReceiver.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  Reads the node socket on a thread of its own and sorts what arrives into a queue per packet type, so a burst of
+//  packets never holds up the thread that consumes them. Each queue is a single producer, single consumer ring - the
+//  receive thread pushes, the assignment's thread pops - and neither side takes a lock.
+//
+
+#ifndef __hifi__DatagramReceiver__
+#define __hifi__DatagramReceiver__
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QByteArray>
+
+#include "GenericThread.h"
+#include "HifiSockAddr.h"
+#include "PacketHeaders.h"
+
+/// how many datagrams one type can have waiting before more of that type are dropped
+const int DATAGRAM_QUEUE_CAPACITY = 1024;
+
+/// packet types are one byte on the wire while they are below 255, so every type gets a queue
+const int NUM_DATAGRAM_QUEUES = 256;
+
+/// how long the receive thread waits for a datagram before it checks whether it has been stopped
+const int DATAGRAM_RECEIVER_POLL_MSECS = 100;
+
+/// a datagram, who sent it and when it came in
+struct QueuedDatagram {
+    QByteArray datagram;
+    HifiSockAddr senderSockAddr;
+    quint64 receivedUsecs;
+};
+
+/// the datagrams of one packet type waiting to be read
+class DatagramQueue {
+public:
+    DatagramQueue();
+
+    /// the slot the next datagram goes in, or NULL when the queue is full - receive thread only
+    QueuedDatagram* beginPush();
+
+    /// makes the datagram put in the slot from beginPush visible to the consumer - receive thread only
+    void endPush();
+
+    /// counts a datagram that was dropped because the queue was full - receive thread only
+    void recordDrop() { _numDropped.ref(); }
+
+    /// swaps the oldest datagram into destinationByteArray, false when there is none - consuming thread only
+    bool pop(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
+
+    bool isEmpty() const { return _head.loadAcquire() == _tail.loadAcquire(); }
+
+    /// the deepest the queue got, the datagrams dropped and the time from arrival to being read, since the last call
+    void takeStats(int& maxDepth, int& numDropped, int& numPopped, float& averageLatencyUsecs, quint64& maxLatencyUsecs);
+private:
+    QueuedDatagram _slots[DATAGRAM_QUEUE_CAPACITY];
+
+    // both count up forever and are taken modulo the capacity, so full and empty can be told apart
+    QAtomicInt _head;
+    QAtomicInt _tail;
+
+    // written by the receive thread, read and reset by the consuming thread
+    QAtomicInt _maxDepth;
+    QAtomicInt _numDropped;
+
+    // only touched by the consuming thread
+    int _numPopped;
+    quint64 _totalLatencyUsecs;
+    quint64 _maxLatencyUsecs;
+};
+
+/// receives datagrams from a socket descriptor into a queue per packet type
+class DatagramReceiver : public GenericThread {
+    Q_OBJECT
+public:
+    DatagramReceiver(int socketDescriptor);
+    ~DatagramReceiver();
+
+    /// reads the next queued datagram, taking the queues in turn so that no packet type starves the others - false
+    /// once they are all empty
+    bool readDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
+
+    /// logs the depth, drops and latency of every queue that saw traffic since the last call
+    void logQueueStats();
+signals:
+    /// emitted when a datagram is queued after the consumer last found every queue empty
+    void datagramsQueued();
+protected:
+    virtual bool process();
+private:
+    /// pops from the first queue at or after _nextQueueIndex that has a datagram waiting, and moves the index past it
+    bool popFromAnyQueue(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
+
+    int _socketDescriptor;
+    QAtomicPointer<DatagramQueue> _queues[NUM_DATAGRAM_QUEUES];
+    QAtomicInt _numQueuesInUse;
+    QAtomicInt _isWakePending;
+
+    QByteArray _receiveBuffer;
+
+    int _nextQueueIndex; ///< only touched by the consumer
+};
+
+#endif /* defined(__hifi__DatagramReceiver__) */
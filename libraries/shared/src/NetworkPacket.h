@@ -35,6 +35,7 @@ public:
 
     const SharedNodePointer& getDestinationNode() const { return _destinationNode; }
     const QByteArray& getByteArray() const { return _byteArray; }
+    QByteArray& getByteArray() { return _byteArray; }
 
 private:
     void copyContents(const SharedNodePointer& destinationNode, const QByteArray& byteArray);
@@ -47,6 +47,7 @@ const QString& NodeType::getNodeTypeName(NodeType_t nodeType) {
 Node::Node(const QUuid& uuid, char type, const HifiSockAddr& publicSocket, const HifiSockAddr& localSocket) :
     _type(type),
     _uuid(uuid),
+    _slot(-1),
     _wakeMicrostamp(usecTimestampNow()),
     _lastHeardMicrostamp(usecTimestampNow()),
     _publicSocket(publicSocket),
@@ -57,6 +58,8 @@ Node::Node(const QUuid& uuid, char type, const HifiSockAddr& publicSocket, const
     _linkedData(NULL),
     _isAlive(true),
     _clockSkewUsec(0),
+    _channels(),
+    _trafficStats(),
     _mutex()
 {
 }
@@ -24,8 +24,10 @@
 #include <QMutex>
 
 #include "HifiSockAddr.h"
+#include "NodeChannel.h"
 #include "NodeData.h"
 #include "SimpleMovingAverage.h"
+#include "TrafficStats.h"
 
 typedef quint8 NodeType_t;
 
@@ -60,6 +62,10 @@ public:
     const QUuid& getUUID() const { return _uuid; }
     void setUUID(const QUuid& uuid) { _uuid = uuid; }
 
+    /// the dense index the NodeList gave this node, reused once the node is killed - -1 until it is in the list
+    int getSlot() const { return _slot; }
+    void setSlot(int slot) { _slot = slot; }
+
     quint64 getWakeMicrostamp() const { return _wakeMicrostamp; }
     void setWakeMicrostamp(quint64 wakeMicrostamp) { _wakeMicrostamp = wakeMicrostamp; }
 
@@ -94,6 +100,12 @@ public:
 
     int getClockSkewUsec() const { return _clockSkewUsec; }
     void setClockSkewUsec(int clockSkew) { _clockSkewUsec = clockSkew; }
+
+    /// the sequenced and reliable channels to and from this node, and their round trip time estimate
+    NodeChannels& getChannels() { return _channels; }
+
+    /// the packets and bytes sent to and verified from this node
+    NodeTrafficStats& getTrafficStats() { return _trafficStats; }
     QMutex& getMutex() { return _mutex; }
     
     friend QDataStream& operator<<(QDataStream& out, const Node& node);
@@ -106,6 +118,7 @@ private:
 
     NodeType_t _type;
     QUuid _uuid;
+    int _slot;
     quint64 _wakeMicrostamp;
     quint64 _lastHeardMicrostamp;
     HifiSockAddr _publicSocket;
@@ -117,6 +130,8 @@ private:
     bool _isAlive;
     int _pingMs;
     int _clockSkewUsec;
+    NodeChannels _channels;
+    NodeTrafficStats _trafficStats;
     QMutex _mutex;
 };
 
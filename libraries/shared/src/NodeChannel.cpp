@@ -0,0 +1,538 @@
+//
+//  NodeChannel.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QDebug>
+
+#include "PacketHeaders.h"
+#include "SharedUtil.h"
+
+#include "NodeChannel.h"
+
+// channel data is the channel, the mode, the epoch and the sequence, followed by the packet carried
+const int NUM_BYTES_CHANNEL_DATA_FIELDS = sizeof(ChannelID_t) + sizeof(ChannelMode_t) + sizeof(quint32) + sizeof(quint16);
+
+// an acknowledgement is the channel, the epoch, whether it asks for a reset, the last sequence received in order and
+// the mask of the ones received after it
+const int NUM_BYTES_CHANNEL_ACK_FIELDS = sizeof(ChannelID_t) + sizeof(quint32) + sizeof(quint8) + sizeof(quint16)
+    + sizeof(quint32);
+
+const int NUM_RECEIVED_AFTER_MASK_BITS = sizeof(quint32) * 8;
+
+// a missing packet is taken as lost once a packet this many sequences after it has been acknowledged
+const int CHANNEL_REORDERING_THRESHOLD = 3;
+
+const float INITIAL_CHANNEL_CONGESTION_WINDOW = 2.0f;
+const float MIN_CHANNEL_SLOW_START_THRESHOLD = 2.0f;
+
+// past this many doublings the timeout is at its maximum anyway
+const int MAX_CHANNEL_RETRANSMIT_BACKOFFS = 5;
+
+// with nothing to go on, the retransmit timeout starts at a second
+const quint64 INITIAL_CHANNEL_RETRANSMIT_USECS = 1000 * 1000;
+
+// the clock granularity term of the retransmit timeout
+const quint64 CHANNEL_RETRANSMIT_GRANULARITY_USECS = CHANNEL_TIMEOUT_CHECK_INTERVAL_MSECS * 1000;
+
+static bool sequenceGreaterThan(quint16 sequence, quint16 otherSequence) {
+    return (qint16) (sequence - otherSequence) > 0;
+}
+
+static bool epochGreaterThan(quint32 epoch, quint32 otherEpoch) {
+    return (qint32) (epoch - otherEpoch) > 0;
+}
+
+// epochs count milliseconds, so a process that restarts opens newer epochs than it did before, and one process never
+// opens the same epoch twice
+static QAtomicInt lastChannelEpoch(0);
+
+static quint32 nextChannelEpoch() {
+    quint32 nowEpoch = (quint32) (usecTimestampNow() / 1000);
+
+    forever {
+        int lastEpoch = lastChannelEpoch.load();
+        quint32 epoch = epochGreaterThan(nowEpoch, lastEpoch) ? nowEpoch : (quint32) lastEpoch + 1;
+
+        if (lastChannelEpoch.testAndSetOrdered(lastEpoch, (int) epoch)) {
+            return epoch;
+        }
+    }
+}
+
+int numBytesChannelOverhead() {
+    return numBytesForPacketHeaderGivenPacketType(PacketTypeChannelData) + NUM_BYTES_CHANNEL_DATA_FIELDS;
+}
+
+int maxChannelPayloadBytes() {
+    return MAX_PACKET_SIZE - numBytesChannelOverhead();
+}
+
+RoundTripEstimator::RoundTripEstimator() :
+    _hasSample(false),
+    _smoothedUsecs(0),
+    _variationUsecs(0)
+{
+}
+
+void RoundTripEstimator::recordSample(quint64 roundTripUsecs) {
+    if (!_hasSample) {
+        _smoothedUsecs = roundTripUsecs;
+        _variationUsecs = roundTripUsecs / 2;
+        _hasSample = true;
+    } else {
+        quint64 difference = (roundTripUsecs > _smoothedUsecs)
+            ? roundTripUsecs - _smoothedUsecs : _smoothedUsecs - roundTripUsecs;
+        _variationUsecs = (3 * _variationUsecs + difference) / 4;
+        _smoothedUsecs = (7 * _smoothedUsecs + roundTripUsecs) / 8;
+    }
+}
+
+quint64 RoundTripEstimator::getRetransmitTimeoutUsecs() const {
+    if (!_hasSample) {
+        return INITIAL_CHANNEL_RETRANSMIT_USECS;
+    }
+
+    quint64 timeoutUsecs = _smoothedUsecs + std::max(CHANNEL_RETRANSMIT_GRANULARITY_USECS, 4 * _variationUsecs);
+    return std::min(std::max(timeoutUsecs, MIN_CHANNEL_RETRANSMIT_USECS), MAX_CHANNEL_RETRANSMIT_USECS);
+}
+
+OutgoingChannel::OutgoingChannel(ChannelID_t channelID, ChannelMode_t channelMode) :
+    _id(channelID),
+    _mode(channelMode),
+    _epoch(nextChannelEpoch()),
+    _nextSequence(0),
+    _inFlight(),
+    _waiting(),
+    _congestionWindow(INITIAL_CHANNEL_CONGESTION_WINDOW),
+    _slowStartThreshold(MAX_CHANNEL_CONGESTION_WINDOW),
+    _recoverySequence(0),
+    _isRecovering(false),
+    _numRetransmissions(0)
+{
+}
+
+void OutgoingChannel::queuePacket(const QByteArray& packet, quint64 now, QList<QByteArray>& packetsToSend) {
+    QByteArray channelPacket = byteArrayWithPopluatedHeader(PacketTypeChannelData);
+    channelPacket.reserve(channelPacket.size() + NUM_BYTES_CHANNEL_DATA_FIELDS + packet.size());
+
+    // the epoch and sequence go in when the packet is sent, since a reliable one can wait for the window first
+    quint32 epochPlaceholder = 0;
+    quint16 sequencePlaceholder = 0;
+    channelPacket.append(reinterpret_cast<const char*>(&_id), sizeof(_id));
+    channelPacket.append(reinterpret_cast<const char*>(&_mode), sizeof(_mode));
+    channelPacket.append(reinterpret_cast<const char*>(&epochPlaceholder), sizeof(epochPlaceholder));
+    channelPacket.append(reinterpret_cast<const char*>(&sequencePlaceholder), sizeof(sequencePlaceholder));
+    channelPacket.append(packet);
+
+    _waiting.append(channelPacket);
+    sendWithinWindow(now, packetsToSend);
+}
+
+void OutgoingChannel::sendWithinWindow(quint64 now, QList<QByteArray>& packetsToSend) {
+    while (!_waiting.isEmpty() && (_mode != ChannelMode::Reliable || _inFlight.size() < (int) _congestionWindow)) {
+        QByteArray channelPacket = _waiting.takeFirst();
+
+        quint16 sequence = _nextSequence++;
+        char* epochAt = channelPacket.data() + numBytesForPacketHeader(channelPacket) + sizeof(ChannelID_t)
+            + sizeof(ChannelMode_t);
+        memcpy(epochAt, &_epoch, sizeof(_epoch));
+        memcpy(epochAt + sizeof(_epoch), &sequence, sizeof(sequence));
+
+        if (_mode == ChannelMode::Reliable) {
+            SentPacket sentPacket = { channelPacket, now, 1, false };
+            _inFlight.insert(sequence, sentPacket);
+        }
+
+        packetsToSend.append(channelPacket);
+    }
+}
+
+void OutgoingChannel::processAck(quint16 lastInOrderSequence, quint32 receivedAfterMask, quint64 now,
+                                 RoundTripEstimator& roundTrip, QList<QByteArray>& packetsToSend) {
+    quint16 highestAcknowledged = lastInOrderSequence;
+
+    QMap<quint16, SentPacket>::iterator sentPacket = _inFlight.begin();
+    while (sentPacket != _inFlight.end()) {
+        quint16 sequence = sentPacket.key();
+        bool isAcknowledged = !sequenceGreaterThan(sequence, lastInOrderSequence);
+
+        if (!isAcknowledged) {
+            int maskBit = (quint16) (sequence - lastInOrderSequence) - 2;
+            isAcknowledged = maskBit >= 0 && maskBit < NUM_RECEIVED_AFTER_MASK_BITS
+                && (receivedAfterMask & (1u << maskBit));
+        }
+
+        if (isAcknowledged) {
+            if (sequenceGreaterThan(sequence, highestAcknowledged)) {
+                highestAcknowledged = sequence;
+            }
+
+            packetAcknowledged(sequence, sentPacket.value(), now, roundTrip);
+            sentPacket = _inFlight.erase(sentPacket);
+        } else {
+            ++sentPacket;
+        }
+    }
+
+    // what is still in flight well before a packet that made it is taken as lost and sent again straight away, once
+    for (sentPacket = _inFlight.begin(); sentPacket != _inFlight.end(); ++sentPacket) {
+        if (!sentPacket->hasBeenFastRetransmitted
+            && (qint16) (highestAcknowledged - sentPacket.key()) >= CHANNEL_REORDERING_THRESHOLD) {
+            shrinkWindowForLoss(sentPacket.key(), false);
+
+            sentPacket->hasBeenFastRetransmitted = true;
+            sentPacket->numTransmissions++;
+            sentPacket->lastSentUsecs = now;
+            _numRetransmissions++;
+
+            packetsToSend.append(sentPacket->packet);
+        }
+    }
+
+    sendWithinWindow(now, packetsToSend);
+}
+
+void OutgoingChannel::packetAcknowledged(quint16 sequence, const SentPacket& sentPacket, quint64 now,
+                                         RoundTripEstimator& roundTrip) {
+    // a packet that was sent more than once cannot say which send the acknowledgement is for (Karn's algorithm)
+    if (sentPacket.numTransmissions == 1) {
+        roundTrip.recordSample(now - sentPacket.lastSentUsecs);
+    }
+
+    if (_isRecovering && !sequenceGreaterThan(_recoverySequence, sequence)) {
+        // everything that was in flight when the loss was seen has been acknowledged
+        _isRecovering = false;
+    }
+
+    if (_congestionWindow < _slowStartThreshold) {
+        _congestionWindow += 1.0f;
+    } else {
+        _congestionWindow += 1.0f / _congestionWindow;
+    }
+
+    _congestionWindow = std::min(_congestionWindow, (float) MAX_CHANNEL_CONGESTION_WINDOW);
+}
+
+void OutgoingChannel::shrinkWindowForLoss(quint16 lostSequence, bool wasTimeout) {
+    // the window is only halved once for the losses in one window of packets
+    if (!_isRecovering || sequenceGreaterThan(lostSequence, _recoverySequence)) {
+        _slowStartThreshold = std::max(_congestionWindow / 2.0f, MIN_CHANNEL_SLOW_START_THRESHOLD);
+        _congestionWindow = _slowStartThreshold;
+
+        _isRecovering = true;
+        _recoverySequence = _nextSequence - 1;
+    }
+
+    if (wasTimeout) {
+        // nothing has been heard for a whole timeout, so start again from a single packet
+        _congestionWindow = 1.0f;
+    }
+}
+
+void OutgoingChannel::processTimeouts(quint64 now, const RoundTripEstimator& roundTrip,
+                                      QList<QByteArray>& packetsToSend) {
+    quint64 retransmitTimeoutUsecs = roundTrip.getRetransmitTimeoutUsecs();
+
+    QMap<quint16, SentPacket>::iterator sentPacket = _inFlight.begin();
+    while (sentPacket != _inFlight.end()) {
+        // the timeout doubles with each send of the same packet - a packet is never given up on, since the channel
+        // would stall behind it, and a node that stops answering is killed once it has been silent long enough
+        int numBackoffs = std::min(sentPacket->numTransmissions - 1, MAX_CHANNEL_RETRANSMIT_BACKOFFS);
+        quint64 backedOffTimeoutUsecs = std::min(retransmitTimeoutUsecs << numBackoffs, MAX_CHANNEL_RETRANSMIT_USECS);
+
+        if (now - sentPacket->lastSentUsecs < backedOffTimeoutUsecs) {
+            ++sentPacket;
+            continue;
+        }
+
+        shrinkWindowForLoss(sentPacket.key(), true);
+
+        sentPacket->numTransmissions++;
+        sentPacket->lastSentUsecs = now;
+        _numRetransmissions++;
+
+        packetsToSend.append(sentPacket->packet);
+        ++sentPacket;
+    }
+
+    sendWithinWindow(now, packetsToSend);
+}
+
+void OutgoingChannel::restartEpoch(quint64 now, QList<QByteArray>& packetsToSend) {
+    // what is in flight goes out again ahead of what is waiting, oldest first - the sequences wrap, so they are put
+    // in order by how far they are behind the next one
+    QMap<quint16, QByteArray> inFlightByAge;
+    for (QMap<quint16, SentPacket>::const_iterator sentPacket = _inFlight.constBegin();
+         sentPacket != _inFlight.constEnd(); ++sentPacket) {
+        inFlightByAge.insert((quint16) (sentPacket.key() - _nextSequence), sentPacket->packet);
+    }
+
+    _waiting = inFlightByAge.values() + _waiting;
+    _inFlight.clear();
+
+    qDebug() << "Channel" << (int) _id << "restarting in a new epoch with" << _waiting.size() << "packets to send.";
+
+    _epoch = nextChannelEpoch();
+    _nextSequence = 0;
+
+    // nothing is known about the path in the new epoch either
+    _congestionWindow = INITIAL_CHANNEL_CONGESTION_WINDOW;
+    _slowStartThreshold = MAX_CHANNEL_CONGESTION_WINDOW;
+    _isRecovering = false;
+
+    sendWithinWindow(now, packetsToSend);
+}
+
+IncomingChannel::IncomingChannel() :
+    _epoch(0),
+    _hasEpoch(false),
+    _resetRequestedEpoch(0),
+    _hasRequestedReset(false),
+    _nextExpectedSequence(0),
+    _hasReceived(false),
+    _outOfOrder()
+{
+}
+
+void IncomingChannel::enterEpoch(quint32 epoch) {
+    _epoch = epoch;
+    _hasEpoch = true;
+    _hasRequestedReset = false;
+    _nextExpectedSequence = 0;
+    _hasReceived = false;
+    _outOfOrder.clear();
+}
+
+bool IncomingChannel::processData(quint32 epoch, quint16 sequence, ChannelMode_t channelMode, const QByteArray& packet,
+                                  QList<QByteArray>& deliveredPackets, bool& shouldRequestReset) {
+    shouldRequestReset = false;
+
+    if (!_hasEpoch) {
+        // a reliable channel has to see its epoch from the start, or it would wait forever for what the sender had
+        // acknowledged before we forgot it - but a newer epoch than one we asked to reset was opened after we asked
+        bool isAfterResetRequest = !_hasRequestedReset || epochGreaterThan(epoch, _resetRequestedEpoch);
+
+        if (channelMode == ChannelMode::Reliable && (sequence != 0 || !isAfterResetRequest)) {
+            if (isAfterResetRequest || epoch == _resetRequestedEpoch) {
+                // ask again for one we already asked for, in case the request was lost
+                _resetRequestedEpoch = epoch;
+                _hasRequestedReset = true;
+                shouldRequestReset = true;
+            }
+
+            return false;
+        }
+
+        enterEpoch(epoch);
+    } else if (epoch != _epoch) {
+        if (!epochGreaterThan(epoch, _epoch)) {
+            // left over from an epoch the sender has moved on from
+            return false;
+        }
+
+        // the sender restarted, forgot us, or is answering a reset - either way the new epoch starts from 0
+        enterEpoch(epoch);
+    }
+
+    if (channelMode != ChannelMode::Reliable) {
+        // only a packet newer than any before it is worth handing on
+        if (_hasReceived && !sequenceGreaterThan(sequence, _nextExpectedSequence - 1)) {
+            return false;
+        }
+
+        _hasReceived = true;
+        _nextExpectedSequence = sequence + 1;
+        deliveredPackets.append(packet);
+        return true;
+    }
+
+    if (sequence == _nextExpectedSequence) {
+        deliveredPackets.append(packet);
+        _nextExpectedSequence++;
+
+        // hand on whatever was waiting for this one
+        QMap<quint16, QByteArray>::iterator waitingPacket;
+        while ((waitingPacket = _outOfOrder.find(_nextExpectedSequence)) != _outOfOrder.end()) {
+            deliveredPackets.append(waitingPacket.value());
+            _outOfOrder.erase(waitingPacket);
+            _nextExpectedSequence++;
+        }
+
+        return true;
+    } else if (sequenceGreaterThan(sequence, _nextExpectedSequence)
+               && (quint16) (sequence - _nextExpectedSequence) < MAX_CHANNEL_CONGESTION_WINDOW
+               && !_outOfOrder.contains(sequence)) {
+        _outOfOrder.insert(sequence, packet);
+        return true;
+    }
+
+    return false;
+}
+
+quint32 IncomingChannel::getReceivedAfterMask() const {
+    quint32 receivedAfterMask = 0;
+
+    for (QMap<quint16, QByteArray>::const_iterator waitingPacket = _outOfOrder.constBegin();
+         waitingPacket != _outOfOrder.constEnd(); ++waitingPacket) {
+        int maskBit = (quint16) (waitingPacket.key() - _nextExpectedSequence) - 1;
+
+        if (maskBit >= 0 && maskBit < NUM_RECEIVED_AFTER_MASK_BITS) {
+            receivedAfterMask |= (1u << maskBit);
+        }
+    }
+
+    return receivedAfterMask;
+}
+
+NodeChannels::NodeChannels() :
+    _mutex(),
+    _roundTrip(),
+    _outgoingChannels(),
+    _incomingChannels()
+{
+}
+
+NodeChannels::~NodeChannels() {
+    qDeleteAll(_outgoingChannels);
+    qDeleteAll(_incomingChannels);
+}
+
+void NodeChannels::recordRoundTripSample(quint64 roundTripUsecs) {
+    QMutexLocker locker(&_mutex);
+    _roundTrip.recordSample(roundTripUsecs);
+}
+
+quint64 NodeChannels::getSmoothedRoundTripUsecs() {
+    QMutexLocker locker(&_mutex);
+    return _roundTrip.getSmoothedUsecs();
+}
+
+void NodeChannels::queuePacket(ChannelID_t channelID, ChannelMode_t channelMode, const QByteArray& packet,
+                               QList<QByteArray>& packetsToSend) {
+    QMutexLocker locker(&_mutex);
+
+    OutgoingChannel*& channel = _outgoingChannels[channelID];
+    if (!channel) {
+        channel = new OutgoingChannel(channelID, channelMode);
+    } else if (channel->getMode() != channelMode) {
+        qDebug() << "Channel" << (int) channelID << "was opened with mode" << (int) channel->getMode()
+            << "- sending on it with mode" << (int) channelMode << "anyways.";
+    }
+
+    channel->queuePacket(packet, usecTimestampNow(), packetsToSend);
+}
+
+void NodeChannels::processDataPacket(const QByteArray& channelPacket, QList<QByteArray>& deliveredPackets,
+                                     QByteArray& ackPacket, const QUuid& connectionUUID) {
+    int numBytesPacketHeader = numBytesForPacketHeader(channelPacket);
+    if (channelPacket.size() < numBytesPacketHeader + NUM_BYTES_CHANNEL_DATA_FIELDS) {
+        return;
+    }
+
+    const char* dataAt = channelPacket.constData() + numBytesPacketHeader;
+
+    ChannelID_t channelID;
+    memcpy(&channelID, dataAt, sizeof(channelID));
+    dataAt += sizeof(channelID);
+
+    ChannelMode_t channelMode;
+    memcpy(&channelMode, dataAt, sizeof(channelMode));
+    dataAt += sizeof(channelMode);
+
+    quint32 epoch;
+    memcpy(&epoch, dataAt, sizeof(epoch));
+    dataAt += sizeof(epoch);
+
+    quint16 sequence;
+    memcpy(&sequence, dataAt, sizeof(sequence));
+    dataAt += sizeof(sequence);
+
+    QByteArray packet = channelPacket.mid(dataAt - channelPacket.constData());
+
+    QMutexLocker locker(&_mutex);
+
+    IncomingChannel*& channel = _incomingChannels[channelID];
+    if (!channel) {
+        channel = new IncomingChannel();
+    }
+
+    bool shouldRequestReset = false;
+    channel->processData(epoch, sequence, channelMode, packet, deliveredPackets, shouldRequestReset);
+
+    // duplicates are acknowledged too, since they mean an earlier acknowledgement was lost - packets from an epoch
+    // the sender has left behind are not, since it would ignore the acknowledgement anyway
+    if (channelMode == ChannelMode::Reliable
+        && (shouldRequestReset || (channel->hasEpoch() && channel->getEpoch() == epoch))) {
+        ackPacket = byteArrayWithPopluatedHeader(PacketTypeChannelAck, connectionUUID);
+
+        quint8 isResetRequest = shouldRequestReset ? 1 : 0;
+        quint16 lastInOrderSequence = shouldRequestReset ? 0 : channel->getLastInOrderSequence();
+        quint32 receivedAfterMask = shouldRequestReset ? 0 : channel->getReceivedAfterMask();
+
+        ackPacket.append(reinterpret_cast<const char*>(&channelID), sizeof(channelID));
+        ackPacket.append(reinterpret_cast<const char*>(&epoch), sizeof(epoch));
+        ackPacket.append(reinterpret_cast<const char*>(&isResetRequest), sizeof(isResetRequest));
+        ackPacket.append(reinterpret_cast<const char*>(&lastInOrderSequence), sizeof(lastInOrderSequence));
+        ackPacket.append(reinterpret_cast<const char*>(&receivedAfterMask), sizeof(receivedAfterMask));
+    }
+}
+
+void NodeChannels::processAckPacket(const QByteArray& ackPacket, QList<QByteArray>& packetsToSend) {
+    int numBytesPacketHeader = numBytesForPacketHeader(ackPacket);
+    if (ackPacket.size() < numBytesPacketHeader + NUM_BYTES_CHANNEL_ACK_FIELDS) {
+        return;
+    }
+
+    const char* dataAt = ackPacket.constData() + numBytesPacketHeader;
+
+    ChannelID_t channelID;
+    memcpy(&channelID, dataAt, sizeof(channelID));
+    dataAt += sizeof(channelID);
+
+    quint32 epoch;
+    memcpy(&epoch, dataAt, sizeof(epoch));
+    dataAt += sizeof(epoch);
+
+    quint8 isResetRequest;
+    memcpy(&isResetRequest, dataAt, sizeof(isResetRequest));
+    dataAt += sizeof(isResetRequest);
+
+    quint16 lastInOrderSequence;
+    memcpy(&lastInOrderSequence, dataAt, sizeof(lastInOrderSequence));
+    dataAt += sizeof(lastInOrderSequence);
+
+    quint32 receivedAfterMask;
+    memcpy(&receivedAfterMask, dataAt, sizeof(receivedAfterMask));
+
+    QMutexLocker locker(&_mutex);
+
+    // an acknowledgement for an epoch we have moved on from says nothing about the one we are in
+    OutgoingChannel* channel = _outgoingChannels.value(channelID);
+    if (channel && channel->getEpoch() == epoch) {
+        if (isResetRequest) {
+            channel->restartEpoch(usecTimestampNow(), packetsToSend);
+        } else {
+            channel->processAck(lastInOrderSequence, receivedAfterMask, usecTimestampNow(), _roundTrip, packetsToSend);
+        }
+    }
+}
+
+void NodeChannels::processTimeouts(QList<QByteArray>& packetsToSend) {
+    QMutexLocker locker(&_mutex);
+
+    quint64 now = usecTimestampNow();
+
+    foreach (OutgoingChannel* channel, _outgoingChannels) {
+        if (channel->getMode() == ChannelMode::Reliable) {
+            channel->processTimeouts(now, _roundTrip, packetsToSend);
+        }
+    }
+}
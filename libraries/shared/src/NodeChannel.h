@@ -0,0 +1,194 @@
+//
+//  NodeChannel.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  Channels carry whole packets to a node inside PacketTypeChannelData packets. Every channel numbers what it sends, so
+//  the receiver can drop stale and duplicate packets. A reliable channel also has the receiver acknowledge the last
+//  packet it got in order plus a mask of the ones after it. The sender retransmits on timeout or on a gap in the
+//  mask, and keeps no more than an AIMD congestion window of packets in flight.
+//
+//  The numbering runs within an epoch, which starts at sequence 0 and is newer than any epoch the sending process
+//  opened before it. A receiver moves to a newer epoch when one shows up, so a sender that restarted or forgot the node
+//  is picked up straight away. A receiver that forgot the node has no idea where the sender's epoch is up to, so it
+//  asks for a reset, and the sender opens a new epoch with everything not yet acknowledged renumbered from 0.
+//
+
+#ifndef __hifi__NodeChannel__
+#define __hifi__NodeChannel__
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QUuid>
+
+typedef quint8 ChannelID_t;
+namespace ChannelID {
+    const ChannelID_t None = 0;
+    const ChannelID_t OctreeEdits = 1;
+    const ChannelID_t ParticleAddResponses = 2;
+    const ChannelID_t AvatarIdentity = 3;
+}
+
+typedef quint8 ChannelMode_t;
+namespace ChannelMode {
+    const ChannelMode_t UnreliableSequenced = 0;
+    const ChannelMode_t Reliable = 1;
+}
+
+/// the bytes a channel adds in front of the packet it carries - its own packet header, the channel, mode and sequence
+int numBytesChannelOverhead();
+
+/// the largest packet a channel can carry without the channel packet going over MAX_PACKET_SIZE
+int maxChannelPayloadBytes();
+
+/// the smallest and largest the retransmit timeout gets, however the round trip time changes
+const quint64 MIN_CHANNEL_RETRANSMIT_USECS = 100 * 1000;
+const quint64 MAX_CHANNEL_RETRANSMIT_USECS = 2 * 1000 * 1000;
+
+/// the congestion window never grows past this many packets in flight
+const int MAX_CHANNEL_CONGESTION_WINDOW = 256;
+
+/// how often the NodeList looks for reliable packets to retransmit
+const int CHANNEL_TIMEOUT_CHECK_INTERVAL_MSECS = 25;
+
+/// smoothed round trip time and its variation, with the retransmit timeout that follows from them (RFC 6298)
+class RoundTripEstimator {
+public:
+    RoundTripEstimator();
+
+    void recordSample(quint64 roundTripUsecs);
+
+    bool hasSample() const { return _hasSample; }
+    quint64 getSmoothedUsecs() const { return _smoothedUsecs; }
+    quint64 getRetransmitTimeoutUsecs() const;
+private:
+    bool _hasSample;
+    quint64 _smoothedUsecs;
+    quint64 _variationUsecs;
+};
+
+/// the sending side of one channel to one node
+class OutgoingChannel {
+public:
+    OutgoingChannel(ChannelID_t channelID, ChannelMode_t channelMode);
+
+    ChannelMode_t getMode() const { return _mode; }
+
+    /// wraps the packet in a channel packet - it goes in packetsToSend now, or for a reliable channel once there is
+    /// room in the congestion window
+    void queuePacket(const QByteArray& packet, quint64 now, QList<QByteArray>& packetsToSend);
+
+    /// drops the acknowledged packets, grows the window for them and retransmits the ones the mask shows as missing
+    void processAck(quint16 lastInOrderSequence, quint32 receivedAfterMask, quint64 now, RoundTripEstimator& roundTrip,
+                    QList<QByteArray>& packetsToSend);
+
+    /// retransmits the packets whose timeout has run out and sends what the window has room for
+    void processTimeouts(quint64 now, const RoundTripEstimator& roundTrip, QList<QByteArray>& packetsToSend);
+
+    /// the receiver has nothing to go on for this epoch - sends everything not yet acknowledged again in a new one
+    void restartEpoch(quint64 now, QList<QByteArray>& packetsToSend);
+
+    quint32 getEpoch() const { return _epoch; }
+
+    int getNumInFlight() const { return _inFlight.size(); }
+    int getNumWaiting() const { return _waiting.size(); }
+    float getCongestionWindow() const { return _congestionWindow; }
+    int getNumRetransmissions() const { return _numRetransmissions; }
+private:
+    struct SentPacket {
+        QByteArray packet;
+        quint64 lastSentUsecs;
+        int numTransmissions;
+        bool hasBeenFastRetransmitted;
+    };
+
+    void sendWithinWindow(quint64 now, QList<QByteArray>& packetsToSend);
+    void packetAcknowledged(quint16 sequence, const SentPacket& sentPacket, quint64 now, RoundTripEstimator& roundTrip);
+    void shrinkWindowForLoss(quint16 lostSequence, bool wasTimeout);
+
+    ChannelID_t _id;
+    ChannelMode_t _mode;
+    quint32 _epoch;
+    quint16 _nextSequence;
+
+    // sequences wrap, so they are compared with sequenceGreaterThan and never by their order in the map
+    QMap<quint16, SentPacket> _inFlight;
+    QList<QByteArray> _waiting;
+
+    float _congestionWindow;
+    float _slowStartThreshold;
+    quint16 _recoverySequence;
+    bool _isRecovering;
+    int _numRetransmissions;
+};
+
+/// the receiving side of one channel from one node
+class IncomingChannel {
+public:
+    IncomingChannel();
+
+    /// puts the packets that can now be handed on, in order, in deliveredPackets - false for a stale or duplicate one,
+    /// or for one the sender has to send again in a new epoch, which sets shouldRequestReset
+    bool processData(quint32 epoch, quint16 sequence, ChannelMode_t channelMode, const QByteArray& packet,
+                     QList<QByteArray>& deliveredPackets, bool& shouldRequestReset);
+
+    bool hasEpoch() const { return _hasEpoch; }
+    quint32 getEpoch() const { return _epoch; }
+    quint16 getLastInOrderSequence() const { return _nextExpectedSequence - 1; }
+
+    /// bit n is set when the packet n + 2 past the last one received in order has arrived - the one right after it never
+    /// has, or it would be in order too
+    quint32 getReceivedAfterMask() const;
+private:
+    /// starts over at the beginning of the passed epoch
+    void enterEpoch(quint32 epoch);
+
+    quint32 _epoch;
+    bool _hasEpoch;
+    quint32 _resetRequestedEpoch;
+    bool _hasRequestedReset;
+    quint16 _nextExpectedSequence;
+    bool _hasReceived;
+    QMap<quint16, QByteArray> _outOfOrder;
+};
+
+/// every channel to and from one node, and the round trip time they share
+class NodeChannels {
+public:
+    NodeChannels();
+    ~NodeChannels();
+
+    /// fed by ping replies as well as by channel acknowledgements
+    void recordRoundTripSample(quint64 roundTripUsecs);
+    quint64 getSmoothedRoundTripUsecs();
+
+    void queuePacket(ChannelID_t channelID, ChannelMode_t channelMode, const QByteArray& packet,
+                     QList<QByteArray>& packetsToSend);
+
+    /// handles a PacketTypeChannelData packet - the packets it carries that are ready go in deliveredPackets, and the
+    /// acknowledgement for it, if the channel is reliable, in ackPacket - from connectionUUID, or from the NodeList's
+    /// session when that is null
+    void processDataPacket(const QByteArray& channelPacket, QList<QByteArray>& deliveredPackets, QByteArray& ackPacket,
+                           const QUuid& connectionUUID = QUuid());
+
+    /// handles a PacketTypeChannelAck packet
+    void processAckPacket(const QByteArray& ackPacket, QList<QByteArray>& packetsToSend);
+
+    void processTimeouts(QList<QByteArray>& packetsToSend);
+private:
+    // there is nothing to copy the channels to
+    NodeChannels(const NodeChannels&);
+    NodeChannels& operator=(const NodeChannels&);
+
+    QMutex _mutex;
+    RoundTripEstimator _roundTrip;
+    QHash<ChannelID_t, OutgoingChannel*> _outgoingChannels;
+    QHash<ChannelID_t, IncomingChannel*> _incomingChannels;
+};
+
+#endif /* defined(__hifi__NodeChannel__) */
@@ -59,6 +59,16 @@ NodeList* NodeList::getInstance() {
 NodeList::NodeList(char newOwnerType, unsigned short int newSocketListenPort) :
     _nodeHash(),
     _nodeHashMutex(QMutex::Recursive),
+    _nodeSnapshots(),
+    _freeNodeSlots(),
+    _numNodeSlots(0),
+    _isDatagramBatchingEnabled(false),
+    _datagramReceiveBatch(NULL),
+    _datagramSendBatches(),
+    _deliveredChannelPackets(),
+    _trafficStats(),
+    _packetCapture(NULL),
+    _packetReplay(NULL),
     _domainHostname(DEFAULT_DOMAIN_HOSTNAME),
     _domainSockAddr(HifiSockAddr(QHostAddress::Null, DEFAULT_DOMAIN_SERVER_PORT)),
     _nodeSocket(this),
@@ -78,41 +88,47 @@ NodeList::NodeList(char newOwnerType, unsigned short int newSocketListenPort) :
 
 NodeList::~NodeList() {
     clear();
+    delete _datagramReceiveBatch;
+    delete _packetCapture;
 }
 
 bool NodeList::packetVersionAndHashMatch(const QByteArray& packet) {
-    // currently this just checks if the version in the packet matches our return from versionForPacketType
+    // packets with a version other than our return from versionForPacketType are dropped
     // may need to be expanded in the future for types and versions that take > than 1 byte
+    PacketType packetType = packetTypeForPacket(packet);
     
-    if (packet[1] != versionForPacketType(packetTypeForPacket(packet))
-        && packetTypeForPacket(packet) != PacketTypeStunResponse) {
-        PacketType mismatchType = packetTypeForPacket(packet);
+    if (packet[1] != versionForPacketType(packetType) && packetType != PacketTypeStunResponse) {
         int numPacketTypeBytes = arithmeticCodingValueFromBuffer(packet.data());
         
-        qDebug() << "Packet version mismatch on" << packetTypeForPacket(packet) << "- Sender"
+        qDebug() << "Packet version mismatch on" << packetType << "- Sender"
             << uuidFromPacketHeader(packet) << "sent" << qPrintable(QString::number(packet[numPacketTypeBytes])) << "but"
-            << qPrintable(QString::number(versionForPacketType(mismatchType))) << "expected.";
+            << qPrintable(QString::number(versionForPacketType(packetType))) << "expected.";
+        
+        _trafficStats.recordVersionMismatch(packetType);
+        
+        // a different version can have a different header, so nothing after the version can be trusted
+        return false;
     }
     
-    const QSet<PacketType> NON_VERIFIED_PACKETS = QSet<PacketType>() << PacketTypeDomainList
-        << PacketTypeDomainListRequest << PacketTypeStunResponse << PacketTypeDataServerConfirm
-        << PacketTypeDataServerGet << PacketTypeDataServerPut << PacketTypeDataServerSend
-        << PacketTypeCreateAssignment << PacketTypeRequestAssignment;
-    
-    if (!NON_VERIFIED_PACKETS.contains(packetTypeForPacket(packet))) {
+    if (isVerifiedPacketType(packetType)) {
         // figure out which node this is from
         SharedNodePointer sendingNode = sendingNodeForPacket(packet);
         if (sendingNode) {
-            // check if the md5 hash in the header matches the hash we would expect
-            if (hashFromPacketHeader(packet) == hashForPacketAndConnectionUUID(packet, sendingNode->getConnectionSecret())) {
+            // check if the MAC in the header matches the one we would expect
+            if (macFromPacketHeader(packet.constData())
+                == macForPacketAndConnectionSecret(packet.constData(), packet.size(), sendingNode->getConnectionSecret())) {
                 return true;
             } else {
-                qDebug() << "Packet hash mismatch on" << packetTypeForPacket(packet) << "- Sender"
-                    << uuidFromPacketHeader(packet);
+                qDebug() << "Packet MAC mismatch on" << packetType << "- Sender" << uuidFromPacketHeader(packet);
+                
+                _trafficStats.recordHashFailure();
+                sendingNode->getTrafficStats().recordHashFailure();
             }
         } else {
-            qDebug() << "Packet of type" << packetTypeForPacket(packet) << "received from unknown node with UUID"
+            qDebug() << "Packet of type" << packetType << "received from unknown node with UUID"
                 << uuidFromPacketHeader(packet);
+            
+            _trafficStats.recordUnknownSender();
         }
     } else {
         return true;
@@ -123,6 +139,19 @@ bool NodeList::packetVersionAndHashMatch(const QByteArray& packet) {
 
 qint64 NodeList::writeDatagram(const QByteArray& datagram, const SharedNodePointer& destinationNode,
                                const HifiSockAddr& overridenSockAddr) {
+    // the MAC is written into the packet and the caller still holds this one, so it is always copied - senders on a
+    // hot path pass a QByteArray or buffer of their own, which is signed in place
+    QByteArray signedDatagram = datagram;
+    return writeDatagram(signedDatagram, destinationNode, overridenSockAddr);
+}
+
+qint64 NodeList::writeDatagram(QByteArray& datagram, const SharedNodePointer& destinationNode,
+                               const HifiSockAddr& overridenSockAddr) {
+    return writeDatagram(datagram.data(), datagram.size(), destinationNode, overridenSockAddr);
+}
+
+qint64 NodeList::writeDatagram(char* data, qint64 size, const SharedNodePointer& destinationNode,
+                               const HifiSockAddr& overridenSockAddr) {
     if (destinationNode) {
         // if we don't have an ovveriden address, assume they want to send to the node's active socket
         const HifiSockAddr* destinationSockAddr = &overridenSockAddr;
@@ -136,20 +165,306 @@ qint64 NodeList::writeDatagram(const QByteArray& datagram, const SharedNodePoint
             }
         }
         
-        QByteArray datagramCopy = datagram;
-        // setup the MD5 hash for source verification in the header
-        replaceHashInPacketGivenConnectionUUID(datagramCopy, destinationNode->getConnectionSecret());
+        // sign the packet in the caller's buffer for source verification
+        writeMACInPacketGivenConnectionSecret(data, size, destinationNode->getConnectionSecret());
+        
+        _trafficStats.recordOutgoing(packetTypeForPacket(data), size);
+        destinationNode->getTrafficStats().recordOutgoing(size);
+        
+        qint64 bytesWritten;
+        
+        if (_isDatagramBatchingEnabled && !_packetReplay && _datagramSendBatches.hasLocalData()
+            && _datagramSendBatches.localData()->isOpen()) {
+            bytesWritten = _datagramSendBatches.localData()->queueDatagram(_nodeSocket, data, size, *destinationSockAddr);
+        } else {
+            bytesWritten = writeSocketDatagram(data, size, *destinationSockAddr);
+        }
+        
+        if (bytesWritten < 0) {
+            _trafficStats.recordDrop();
+        }
         
-        return _nodeSocket.writeDatagram(datagramCopy, destinationSockAddr->getAddress(), destinationSockAddr->getPort());
+        return bytesWritten;
     }
     
     // didn't have a destinationNode to send to, return 0
     return 0;
 }
 
-qint64 NodeList::writeDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
-                               const HifiSockAddr& overridenSockAddr) {
-    return writeDatagram(QByteArray(data, size), destinationNode, overridenSockAddr);
+qint64 NodeList::writeDatagramOnChannel(const QByteArray& datagram, const SharedNodePointer& destinationNode,
+                                        ChannelID_t channelID, ChannelMode_t channelMode) {
+    // the carried packet is signed, so like writeDatagram this always copies a const QByteArray
+    QByteArray signedDatagram = datagram;
+    return writeDatagramOnChannel(signedDatagram, destinationNode, channelID, channelMode);
+}
+
+qint64 NodeList::writeDatagramOnChannel(QByteArray& datagram, const SharedNodePointer& destinationNode,
+                                        ChannelID_t channelID, ChannelMode_t channelMode) {
+    if (!destinationNode || !destinationNode->getActiveSocket()) {
+        return 0;
+    }
+    
+    if (datagram.size() > maxChannelPayloadBytes()) {
+        // the channel packet would go over MAX_PACKET_SIZE, so this one goes out on its own
+        return writeDatagram(datagram, destinationNode);
+    }
+    
+    // the carried packet is checked like any other once it is delivered, so it is signed as well
+    writeMACInPacketGivenConnectionSecret(datagram.data(), datagram.size(), destinationNode->getConnectionSecret());
+    
+    // the channel packets it goes out in are what count against the node - the carried packet only counts against its
+    // own type, apart from the wire counts
+    _trafficStats.recordOutgoingOnChannel(packetTypeForPacket(datagram), datagram.size());
+    
+    QList<QByteArray> channelPackets;
+    destinationNode->getChannels().queuePacket(channelID, channelMode, datagram, channelPackets);
+    writeChannelPackets(channelPackets, destinationNode);
+    
+    return datagram.size();
+}
+
+void NodeList::writeChannelPackets(QList<QByteArray>& channelPackets, const SharedNodePointer& destinationNode) {
+    for (int i = 0; i < channelPackets.size(); i++) {
+        // sequenced packets are only held here and are signed in place - a reliable packet is also held by its channel
+        // for retransmission, so signing it copies it
+        writeDatagram(channelPackets[i], destinationNode);
+    }
+}
+
+bool NodeList::processChannelPacket(const QByteArray& packet, const HifiSockAddr& senderSockAddr) {
+    PacketType packetType = packetTypeForPacket(packet);
+    
+    if (packetType != PacketTypeChannelData && packetType != PacketTypeChannelAck) {
+        return false;
+    }
+    
+    if (!packetVersionAndHashMatch(packet)) {
+        return true;
+    }
+    
+    SharedNodePointer sendingNode = sendingNodeForPacket(packet);
+    if (!sendingNode) {
+        return true;
+    }
+    
+    if (packetType == PacketTypeChannelData) {
+        QList<QByteArray> deliveredPackets;
+        QByteArray ackPacket;
+        sendingNode->getChannels().processDataPacket(packet, deliveredPackets, ackPacket);
+        
+        if (!ackPacket.isEmpty()) {
+            writeDatagram(ackPacket, sendingNode);
+        }
+        
+        foreach (const QByteArray& deliveredPacket, deliveredPackets) {
+            // the channel packet was counted on the wire, the packet it carried only counts against its own type
+            _trafficStats.recordIncomingOnChannel(packetTypeForPacket(deliveredPacket), deliveredPacket.size());
+            _deliveredChannelPackets.append(qMakePair(senderSockAddr, deliveredPacket));
+        }
+    } else {
+        // an acknowledgement can open the window for packets that were waiting
+        QList<QByteArray> channelPackets;
+        sendingNode->getChannels().processAckPacket(packet, channelPackets);
+        writeChannelPackets(channelPackets, sendingNode);
+    }
+    
+    return true;
+}
+
+bool NodeList::takeDeliveredChannelPacket(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr) {
+    if (_deliveredChannelPackets.isEmpty()) {
+        return false;
+    }
+    
+    QPair<HifiSockAddr, QByteArray> deliveredPacket = _deliveredChannelPackets.takeFirst();
+    senderSockAddr = deliveredPacket.first;
+    destinationByteArray = deliveredPacket.second;
+    return true;
+}
+
+void NodeList::processChannelTimeouts() {
+    {
+        NodeSnapshotPointer nodeSnapshot = getNodeSnapshot();
+        
+        foreach (const SharedNodePointer& node, nodeSnapshot->getNodeHash()) {
+            QList<QByteArray> channelPackets;
+            node->getChannels().processTimeouts(channelPackets);
+            writeChannelPackets(channelPackets, node);
+        }
+    }
+    
+    // otherwise the snapshots retired by the last publish, and any killed nodes only they hold, would wait for the next
+    // publish or silent node pass - skipped when the node hash is busy, since this comes round again shortly
+    if (_nodeHashMutex.tryLock()) {
+        _nodeSnapshots.reclaimRetiredSnapshots();
+        _nodeHashMutex.unlock();
+    }
+}
+
+void NodeList::setDatagramBatchingEnabled(bool isDatagramBatchingEnabled) {
+    if (isDatagramBatchingEnabled && !DatagramReceiveBatch::isSupported()) {
+        qDebug() << "Datagram batching is not supported on this platform, the node socket will be used directly.";
+        return;
+    }
+    
+    if (isDatagramBatchingEnabled && !_datagramReceiveBatch) {
+        _datagramReceiveBatch = new DatagramReceiveBatch();
+    }
+    
+    if (isDatagramBatchingEnabled && !_isDatagramBatchingEnabled) {
+        qDebug() << "Reading and writing node socket datagrams in batches of up to" << MAX_DATAGRAMS_PER_BATCH;
+    }
+    
+    _isDatagramBatchingEnabled = isDatagramBatchingEnabled;
+}
+
+bool NodeList::readDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr) {
+    forever {
+        if (takeDeliveredChannelPacket(destinationByteArray, senderSockAddr)) {
+            return true;
+        }
+        
+        if (!readSocketDatagram(destinationByteArray, senderSockAddr)) {
+            return false;
+        }
+        
+        if (!processChannelPacket(destinationByteArray, senderSockAddr)) {
+            return true;
+        }
+    }
+}
+
+bool NodeList::readSocketDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr) {
+    if (_packetReplay) {
+        if (_packetReplay->readDatagram(destinationByteArray, senderSockAddr)) {
+            recordIncomingDatagram(destinationByteArray);
+            return true;
+        } else {
+            return false;
+        }
+    }
+    
+    bool hasReadDatagram = false;
+    
+    if (_isDatagramBatchingEnabled) {
+        int numTruncatedBefore = _datagramReceiveBatch->getNumTruncatedDatagrams();
+        hasReadDatagram = _datagramReceiveBatch->readDatagram(_nodeSocket, destinationByteArray, senderSockAddr);
+        
+        int numTruncated = _datagramReceiveBatch->getNumTruncatedDatagrams() - numTruncatedBefore;
+        if (numTruncated > 0) {
+            _trafficStats.recordDrop(numTruncated);
+        }
+    } else if (_nodeSocket.hasPendingDatagrams()) {
+        destinationByteArray.resize(_nodeSocket.pendingDatagramSize());
+        _nodeSocket.readDatagram(destinationByteArray.data(), destinationByteArray.size(),
+                                 senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+        hasReadDatagram = true;
+    }
+    
+    if (hasReadDatagram) {
+        recordIncomingDatagram(destinationByteArray);
+        captureDatagram(destinationByteArray, senderSockAddr);
+    }
+    
+    return hasReadDatagram;
+}
+
+qint64 NodeList::writeSocketDatagram(const char* data, qint64 size, const HifiSockAddr& destinationSockAddr) {
+    if (_packetReplay) {
+        // nobody that sent the captured datagrams is listening, so what would have gone out is only counted
+        _packetReplay->recordOutgoing(size);
+        return size;
+    }
+    
+    return _nodeSocket.writeDatagram(data, size, destinationSockAddr.getAddress(), destinationSockAddr.getPort());
+}
+
+bool NodeList::startPacketCapture(const QString& filename) {
+    PacketCaptureWriter* packetCapture = new PacketCaptureWriter();
+    
+    if (!packetCapture->open(filename, _domainSockAddr)) {
+        delete packetCapture;
+        return false;
+    }
+    
+    _packetCapture = packetCapture;
+    return true;
+}
+
+void NodeList::stopPacketCapture() {
+    if (_packetCapture) {
+        qDebug() << "Captured" << _packetCapture->getNumRecorded() << "datagrams.";
+        
+        delete _packetCapture;
+        _packetCapture = NULL;
+    }
+}
+
+void NodeList::recordIncomingDatagram(const QByteArray& datagram) {
+    PacketType packetType = packetTypeForPacket(datagram);
+    _trafficStats.recordIncoming(packetType, datagram.size());
+    
+    // only packets with a MAC carry a sender UUID worth looking up
+    if (isVerifiedPacketType(packetType) && datagram.size() >= numBytesForPacketHeader(datagram)) {
+        SharedNodePointer sendingNode = sendingNodeForPacket(datagram);
+        if (sendingNode) {
+            sendingNode->getTrafficStats().recordIncoming(datagram.size());
+        }
+    }
+}
+
+void NodeList::captureDatagram(const QByteArray& datagram, const HifiSockAddr& senderSockAddr) {
+    if (_packetCapture) {
+        _packetCapture->recordDatagram(datagram, senderSockAddr);
+    }
+}
+
+bool NodeList::startPacketReplay(const QString& filename, float speed) {
+    PacketReplay* packetReplay = new PacketReplay(this);
+    
+    if (!packetReplay->open(filename, speed)) {
+        delete packetReplay;
+        return false;
+    }
+    
+    _packetReplay = packetReplay;
+    
+    // the domain lists in the capture are only taken from the domain server they came from
+    _domainSockAddr = _packetReplay->getDomainSockAddr();
+    
+    return true;
+}
+
+void NodeList::beginDatagramBatch() {
+    if (_isDatagramBatchingEnabled) {
+        if (!_datagramSendBatches.hasLocalData()) {
+            _datagramSendBatches.setLocalData(new DatagramSendBatch());
+        }
+        
+        _datagramSendBatches.localData()->open();
+    }
+}
+
+void NodeList::endDatagramBatch() {
+    if (_datagramSendBatches.hasLocalData()) {
+        _datagramSendBatches.localData()->close(_nodeSocket);
+    }
+}
+
+QJsonObject NodeList::getTrafficStatsJSON() {
+    QJsonObject trafficJSON = _trafficStats.toJSON();
+    
+    QJsonObject nodesJSON;
+    NodeSnapshotPointer nodeSnapshot = getNodeSnapshot();
+    
+    foreach (const SharedNodePointer& node, nodeSnapshot->getNodeHash()) {
+        QJsonObject nodeJSON = node->getTrafficStats().toJSON();
+        nodeJSON["type"] = NodeType::getNodeTypeName(node->getType());
+        nodesJSON[uuidStringWithoutCurlyBraces(node->getUUID())] = nodeJSON;
+    }
+    
+    trafficJSON["nodes"] = nodesJSON;
+    return trafficJSON;
 }
 
 void NodeList::setDomainHostname(const QString& domainHostname) {
@@ -204,6 +519,11 @@ void NodeList::timePingReply(const QByteArray& packet, const SharedNodePointer&
     sendingNode->setPingMs(pingTime / 1000);
     sendingNode->setClockSkewUsec(clockSkew);
     
+    // the channels to this node time their retransmits from the same round trip estimate
+    if (pingTime > 0) {
+        sendingNode->getChannels().recordRoundTripSample(pingTime);
+    }
+    
     const bool wantDebug = false;
     
     if (wantDebug) {
@@ -287,8 +607,7 @@ int NodeList::findNodeAndUpdateWithDataFromPacket(const QByteArray& packet) {
 }
 
 SharedNodePointer NodeList::nodeWithUUID(const QUuid& nodeUUID) {
-    QMutexLocker locker(&_nodeHashMutex);
-    return _nodeHash.value(nodeUUID);
+    return getNodeSnapshot()->nodeWithUUID(nodeUUID);
 }
 
 SharedNodePointer NodeList::sendingNodeForPacket(const QByteArray& packet) {
@@ -299,8 +618,11 @@ SharedNodePointer NodeList::sendingNodeForPacket(const QByteArray& packet) {
 }
 
 NodeHash NodeList::getNodeHash() {
-    QMutexLocker locker(&_nodeHashMutex);
-    return NodeHash(_nodeHash);
+    return getNodeSnapshot()->getNodeHash();
+}
+
+void NodeList::publishNodeSnapshot() {
+    _nodeSnapshots.publish(_nodeHash, _numNodeSlots);
 }
 
 void NodeList::clear() {
@@ -374,8 +696,7 @@ void NodeList::sendSTUNRequest() {
         qDebug("Sending intial stun request to %s", stunSockAddr.getAddress().toString().toLocal8Bit().constData());
     }
 
-    _nodeSocket.writeDatagram((char*) stunRequestPacket, sizeof(stunRequestPacket),
-                              stunSockAddr.getAddress(), stunSockAddr.getPort());
+    writeSocketDatagram((char*) stunRequestPacket, sizeof(stunRequestPacket), stunSockAddr);
 
     _stunRequestsSinceSuccess++;
 
@@ -483,7 +804,14 @@ void NodeList::killNodeWithUUID(const QUuid& nodeUUID) {
 NodeHash::iterator NodeList::killNodeAtHashIterator(NodeHash::iterator& nodeItemToKill) {
     qDebug() << "Killed" << *nodeItemToKill.value();
     emit nodeKilled(nodeItemToKill.value());
-    return _nodeHash.erase(nodeItemToKill);
+
+    // the slot can go to the next node that is added, the nodeKilled handlers are done with it
+    _freeNodeSlots.append(nodeItemToKill.value()->getSlot());
+
+    NodeHash::iterator nextNodeItem = _nodeHash.erase(nodeItemToKill);
+    publishNodeSnapshot();
+
+    return nextNodeItem;
 }
 
 void NodeList::processKillNode(const QByteArray& dataByteArray) {
@@ -544,7 +872,8 @@ void NodeList::sendDomainServerCheckIn() {
             packetStream << nodeTypeOfInterest;
         }
         
-        _nodeSocket.writeDatagram(domainServerPacket, _domainSockAddr.getAddress(), _domainSockAddr.getPort());
+        _trafficStats.recordOutgoing(packetTypeForPacket(domainServerPacket), domainServerPacket.size());
+        writeSocketDatagram(domainServerPacket.constData(), domainServerPacket.size(), _domainSockAddr);
         const int NUM_DOMAIN_SERVER_CHECKINS_PER_STUN_REQUEST = 5;
         static unsigned int numDomainCheckins = 0;
 
@@ -630,7 +959,8 @@ void NodeList::sendAssignment(Assignment& assignment) {
         ? &DEFAULT_ASSIGNMENT_SOCKET
         : &_assignmentServerSocket;
 
-    _nodeSocket.writeDatagram(packet, assignmentServerSocket->getAddress(), assignmentServerSocket->getPort());
+    _trafficStats.recordOutgoing(packetTypeForPacket(packet), packet.size());
+    writeSocketDatagram(packet.constData(), packet.size(), *assignmentServerSocket);
 }
 
 QByteArray NodeList::constructPingPacket(PingType_t pingType) {
@@ -682,8 +1012,16 @@ SharedNodePointer NodeList::addOrUpdateNode(const QUuid& uuid, char nodeType,
         // we didn't have this node, so add them
         Node* newNode = new Node(uuid, nodeType, publicSocket, localSocket);
         SharedNodePointer newNodeSharedPointer(newNode, &QObject::deleteLater);
+
+        if (_freeNodeSlots.isEmpty()) {
+            newNode->setSlot(_numNodeSlots++);
+        } else {
+            newNode->setSlot(_freeNodeSlots.last());
+            _freeNodeSlots.pop_back();
+        }
         
         _nodeHash.insert(newNode->getUUID(), newNodeSharedPointer);
+        publishNodeSnapshot();
         
         _nodeHashMutex.unlock();
         
@@ -723,10 +1061,13 @@ SharedNodePointer NodeList::addOrUpdateNode(const QUuid& uuid, char nodeType,
 unsigned NodeList::broadcastToNodes(const QByteArray& packet, const NodeSet& destinationNodeTypes) {
     unsigned n = 0;
 
+    // every node's MAC is written into the same copy of the packet, so it is copied at most once
+    QByteArray signedPacket = packet;
+
     foreach (const SharedNodePointer& node, getNodeHash()) {
         // only send to the NodeTypes we are asked to send to.
         if (destinationNodeTypes.contains(node->getType())) {
-            writeDatagram(packet, node);
+            writeDatagram(signedPacket, node);
             ++n;
         }
     }
@@ -734,6 +1075,24 @@ unsigned NodeList::broadcastToNodes(const QByteArray& packet, const NodeSet& des
     return n;
 }
 
+unsigned NodeList::broadcastToNodesOnChannel(const QByteArray& packet, const NodeSet& destinationNodeTypes,
+                                             ChannelID_t channelID, ChannelMode_t channelMode) {
+    unsigned n = 0;
+    
+    // the channel copies the carried packet into its own, so one copy is signed for every node in turn
+    QByteArray signedPacket = packet;
+    
+    foreach (const SharedNodePointer& node, getNodeHash()) {
+        // only send to the NodeTypes we are asked to send to.
+        if (destinationNodeTypes.contains(node->getType())) {
+            writeDatagramOnChannel(signedPacket, node, channelID, channelMode);
+            ++n;
+        }
+    }
+    
+    return n;
+}
+
 void NodeList::pingInactiveNodes() {
     foreach (const SharedNodePointer& node, getNodeHash()) {
         if (!node->getActiveSocket()) {
@@ -793,6 +1152,9 @@ void NodeList::removeSilentNodes() {
         
         node->getMutex().unlock();
     }
+
+    // snapshots retired since the last pass are usually unreferenced by now, and the nodes only they held can go
+    _nodeSnapshots.reclaimRetiredSnapshots();
     
     _nodeHashMutex.unlock();
 }
@@ -21,14 +21,21 @@
 #include <unistd.h> // not on windows, not needed for mac or windows
 #endif
 
+#include <QtCore/QJsonObject>
 #include <QtCore/QMutex>
+#include <QtCore/QPair>
 #include <QtCore/QSet>
 #include <QtCore/QSettings>
 #include <QtCore/QSharedPointer>
+#include <QtCore/QThreadStorage>
 #include <QtNetwork/QHostAddress>
 #include <QtNetwork/QUdpSocket>
 
+#include "DatagramBatch.h"
 #include "Node.h"
+#include "NodeSnapshot.h"
+#include "PacketCapture.h"
+#include "TrafficStats.h"
 
 const quint64 NODE_SILENCE_THRESHOLD_USECS = 2 * 1000 * 1000;
 const quint64 DOMAIN_SERVER_CHECK_IN_USECS = 1 * 1000000;
@@ -48,8 +55,6 @@ class HifiSockAddr;
 
 typedef QSet<NodeType_t> NodeSet;
 
-typedef QSharedPointer<Node> SharedNodePointer;
-typedef QHash<QUuid, SharedNodePointer> NodeHash;
 Q_DECLARE_METATYPE(SharedNodePointer)
 
 typedef quint8 PingType_t;
@@ -84,15 +89,77 @@ public:
     
     bool packetVersionAndHashMatch(const QByteArray& packet);
     
+    /// copies the datagram to sign it, since the caller still holds it
     qint64 writeDatagram(const QByteArray& datagram, const SharedNodePointer& destinationNode,
                          const HifiSockAddr& overridenSockAddr = HifiSockAddr());
-    qint64 writeDatagram(const char* data, qint64 size, const SharedNodePointer& destinationNode,
+
+    /// signs the datagram in place before sending it, so it is not copied unless its data is shared
+    qint64 writeDatagram(QByteArray& datagram, const SharedNodePointer& destinationNode,
+                         const HifiSockAddr& overridenSockAddr = HifiSockAddr());
+
+    /// signs the packet in the caller's buffer before sending it
+    qint64 writeDatagram(char* data, qint64 size, const SharedNodePointer& destinationNode,
                          const HifiSockAddr& overridenSockAddr = HifiSockAddr());
 
+    /// sends the packet on one of the destination node's channels - numbered so stale and duplicate packets are dropped,
+    /// and on a reliable channel acknowledged, retransmitted and held to the channel's congestion window
+    qint64 writeDatagramOnChannel(const QByteArray& datagram, const SharedNodePointer& destinationNode,
+                                  ChannelID_t channelID, ChannelMode_t channelMode);
+
+    /// signs the carried datagram in place, so it is not copied unless its data is shared
+    qint64 writeDatagramOnChannel(QByteArray& datagram, const SharedNodePointer& destinationNode,
+                                  ChannelID_t channelID, ChannelMode_t channelMode);
+
+    /// moves datagrams through the node socket in batches (recvmmsg/sendmmsg) where the platform supports it
+    void setDatagramBatchingEnabled(bool isDatagramBatchingEnabled);
+    bool isDatagramBatchingEnabled() const { return _isDatagramBatchingEnabled; }
+
+    /// reads the next datagram from the node socket, a batch at a time when batching is enabled - false once drained.
+    /// Channel packets are handled on the way, and the packets they carry are handed out in their place
+    bool readDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
+
+    /// handles a channel data or acknowledgement packet read from somewhere other than readDatagram - false when the
+    /// packet is not a channel packet, and should be processed as it is
+    bool processChannelPacket(const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+
+    /// the next packet delivered by a channel, in the order the channel delivered it - to be called from the thread
+    /// that reads the node socket
+    bool takeDeliveredChannelPacket(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
+
+    /// while a batch is open on the calling thread, datagrams written from it are queued and sent together when it ends
+    void beginDatagramBatch();
+    void endDatagramBatch();
+
+    /// packets and bytes through the node socket by packet type. A packet carried on a channel is counted as channel
+    /// data and then again under its own type, on both ends
+    TrafficStats& getTrafficStats() { return _trafficStats; }
+
+    /// the traffic by packet type along with the traffic to and from each current node, for the stats endpoints
+    QJsonObject getTrafficStatsJSON();
+
+    /// writes every datagram read from the node socket to a capture file, with its sender and when it came in
+    bool startPacketCapture(const QString& filename);
+    void stopPacketCapture();
+
+    /// counts a datagram read from the node socket against its packet type and sending node - readDatagram does this
+    /// itself, anything else that reads the socket calls it once per datagram. Safe to call from any thread
+    void recordIncomingDatagram(const QByteArray& datagram);
+
+    /// for whatever reads the node socket without going through readDatagram, so the capture has those datagrams too
+    void captureDatagram(const QByteArray& datagram, const HifiSockAddr& senderSockAddr);
+
+    /// reads the datagrams of a capture file in place of the node socket, and counts what is written instead of sending
+    /// it - the domain server the capture was made against stands in for the real one
+    bool startPacketReplay(const QString& filename, float speed);
+    PacketReplay* getPacketReplay() const { return _packetReplay; }
+
     void(*linkedDataCreateCallback)(Node *);
 
+    /// the current nodes, without locking or copying the node hash - hold the pointer for as long as the nodes are used
+    NodeSnapshotPointer getNodeSnapshot() const { return _nodeSnapshots.acquire(); }
+
     NodeHash getNodeHash();
-    int size() const { return _nodeHash.size(); }
+    int size() const { return getNodeSnapshot()->getNodeHash().size(); }
 
     int getNumNoReplyDomainCheckIns() const { return _numNoReplyDomainCheckIns; }
 
@@ -124,6 +191,8 @@ public:
     int findNodeAndUpdateWithDataFromPacket(const QByteArray& packet);
 
     unsigned broadcastToNodes(const QByteArray& packet, const NodeSet& destinationNodeTypes);
+    unsigned broadcastToNodesOnChannel(const QByteArray& packet, const NodeSet& destinationNodeTypes,
+                                       ChannelID_t channelID, ChannelMode_t channelMode);
     SharedNodePointer soloNodeOfType(char nodeType);
 
     void loadData(QSettings* settings);
@@ -133,6 +202,10 @@ public slots:
     void pingInactiveNodes();
     void removeSilentNodes();
     
+    /// retransmits the reliable channel packets whose timeout has run out, and frees the retired node snapshots nothing
+    /// holds any more - run every CHANNEL_TIMEOUT_CHECK_INTERVAL_MSECS
+    void processChannelTimeouts();
+    
     void killNodeWithUUID(const QUuid& nodeUUID);
 signals:
     void domainChanged(const QString& domainHostname);
@@ -151,8 +224,25 @@ private:
 
     NodeHash::iterator killNodeAtHashIterator(NodeHash::iterator& nodeItemToKill);
 
+    /// makes the node hash as it is now the snapshot readers see - called with the node hash mutex held
+    void publishNodeSnapshot();
+
+    bool readSocketDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
+    qint64 writeSocketDatagram(const char* data, qint64 size, const HifiSockAddr& destinationSockAddr);
+    void writeChannelPackets(QList<QByteArray>& channelPackets, const SharedNodePointer& destinationNode);
+
     NodeHash _nodeHash;
     QMutex _nodeHashMutex;
+    NodeSnapshotRegistry _nodeSnapshots;
+    QVector<int> _freeNodeSlots;
+    int _numNodeSlots;
+    bool _isDatagramBatchingEnabled;
+    DatagramReceiveBatch* _datagramReceiveBatch;
+    QThreadStorage<DatagramSendBatch*> _datagramSendBatches;
+    QList<QPair<HifiSockAddr, QByteArray> > _deliveredChannelPackets;
+    TrafficStats _trafficStats;
+    PacketCaptureWriter* _packetCapture;
+    PacketReplay* _packetReplay;
     QString _domainHostname;
     HifiSockAddr _domainSockAddr;
     QUdpSocket _nodeSocket;
@@ -0,0 +1,185 @@
+//
+//  NodeSnapshot.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <QtCore/QThreadStorage>
+
+#include "Node.h"
+
+#include "NodeSnapshot.h"
+
+// the snapshot each reader thread is about to take a reference to, if any
+static QAtomicPointer<NodeSnapshot> readerHazards[MAX_NODE_SNAPSHOT_READER_THREADS];
+
+// set while a thread owns the hazard slot at the same index
+static QAtomicInt readerHazardOwners[MAX_NODE_SNAPSHOT_READER_THREADS];
+
+/// the hazard slot a thread claimed the first time it read a snapshot, given back when the thread exits
+class NodeSnapshotReaderSlot {
+public:
+    NodeSnapshotReaderSlot(int index) : _index(index) {}
+    ~NodeSnapshotReaderSlot() {
+        if (_index >= 0) {
+            readerHazards[_index].storeRelease(NULL);
+            readerHazardOwners[_index].storeRelease(0);
+        }
+    }
+
+    QAtomicPointer<NodeSnapshot>* getHazard() const { return _index >= 0 ? &readerHazards[_index] : NULL; }
+private:
+    int _index;
+};
+
+static QThreadStorage<NodeSnapshotReaderSlot*> readerSlots;
+
+static QAtomicPointer<NodeSnapshot>* hazardForCurrentThread() {
+    if (!readerSlots.hasLocalData()) {
+        int claimedIndex = -1;
+
+        for (int i = 0; i < MAX_NODE_SNAPSHOT_READER_THREADS; i++) {
+            if (readerHazardOwners[i].testAndSetOrdered(0, 1)) {
+                claimedIndex = i;
+                break;
+            }
+        }
+
+        if (claimedIndex < 0) {
+            qDebug() << "All" << MAX_NODE_SNAPSHOT_READER_THREADS
+                << "node snapshot hazard slots are taken, this thread will read snapshots under a lock.";
+        }
+
+        // a thread that found no free slot keeps an empty one, so it does not look again on every read
+        readerSlots.setLocalData(new NodeSnapshotReaderSlot(claimedIndex));
+    }
+
+    return readerSlots.localData()->getHazard();
+}
+
+NodeSnapshot::NodeSnapshot(const NodeHash& nodeHash, int numSlots) :
+    _nodeHash(nodeHash),
+    _nodesBySlot(numSlots),
+    _referenceCount(1)
+{
+    for (NodeHash::const_iterator node = _nodeHash.constBegin(); node != _nodeHash.constEnd(); node++) {
+        _nodesBySlot[node.value()->getSlot()] = node.value();
+    }
+}
+
+NodeSnapshotPointer::NodeSnapshotPointer() :
+    _snapshot(NULL)
+{
+}
+
+NodeSnapshotPointer::NodeSnapshotPointer(const NodeSnapshotPointer& otherPointer) :
+    _snapshot(otherPointer._snapshot)
+{
+    if (_snapshot) {
+        _snapshot->_referenceCount.ref();
+    }
+}
+
+NodeSnapshotPointer::~NodeSnapshotPointer() {
+    // the registry deletes snapshots once they are unreferenced, a pointer only ever gives its reference back
+    if (_snapshot) {
+        _snapshot->_referenceCount.deref();
+    }
+}
+
+NodeSnapshotPointer& NodeSnapshotPointer::operator=(const NodeSnapshotPointer& otherPointer) {
+    if (otherPointer._snapshot) {
+        otherPointer._snapshot->_referenceCount.ref();
+    }
+
+    if (_snapshot) {
+        _snapshot->_referenceCount.deref();
+    }
+
+    _snapshot = otherPointer._snapshot;
+    return *this;
+}
+
+NodeSnapshotRegistry::NodeSnapshotRegistry() :
+    _currentSnapshot(new NodeSnapshot(NodeHash(), 0)),
+    _retiredSnapshots(),
+    _fallbackMutex()
+{
+}
+
+NodeSnapshotRegistry::~NodeSnapshotRegistry() {
+    delete _currentSnapshot.load();
+
+    foreach (NodeSnapshot* retiredSnapshot, _retiredSnapshots) {
+        delete retiredSnapshot;
+    }
+}
+
+NodeSnapshotPointer NodeSnapshotRegistry::acquire() const {
+    QAtomicPointer<NodeSnapshot>* hazard = hazardForCurrentThread();
+
+    if (!hazard) {
+        QMutexLocker locker(&_fallbackMutex);
+        NodeSnapshot* snapshot = _currentSnapshot.loadAcquire();
+        snapshot->_referenceCount.ref();
+        return NodeSnapshotPointer(snapshot);
+    }
+
+    // announce the snapshot before taking a reference, and check it is still current once the announcement is visible
+    // - if it is, the writer has not retired it yet and will see the announcement before it tries to delete it
+    NodeSnapshot* snapshot = _currentSnapshot.loadAcquire();
+
+    forever {
+        hazard->fetchAndStoreOrdered(snapshot);
+
+        NodeSnapshot* currentSnapshot = _currentSnapshot.loadAcquire();
+        if (currentSnapshot == snapshot) {
+            break;
+        }
+
+        snapshot = currentSnapshot;
+    }
+
+    snapshot->_referenceCount.ref();
+    hazard->storeRelease(NULL);
+
+    return NodeSnapshotPointer(snapshot);
+}
+
+void NodeSnapshotRegistry::publish(const NodeHash& nodeHash, int numSlots) {
+    NodeSnapshot* replacedSnapshot = _currentSnapshot.fetchAndStoreOrdered(new NodeSnapshot(nodeHash, numSlots));
+
+    // give back the reference the registry held on the snapshot while it was current
+    replacedSnapshot->_referenceCount.deref();
+    _retiredSnapshots.append(replacedSnapshot);
+
+    reclaimRetiredSnapshots();
+}
+
+void NodeSnapshotRegistry::reclaimRetiredSnapshots() {
+    // hold the lock readers without a hazard slot take, so none of them is between loading and referencing a snapshot
+    QMutexLocker locker(&_fallbackMutex);
+
+    for (int i = _retiredSnapshots.size() - 1; i >= 0; i--) {
+        NodeSnapshot* retiredSnapshot = _retiredSnapshots[i];
+
+        // the announcements have to be checked before the reference count - a reader that announced the snapshot
+        // references it before it clears its announcement, so if the announcement is gone the reference is visible
+        if (!isAnnouncedByReader(retiredSnapshot) && retiredSnapshot->_referenceCount.loadAcquire() == 0) {
+            delete retiredSnapshot;
+            _retiredSnapshots.remove(i);
+        }
+    }
+}
+
+bool NodeSnapshotRegistry::isAnnouncedByReader(const NodeSnapshot* snapshot) const {
+    for (int i = 0; i < MAX_NODE_SNAPSHOT_READER_THREADS; i++) {
+        if (readerHazards[i].loadAcquire() == snapshot) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,104 @@
+//
+//  NodeSnapshot.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  Immutable snapshots of the node list. The NodeList publishes a new snapshot whenever a node is added or killed,
+//  and readers pick up the current one without taking a lock or copying anything.
+//
+//  A reader announces the snapshot it is about to take a reference to in a per-thread hazard slot, so the writer
+//  never deletes a retired snapshot between the reader loading the pointer and taking its reference. Retired
+//  snapshots are deleted by the writer once they are neither referenced nor announced.
+//
+
+#ifndef __hifi__NodeSnapshot__
+#define __hifi__NodeSnapshot__
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QUuid>
+#include <QtCore/QVector>
+
+class Node;
+
+typedef QSharedPointer<Node> SharedNodePointer;
+typedef QHash<QUuid, SharedNodePointer> NodeHash;
+
+/// the most threads that can hold a hazard slot at once - any more fall back to taking the writer's lock
+const int MAX_NODE_SNAPSHOT_READER_THREADS = 64;
+
+/// the nodes in the node list at one point in time, by UUID and by dense slot
+class NodeSnapshot {
+public:
+    NodeSnapshot(const NodeHash& nodeHash, int numSlots);
+
+    const NodeHash& getNodeHash() const { return _nodeHash; }
+
+    /// the number of slots in use or free - every node's slot is below this
+    int getNumSlots() const { return _nodesBySlot.size(); }
+
+    /// the node in the passed slot, or a null pointer if that slot is free in this snapshot
+    const SharedNodePointer& nodeInSlot(int slot) const { return _nodesBySlot[slot]; }
+
+    SharedNodePointer nodeWithUUID(const QUuid& nodeUUID) const { return _nodeHash.value(nodeUUID); }
+private:
+    friend class NodeSnapshotPointer;
+    friend class NodeSnapshotRegistry;
+
+    NodeHash _nodeHash;
+    QVector<SharedNodePointer> _nodesBySlot;
+    mutable QAtomicInt _referenceCount;
+};
+
+/// a reference to a snapshot, which stays valid for as long as the pointer is held
+class NodeSnapshotPointer {
+public:
+    NodeSnapshotPointer();
+    NodeSnapshotPointer(const NodeSnapshotPointer& otherPointer);
+    ~NodeSnapshotPointer();
+
+    NodeSnapshotPointer& operator=(const NodeSnapshotPointer& otherPointer);
+
+    const NodeSnapshot* operator->() const { return _snapshot; }
+    const NodeSnapshot& operator*() const { return *_snapshot; }
+    bool isNull() const { return _snapshot == NULL; }
+private:
+    friend class NodeSnapshotRegistry;
+
+    /// takes over a reference the registry already added
+    explicit NodeSnapshotPointer(const NodeSnapshot* snapshot) : _snapshot(snapshot) {}
+
+    const NodeSnapshot* _snapshot;
+};
+
+/// publishes snapshots to lock-free readers - calls to publish and reclaimRetiredSnapshots must be serialized
+class NodeSnapshotRegistry {
+public:
+    NodeSnapshotRegistry();
+    ~NodeSnapshotRegistry();
+
+    /// the current snapshot, without taking a lock unless this thread could not get a hazard slot
+    NodeSnapshotPointer acquire() const;
+
+    /// makes a snapshot of the passed nodes the current one, and retires the one it replaces
+    void publish(const NodeHash& nodeHash, int numSlots);
+
+    /// deletes the retired snapshots that no reader holds or is about to take
+    void reclaimRetiredSnapshots();
+private:
+    NodeSnapshotRegistry(const NodeSnapshotRegistry&);
+    NodeSnapshotRegistry& operator=(const NodeSnapshotRegistry&);
+
+    bool isAnnouncedByReader(const NodeSnapshot* snapshot) const;
+
+    QAtomicPointer<NodeSnapshot> _currentSnapshot;
+    QVector<NodeSnapshot*> _retiredSnapshots;
+    mutable QMutex _fallbackMutex;
+};
+
+#endif /* defined(__hifi__NodeSnapshot__) */
@@ -0,0 +1,191 @@
+//
+//  PacketCapture.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <cstring>
+
+#include <QtCore/QDebug>
+#include <QtCore/QTimer>
+
+#include "SharedUtil.h"
+
+#include "PacketCapture.h"
+
+PacketCaptureWriter::PacketCaptureWriter() :
+    _mutex(),
+    _file(),
+    _stream(),
+    _startUsecs(0),
+    _numRecorded(0)
+{
+    
+}
+
+bool PacketCaptureWriter::open(const QString& filename, const HifiSockAddr& domainSockAddr) {
+    _file.setFileName(filename);
+    
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qDebug() << "Could not open" << filename << "to capture packets to -" << _file.errorString();
+        return false;
+    }
+    
+    _stream.setDevice(&_file);
+    _stream.writeRawData(PACKET_CAPTURE_MAGIC, sizeof(PACKET_CAPTURE_MAGIC));
+    _stream << PACKET_CAPTURE_VERSION << domainSockAddr;
+    
+    _startUsecs = usecTimestampNow();
+    
+    qDebug() << "Capturing the packets read from the node socket to" << filename;
+    return true;
+}
+
+void PacketCaptureWriter::recordDatagram(const QByteArray& datagram, const HifiSockAddr& senderSockAddr) {
+    QMutexLocker locker(&_mutex);
+    
+    if (!_file.isOpen()) {
+        return;
+    }
+    
+    _stream << usecTimestampNow() - _startUsecs << senderSockAddr << datagram;
+    _numRecorded++;
+}
+
+PacketCaptureReader::PacketCaptureReader() :
+    _file(),
+    _stream(),
+    _domainSockAddr()
+{
+    
+}
+
+bool PacketCaptureReader::open(const QString& filename) {
+    _file.setFileName(filename);
+    
+    if (!_file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Could not open the packet capture" << filename << "-" << _file.errorString();
+        return false;
+    }
+    
+    _stream.setDevice(&_file);
+    
+    char magic[sizeof(PACKET_CAPTURE_MAGIC)];
+    quint8 version = 0;
+    
+    if (_stream.readRawData(magic, sizeof(magic)) != sizeof(magic)
+        || memcmp(magic, PACKET_CAPTURE_MAGIC, sizeof(magic)) != 0) {
+        qDebug() << filename << "is not a packet capture.";
+        return false;
+    }
+    
+    _stream >> version;
+    
+    if (version != PACKET_CAPTURE_VERSION) {
+        qDebug() << "The packet capture" << filename << "is version" << version << "but only version"
+            << PACKET_CAPTURE_VERSION << "can be replayed.";
+        return false;
+    }
+    
+    _stream >> _domainSockAddr;
+    
+    return _stream.status() == QDataStream::Ok;
+}
+
+bool PacketCaptureReader::readNext(CapturedDatagram& capturedDatagram) {
+    if (!_file.isOpen() || _stream.atEnd()) {
+        return false;
+    }
+    
+    _stream >> capturedDatagram.usecsSinceCaptureStart >> capturedDatagram.senderSockAddr >> capturedDatagram.datagram;
+    
+    if (_stream.status() != QDataStream::Ok) {
+        // a capture that was cut short by the assignment being killed ends part way into a record
+        qDebug() << "The packet capture ends part way into a datagram, stopping there.";
+        return false;
+    }
+    
+    return true;
+}
+
+PacketReplay::PacketReplay(QObject* parent) :
+    QObject(parent),
+    _reader(),
+    _nextDatagram(),
+    _hasNextDatagram(false),
+    _hasFinished(false),
+    _speed(1.0f),
+    _startUsecs(0),
+    _numReadSinceDue(0),
+    _dueTimer(new QTimer(this)),
+    _numReplayed(0),
+    _packetsOut(),
+    _bytesOut()
+{
+    _dueTimer->setSingleShot(true);
+    connect(_dueTimer, &QTimer::timeout, this, &PacketReplay::datagramsDue);
+}
+
+bool PacketReplay::open(const QString& filename, float speed) {
+    if (!_reader.open(filename)) {
+        return false;
+    }
+    
+    _speed = speed;
+    _hasNextDatagram = _reader.readNext(_nextDatagram);
+    
+    qDebug() << "Replaying" << filename << (_speed > 0.0f ? QString("at %1x").arg(_speed) : QString("as fast as it is read"));
+    return true;
+}
+
+bool PacketReplay::isDue(quint64 now) const {
+    return _speed <= 0.0f || now - _startUsecs >= _nextDatagram.usecsSinceCaptureStart / _speed;
+}
+
+bool PacketReplay::readDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr) {
+    if (!_hasNextDatagram) {
+        if (!_hasFinished) {
+            _hasFinished = true;
+            emit finished();
+        }
+        
+        return false;
+    }
+    
+    quint64 now = usecTimestampNow();
+    
+    if (_startUsecs == 0) {
+        // the capture's clock starts with the first read, not with the replay being opened
+        _startUsecs = now;
+    }
+    
+    if (_numReadSinceDue >= MAX_REPLAY_DATAGRAMS_PER_READ || !isDue(now)) {
+        _numReadSinceDue = 0;
+        
+        int msecsUntilDue = 0;
+        
+        if (!isDue(now)) {
+            quint64 usecsUntilDue = _nextDatagram.usecsSinceCaptureStart / _speed - (now - _startUsecs);
+            msecsUntilDue = (usecsUntilDue + USECS_PER_MSEC - 1) / USECS_PER_MSEC;
+        }
+        
+        _dueTimer->start(msecsUntilDue);
+        return false;
+    }
+    
+    destinationByteArray = _nextDatagram.datagram;
+    senderSockAddr = _nextDatagram.senderSockAddr;
+    
+    _numReplayed++;
+    _numReadSinceDue++;
+    
+    _hasNextDatagram = _reader.readNext(_nextDatagram);
+    
+    return true;
+}
+
+quint64 PacketReplay::getElapsedUsecs() const {
+    return _startUsecs == 0 ? 0 : usecTimestampNow() - _startUsecs;
+}
@@ -0,0 +1,116 @@
+//
+//  PacketCapture.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  A capture is every datagram an assignment read from its node socket, with who sent it and when it came in. Fed
+//  back through the NodeList in place of the socket, it puts an assignment under the same load again without any of
+//  the clients that made it - at the speed it was captured, faster, or as fast as the assignment can take it.
+//
+
+#ifndef __hifi__PacketCapture__
+#define __hifi__PacketCapture__
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+
+#include "HifiSockAddr.h"
+#include "TrafficStats.h"
+
+class QTimer;
+
+/// a capture file starts with these, then the domain server the capture was made against
+const char PACKET_CAPTURE_MAGIC[] = "HFCAPTURE";
+const quint8 PACKET_CAPTURE_VERSION = 1;
+
+/// a replay hands out no more than this many datagrams before it lets the event loop run again
+const int MAX_REPLAY_DATAGRAMS_PER_READ = 1000;
+
+/// one datagram from a capture
+struct CapturedDatagram {
+    quint64 usecsSinceCaptureStart;
+    HifiSockAddr senderSockAddr;
+    QByteArray datagram;
+};
+
+/// writes the datagrams read from the node socket to a capture file - from any thread
+class PacketCaptureWriter {
+public:
+    PacketCaptureWriter();
+
+    bool open(const QString& filename, const HifiSockAddr& domainSockAddr);
+    void recordDatagram(const QByteArray& datagram, const HifiSockAddr& senderSockAddr);
+
+    int getNumRecorded() const { return _numRecorded; }
+private:
+    QMutex _mutex;
+    QFile _file;
+    QDataStream _stream;
+    quint64 _startUsecs;
+    int _numRecorded;
+};
+
+/// reads a capture file back
+class PacketCaptureReader {
+public:
+    PacketCaptureReader();
+
+    bool open(const QString& filename);
+    const HifiSockAddr& getDomainSockAddr() const { return _domainSockAddr; }
+
+    /// false at the end of the capture
+    bool readNext(CapturedDatagram& capturedDatagram);
+private:
+    QFile _file;
+    QDataStream _stream;
+    HifiSockAddr _domainSockAddr;
+};
+
+/// hands out the datagrams of a capture as their time comes round, and counts what is sent back in reply
+class PacketReplay : public QObject {
+    Q_OBJECT
+public:
+    PacketReplay(QObject* parent = 0);
+
+    /// speed 2 replays the capture twice as fast as it was made, 0 as fast as the datagrams are read
+    bool open(const QString& filename, float speed);
+    const HifiSockAddr& getDomainSockAddr() const { return _reader.getDomainSockAddr(); }
+
+    /// the next datagram that is due - false when none is due yet, with datagramsDue to follow when one is
+    bool readDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
+
+    /// counts a datagram the assignment sent, which goes nowhere - from any thread
+    void recordOutgoing(qint64 numBytes) { _packetsOut.add(1); _bytesOut.add(numBytes); }
+
+    int getNumReplayed() const { return _numReplayed; }
+    quint64 getPacketsOut() const { return _packetsOut.getTotal(); }
+    quint64 getBytesOut() const { return _bytesOut.getTotal(); }
+    quint64 getElapsedUsecs() const;
+signals:
+    void datagramsDue();
+
+    /// emitted once the last datagram has been read
+    void finished();
+private:
+    bool isDue(quint64 now) const;
+
+    PacketCaptureReader _reader;
+    CapturedDatagram _nextDatagram;
+    bool _hasNextDatagram;
+    bool _hasFinished;
+    float _speed;
+    quint64 _startUsecs;
+    int _numReadSinceDue;
+    QTimer* _dueTimer;
+
+    int _numReplayed;
+    TrafficCounter _packetsOut;
+    TrafficCounter _bytesOut;
+};
+
+#endif /* defined(__hifi__PacketCapture__) */
@@ -8,9 +8,13 @@
 
 #include <math.h>
 
+#include <QtCore/QCryptographicHash>
 #include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
 
 #include "NodeList.h"
+#include "SharedUtil.h"
+#include "SipHash.h"
 
 #include "PacketHeaders.h"
 
@@ -42,10 +46,17 @@ int packArithmeticallyCodedValue(int value, char* destination) {
     }
 }
 
-PacketVersion versionForPacketType(PacketType type) {
+// every packet type moves up a version with a change to the header, which is in front of every packet
+// (the 8 byte MAC was the first one)
+const PacketVersion HEADER_VERSION = 1;
+
+PacketVersion dataVersionForPacketType(PacketType type) {
     switch (type) {
         case PacketTypeParticleData:
             return 1;
+        case PacketTypeAvatarData:
+        case PacketTypeBulkAvatarData:
+            return 2;
         case PacketTypeDomainList:
         case PacketTypeDomainListRequest:
             return 1;
@@ -57,11 +68,29 @@ PacketVersion versionForPacketType(PacketType type) {
         case PacketTypeDataServerConfirm:
         case PacketTypeDataServerSend:
             return 1;
+        case PacketTypeOctreeStats:
+            return 1;
+        case PacketTypeVoxelQuery:
+        case PacketTypeParticleQuery:
+            return 2;
+        case PacketTypeMicrophoneAudioNoEcho:
+        case PacketTypeMicrophoneAudioWithEcho:
+        case PacketTypeInjectAudio:
+        case PacketTypeMixedAudio:
+        case PacketTypeSilentAudioFrame:
+            return 1;
+        case PacketTypeChannelData:
+        case PacketTypeChannelAck:
+            return 1;
         default:
             return 0;
     }
 }
 
+PacketVersion versionForPacketType(PacketType type) {
+    return HEADER_VERSION + dataVersionForPacketType(type);
+}
+
 QByteArray byteArrayWithPopluatedHeader(PacketType type, const QUuid& connectionUUID) {
     QByteArray freshByteArray(MAX_PACKET_HEADER_BYTES, 0);
     freshByteArray.resize(populatePacketHeader(freshByteArray, type, connectionUUID));
@@ -88,9 +117,9 @@ int populatePacketHeader(char* packet, PacketType type, const QUuid& connectionU
     memcpy(position, rfcUUID.constData(), NUM_BYTES_RFC4122_UUID);
     position += NUM_BYTES_RFC4122_UUID;
     
-    // pack 16 bytes of zeros where the md5 hash will be placed one data is packed
-    memset(position, 0, NUM_BYTES_MD5_HASH);
-    position += NUM_BYTES_MD5_HASH;
+    // pack zeros where the MAC will be placed once data is packed
+    memset(position, 0, NUM_BYTES_PACKET_MAC);
+    position += NUM_BYTES_PACKET_MAC;
     
     // return the number of bytes written for pointer pushing
     return position - packet;
@@ -115,18 +144,121 @@ QUuid uuidFromPacketHeader(const QByteArray& packet) {
                                          NUM_BYTES_RFC4122_UUID));
 }
 
-QByteArray hashFromPacketHeader(const QByteArray& packet) {
-    return packet.mid(numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH);
+bool isVerifiedPacketType(PacketType type) {
+    switch (type) {
+        case PacketTypeDomainList:
+        case PacketTypeDomainListRequest:
+        case PacketTypeStunResponse:
+        case PacketTypeDataServerConfirm:
+        case PacketTypeDataServerGet:
+        case PacketTypeDataServerPut:
+        case PacketTypeDataServerSend:
+        case PacketTypeCreateAssignment:
+        case PacketTypeRequestAssignment:
+            return false;
+        default:
+            return true;
+    }
+}
+
+quint64 macFromPacketHeader(const char* packet) {
+    quint64 mac;
+    memcpy(&mac, packet + numBytesForPacketHeader(packet) - NUM_BYTES_PACKET_MAC, NUM_BYTES_PACKET_MAC);
+    return mac;
+}
+
+quint64 macForPacketAndConnectionSecret(const char* packet, int numPacketBytes, const QUuid& connectionSecret) {
+    int numHeaderBytes = numBytesForPacketHeader(packet);
+    return sipHash24(sipHashKeyForUUID(connectionSecret), packet + numHeaderBytes, numPacketBytes - numHeaderBytes);
 }
 
-QByteArray hashForPacketAndConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID) {
-    return QCryptographicHash::hash(packet.mid(numBytesForPacketHeader(packet)) + connectionUUID.toRfc4122(),
-                                    QCryptographicHash::Md5);
+void writeMACInPacketGivenConnectionSecret(char* packet, int numPacketBytes, const QUuid& connectionSecret) {
+    quint64 mac = macForPacketAndConnectionSecret(packet, numPacketBytes, connectionSecret);
+    memcpy(packet + numBytesForPacketHeader(packet) - NUM_BYTES_PACKET_MAC, &mac, NUM_BYTES_PACKET_MAC);
 }
 
-void replaceHashInPacketGivenConnectionUUID(QByteArray& packet, const QUuid& connectionUUID) {
-    packet.replace(numBytesForPacketHeader(packet) - NUM_BYTES_MD5_HASH, NUM_BYTES_MD5_HASH,
-                   hashForPacketAndConnectionUUID(packet, connectionUUID));
+void benchmarkPacketHeaders() {
+    const int NUM_ITERATIONS = 100000;
+    const int PACKET_SIZES[] = { 64, 512, MAX_PACKET_SIZE };
+    const int NUM_PACKET_SIZES = sizeof(PACKET_SIZES) / sizeof(PACKET_SIZES[0]);
+
+    QUuid connectionSecret = QUuid::createUuid();
+    QUuid senderUUID = QUuid::createUuid();
+
+    char packet[MAX_PACKET_SIZE];
+    memset(packet, 0, sizeof(packet));
+
+    QElapsedTimer benchmarkTimer;
+    benchmarkTimer.start();
+
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        populatePacketHeader(packet, PacketTypeMixedAudio, senderUUID);
+    }
+
+    qDebug("Packet header benchmark: populating a header took %.1f ns.",
+           (float) benchmarkTimer.nsecsElapsed() / NUM_ITERATIONS);
+
+    // the checksum keeps the compiler from dropping the loops whose results are otherwise unused
+    quint64 checksum = 0;
+
+    for (int i = 0; i < NUM_PACKET_SIZES; i++) {
+        int numPacketBytes = PACKET_SIZES[i];
+
+        for (int j = numBytesForPacketHeader(packet); j < numPacketBytes; j++) {
+            packet[j] = (char) (j * 31);
+        }
+
+        // the old header cost - copy the packet, hash the payload and secret with MD5 and replace the hash in the copy
+        QByteArray datagram(packet, numPacketBytes);
+        benchmarkTimer.restart();
+
+        for (int j = 0; j < NUM_ITERATIONS; j++) {
+            QByteArray datagramCopy = datagram;
+            datagramCopy.replace(numBytesForPacketHeader(datagramCopy) - NUM_BYTES_PACKET_MAC, NUM_BYTES_PACKET_MAC,
+                                 QCryptographicHash::hash(datagramCopy.mid(numBytesForPacketHeader(datagramCopy))
+                                                          + connectionSecret.toRfc4122(),
+                                                          QCryptographicHash::Md5).left(NUM_BYTES_PACKET_MAC));
+            checksum += datagramCopy[numPacketBytes - 1];
+        }
+
+        qint64 md5Nsecs = benchmarkTimer.nsecsElapsed();
+        benchmarkTimer.restart();
+
+        for (int j = 0; j < NUM_ITERATIONS; j++) {
+            writeMACInPacketGivenConnectionSecret(packet, numPacketBytes, connectionSecret);
+            checksum += macFromPacketHeader(packet);
+        }
+
+        qint64 signNsecs = benchmarkTimer.nsecsElapsed();
+        benchmarkTimer.restart();
+
+        // what NodeList::writeDatagram costs for a const QByteArray, which it has to copy before signing
+        for (int j = 0; j < NUM_ITERATIONS; j++) {
+            QByteArray datagramCopy = datagram;
+            writeMACInPacketGivenConnectionSecret(datagramCopy.data(), numPacketBytes, connectionSecret);
+            checksum += macFromPacketHeader(datagramCopy.constData());
+        }
+
+        qint64 copyAndSignNsecs = benchmarkTimer.nsecsElapsed();
+        benchmarkTimer.restart();
+
+        int numVerified = 0;
+        for (int j = 0; j < NUM_ITERATIONS; j++) {
+            if (macFromPacketHeader(packet) == macForPacketAndConnectionSecret(packet, numPacketBytes, connectionSecret)) {
+                numVerified++;
+            }
+        }
+
+        qint64 verifyNsecs = benchmarkTimer.nsecsElapsed();
+
+        qDebug("Packet header benchmark: %d byte packets - MD5 copy and sign %.1f ns, SipHash sign in place %.1f ns,"
+               " SipHash copy and sign %.1f ns, SipHash verify %.1f ns (%d of %d verified).", numPacketBytes,
+               (float) md5Nsecs / NUM_ITERATIONS, (float) signNsecs / NUM_ITERATIONS,
+               (float) copyAndSignNsecs / NUM_ITERATIONS, (float) verifyNsecs / NUM_ITERATIONS,
+               numVerified, NUM_ITERATIONS);
+    }
+
+    qDebug() << "Packet header benchmark checksum" << checksum;
 }
 
 PacketType packetTypeForPacket(const QByteArray& packet) {
@@ -12,7 +12,6 @@
 #ifndef hifi_PacketHeaders_h
 #define hifi_PacketHeaders_h
 
-#include <QtCore/QCryptographicHash>
 #include <QtCore/QUuid>
 
 #include "UUID.h"
@@ -53,17 +52,23 @@ enum PacketType {
     PacketTypeParticleErase,
     PacketTypeParticleAddResponse,
     PacketTypeMetavoxelData,
-    PacketTypeAvatarIdentity
+    PacketTypeAvatarIdentity,
+    PacketTypeSilentAudioFrame,
+    PacketTypeChannelData,
+    PacketTypeChannelAck
 };
 
 typedef char PacketVersion;
 
-const int NUM_BYTES_MD5_HASH = 16;
-const int NUM_STATIC_HEADER_BYTES = sizeof(PacketVersion) + NUM_BYTES_RFC4122_UUID + NUM_BYTES_MD5_HASH;
+const int NUM_BYTES_PACKET_MAC = sizeof(quint64);
+const int NUM_STATIC_HEADER_BYTES = sizeof(PacketVersion) + NUM_BYTES_RFC4122_UUID + NUM_BYTES_PACKET_MAC;
 const int MAX_PACKET_HEADER_BYTES = sizeof(PacketType) + NUM_STATIC_HEADER_BYTES;
 
 PacketVersion versionForPacketType(PacketType type);
 
+/// the version of what follows the header of a packet of this type, which is all an SVO file keeps of it
+PacketVersion dataVersionForPacketType(PacketType type);
+
 const QUuid nullUUID = QUuid();
 
 QByteArray byteArrayWithPopluatedHeader(PacketType type, const QUuid& connectionUUID = nullUUID);
@@ -76,9 +81,18 @@ int numBytesForPacketHeaderGivenPacketType(PacketType type);
 
 QUuid uuidFromPacketHeader(const QByteArray& packet);
 
-QByteArray hashFromPacketHeader(const QByteArray& packet);
-QByteArray hashForPacketAndConnectionUUID(const QByteArray& packet, const QUuid& connectionUUID);
-void replaceHashInPacketGivenConnectionUUID(QByteArray& packet, const QUuid& connectionUUID);
+/// false for the packets that are sent before there is a connection secret to sign them with
+bool isVerifiedPacketType(PacketType type);
+
+/// the SipHash of everything after the header, keyed with the connection secret
+quint64 macFromPacketHeader(const char* packet);
+quint64 macForPacketAndConnectionSecret(const char* packet, int numPacketBytes, const QUuid& connectionSecret);
+
+/// signs the packet by writing its MAC into its own header
+void writeMACInPacketGivenConnectionSecret(char* packet, int numPacketBytes, const QUuid& connectionSecret);
+
+/// times packing a header and signing and verifying packets of a few sizes, and logs the cost per packet
+void benchmarkPacketHeaders();
 
 PacketType packetTypeForPacket(const QByteArray& packet);
 PacketType packetTypeForPacket(const char* packet);
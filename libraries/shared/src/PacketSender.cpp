@@ -24,14 +24,26 @@ const int PacketSender::MAX_SLEEP_INTERVAL = PacketSender::USECS_PER_SECOND;
 const int PacketSender::DEFAULT_PACKETS_PER_SECOND = 30;
 const int PacketSender::MINIMUM_PACKETS_PER_SECOND = 1;
 const int PacketSender::MINIMAL_SLEEP_INTERVAL = (USECS_PER_SECOND / TARGET_FPS) / 2;
+const int PacketSender::UNLIMITED_PACKETS_PER_NODE = 0;
 
 const int AVERAGE_CALL_TIME_SAMPLES = 10;
 
+// a node's token bucket holds about one frame's worth of packets, so a backlog for it goes out over the frames that
+// follow rather than in one burst
+const quint64 NODE_TOKEN_BUCKET_USECS = PacketSender::USECS_PER_SECOND / PacketSender::TARGET_FPS;
+
 PacketSender::PacketSender(int packetsPerSecond) :
     _packetsPerSecond(packetsPerSecond),
     _usecsPerProcessCallHint(0),
     _lastProcessCallTime(0),
     _averageProcessCallTime(AVERAGE_CALL_TIME_SAMPLES),
+    _channelID(ChannelID::None),
+    _channelMode(ChannelMode::UnreliableSequenced),
+    _nodeSendQueues(),
+    _lastNodeSentTo(),
+    _numPacketsToSend(0),
+    _packetsPerSecondPerNode(0),
+    _maxPacketsPerNode(UNLIMITED_PACKETS_PER_NODE),
     _lastSendTime(0), // Note: we set this to 0 to indicate we haven't yet sent something
     _lastPPSCheck(0),
     _packetsOverCheckInterval(0),
@@ -39,7 +51,8 @@ PacketSender::PacketSender(int packetsPerSecond) :
     _totalPacketsSent(0),
     _totalBytesSent(0),
     _totalPacketsQueued(0),
-    _totalBytesQueued(0)
+    _totalBytesQueued(0),
+    _totalPacketsDropped(0)
 {
 }
 
@@ -48,10 +61,42 @@ PacketSender::~PacketSender() {
 
 
 void PacketSender::queuePacketForSending(const SharedNodePointer& destinationNode, const QByteArray& packet) {
-    NetworkPacket networkPacket(destinationNode, packet);
     lock();
-    _packets.push_back(networkPacket);
+
+    QMap<QUuid, NodeSendQueue>::iterator sendQueue = _nodeSendQueues.find(destinationNode->getUUID());
+    if (sendQueue == _nodeSendQueues.end()) {
+        // a new node starts with a full bucket, as if it had been idle for as long as the bucket takes to fill
+        NodeSendQueue newSendQueue;
+        newSendQueue.numPackets = 0;
+        newSendQueue.tokens = 0.0f;
+        newSendQueue.lastRefill = usecTimestampNow() - NODE_TOKEN_BUCKET_USECS;
+        sendQueue = _nodeSendQueues.insert(destinationNode->getUUID(), newSendQueue);
+    } else if (sendQueue->node != destinationNode) {
+        // the node came back as a new Node before its old queue was let go of - the waiting packets go to the new one
+        sendQueue->node->getTrafficStats().addToSendQueueDepth(-sendQueue->numPackets);
+        destinationNode->getTrafficStats().addToSendQueueDepth(sendQueue->numPackets);
+    }
+    sendQueue->node = destinationNode;
+
+    if (_maxPacketsPerNode != UNLIMITED_PACKETS_PER_NODE && sendQueue->numPackets >= _maxPacketsPerNode) {
+        // make room by dropping the oldest packet
+        sendQueue->packets.removeFirst();
+        sendQueue->numPackets--;
+        _numPacketsToSend--;
+
+        _totalPacketsDropped++;
+        NodeList::getInstance()->getTrafficStats().recordDrop();
+        destinationNode->getTrafficStats().addToSendQueueDepth(-1);
+        destinationNode->getTrafficStats().recordSendQueueDrop();
+    }
+
+    sendQueue->packets.append(packet);
+    sendQueue->numPackets++;
+    _numPacketsToSend++;
+    destinationNode->getTrafficStats().addToSendQueueDepth(1);
+
     unlock();
+
     _totalPacketsQueued++;
     _totalBytesQueued += packet.size();
 }
@@ -62,6 +107,12 @@ void PacketSender::setPacketsPerSecond(int packetsPerSecond) {
 
 
 bool PacketSender::process() {
+    // an empty queue still holds on to its node, so departed nodes are let go of even when there is nothing to send -
+    // once a pass, since it looks every queue's node up in the node list
+    lock();
+    removeDepartedNodes();
+    unlock();
+
     if (isThreaded()) {
         return threadedProcess();
     }
@@ -77,7 +128,7 @@ bool PacketSender::threadedProcess() {
     }
 
     // in threaded mode, we keep running and just empty our packet queue sleeping enough to keep our PPS on target
-    while (_packets.size() > 0) {
+    while (_numPacketsToSend > 0) {
         // Recalculate our SEND_INTERVAL_USECS each time, in case the caller has changed it on us..
         int packetsPerSecondTarget = (_packetsPerSecond > MINIMUM_PACKETS_PER_SECOND)
                                             ? _packetsPerSecond : MINIMUM_PACKETS_PER_SECOND;
@@ -102,11 +153,18 @@ bool PacketSender::threadedProcess() {
         }
 
         // call our non-threaded version of ourselves
+        quint64 packetsSentBefore = _totalPacketsSent;
         bool keepRunning = nonThreadedProcess();
 
         if (!keepRunning) {
             break;
         }
+
+        if (_totalPacketsSent == packetsSentBefore) {
+            // every node with packets waiting is out of tokens - give them time to refill instead of spinning
+            usleep(sleepInterval);
+            hasSlept = true;
+        }
     }
 
     // if threaded and we haven't slept? We want to sleep a little so we don't hog the CPU, but
@@ -155,7 +213,7 @@ bool PacketSender::nonThreadedProcess() {
         averageCallTime = _usecsPerProcessCallHint;
     }
 
-    if (_packets.size() == 0) {
+    if (_numPacketsToSend == 0) {
         // in non-threaded mode, if there's nothing to do, just return, keep running till they terminate us
         return isStillRunning();
     }
@@ -251,27 +309,106 @@ bool PacketSender::nonThreadedProcess() {
         }
     }
 
-    int packetsLeft = _packets.size();
+    // Now that we know how many packets to send this call to process, send them as the node token buckets allow.
+    while (packetsSentThisCall < packetsToSendThisCall) {
+        SharedNodePointer destinationNode;
+        QByteArray packet;
 
-    // Now that we know how many packets to send this call to process, just send them.
-    while ((packetsSentThisCall < packetsToSendThisCall) && (packetsLeft > 0)) {
         lock();
-        NetworkPacket& packet = _packets.front();
-        NetworkPacket temporary = packet; // make a copy
-        _packets.erase(_packets.begin());
-        packetsLeft = _packets.size();
+        bool hasPacket = takeNextPacket(now, destinationNode, packet);
         unlock();
 
+        if (!hasPacket) {
+            break;
+        }
+
         // send the packet through the NodeList...
-        NodeList::getInstance()->writeDatagram(temporary.getByteArray(), temporary.getDestinationNode());
+        if (_channelID != ChannelID::None) {
+            NodeList::getInstance()->writeDatagramOnChannel(packet, destinationNode, _channelID, _channelMode);
+        } else {
+            NodeList::getInstance()->writeDatagram(packet, destinationNode);
+        }
         packetsSentThisCall++;
         _packetsOverCheckInterval++;
         _totalPacketsSent++;
-        _totalBytesSent += temporary.getByteArray().size();
+        _totalBytesSent += packet.size();
         
-        emit packetSent(temporary.getByteArray().size());
+        emit packetSent(packet.size());
         
         _lastSendTime = now;
     }
+
     return isStillRunning();
-}
\ No newline at end of file
+}
+
+bool PacketSender::takeNextPacket(quint64 now, SharedNodePointer& destinationNode, QByteArray& packet) {
+    if (_nodeSendQueues.isEmpty()) {
+        return false;
+    }
+
+    // the nodes take turns, starting with the one after the node sent to last
+    QMap<QUuid, NodeSendQueue>::iterator sendQueue = _nodeSendQueues.upperBound(_lastNodeSentTo);
+
+    for (int i = 0; i < _nodeSendQueues.size(); i++, ++sendQueue) {
+        if (sendQueue == _nodeSendQueues.end()) {
+            sendQueue = _nodeSendQueues.begin();
+        }
+
+        if (sendQueue->packets.isEmpty()) {
+            continue;
+        }
+
+        refillTokens(*sendQueue, now);
+        if (sendQueue->tokens < 1.0f) {
+            continue;
+        }
+
+        sendQueue->tokens -= 1.0f;
+        packet = sendQueue->packets.takeFirst();
+        sendQueue->numPackets--;
+        _numPacketsToSend--;
+        sendQueue->node->getTrafficStats().addToSendQueueDepth(-1);
+
+        destinationNode = sendQueue->node;
+        _lastNodeSentTo = sendQueue.key();
+        return true;
+    }
+
+    return false;
+}
+
+void PacketSender::refillTokens(NodeSendQueue& sendQueue, quint64 now) {
+    if (now <= sendQueue.lastRefill) {
+        return;
+    }
+
+    int packetsPerSecond = (_packetsPerSecondPerNode > 0) ? _packetsPerSecondPerNode : _packetsPerSecond;
+    packetsPerSecond = std::max(packetsPerSecond, MINIMUM_PACKETS_PER_SECOND);
+
+    // the bucket always holds at least one packet, or a slow rate could never send anything
+    float maxTokens = std::max(1.0f, (float) packetsPerSecond * NODE_TOKEN_BUCKET_USECS / USECS_PER_SECOND);
+
+    sendQueue.tokens = std::min(maxTokens,
+                                sendQueue.tokens + (float) packetsPerSecond * (now - sendQueue.lastRefill) / USECS_PER_SECOND);
+    sendQueue.lastRefill = now;
+}
+
+void PacketSender::removeDepartedNodes() {
+    QMap<QUuid, NodeSendQueue>::iterator sendQueue = _nodeSendQueues.begin();
+    while (sendQueue != _nodeSendQueues.end()) {
+        if (NodeList::getInstance()->nodeWithUUID(sendQueue.key()) != sendQueue->node) {
+            // the node has left, or come back as a new node - what is still waiting would go to a socket nobody is
+            // listening on, and holding it would keep the departed node alive
+            if (sendQueue->numPackets > 0) {
+                _numPacketsToSend -= sendQueue->numPackets;
+                _totalPacketsDropped += sendQueue->numPackets;
+                NodeList::getInstance()->getTrafficStats().recordDrop(sendQueue->numPackets);
+                sendQueue->node->getTrafficStats().addToSendQueueDepth(-sendQueue->numPackets);
+            }
+
+            sendQueue = _nodeSendQueues.erase(sendQueue);
+        } else {
+            ++sendQueue;
+        }
+    }
+}
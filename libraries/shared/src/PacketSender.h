@@ -7,10 +7,19 @@
 //
 //  Threaded or non-threaded packet sender.
 //
+//  Packets wait in a queue per destination node, and go out to each node in the order they were queued. Each
+//  process() call sends as many packets as the sender's rate allows, letting the nodes take turns. Each node also has a
+//  token bucket that refills at the per node rate and holds about a frame of packets, so one node's burst goes out
+//  paced instead of in one lump, and a node that has used up its tokens does not hold up the others.
+//
 
 #ifndef __shared__PacketSender__
 #define __shared__PacketSender__
 
+#include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QUuid>
+
 #include "GenericThread.h"
 #include "NetworkPacket.h"
 #include "NodeList.h"
@@ -29,6 +38,7 @@ public:
     static const int DEFAULT_PACKETS_PER_SECOND;
     static const int MINIMUM_PACKETS_PER_SECOND;
     static const int MINIMAL_SLEEP_INTERVAL;
+    static const int UNLIMITED_PACKETS_PER_NODE;
 
     PacketSender(int packetsPerSecond = DEFAULT_PACKETS_PER_SECOND);
     ~PacketSender();
@@ -43,13 +53,25 @@ public:
     void setPacketsPerSecond(int packetsPerSecond);
     int getPacketsPerSecond() const { return _packetsPerSecond; }
 
+    /// the rate each node's token bucket refills at - 0, the default, gives each node the whole packets per second
+    void setPacketsPerSecondPerNode(int packetsPerSecondPerNode) { _packetsPerSecondPerNode = packetsPerSecondPerNode; }
+    int getPacketsPerSecondPerNode() const { return _packetsPerSecondPerNode; }
+
+    /// how many packets can wait for one node before the oldest is dropped - by default there is no limit
+    void setMaxPacketsPerNode(int maxPacketsPerNode) { _maxPacketsPerNode = maxPacketsPerNode; }
+    int getMaxPacketsPerNode() const { return _maxPacketsPerNode; }
+
+    /// sends the queued packets on a channel to each node instead of on their own - ChannelID::None for no channel
+    void setChannel(ChannelID_t channelID, ChannelMode_t channelMode) { _channelID = channelID; _channelMode = channelMode; }
+    ChannelID_t getChannelID() const { return _channelID; }
+
     virtual bool process();
 
     /// are there packets waiting in the send queue to be sent
-    bool hasPacketsToSend() const { return _packets.size() > 0; }
+    bool hasPacketsToSend() const { return _numPacketsToSend > 0; }
 
     /// how many packets are there in the send queue waiting to be sent
-    int packetsToSendCount() const { return _packets.size(); }
+    int packetsToSendCount() const { return _numPacketsToSend; }
 
     /// If you're running in non-threaded mode, call this to give us a hint as to how frequently you will call process.
     /// This has no effect in threaded mode. This is only considered a hint in non-threaded mode.
@@ -89,6 +111,9 @@ public:
 
     /// returns the total bytes queued by this object over its lifetime
     quint64 getLifetimeBytesQueued() const { return _totalBytesQueued; }
+
+    /// returns the total packets dropped from full node queues by this object over its lifetime
+    quint64 getLifetimePacketsDropped() const { return _totalPacketsDropped; }
 signals:
     void packetSent(quint64);
 protected:
@@ -96,14 +121,39 @@ protected:
     int _usecsPerProcessCallHint;
     quint64 _lastProcessCallTime;
     SimpleMovingAverage _averageProcessCallTime;
+    ChannelID_t _channelID;
+    ChannelMode_t _channelMode;
 
 private:
-    std::vector<NetworkPacket> _packets;
-    quint64 _lastSendTime;
+    /// the packets waiting for one node, oldest first, and the tokens it has to send them with
+    struct NodeSendQueue {
+        SharedNodePointer node;
+        QList<QByteArray> packets;
+        int numPackets;
+        float tokens;
+        quint64 lastRefill;
+    };
 
     bool threadedProcess();
     bool nonThreadedProcess();
 
+    /// takes the next packet to send, if any node with one waiting has a token for it - call with the lock held
+    bool takeNextPacket(quint64 now, SharedNodePointer& destinationNode, QByteArray& packet);
+
+    /// tops up the token bucket for the time since it was last topped up
+    void refillTokens(NodeSendQueue& sendQueue, quint64 now);
+
+    /// forgets the nodes that have left the NodeList, dropping any packets still waiting for them - call with the lock
+    /// held
+    void removeDepartedNodes();
+
+    QMap<QUuid, NodeSendQueue> _nodeSendQueues;
+    QUuid _lastNodeSentTo;
+    int _numPacketsToSend;
+    int _packetsPerSecondPerNode;
+    int _maxPacketsPerNode;
+    quint64 _lastSendTime;
+
     quint64 _lastPPSCheck;
     int _packetsOverCheckInterval;
 
@@ -113,6 +163,7 @@ private:
 
     quint64 _totalPacketsQueued;
     quint64 _totalBytesQueued;
+    quint64 _totalPacketsDropped;
 };
 
 #endif // __shared__PacketSender__
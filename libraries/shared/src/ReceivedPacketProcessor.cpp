@@ -8,40 +8,98 @@
 //  Threaded or non-threaded packet receiver.
 //
 
+#include <cstring>
+
 #include "NodeList.h"
 #include "ReceivedPacketProcessor.h"
 #include "SharedUtil.h"
 
-ReceivedPacketProcessor::ReceivedPacketProcessor() {
-    _dontSleep = false;
+ReceivedPacketProcessor::ReceivedPacketProcessor() :
+    _dontSleep(false),
+    _ringHead(0),
+    _numRingPackets(0),
+    _overflowPackets(),
+    _numPacketsToProcess(0),
+    _bufferAllocations(0),
+    _bufferAllocationStatsStarted(usecTimestampNow())
+{
 }
 
 void ReceivedPacketProcessor::queueReceivedPacket(const SharedNodePointer& destinationNode, const QByteArray& packet) {
     // Make sure our Node and NodeList knows we've heard from this node.
     destinationNode->setLastHeardMicrostamp(usecTimestampNow());
 
-    NetworkPacket networkPacket(destinationNode, packet);
     lock();
-    _packets.push_back(networkPacket);
+    if (_overflowPackets.isEmpty() && _numRingPackets < RECEIVED_PACKET_BUFFER_COUNT) {
+        ReceivedPacket& ringPacket = _ringPackets[(_ringHead + _numRingPackets) % RECEIVED_PACKET_BUFFER_COUNT];
+        copyIntoBuffer(ringPacket.packet, packet);
+        ringPacket.sendingNode = destinationNode;
+        _numRingPackets++;
+    } else {
+        ReceivedPacket overflowPacket = { destinationNode, packet };
+        _overflowPackets.append(overflowPacket);
+        _bufferAllocations.fetchAndAddRelaxed(1);
+    }
+    _numPacketsToProcess++;
     unlock();
 }
 
+void ReceivedPacketProcessor::copyIntoBuffer(QByteArray& buffer, const QByteArray& packet) {
+    if (!buffer.isDetached() || buffer.capacity() < MAX_PACKET_SIZE) {
+        // writing to the buffer would allocate anyways, so give it a block of its own at the full size right away
+        buffer = QByteArray();
+        buffer.reserve(MAX_PACKET_SIZE);
+        _bufferAllocations.fetchAndAddRelaxed(1);
+    }
+
+    buffer.resize(packet.size());
+    memcpy(buffer.data(), packet.constData(), packet.size());
+}
+
 bool ReceivedPacketProcessor::process() {
 
     // If a derived class handles process sleeping, like the JurisdiciontListener, then it can set
     // this _dontSleep member and we will honor that request.
-    if (_packets.size() == 0 && !_dontSleep) {
+    if (_numPacketsToProcess == 0 && !_dontSleep) {
         const quint64 RECEIVED_THREAD_SLEEP_INTERVAL = (1000 * 1000)/60; // check at 60fps
         usleep(RECEIVED_THREAD_SLEEP_INTERVAL);
     }
-    while (_packets.size() > 0) {
 
+    forever {
         lock(); // lock to make sure nothing changes on us
-        NetworkPacket& packet = _packets.front(); // get the oldest packet
-        NetworkPacket temporary = packet; // make a copy of the packet in case the vector is resized on us
-        _packets.erase(_packets.begin()); // remove the oldest packet
-        unlock(); // let others add to the packets
-        processPacket(temporary.getDestinationNode(), temporary.getByteArray()); // process our temporary copy
+
+        if (_numRingPackets > 0) {
+            // the oldest packet stays in its buffer while it is processed - nothing is queued into it until it is released
+            ReceivedPacket& ringPacket = _ringPackets[_ringHead];
+            unlock(); // let others add to the packets
+            processPacket(ringPacket.sendingNode, ringPacket.packet);
+
+            lock();
+            ringPacket.sendingNode.clear();
+            _ringHead = (_ringHead + 1) % RECEIVED_PACKET_BUFFER_COUNT;
+            _numRingPackets--;
+            _numPacketsToProcess--;
+            unlock();
+        } else if (!_overflowPackets.isEmpty()) {
+            ReceivedPacket overflowPacket = _overflowPackets.takeFirst();
+            _numPacketsToProcess--;
+            unlock();
+            processPacket(overflowPacket.sendingNode, overflowPacket.packet);
+        } else {
+            unlock();
+            break;
+        }
     }
     return isStillRunning();  // keep running till they terminate us
 }
+
+float ReceivedPacketProcessor::getBufferAllocationsPerSecond() const {
+    const float USECS_PER_SECOND = 1000.0f * 1000.0f;
+    float secondsSinceReset = (usecTimestampNow() - _bufferAllocationStatsStarted) / USECS_PER_SECOND;
+    return (secondsSinceReset > 0.0f) ? _bufferAllocations.load() / secondsSinceReset : 0.0f;
+}
+
+void ReceivedPacketProcessor::resetBufferAllocationStats() {
+    _bufferAllocations.store(0);
+    _bufferAllocationStatsStarted = usecTimestampNow();
+}
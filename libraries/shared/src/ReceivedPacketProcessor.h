@@ -7,12 +7,24 @@
 //
 //  Threaded or non-threaded received packet processor.
 //
+//  Received packets are copied into a fixed ring of buffers that are each allocated once, at the size of the largest
+//  packet, and reused for every packet after that. Processing a packet hands the processor the buffer it sits in, so
+//  nothing is allocated between the packet being received and it being processed. A processor that keeps a copy of a
+//  packet shares the buffer, and the buffer is replaced rather than overwritten the next time round.
+//
 
 #ifndef __shared__ReceivedPacketProcessor__
 #define __shared__ReceivedPacketProcessor__
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+
 #include "GenericThread.h"
-#include "NetworkPacket.h"
+#include "NodeList.h"
+
+/// how many received packets can wait in the ring of buffers - past that they wait in a list, which allocates
+const int RECEIVED_PACKET_BUFFER_COUNT = 256;
 
 /// Generalized threaded processor for handling received inbound packets. 
 class ReceivedPacketProcessor : public GenericThread {
@@ -27,10 +39,21 @@ public:
     void queueReceivedPacket(const SharedNodePointer& destinationNode, const QByteArray& packet);
 
     /// Are there received packets waiting to be processed
-    bool hasPacketsToProcess() const { return _packets.size() > 0; }
+    bool hasPacketsToProcess() const { return _numPacketsToProcess > 0; }
 
     /// How many received packets waiting are to be processed
-    int packetsToProcessCount() const { return _packets.size(); }
+    int packetsToProcessCount() const { return _numPacketsToProcess; }
+
+    /// how many times a packet buffer was allocated between receiving and processing packets since the stats were reset
+    quint64 getBufferAllocations() const { return _bufferAllocations.load(); }
+
+    /// the buffer allocations per second since the stats were reset - 0 once every buffer is in use and none is kept
+    float getBufferAllocationsPerSecond() const;
+
+    /// counts an allocation the receiving thread had to make to read a packet, before it was queued here
+    void recordBufferAllocation() { _bufferAllocations.fetchAndAddRelaxed(1); }
+
+    void resetBufferAllocationStats();
 
 protected:
     /// Callback for processing of recieved packets. Implement this to process the incoming packets.
@@ -46,8 +69,26 @@ protected:
     bool _dontSleep;
 
 private:
+    struct ReceivedPacket {
+        SharedNodePointer sendingNode;
+        QByteArray packet;
+    };
+
+    /// copies the packet into a ring buffer, replacing the buffer first if it is new or still shared
+    void copyIntoBuffer(QByteArray& buffer, const QByteArray& packet);
+
+    ReceivedPacket _ringPackets[RECEIVED_PACKET_BUFFER_COUNT];
+    int _ringHead;
+    int _numRingPackets;
+
+    // packets that arrive while the ring is full, or while any are still in here, so they stay in order
+    QList<ReceivedPacket> _overflowPackets;
+
+    int _numPacketsToProcess;
 
-    std::vector<NetworkPacket> _packets;
+    // counted by the receiving thread and read and reset by the stats page, outside the lock
+    QAtomicInt _bufferAllocations;
+    quint64 _bufferAllocationStatsStarted;
 };
 
 #endif // __shared__PacketReceiver__
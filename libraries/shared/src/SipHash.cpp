@@ -0,0 +1,86 @@
+//
+//  SipHash.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <QtCore/QtEndian>
+
+#include "SipHash.h"
+
+static inline quint64 rotateLeft(quint64 value, int numBits) {
+    return (value << numBits) | (value >> (64 - numBits));
+}
+
+static inline void sipRound(quint64& v0, quint64& v1, quint64& v2, quint64& v3) {
+    v0 += v1;
+    v1 = rotateLeft(v1, 13);
+    v1 ^= v0;
+    v0 = rotateLeft(v0, 32);
+    v2 += v3;
+    v3 = rotateLeft(v3, 16);
+    v3 ^= v2;
+    v0 += v3;
+    v3 = rotateLeft(v3, 21);
+    v3 ^= v0;
+    v2 += v1;
+    v1 = rotateLeft(v1, 17);
+    v1 ^= v2;
+    v2 = rotateLeft(v2, 32);
+}
+
+// reads 8 bytes as a little endian word, whatever the byte order of the host
+static inline quint64 readLittleEndianWord(const unsigned char* bytes) {
+    return qFromLittleEndian<quint64>(bytes);
+}
+
+SipHashKey sipHashKeyForUUID(const QUuid& uuid) {
+    SipHashKey key;
+    key.k0 = ((quint64) uuid.data1 << 32) | ((quint64) uuid.data2 << 16) | (quint64) uuid.data3;
+    key.k1 = 0;
+
+    for (int i = 0; i < 8; i++) {
+        key.k1 = (key.k1 << 8) | uuid.data4[i];
+    }
+
+    return key;
+}
+
+quint64 sipHash24(const SipHashKey& key, const char* data, int numBytes) {
+    quint64 v0 = key.k0 ^ 0x736f6d6570736575ULL;
+    quint64 v1 = key.k1 ^ 0x646f72616e646f6dULL;
+    quint64 v2 = key.k0 ^ 0x6c7967656e657261ULL;
+    quint64 v3 = key.k1 ^ 0x7465646279746573ULL;
+
+    const unsigned char* position = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* lastWordEnd = position + (numBytes & ~7);
+
+    for (; position != lastWordEnd; position += 8) {
+        quint64 word = readLittleEndianWord(position);
+        v3 ^= word;
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        v0 ^= word;
+    }
+
+    // the last word holds the remaining bytes and the message length in its top byte
+    quint64 lastWord = (quint64) numBytes << 56;
+    for (int i = (numBytes & 7) - 1; i >= 0; i--) {
+        lastWord |= (quint64) position[i] << (i * 8);
+    }
+
+    v3 ^= lastWord;
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    v0 ^= lastWord;
+
+    v2 ^= 0xff;
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
@@ -0,0 +1,28 @@
+//
+//  SipHash.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  SipHash-2-4, a keyed 64 bit MAC that is fast on short messages - used to sign packets with a connection secret.
+//
+
+#ifndef __hifi__SipHash__
+#define __hifi__SipHash__
+
+#include <QtCore/QUuid>
+
+/// the two halves of a 128 bit SipHash key
+struct SipHashKey {
+    quint64 k0;
+    quint64 k1;
+};
+
+/// the key for a connection secret, built from the UUID's fields so both ends get the same key on any byte order
+SipHashKey sipHashKeyForUUID(const QUuid& uuid);
+
+/// the SipHash-2-4 of numBytes of data under the passed key
+quint64 sipHash24(const SipHashKey& key, const char* data, int numBytes);
+
+#endif /* defined(__hifi__SipHash__) */
@@ -6,15 +6,26 @@
 //  Copyright (c) 2013 HighFidelity, Inc. All rights reserved.
 //
 
+#include <algorithm>
+
 #include <QtCore/QCoreApplication>
+#include <QtCore/QStringList>
 #include <QtCore/QTimer>
 
+#include "DatagramReceiver.h"
 #include "Logging.h"
+#include "PacketHeaders.h"
 #include "ThreadedAssignment.h"
 
 ThreadedAssignment::ThreadedAssignment(const QByteArray& packet) :
     Assignment(packet),
-    _isFinished(false)
+    _isFinished(false),
+    _isDrainingDatagramsEachFrame(false),
+    _datagramReceiver(NULL),
+    _frameTimeMutex(),
+    _numFrames(0),
+    _totalFrameUsecs(0),
+    _maxFrameUsecs(0)
 {
     
 }
@@ -29,10 +40,56 @@ void ThreadedAssignment::setFinished(bool isFinished) {
     _isFinished = isFinished;
 
     if (_isFinished) {
+        stopDatagramReceiver();
+        NodeList::getInstance()->stopPacketCapture();
+        logPacketReplayReport();
         emit finished();
     }
 }
 
+void ThreadedAssignment::recordFrameTime(quint64 frameUsecs) {
+    if (!NodeList::getInstance()->getPacketReplay()) {
+        // nobody reports the frame times outside of a replay
+        return;
+    }
+    
+    QMutexLocker locker(&_frameTimeMutex);
+    
+    _numFrames++;
+    _totalFrameUsecs += frameUsecs;
+    _maxFrameUsecs = std::max(_maxFrameUsecs, frameUsecs);
+}
+
+void ThreadedAssignment::packetReplayFinished() {
+    setFinished(true);
+}
+
+void ThreadedAssignment::logPacketReplayReport() {
+    PacketReplay* packetReplay = NodeList::getInstance()->getPacketReplay();
+    
+    if (!packetReplay) {
+        return;
+    }
+    
+    QMutexLocker locker(&_frameTimeMutex);
+    
+    qDebug() << "Replayed" << packetReplay->getNumReplayed() << "datagrams in"
+        << packetReplay->getElapsedUsecs() / (float) USECS_PER_SECOND << "seconds.";
+    qDebug() << "Frames:" << _numFrames << "- average" << (_numFrames > 0 ? _totalFrameUsecs / _numFrames : 0)
+        << "usecs, max" << _maxFrameUsecs << "usecs.";
+    qDebug() << "Sent" << packetReplay->getPacketsOut() << "packets," << packetReplay->getBytesOut() << "bytes.";
+}
+
+QString ThreadedAssignment::payloadOptionValue(const QStringList& payloadOptions, const QString& option) {
+    int optionIndex = payloadOptions.indexOf(option);
+    
+    if (optionIndex != -1 && optionIndex + 1 < payloadOptions.size()) {
+        return payloadOptions[optionIndex + 1];
+    } else {
+        return QString();
+    }
+}
+
 void ThreadedAssignment::commonInit(const char* targetName, NodeType_t nodeType) {
     // change the logging target name while the assignment is running
     Logging::setTargetName(targetName);
@@ -40,6 +97,43 @@ void ThreadedAssignment::commonInit(const char* targetName, NodeType_t nodeType)
     NodeList* nodeList = NodeList::getInstance();
     nodeList->setOwnerType(nodeType);
     
+    // any assignment can move its datagrams in batches, and time doing so against the socket first
+    QStringList payloadOptions = QString(getPayload()).split(" ", QString::SkipEmptyParts);
+    
+    const QString BATCH_DATAGRAMS_OPTION = "--batchDatagrams";
+    nodeList->setDatagramBatchingEnabled(payloadOptions.contains(BATCH_DATAGRAMS_OPTION));
+    
+    const QString BENCHMARK_DATAGRAM_BATCHES_OPTION = "--benchmarkDatagramBatches";
+    if (payloadOptions.contains(BENCHMARK_DATAGRAM_BATCHES_OPTION)) {
+        benchmarkDatagramBatches();
+    }
+    
+    // times signing and verifying packet headers, in place and on a copy the way a const QByteArray is sent
+    const QString BENCHMARK_PACKET_HEADERS_OPTION = "--benchmarkPacketHeaders";
+    if (payloadOptions.contains(BENCHMARK_PACKET_HEADERS_OPTION)) {
+        benchmarkPacketHeaders();
+    }
+    
+    // the datagrams read from here on can be captured, to be replayed against the assignment later
+    const QString CAPTURE_OPTION = "--capture";
+    QString captureFilename = payloadOptionValue(payloadOptions, CAPTURE_OPTION);
+    if (!captureFilename.isEmpty()) {
+        nodeList->startPacketCapture(captureFilename);
+    }
+    
+    PacketReplay* packetReplay = nodeList->getPacketReplay();
+    
+    const QString RECEIVE_THREAD_OPTION = "--receiveThread";
+    
+    if (packetReplay) {
+        // the replay stands in for the node socket, and says when it has datagrams due
+        connect(packetReplay, &PacketReplay::datagramsDue, this, &ThreadedAssignment::readPendingDatagrams);
+        connect(packetReplay, &PacketReplay::finished, this, &ThreadedAssignment::packetReplayFinished);
+        QTimer::singleShot(0, this, SLOT(readPendingDatagrams()));
+    } else if (payloadOptions.contains(RECEIVE_THREAD_OPTION)) {
+        startDatagramReceiver();
+    }
+    
     QTimer* domainServerTimer = new QTimer(this);
     connect(domainServerTimer, SIGNAL(timeout()), this, SLOT(checkInWithDomainServerOrExit()));
     domainServerTimer->start(DOMAIN_SERVER_CHECK_IN_USECS / 1000);
@@ -48,28 +142,84 @@ void ThreadedAssignment::commonInit(const char* targetName, NodeType_t nodeType)
     connect(pingNodesTimer, SIGNAL(timeout()), nodeList, SLOT(pingInactiveNodes()));
     pingNodesTimer->start(PING_INACTIVE_NODE_INTERVAL_USECS / 1000);
     
+    QTimer* channelTimeoutTimer = new QTimer(this);
+    connect(channelTimeoutTimer, SIGNAL(timeout()), nodeList, SLOT(processChannelTimeouts()));
+    channelTimeoutTimer->start(CHANNEL_TIMEOUT_CHECK_INTERVAL_MSECS);
+    
     QTimer* silentNodeRemovalTimer = new QTimer(this);
     connect(silentNodeRemovalTimer, SIGNAL(timeout()), nodeList, SLOT(removeSilentNodes()));
     silentNodeRemovalTimer->start(NODE_SILENCE_THRESHOLD_USECS / 1000);
 }
 
 void ThreadedAssignment::checkInWithDomainServerOrExit() {
-    if (NodeList::getInstance()->getNumNoReplyDomainCheckIns() == MAX_SILENT_DOMAIN_SERVER_CHECK_INS) {
+    NodeList* nodeList = NodeList::getInstance();
+    
+    // a replay only hears from the domain server as often as the capture did
+    if (nodeList->getNumNoReplyDomainCheckIns() == MAX_SILENT_DOMAIN_SERVER_CHECK_INS && !nodeList->getPacketReplay()) {
         setFinished(true);
     } else {
-        NodeList::getInstance()->sendDomainServerCheckIn();
+        nodeList->sendDomainServerCheckIn();
     }
 }
 
 bool ThreadedAssignment::readAvailableDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr) {
     NodeList* nodeList = NodeList::getInstance();
     
-    if (nodeList->getNodeSocket().hasPendingDatagrams()) {
-        destinationByteArray.resize(nodeList->getNodeSocket().pendingDatagramSize());
-        nodeList->getNodeSocket().readDatagram(destinationByteArray.data(), destinationByteArray.size(),
-                                               senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
-        return true;
-    } else {
-        return false;
+    if (!_datagramReceiver) {
+        return nodeList->readDatagram(destinationByteArray, senderSockAddr);
+    }
+    
+    // the NodeList does not see what comes off the receive thread, so channel packets are handed to it from here
+    forever {
+        if (nodeList->takeDeliveredChannelPacket(destinationByteArray, senderSockAddr)) {
+            return true;
+        }
+        
+        if (!_datagramReceiver->readDatagram(destinationByteArray, senderSockAddr)) {
+            return false;
+        }
+        
+        if (!nodeList->processChannelPacket(destinationByteArray, senderSockAddr)) {
+            return true;
+        }
+    }
+}
+
+void ThreadedAssignment::logDatagramQueueStats() {
+    if (_datagramReceiver) {
+        _datagramReceiver->logQueueStats();
     }
 }
+
+void ThreadedAssignment::startDatagramReceiver() {
+    QUdpSocket& nodeSocket = NodeList::getInstance()->getNodeSocket();
+    
+    // the receive thread is the only reader of the socket from here on
+    disconnect(&nodeSocket, 0, this, 0);
+    
+    _datagramReceiver = new DatagramReceiver(nodeSocket.socketDescriptor());
+    
+    if (!_isDrainingDatagramsEachFrame) {
+        connect(_datagramReceiver, &DatagramReceiver::datagramsQueued, this, &ThreadedAssignment::readPendingDatagrams,
+                Qt::QueuedConnection);
+    }
+    
+    _datagramReceiver->initialize();
+    
+    qDebug() << "Receiving datagrams on a dedicated thread.";
+}
+
+void ThreadedAssignment::stopDatagramReceiver() {
+    if (!_datagramReceiver) {
+        return;
+    }
+    
+    delete _datagramReceiver;
+    _datagramReceiver = NULL;
+    
+    // QUdpSocket turns its read notifier off after the readyRead that nobody was listening to, and only turns it back
+    // on when it is read from - drain it so the AssignmentClient hears the next datagram
+    QUdpSocket& nodeSocket = NodeList::getInstance()->getNodeSocket();
+    char discardedDatagram[MAX_PACKET_SIZE];
+    while (nodeSocket.readDatagram(discardedDatagram, sizeof(discardedDatagram)) >= 0);
+}
@@ -9,14 +9,22 @@
 #ifndef __hifi__ThreadedAssignment__
 #define __hifi__ThreadedAssignment__
 
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+
 #include "Assignment.h"
 
+class DatagramReceiver;
+
 class ThreadedAssignment : public Assignment {
     Q_OBJECT
 public:
     ThreadedAssignment(const QByteArray& packet);
     
     void setFinished(bool isFinished);
+    
+    /// adds one frame's work to the timings reported when a replay finishes - from any thread
+    void recordFrameTime(quint64 frameUsecs);
 public slots:
     /// threaded run of assignment
     virtual void run() = 0;
@@ -28,9 +36,32 @@ protected:
     bool readAvailableDatagram(QByteArray& destinationByteArray, HifiSockAddr& senderSockAddr);
     
     void commonInit(const char* targetName, NodeType_t nodeType);
+    
+    /// the word that follows option in the payload options, or an empty string if the option isn't there
+    static QString payloadOptionValue(const QStringList& payloadOptions, const QString& option);
+    
+    /// logs the receive queue metrics when datagrams come in on a receive thread
+    void logDatagramQueueStats();
+    
     bool _isFinished;
+    
+    /// set by assignments with a frame loop that reads the queued datagrams at the top of each frame, so the receive
+    /// thread does not need to wake them
+    bool _isDrainingDatagramsEachFrame;
+    
+    DatagramReceiver* _datagramReceiver;
 private slots:
     void checkInWithDomainServerOrExit();
+    void packetReplayFinished();
+private:
+    void startDatagramReceiver();
+    void stopDatagramReceiver();
+    void logPacketReplayReport();
+    
+    QMutex _frameTimeMutex;
+    int _numFrames;
+    quint64 _totalFrameUsecs;
+    quint64 _maxFrameUsecs;
 signals:
     void finished();
 };
@@ -0,0 +1,136 @@
+//
+//  TrafficStats.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <algorithm>
+
+#include <QtCore/QMutex>
+
+#include "TrafficStats.h"
+
+// far enough below the 32 bit limit that the adds racing the one that rolls the count up cannot overflow it
+const int TRAFFIC_COUNTER_ROLL_UP_THRESHOLD = 1 << 30;
+
+// rolling up is rare enough that every counter can share the lock for it
+static QMutex trafficCounterRollUpMutex;
+
+const QString JSON_KEY_PACKETS_IN = "packets_in";
+const QString JSON_KEY_BYTES_IN = "bytes_in";
+const QString JSON_KEY_PACKETS_OUT = "packets_out";
+const QString JSON_KEY_BYTES_OUT = "bytes_out";
+const QString JSON_KEY_HASH_FAILURES = "hash_failures";
+const QString JSON_KEY_VERSION_MISMATCHES = "version_mismatches";
+const QString JSON_KEY_CHANNEL_PACKETS_IN = "channel_packets_in";
+const QString JSON_KEY_CHANNEL_BYTES_IN = "channel_bytes_in";
+const QString JSON_KEY_CHANNEL_PACKETS_OUT = "channel_packets_out";
+const QString JSON_KEY_CHANNEL_BYTES_OUT = "channel_bytes_out";
+const QString JSON_KEY_UNKNOWN_SENDERS = "unknown_senders";
+const QString JSON_KEY_DROPS = "drops";
+const QString JSON_KEY_SEND_QUEUE_DEPTH = "send_queue_depth";
+const QString JSON_KEY_SEND_QUEUE_DROPS = "send_queue_drops";
+const QString JSON_KEY_PACKET_TYPES = "packet_types";
+
+TrafficCounter::TrafficCounter() :
+    _recent(0),
+    _rolledUp(0)
+{
+}
+
+void TrafficCounter::add(int amount) {
+    if (_recent.fetchAndAddRelaxed(amount) + amount >= TRAFFIC_COUNTER_ROLL_UP_THRESHOLD) {
+        QMutexLocker locker(&trafficCounterRollUpMutex);
+        _rolledUp += (quint32) _recent.fetchAndStoreRelaxed(0);
+    }
+}
+
+quint64 TrafficCounter::getTotal() const {
+    QMutexLocker locker(&trafficCounterRollUpMutex);
+    return _rolledUp + (quint32) _recent.load();
+}
+
+QJsonObject NodeTrafficStats::toJSON() const {
+    QJsonObject nodeJSON;
+    nodeJSON[JSON_KEY_PACKETS_IN] = (double) _packetsIn.getTotal();
+    nodeJSON[JSON_KEY_BYTES_IN] = (double) _bytesIn.getTotal();
+    nodeJSON[JSON_KEY_PACKETS_OUT] = (double) _packetsOut.getTotal();
+    nodeJSON[JSON_KEY_BYTES_OUT] = (double) _bytesOut.getTotal();
+    nodeJSON[JSON_KEY_HASH_FAILURES] = (double) _hashFailures.getTotal();
+    nodeJSON[JSON_KEY_SEND_QUEUE_DEPTH] = _sendQueueDepth.load();
+    nodeJSON[JSON_KEY_SEND_QUEUE_DROPS] = (double) _sendQueueDrops.getTotal();
+    return nodeJSON;
+}
+
+TrafficStats::PacketTypeCounters& TrafficStats::countersForPacketType(PacketType packetType) {
+    return _packetTypeCounters[std::min((int) packetType, NUM_TRAFFIC_STATS_PACKET_TYPES - 1)];
+}
+
+void TrafficStats::recordIncoming(PacketType packetType, int numBytes) {
+    PacketTypeCounters& counters = countersForPacketType(packetType);
+    counters.packetsIn.add(1);
+    counters.bytesIn.add(numBytes);
+}
+
+void TrafficStats::recordOutgoing(PacketType packetType, int numBytes) {
+    PacketTypeCounters& counters = countersForPacketType(packetType);
+    counters.packetsOut.add(1);
+    counters.bytesOut.add(numBytes);
+}
+
+void TrafficStats::recordVersionMismatch(PacketType packetType) {
+    countersForPacketType(packetType).versionMismatches.add(1);
+}
+
+void TrafficStats::recordIncomingOnChannel(PacketType packetType, int numBytes) {
+    PacketTypeCounters& counters = countersForPacketType(packetType);
+    counters.channelPacketsIn.add(1);
+    counters.channelBytesIn.add(numBytes);
+}
+
+void TrafficStats::recordOutgoingOnChannel(PacketType packetType, int numBytes) {
+    PacketTypeCounters& counters = countersForPacketType(packetType);
+    counters.channelPacketsOut.add(1);
+    counters.channelBytesOut.add(numBytes);
+}
+
+QJsonObject TrafficStats::toJSON() const {
+    QJsonObject packetTypesJSON;
+
+    for (int i = 0; i < NUM_TRAFFIC_STATS_PACKET_TYPES; i++) {
+        const PacketTypeCounters& counters = _packetTypeCounters[i];
+
+        quint64 packetsIn = counters.packetsIn.getTotal();
+        quint64 packetsOut = counters.packetsOut.getTotal();
+        quint64 versionMismatches = counters.versionMismatches.getTotal();
+        quint64 channelPacketsIn = counters.channelPacketsIn.getTotal();
+        quint64 channelPacketsOut = counters.channelPacketsOut.getTotal();
+
+        if (packetsIn == 0 && packetsOut == 0 && versionMismatches == 0 && channelPacketsIn == 0 && channelPacketsOut == 0) {
+            // a type that has never been seen would only pad out the JSON
+            continue;
+        }
+
+        QJsonObject packetTypeJSON;
+        packetTypeJSON[JSON_KEY_PACKETS_IN] = (double) packetsIn;
+        packetTypeJSON[JSON_KEY_BYTES_IN] = (double) counters.bytesIn.getTotal();
+        packetTypeJSON[JSON_KEY_PACKETS_OUT] = (double) packetsOut;
+        packetTypeJSON[JSON_KEY_BYTES_OUT] = (double) counters.bytesOut.getTotal();
+        packetTypeJSON[JSON_KEY_VERSION_MISMATCHES] = (double) versionMismatches;
+        packetTypeJSON[JSON_KEY_CHANNEL_PACKETS_IN] = (double) channelPacketsIn;
+        packetTypeJSON[JSON_KEY_CHANNEL_BYTES_IN] = (double) counters.channelBytesIn.getTotal();
+        packetTypeJSON[JSON_KEY_CHANNEL_PACKETS_OUT] = (double) channelPacketsOut;
+        packetTypeJSON[JSON_KEY_CHANNEL_BYTES_OUT] = (double) counters.channelBytesOut.getTotal();
+
+        packetTypesJSON[QString::number(i)] = packetTypeJSON;
+    }
+
+    QJsonObject trafficJSON;
+    trafficJSON[JSON_KEY_PACKET_TYPES] = packetTypesJSON;
+    trafficJSON[JSON_KEY_HASH_FAILURES] = (double) _hashFailures.getTotal();
+    trafficJSON[JSON_KEY_UNKNOWN_SENDERS] = (double) _unknownSenders.getTotal();
+    trafficJSON[JSON_KEY_DROPS] = (double) _drops.getTotal();
+    return trafficJSON;
+}
@@ -0,0 +1,103 @@
+//
+//  TrafficStats.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  Packets and bytes in and out, per node and per packet type, for finding what is using the bandwidth. The counts
+//  are added to from any thread without a lock, and are only read and put together when somebody asks for them.
+//
+
+#ifndef __hifi__TrafficStats__
+#define __hifi__TrafficStats__
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QJsonObject>
+
+#include "PacketHeaders.h"
+
+/// packet types are one byte on the wire while they are below 255, so every type gets its own counts
+const int NUM_TRAFFIC_STATS_PACKET_TYPES = 256;
+
+/// a count that any thread can add to without a lock - it is kept in 32 bits and moved into a 64 bit total, under a
+/// lock, each time it gets large
+class TrafficCounter {
+public:
+    TrafficCounter();
+
+    void add(int amount);
+    quint64 getTotal() const;
+private:
+    QAtomicInt _recent;
+    quint64 _rolledUp;
+};
+
+/// the traffic to and from one node
+class NodeTrafficStats {
+public:
+    void recordIncoming(int numBytes) { _packetsIn.add(1); _bytesIn.add(numBytes); }
+    void recordOutgoing(int numBytes) { _packetsOut.add(1); _bytesOut.add(numBytes); }
+    void recordHashFailure() { _hashFailures.add(1); }
+
+    /// the packets waiting for this node in PacketSender queues - added to as they are queued and taken away as they
+    /// are sent or dropped
+    void addToSendQueueDepth(int numPackets) { _sendQueueDepth.fetchAndAddRelaxed(numPackets); }
+
+    /// a packet dropped from a PacketSender queue because too many were waiting for this node
+    void recordSendQueueDrop() { _sendQueueDrops.add(1); }
+
+    QJsonObject toJSON() const;
+private:
+    TrafficCounter _packetsIn;
+    TrafficCounter _bytesIn;
+    TrafficCounter _packetsOut;
+    TrafficCounter _bytesOut;
+    TrafficCounter _hashFailures;
+    QAtomicInt _sendQueueDepth;
+    TrafficCounter _sendQueueDrops;
+};
+
+/// the traffic through the node socket by packet type, and the packets that were turned away or lost
+class TrafficStats {
+public:
+    void recordIncoming(PacketType packetType, int numBytes);
+    void recordOutgoing(PacketType packetType, int numBytes);
+    void recordVersionMismatch(PacketType packetType);
+
+    /// a packet carried inside a PacketTypeChannelData packet - the channel packet is what went over the wire and is
+    /// counted as such, so these are kept apart from the wire counts
+    void recordIncomingOnChannel(PacketType packetType, int numBytes);
+    void recordOutgoingOnChannel(PacketType packetType, int numBytes);
+
+    void recordHashFailure() { _hashFailures.add(1); }
+    void recordUnknownSender() { _unknownSenders.add(1); }
+
+    /// packets that were lost on this side - a full queue, a queue for a node that left, a datagram too large to be
+    /// received whole, or a failed send
+    void recordDrop(int numDrops = 1) { _drops.add(numDrops); }
+
+    /// the packet types that have seen traffic and the totals - the nodes are added by the NodeList
+    QJsonObject toJSON() const;
+private:
+    struct PacketTypeCounters {
+        TrafficCounter packetsIn;
+        TrafficCounter bytesIn;
+        TrafficCounter packetsOut;
+        TrafficCounter bytesOut;
+        TrafficCounter versionMismatches;
+        TrafficCounter channelPacketsIn;
+        TrafficCounter channelBytesIn;
+        TrafficCounter channelPacketsOut;
+        TrafficCounter channelBytesOut;
+    };
+
+    PacketTypeCounters& countersForPacketType(PacketType packetType);
+
+    PacketTypeCounters _packetTypeCounters[NUM_TRAFFIC_STATS_PACKET_TYPES];
+    TrafficCounter _hashFailures;
+    TrafficCounter _unknownSenders;
+    TrafficCounter _drops;
+};
+
+#endif /* defined(__hifi__TrafficStats__) */
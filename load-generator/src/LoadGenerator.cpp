@@ -0,0 +1,116 @@
+//
+//  LoadGenerator.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <QtCore/QDebug>
+#include <QtCore/QTimer>
+
+#include <NodeList.h>
+#include <SharedUtil.h>
+
+#include "SimulatedAgent.h"
+
+#include "LoadGenerator.h"
+
+const int DEFAULT_NUM_AGENTS = 10;
+const int DEFAULT_STATS_INTERVAL_SECONDS = 10;
+
+// well under the audio frame interval, so the frames go out close to when they are due
+const int AGENT_UPDATE_INTERVAL_MSECS = 2;
+
+LoadGenerator::LoadGenerator(int &argc, char **argv) :
+    QCoreApplication(argc, argv),
+    _agents()
+{
+    const char NUM_AGENTS_OPTION[] = "-n";
+    const char* numAgentsString = getCmdOption(argc, (const char**) argv, NUM_AGENTS_OPTION);
+    int numAgents = numAgentsString ? atoi(numAgentsString) : DEFAULT_NUM_AGENTS;
+    
+    const char DOMAIN_HOSTNAME_OPTION[] = "-d";
+    const char* domainHostname = getCmdOption(argc, (const char**) argv, DOMAIN_HOSTNAME_OPTION);
+    
+    const char DOMAIN_PORT_OPTION[] = "-p";
+    const char* domainPortString = getCmdOption(argc, (const char**) argv, DOMAIN_PORT_OPTION);
+    
+    HifiSockAddr domainSockAddr(domainHostname ? domainHostname : "localhost",
+                                domainPortString ? atoi(domainPortString) : DEFAULT_DOMAIN_SERVER_PORT);
+    
+    const char DURATION_OPTION[] = "--duration";
+    const char* durationString = getCmdOption(argc, (const char**) argv, DURATION_OPTION);
+    
+    const char STATS_INTERVAL_OPTION[] = "--statsInterval";
+    const char* statsIntervalString = getCmdOption(argc, (const char**) argv, STATS_INTERVAL_OPTION);
+    
+    // agents send a tone each unless they are asked for noise, and send everything unless a stream is turned off
+    bool sendsNoise = cmdOptionExists(argc, (const char**) argv, "--noise");
+    bool sendsAudio = !cmdOptionExists(argc, (const char**) argv, "--noAudio");
+    bool sendsAvatarData = !cmdOptionExists(argc, (const char**) argv, "--noAvatars");
+    bool sendsVoxelQueries = !cmdOptionExists(argc, (const char**) argv, "--noVoxels");
+    
+    qDebug() << "Starting" << numAgents << "simulated agents against the domain at" << domainSockAddr;
+    
+    for (int i = 0; i < numAgents; i++) {
+        SimulatedAgent* agent = new SimulatedAgent(i, domainSockAddr, this);
+        
+        agent->setSendsAudio(sendsAudio);
+        agent->setSendsNoise(sendsNoise);
+        agent->setSendsAvatarData(sendsAvatarData);
+        agent->setSendsVoxelQueries(sendsVoxelQueries);
+        
+        _agents.append(agent);
+    }
+    
+    QTimer* updateTimer = new QTimer(this);
+    updateTimer->setTimerType(Qt::PreciseTimer);
+    connect(updateTimer, SIGNAL(timeout()), this, SLOT(updateAgents()));
+    updateTimer->start(AGENT_UPDATE_INTERVAL_MSECS);
+    
+    QTimer* statsTimer = new QTimer(this);
+    connect(statsTimer, SIGNAL(timeout()), this, SLOT(logStats()));
+    statsTimer->start((statsIntervalString ? atoi(statsIntervalString) : DEFAULT_STATS_INTERVAL_SECONDS) * MSECS_PER_SECOND);
+    
+    if (durationString) {
+        QTimer::singleShot(atoi(durationString) * MSECS_PER_SECOND, this, SLOT(finish()));
+    }
+}
+
+void LoadGenerator::updateAgents() {
+    quint64 now = usecTimestampNow();
+    
+    foreach (SimulatedAgent* agent, _agents) {
+        agent->update(now);
+    }
+}
+
+void LoadGenerator::logStats() {
+    ReceivedStreamStats mixedAudioStats;
+    ReceivedStreamStats avatarStats;
+    ReceivedStreamStats voxelStats;
+    ReceivedStreamStats pingStats;
+    
+    foreach (SimulatedAgent* agent, _agents) {
+        mixedAudioStats.add(agent->getMixedAudioStats());
+        avatarStats.add(agent->getAvatarStats());
+        voxelStats.add(agent->getVoxelStats());
+        pingStats.add(agent->getPingStats());
+    }
+    
+    qDebug() << "Totals over" << _agents.size() << "agents";
+    qDebug() << "    mixed audio:" << qPrintable(mixedAudioStats.toString());
+    qDebug() << "    avatars:" << qPrintable(avatarStats.toString());
+    qDebug() << "    voxels:" << qPrintable(voxelStats.toString());
+    qDebug() << "    pings:" << qPrintable(pingStats.toString());
+}
+
+void LoadGenerator::finish() {
+    foreach (SimulatedAgent* agent, _agents) {
+        agent->logStats();
+    }
+    
+    logStats();
+    quit();
+}
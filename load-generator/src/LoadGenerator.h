@@ -0,0 +1,31 @@
+//
+//  LoadGenerator.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  Runs a number of simulated agents against a domain in one process, and logs what each of them receives.
+//
+
+#ifndef __hifi__LoadGenerator__
+#define __hifi__LoadGenerator__
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QList>
+
+class SimulatedAgent;
+
+class LoadGenerator : public QCoreApplication {
+    Q_OBJECT
+public:
+    LoadGenerator(int &argc, char **argv);
+private slots:
+    void updateAgents();
+    void logStats();
+    void finish();
+private:
+    QList<SimulatedAgent*> _agents;
+};
+
+#endif /* defined(__hifi__LoadGenerator__) */
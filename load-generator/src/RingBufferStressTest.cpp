@@ -0,0 +1,130 @@
+//
+//  RingBufferStressTest.cpp
+//  load-generator
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <algorithm>
+
+#include <QtCore/QDebug>
+#include <QtCore/QThread>
+
+#include <AudioRingBuffer.h>
+
+#include "RingBufferStressTest.h"
+
+// small enough that the writer keeps catching up with the reader, so both ends of the buffer are busy at once
+const int STRESS_TEST_FRAME_SAMPLES = 256;
+
+// the writer goes round these sizes, so writes straddle the end of the buffer at every offset
+const int STRESS_TEST_WRITE_SIZES[] = { 256, 100, 37, 300, 1 };
+const int NUM_STRESS_TEST_WRITE_SIZES = sizeof(STRESS_TEST_WRITE_SIZES) / sizeof(STRESS_TEST_WRITE_SIZES[0]);
+const int MAX_STRESS_TEST_WRITE_SAMPLES = 300;
+
+const int STRESS_TEST_READ_SAMPLES = 512;
+const int STRESS_TEST_PEEK_SAMPLES = 10;
+
+// the reader looks this far back behind the read position, like the mixer does for the delayed channel
+const int STRESS_TEST_HISTORY_SAMPLES = 20;
+
+class RingBufferStressWriter : public QThread {
+public:
+    RingBufferStressWriter(AudioRingBuffer& ringBuffer, int numSamples) :
+        _ringBuffer(ringBuffer),
+        _numSamples(numSamples)
+    {
+    }
+protected:
+    void run() {
+        int16_t samples[MAX_STRESS_TEST_WRITE_SAMPLES];
+        int nextSample = 0;
+        int writeIndex = 0;
+
+        while (nextSample < _numSamples) {
+            int numSamplesToWrite = std::min(STRESS_TEST_WRITE_SIZES[writeIndex % NUM_STRESS_TEST_WRITE_SIZES],
+                                             _numSamples - nextSample);
+
+            // a write that doesn't fit drops samples, which would throw the numbering out - wait for the reader instead
+            if ((int) _ringBuffer.samplesAvailable() + _ringBuffer.getNumHistorySamples() + numSamplesToWrite
+                > _ringBuffer.getSampleCapacity()) {
+                yieldCurrentThread();
+                continue;
+            }
+
+            for (int i = 0; i < numSamplesToWrite; i++) {
+                samples[i] = (int16_t) (nextSample + i);
+            }
+
+            _ringBuffer.writeSamples(samples, numSamplesToWrite);
+            nextSample += numSamplesToWrite;
+            writeIndex++;
+        }
+    }
+private:
+    AudioRingBuffer& _ringBuffer;
+    int _numSamples;
+};
+
+int stressTestAudioRingBuffer(int numSamples) {
+    AudioRingBuffer ringBuffer(STRESS_TEST_FRAME_SAMPLES);
+    ringBuffer.setNumHistorySamples(STRESS_TEST_HISTORY_SAMPLES);
+
+    qDebug() << "Writing" << numSamples << "samples through a ring buffer of" << ringBuffer.getSampleCapacity()
+        << "samples from a second thread.";
+
+    RingBufferStressWriter writer(ringBuffer, numSamples);
+    writer.start();
+
+    int16_t samples[STRESS_TEST_READ_SAMPLES];
+    int expectedSample = 0;
+    int numWrongSamples = 0;
+    int numReads = 0;
+
+    while (expectedSample < numSamples) {
+        unsigned int numSamplesAvailable = ringBuffer.samplesAvailable();
+
+        if (numSamplesAvailable == 0) {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+
+        // every third read looks at the samples in place, and the history behind them, the way the mixer does
+        // before moving past them
+        if (numReads++ % 3 == 0 && numSamplesAvailable >= (unsigned int) STRESS_TEST_PEEK_SAMPLES) {
+            // let the writer fill the buffer first, so that its next writes land right behind the history being read
+            int numSamplesWhenFull = std::min(ringBuffer.getSampleCapacity() - STRESS_TEST_HISTORY_SAMPLES
+                                              - MAX_STRESS_TEST_WRITE_SAMPLES, numSamples - expectedSample);
+            while ((int) ringBuffer.samplesAvailable() < numSamplesWhenFull) {
+                QThread::yieldCurrentThread();
+            }
+
+            // there is no history before the first sample
+            int firstPeekIndex = -std::min(STRESS_TEST_HISTORY_SAMPLES, expectedSample);
+
+            for (int i = firstPeekIndex; i < STRESS_TEST_PEEK_SAMPLES; i++) {
+                if (ringBuffer[i] != (int16_t) (expectedSample + i)) {
+                    numWrongSamples++;
+                }
+            }
+            ringBuffer.shiftReadPosition(STRESS_TEST_PEEK_SAMPLES);
+            expectedSample += STRESS_TEST_PEEK_SAMPLES;
+        } else {
+            int numSamplesRead = ringBuffer.readSamples(samples, STRESS_TEST_READ_SAMPLES) / sizeof(int16_t);
+            for (int i = 0; i < numSamplesRead; i++) {
+                if (samples[i] != (int16_t) (expectedSample + i)) {
+                    numWrongSamples++;
+                }
+            }
+            expectedSample += numSamplesRead;
+        }
+    }
+
+    writer.wait();
+
+    qDebug() << "Read" << expectedSample << "samples," << numWrongSamples << "out of order -"
+        << ringBuffer.getNumOverflowedSamples() << "overflowed.";
+
+    return numWrongSamples;
+}
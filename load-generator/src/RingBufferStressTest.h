@@ -0,0 +1,21 @@
+//
+//  RingBufferStressTest.h
+//  load-generator
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  Runs an AudioRingBuffer the way the audio mixer does, with one thread writing and another reading, and checks that
+//  every sample comes out in the order it went in. The writer numbers the samples and writes them in uneven chunks; the
+//  reader takes them through readSamples and through operator[] with shiftReadPosition, looking back at the history
+//  behind the read position through negative indices as it goes.
+//
+
+#ifndef __hifi__RingBufferStressTest__
+#define __hifi__RingBufferStressTest__
+
+/// writes numSamples samples through a ring buffer from a second thread and logs what was read back - returns the
+/// number of samples that were not the one expected
+int stressTestAudioRingBuffer(int numSamples);
+
+#endif /* defined(__hifi__RingBufferStressTest__) */
@@ -0,0 +1,546 @@
+//
+//  SimulatedAgent.cpp
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <algorithm>
+#include <cmath>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QSet>
+
+#include <AudioRingBuffer.h>
+#include <AvatarWireState.h>
+#include <OctreePacketData.h>
+#include <PacketHeaders.h>
+#include <SharedUtil.h>
+
+#include "SimulatedAgent.h"
+
+const quint64 AVATAR_DATA_SEND_INTERVAL_USECS = USECS_PER_SECOND / 60;
+const quint64 VOXEL_QUERY_SEND_INTERVAL_USECS = USECS_PER_SECOND / 10;
+
+// agents walk circles laid out on a grid, so they hear some of the others and see different parts of the voxels
+const int AGENT_PATHS_PER_ROW = 10;
+const float AGENT_PATH_SPACING = 8.0f;
+const float AGENT_PATH_RADIUS = 3.0f;
+const float AGENT_PATH_HEIGHT = 1.5f;
+const float AGENT_PATH_RADIANS_PER_SECOND = 0.5f;
+
+const float AGENT_TONE_BASE_FREQUENCY = 220.0f;
+const float AGENT_TONE_FREQUENCY_STEP = 10.0f;
+const int AGENT_TONE_FREQUENCIES = 40;
+const int AGENT_AUDIO_AMPLITUDE = 4000;
+
+const float AGENT_CAMERA_FOV = 90.0f;
+const float AGENT_CAMERA_ASPECT_RATIO = 16.0f / 9.0f;
+const float AGENT_CAMERA_NEAR_CLIP = 0.1f;
+const float AGENT_CAMERA_FAR_CLIP = 500.0f;
+
+ReceivedStreamStats::ReceivedStreamStats() :
+    _numReceived(0),
+    _numBytes(0),
+    _numLost(0),
+    _hasSequence(false),
+    _lastSequence(0),
+    _numLatencySamples(0),
+    _totalLatencyUsecs(0),
+    _maxLatencyUsecs(0)
+{
+
+}
+
+void ReceivedStreamStats::recordReceived(int numBytes) {
+    _numReceived++;
+    _numBytes += numBytes;
+}
+
+void ReceivedStreamStats::recordLatency(quint64 latencyUsecs) {
+    _numLatencySamples++;
+    _totalLatencyUsecs += latencyUsecs;
+    _maxLatencyUsecs = std::max(_maxLatencyUsecs, latencyUsecs);
+}
+
+void ReceivedStreamStats::recordSequence(quint16 sequence) {
+    qint16 sequencesAfterLast = sequence - _lastSequence;
+
+    if (!_hasSequence) {
+        _hasSequence = true;
+        _lastSequence = sequence;
+    } else if (sequencesAfterLast > 0) {
+        _numLost += sequencesAfterLast - 1;
+        _lastSequence = sequence;
+    } else if (_numLost > 0) {
+        // a packet that was counted lost turned up late
+        _numLost--;
+    }
+}
+
+void ReceivedStreamStats::add(const ReceivedStreamStats& otherStats) {
+    _numReceived += otherStats._numReceived;
+    _numBytes += otherStats._numBytes;
+    _numLost += otherStats._numLost;
+    _numLatencySamples += otherStats._numLatencySamples;
+    _totalLatencyUsecs += otherStats._totalLatencyUsecs;
+    _maxLatencyUsecs = std::max(_maxLatencyUsecs, otherStats._maxLatencyUsecs);
+}
+
+QString ReceivedStreamStats::toString() const {
+    int numExpected = _numReceived + _numLost;
+
+    QString statsString = QString("%1 packets, %2 bytes, %3 lost (%4%)").arg(_numReceived).arg(_numBytes).arg(_numLost)
+        .arg(numExpected > 0 ? 100.0f * _numLost / numExpected : 0.0f, 0, 'f', 2);
+
+    if (_numLatencySamples > 0) {
+        statsString += QString(", latency avg %1 ms max %2 ms")
+            .arg(_totalLatencyUsecs / (float) _numLatencySamples / USECS_PER_MSEC, 0, 'f', 2)
+            .arg(_maxLatencyUsecs / (float) USECS_PER_MSEC, 0, 'f', 2);
+    }
+
+    return statsString;
+}
+
+SimulatedAgent::SimulatedAgent(int agentIndex, const HifiSockAddr& domainSockAddr, QObject* parent) :
+    QObject(parent),
+    _agentIndex(agentIndex),
+    _sessionUUID(QUuid::createUuid()), // the domain server keeps the UUID an agent checks in with as its session
+    _socket(this),
+    _domainSockAddr(domainSockAddr),
+    _servers(),
+    _sendsAudio(true),
+    _sendsNoise(false),
+    _sendsAvatarData(true),
+    _sendsVoxelQueries(true),
+    _startUsecs(usecTimestampNow()),
+    _nextCheckInUsecs(_startUsecs),
+    _nextAudioFrameUsecs(_startUsecs),
+    _nextAvatarDataUsecs(_startUsecs),
+    _nextVoxelQueryUsecs(_startUsecs),
+    _pathCenter(AGENT_PATH_SPACING * (1 + agentIndex % AGENT_PATHS_PER_ROW), AGENT_PATH_HEIGHT,
+                AGENT_PATH_SPACING * (1 + agentIndex / AGENT_PATHS_PER_ROW)),
+    _pathPhase(randFloat() * PI_TIMES_TWO),
+    _position(_pathCenter),
+    _yawRadians(0.0f),
+    _orientation(),
+    _toneFrequency(AGENT_TONE_BASE_FREQUENCY + AGENT_TONE_FREQUENCY_STEP * (agentIndex % AGENT_TONE_FREQUENCIES)),
+    _toneSampleIndex(0),
+    _avatarData(),
+    _voxelQuery(),
+    _voxelServerStats(),
+    _bulkAvatarDataAcks(),
+    _firstMixedAudioUsecs(0),
+    _mixedAudioStats(),
+    _avatarStats(),
+    _voxelStats(),
+    _pingStats()
+{
+    // every agent has a port of its own, so the servers see it as a separate client
+    _socket.bind(QHostAddress::AnyIPv4, 0);
+    connect(&_socket, &QUdpSocket::readyRead, this, &SimulatedAgent::readPendingDatagrams);
+
+    _voxelQuery.setCameraFov(AGENT_CAMERA_FOV);
+    _voxelQuery.setCameraAspectRatio(AGENT_CAMERA_ASPECT_RATIO);
+    _voxelQuery.setCameraNearClip(AGENT_CAMERA_NEAR_CLIP);
+    _voxelQuery.setCameraFarClip(AGENT_CAMERA_FAR_CLIP);
+}
+
+void SimulatedAgent::update(quint64 now) {
+    if (now >= _nextCheckInUsecs) {
+        sendDomainServerCheckIn();
+        pingServers();
+        _nextCheckInUsecs += DOMAIN_SERVER_CHECK_IN_USECS;
+    }
+
+    updatePath(now);
+
+    // frames that fell behind go out back to back, the way a client catching up would send them
+    while (now >= _nextAudioFrameUsecs) {
+        if (_sendsAudio) {
+            sendAudioFrame();
+        }
+        _nextAudioFrameUsecs += BUFFER_SEND_INTERVAL_USECS;
+    }
+
+    if (now >= _nextAvatarDataUsecs) {
+        if (_sendsAvatarData) {
+            sendAvatarData();
+        }
+        _nextAvatarDataUsecs = now + AVATAR_DATA_SEND_INTERVAL_USECS;
+    }
+
+    if (now >= _nextVoxelQueryUsecs) {
+        if (_sendsVoxelQueries) {
+            sendVoxelQuery();
+        }
+        _nextVoxelQueryUsecs = now + VOXEL_QUERY_SEND_INTERVAL_USECS;
+    }
+}
+
+void SimulatedAgent::writeToServer(QByteArray& packet, const ServerNode& server, const HifiSockAddr& destinationSockAddr) {
+    writeMACInPacketGivenConnectionSecret(packet.data(), packet.size(), server.connectionSecret);
+    _socket.writeDatagram(packet, destinationSockAddr.getAddress(), destinationSockAddr.getPort());
+}
+
+void SimulatedAgent::writeToServersOfType(QByteArray& packet, NodeType_t serverType) {
+    foreach (const ServerNode& server, _servers) {
+        if (server.type == serverType && !server.activeSocket.isNull()) {
+            writeToServer(packet, server, server.activeSocket);
+        }
+    }
+}
+
+QByteArray SimulatedAgent::constructPingPacket(PingType_t pingType) {
+    QByteArray pingPacket = byteArrayWithPopluatedHeader(PacketTypePing, _sessionUUID);
+
+    QDataStream packetStream(&pingPacket, QIODevice::Append);
+    packetStream << pingType << usecTimestampNow();
+
+    return pingPacket;
+}
+
+void SimulatedAgent::sendDomainServerCheckIn() {
+    static NodeSet serverTypes = NodeSet() << NodeType::AudioMixer << NodeType::AvatarMixer << NodeType::VoxelServer;
+
+    QByteArray checkInPacket = byteArrayWithPopluatedHeader(PacketTypeDomainListRequest, _sessionUUID);
+    QDataStream packetStream(&checkInPacket, QIODevice::Append);
+
+    // a null public address has the domain server fill in the one it sees
+    packetStream << NodeType::Agent << HifiSockAddr()
+        << HifiSockAddr(QHostAddress(getHostOrderLocalAddress()), _socket.localPort())
+        << (quint8) serverTypes.size();
+
+    foreach (NodeType_t serverType, serverTypes) {
+        packetStream << serverType;
+    }
+
+    _socket.writeDatagram(checkInPacket, _domainSockAddr.getAddress(), _domainSockAddr.getPort());
+}
+
+void SimulatedAgent::processDomainList(const QByteArray& packet) {
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+
+    QUuid ownUUID;
+    packetStream >> ownUUID;
+
+    QSet<QUuid> listedServers;
+
+    while (packetStream.device()->pos() < packet.size()) {
+        qint8 nodeType;
+        QUuid nodeUUID;
+        HifiSockAddr publicSocket;
+        HifiSockAddr localSocket;
+        QUuid connectionSecret;
+
+        packetStream >> nodeType >> nodeUUID >> publicSocket >> localSocket >> connectionSecret;
+
+        if (publicSocket.getAddress().isNull()) {
+            // the server is on the domain server's box
+            publicSocket.setAddress(_domainSockAddr.getAddress());
+        }
+
+        ServerNode& server = _servers[nodeUUID];
+
+        if (server.publicSocket != publicSocket || server.localSocket != localSocket) {
+            // a new server, or one that came back somewhere else, has to be pinged before it is sent to
+            server.activeSocket = HifiSockAddr();
+        }
+
+        if (!server.channels) {
+            server.channels = QSharedPointer<NodeChannels>(new NodeChannels());
+        }
+
+        server.type = nodeType;
+        server.publicSocket = publicSocket;
+        server.localSocket = localSocket;
+        server.connectionSecret = connectionSecret;
+
+        listedServers.insert(nodeUUID);
+    }
+
+    // servers that left the domain are no longer sent to
+    QHash<QUuid, ServerNode>::iterator server = _servers.begin();
+    while (server != _servers.end()) {
+        if (listedServers.contains(server.key())) {
+            ++server;
+        } else {
+            server = _servers.erase(server);
+        }
+    }
+}
+
+void SimulatedAgent::pingServers() {
+    QHash<QUuid, ServerNode>::const_iterator server = _servers.constBegin();
+
+    for (; server != _servers.constEnd(); ++server) {
+        if (server->activeSocket.isNull()) {
+            QByteArray localPingPacket = constructPingPacket(PingType::Local);
+            writeToServer(localPingPacket, *server, server->localSocket);
+
+            QByteArray publicPingPacket = constructPingPacket(PingType::Public);
+            writeToServer(publicPingPacket, *server, server->publicSocket);
+        } else {
+            // the replies to these are only for the latency
+            QByteArray agnosticPingPacket = constructPingPacket(PingType::Agnostic);
+            writeToServer(agnosticPingPacket, *server, server->activeSocket);
+        }
+    }
+}
+
+void SimulatedAgent::processPing(const QByteArray& packet, const HifiSockAddr& senderSockAddr) {
+    QHash<QUuid, ServerNode>::const_iterator server = _servers.constFind(uuidFromPacketHeader(packet));
+
+    if (server == _servers.constEnd()) {
+        return;
+    }
+
+    QDataStream pingPacketStream(packet);
+    pingPacketStream.skipRawData(numBytesForPacketHeader(packet));
+
+    PingType_t pingType;
+    quint64 timeFromOriginalPing;
+    pingPacketStream >> pingType >> timeFromOriginalPing;
+
+    // the server activates the socket it hears this on, the same as it would for an interface
+    QByteArray replyPacket = byteArrayWithPopluatedHeader(PacketTypePingReply, _sessionUUID);
+    QDataStream replyPacketStream(&replyPacket, QIODevice::Append);
+    replyPacketStream << pingType << timeFromOriginalPing << usecTimestampNow();
+
+    writeToServer(replyPacket, *server, senderSockAddr);
+}
+
+void SimulatedAgent::processPingReply(const QByteArray& packet, quint64 now) {
+    QHash<QUuid, ServerNode>::iterator server = _servers.find(uuidFromPacketHeader(packet));
+
+    if (server == _servers.end()) {
+        return;
+    }
+
+    QDataStream packetStream(packet);
+    packetStream.skipRawData(numBytesForPacketHeader(packet));
+
+    PingType_t pingType;
+    quint64 timeFromOriginalPing;
+    packetStream >> pingType >> timeFromOriginalPing;
+
+    if (pingType == PingType::Local && server->activeSocket != server->localSocket) {
+        server->activeSocket = server->localSocket;
+    } else if (pingType == PingType::Public && server->activeSocket.isNull()) {
+        server->activeSocket = server->publicSocket;
+    }
+
+    _pingStats.recordReceived(packet.size());
+    _pingStats.recordLatency(now - timeFromOriginalPing);
+}
+
+void SimulatedAgent::updatePath(quint64 now) {
+    float pathAngle = _pathPhase + AGENT_PATH_RADIANS_PER_SECOND * (now - _startUsecs) / USECS_PER_SECOND;
+
+    _position = _pathCenter + AGENT_PATH_RADIUS * glm::vec3(cosf(pathAngle), 0.0f, sinf(pathAngle));
+
+    // face along the circle, so the frustum sweeps around as the agent walks it
+    _yawRadians = -pathAngle;
+    _orientation = glm::quat(glm::vec3(0.0f, _yawRadians, 0.0f));
+}
+
+void SimulatedAgent::sendAudioFrame() {
+    QByteArray audioPacket = byteArrayWithPopluatedHeader(PacketTypeMicrophoneAudioNoEcho, _sessionUUID);
+
+    audioPacket.append(reinterpret_cast<const char*>(&_position), sizeof(_position));
+    audioPacket.append(reinterpret_cast<const char*>(&_orientation), sizeof(_orientation));
+
+    int numHeaderBytes = audioPacket.size();
+    audioPacket.resize(numHeaderBytes + NETWORK_BUFFER_LENGTH_BYTES_PER_CHANNEL);
+    int16_t* samples = reinterpret_cast<int16_t*>(audioPacket.data() + numHeaderBytes);
+
+    for (int i = 0; i < NETWORK_BUFFER_LENGTH_SAMPLES_PER_CHANNEL; i++) {
+        if (_sendsNoise) {
+            samples[i] = randIntInRange(-AGENT_AUDIO_AMPLITUDE, AGENT_AUDIO_AMPLITUDE);
+        } else {
+            samples[i] = AGENT_AUDIO_AMPLITUDE * sinf(PI_TIMES_TWO * _toneFrequency * _toneSampleIndex++ / SAMPLE_RATE);
+        }
+    }
+
+    // keep the tone's sample index from growing until the sine loses its precision
+    _toneSampleIndex %= SAMPLE_RATE;
+
+    writeToServersOfType(audioPacket, NodeType::AudioMixer);
+}
+
+void SimulatedAgent::sendAvatarData() {
+    _avatarData.setPosition(_position);
+    _avatarData.setBodyYaw(glm::degrees(_yawRadians));
+
+    QByteArray avatarPacket = byteArrayWithPopluatedHeader(PacketTypeAvatarData, _sessionUUID);
+    avatarPacket.append(_avatarData.toByteArray());
+
+    // acknowledge the bulk packets the same way an interface does, so the mixer can send deltas
+    _bulkAvatarDataAcks.appendAck(avatarPacket);
+
+    writeToServersOfType(avatarPacket, NodeType::AvatarMixer);
+}
+
+void SimulatedAgent::sendVoxelQuery() {
+    _voxelQuery.setCameraPosition(_position);
+    _voxelQuery.setCameraOrientation(_orientation);
+
+    for (QHash<QUuid, ServerNode>::const_iterator server = _servers.constBegin(); server != _servers.constEnd(); ++server) {
+        if (server->type != NodeType::VoxelServer || server->activeSocket.isNull()) {
+            continue;
+        }
+
+        // acknowledge each server's packets the same way an interface does, so it only resends what we missed
+        bool hasOctreeAck = false;
+        OCTREE_PACKET_SEQUENCE ackedSequence = 0;
+        quint64 ackedReceivedBits = 0;
+        QHash<QUuid, OctreeSceneStats>::const_iterator serverStats = _voxelServerStats.constFind(server.key());
+        if (serverStats != _voxelServerStats.constEnd()) {
+            hasOctreeAck = serverStats->getIncomingAck(ackedSequence, ackedReceivedBits);
+        }
+        _voxelQuery.setOctreeAck(hasOctreeAck, ackedSequence, ackedReceivedBits);
+
+        QByteArray queryPacket = byteArrayWithPopluatedHeader(PacketTypeVoxelQuery, _sessionUUID);
+
+        int numHeaderBytes = queryPacket.size();
+        queryPacket.resize(MAX_PACKET_SIZE);
+        queryPacket.resize(numHeaderBytes
+                           + _voxelQuery.getBroadcastData(reinterpret_cast<unsigned char*>(queryPacket.data())
+                                                          + numHeaderBytes));
+
+        writeToServer(queryPacket, *server, server->activeSocket);
+    }
+}
+
+void SimulatedAgent::processMixedAudio(const QByteArray& packet, quint64 now) {
+    if (_firstMixedAudioUsecs == 0) {
+        _firstMixedAudioUsecs = now;
+    }
+
+    _mixedAudioStats.recordReceived(packet.size());
+
+    // mixed audio is not numbered - the mixer sends a frame every interval, so the frames that should have come by now
+    // and have not are counted lost
+    int numExpected = (now - _firstMixedAudioUsecs) / BUFFER_SEND_INTERVAL_USECS + 1;
+    int numMissing = numExpected - _mixedAudioStats.getNumReceived() - _mixedAudioStats.getNumLost();
+
+    if (numMissing > 0) {
+        _mixedAudioStats.recordLost(numMissing);
+    }
+}
+
+void SimulatedAgent::processBulkAvatarData(const QByteArray& packet) {
+    int numHeaderBytes = numBytesForPacketHeader(packet);
+    quint16 sequence;
+
+    if (packet.size() - numHeaderBytes < (int) sizeof(sequence)) {
+        return;
+    }
+
+    memcpy(&sequence, packet.constData() + numHeaderBytes, sizeof(sequence));
+
+    _avatarStats.recordReceived(packet.size());
+    _avatarStats.recordSequence(sequence);
+    _bulkAvatarDataAcks.recordSequence(sequence);
+}
+
+void SimulatedAgent::processVoxelData(const QByteArray& packet, quint64 now) {
+    const unsigned char* dataAt = reinterpret_cast<const unsigned char*>(packet.constData()) + numBytesForPacketHeader(packet);
+
+    if (packet.size() < numBytesForPacketHeader(packet) + OCTREE_PACKET_EXTRA_HEADERS_SIZE) {
+        return;
+    }
+
+    dataAt += sizeof(OCTREE_PACKET_FLAGS);
+
+    OCTREE_PACKET_SEQUENCE sequence;
+    memcpy(&sequence, dataAt, sizeof(sequence));
+    dataAt += sizeof(OCTREE_PACKET_SEQUENCE);
+
+    OCTREE_PACKET_SENT_TIME sentAt;
+    memcpy(&sentAt, dataAt, sizeof(sentAt));
+
+    _voxelStats.recordReceived(packet.size());
+    _voxelStats.recordSequence(sequence);
+    _voxelServerStats[uuidFromPacketHeader(packet)].trackIncomingOctreePacket(packet, false, 0);
+
+    // the server's clock only lines up with ours when they are on the same box
+    if (now > sentAt) {
+        _voxelStats.recordLatency(now - sentAt);
+    }
+}
+
+void SimulatedAgent::readPendingDatagrams() {
+    QByteArray receivedPacket;
+    HifiSockAddr senderSockAddr;
+
+    while (_socket.hasPendingDatagrams()) {
+        receivedPacket.resize(_socket.pendingDatagramSize());
+        _socket.readDatagram(receivedPacket.data(), receivedPacket.size(),
+                             senderSockAddr.getAddressPointer(), senderSockAddr.getPortPointer());
+
+        processPacket(receivedPacket, senderSockAddr, usecTimestampNow());
+    }
+}
+
+void SimulatedAgent::processPacket(const QByteArray& packet, const HifiSockAddr& senderSockAddr, quint64 now) {
+    switch (packetTypeForPacket(packet)) {
+        case PacketTypeDomainList:
+            processDomainList(packet);
+            break;
+        case PacketTypePing:
+            processPing(packet, senderSockAddr);
+            break;
+        case PacketTypePingReply:
+            processPingReply(packet, now);
+            break;
+        case PacketTypeChannelData:
+            processChannelData(packet, senderSockAddr, now);
+            break;
+        case PacketTypeMixedAudio:
+        case PacketTypeSilentAudioFrame:
+            processMixedAudio(packet, now);
+            break;
+        case PacketTypeBulkAvatarData:
+            processBulkAvatarData(packet);
+            break;
+        case PacketTypeVoxelData:
+            processVoxelData(packet, now);
+            break;
+        default:
+            break;
+    }
+}
+
+void SimulatedAgent::processChannelData(const QByteArray& packet, const HifiSockAddr& senderSockAddr, quint64 now) {
+    QHash<QUuid, ServerNode>::const_iterator server = _servers.constFind(uuidFromPacketHeader(packet));
+
+    if (server == _servers.constEnd()) {
+        return;
+    }
+
+    // the mixer holds back everything after a reliable packet until it is acknowledged, so an agent that ignored
+    // these would stall its own channel - the identities it carries are not looked at any further
+    QList<QByteArray> deliveredPackets;
+    QByteArray ackPacket;
+    server->channels->processDataPacket(packet, deliveredPackets, ackPacket, _sessionUUID);
+
+    if (!ackPacket.isEmpty()) {
+        writeToServer(ackPacket, *server, senderSockAddr);
+    }
+
+    foreach (const QByteArray& deliveredPacket, deliveredPackets) {
+        processPacket(deliveredPacket, senderSockAddr, now);
+    }
+}
+
+void SimulatedAgent::logStats() const {
+    qDebug() << "Agent" << _agentIndex << _sessionUUID << "-" << _servers.size() << "servers";
+    qDebug() << "    mixed audio:" << qPrintable(_mixedAudioStats.toString());
+    qDebug() << "    avatars:" << qPrintable(_avatarStats.toString());
+    qDebug() << "    voxels:" << qPrintable(_voxelStats.toString());
+    qDebug() << "    pings:" << qPrintable(_pingStats.toString());
+}
@@ -0,0 +1,158 @@
+//
+//  SimulatedAgent.h
+//  hifi
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+//  One simulated client - its own socket and session with the domain server, sending what an interface sends to the
+//  mixers and voxel servers it is given, and keeping track of what comes back.
+//
+
+#ifndef __hifi__SimulatedAgent__
+#define __hifi__SimulatedAgent__
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QUuid>
+#include <QtNetwork/QUdpSocket>
+
+#include <AvatarData.h>
+#include <AvatarWireState.h>
+#include <HifiSockAddr.h>
+#include <NodeChannel.h>
+#include <NodeList.h>
+#include <OctreeSceneStats.h>
+#include <VoxelQuery.h>
+
+/// one kind of packet an agent receives - how many came, how many went missing and how late they were
+class ReceivedStreamStats {
+public:
+    ReceivedStreamStats();
+
+    void recordReceived(int numBytes);
+    void recordLost(int numLost) { _numLost += numLost; }
+    void recordLatency(quint64 latencyUsecs);
+
+    /// counts the sequences skipped since the last one as lost - a late packet from before it is only counted received
+    void recordSequence(quint16 sequence);
+
+    int getNumReceived() const { return _numReceived; }
+    int getNumLost() const { return _numLost; }
+
+    /// folds another agent's counts into these, for the totals over every agent
+    void add(const ReceivedStreamStats& otherStats);
+
+    QString toString() const;
+private:
+    int _numReceived;
+    quint64 _numBytes;
+    int _numLost;
+    bool _hasSequence;
+    quint16 _lastSequence;
+    int _numLatencySamples;
+    quint64 _totalLatencyUsecs;
+    quint64 _maxLatencyUsecs;
+};
+
+class SimulatedAgent : public QObject {
+    Q_OBJECT
+public:
+    SimulatedAgent(int agentIndex, const HifiSockAddr& domainSockAddr, QObject* parent = 0);
+
+    void setSendsAudio(bool sendsAudio) { _sendsAudio = sendsAudio; }
+    void setSendsNoise(bool sendsNoise) { _sendsNoise = sendsNoise; }
+    void setSendsAvatarData(bool sendsAvatarData) { _sendsAvatarData = sendsAvatarData; }
+    void setSendsVoxelQueries(bool sendsVoxelQueries) { _sendsVoxelQueries = sendsVoxelQueries; }
+
+    /// sends whatever is due by now - called far more often than anything is due
+    void update(quint64 now);
+
+    const ReceivedStreamStats& getMixedAudioStats() const { return _mixedAudioStats; }
+    const ReceivedStreamStats& getAvatarStats() const { return _avatarStats; }
+    const ReceivedStreamStats& getVoxelStats() const { return _voxelStats; }
+    const ReceivedStreamStats& getPingStats() const { return _pingStats; }
+
+    void logStats() const;
+private slots:
+    void readPendingDatagrams();
+private:
+    /// a mixer or voxel server from the domain list
+    struct ServerNode {
+        NodeType_t type;
+        HifiSockAddr publicSocket;
+        HifiSockAddr localSocket;
+        HifiSockAddr activeSocket;
+        QUuid connectionSecret;
+        QSharedPointer<NodeChannels> channels; // what the server sends on channels, acknowledged as an interface would
+    };
+
+    void writeToServer(QByteArray& packet, const ServerNode& server, const HifiSockAddr& destinationSockAddr);
+    void writeToServersOfType(QByteArray& packet, NodeType_t serverType);
+
+    QByteArray constructPingPacket(PingType_t pingType);
+
+    void sendDomainServerCheckIn();
+    void processDomainList(const QByteArray& packet);
+    void pingServers();
+    void processPing(const QByteArray& packet, const HifiSockAddr& senderSockAddr);
+    void processPingReply(const QByteArray& packet, quint64 now);
+
+    /// handles one packet from the socket, or one a channel packet carried
+    void processPacket(const QByteArray& packet, const HifiSockAddr& senderSockAddr, quint64 now);
+    void processChannelData(const QByteArray& packet, const HifiSockAddr& senderSockAddr, quint64 now);
+
+    void updatePath(quint64 now);
+    void sendAudioFrame();
+    void sendAvatarData();
+    void sendVoxelQuery();
+
+    void processMixedAudio(const QByteArray& packet, quint64 now);
+    void processBulkAvatarData(const QByteArray& packet);
+    void processVoxelData(const QByteArray& packet, quint64 now);
+
+    int _agentIndex;
+    QUuid _sessionUUID;
+    QUdpSocket _socket;
+    HifiSockAddr _domainSockAddr;
+    QHash<QUuid, ServerNode> _servers;
+
+    bool _sendsAudio;
+    bool _sendsNoise;
+    bool _sendsAvatarData;
+    bool _sendsVoxelQueries;
+
+    quint64 _startUsecs;
+    quint64 _nextCheckInUsecs;
+    quint64 _nextAudioFrameUsecs;
+    quint64 _nextAvatarDataUsecs;
+    quint64 _nextVoxelQueryUsecs;
+
+    glm::vec3 _pathCenter;
+    float _pathPhase;
+    glm::vec3 _position;
+    float _yawRadians;
+    glm::quat _orientation;
+
+    float _toneFrequency;
+    int _toneSampleIndex;
+
+    AvatarData _avatarData;
+    VoxelQuery _voxelQuery;
+    QHash<QUuid, OctreeSceneStats> _voxelServerStats; // what each voxel server has sent us, for the acks in our queries
+
+    AvatarWireAckTracker _bulkAvatarDataAcks;
+
+    quint64 _firstMixedAudioUsecs;
+
+    ReceivedStreamStats _mixedAudioStats;
+    ReceivedStreamStats _avatarStats;
+    ReceivedStreamStats _voxelStats;
+    ReceivedStreamStats _pingStats;
+};
+
+#endif /* defined(__hifi__SimulatedAgent__) */
@@ -0,0 +1,30 @@
+//
+//  main.cpp
+//  load-generator
+//
+//  Created by agent on 10/16/26.
+//  Copyright (c) 2026 HighFidelity, Inc. All rights reserved.
+//
+
+#include <SharedUtil.h>
+
+#include "LoadGenerator.h"
+#include "RingBufferStressTest.h"
+
+const int DEFAULT_STRESS_TEST_SAMPLES = 10 * 1000 * 1000;
+
+int main(int argc, char* argv[]) {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    
+    // --stressRingBuffer [samples] checks the audio ring buffer across two threads instead of generating any load
+    const char STRESS_RING_BUFFER_OPTION[] = "--stressRingBuffer";
+    if (cmdOptionExists(argc, (const char**) argv, STRESS_RING_BUFFER_OPTION)) {
+        const char* numSamplesString = getCmdOption(argc, (const char**) argv, STRESS_RING_BUFFER_OPTION);
+        int numSamples = numSamplesString ? atoi(numSamplesString) : 0;
+        
+        return stressTestAudioRingBuffer(numSamples > 0 ? numSamples : DEFAULT_STRESS_TEST_SAMPLES) == 0 ? 0 : 1;
+    }
+    
+    LoadGenerator loadGenerator(argc, argv);
+    return loadGenerator.exec();
+}
@@ -10,6 +10,7 @@
 #include <SharedUtil.h>
 #include <SceneUtils.h>
 #include <JurisdictionMap.h>
+#include <OctreePacketData.h>
 #include <QString>
 #include <QStringList>
 
@@ -233,6 +234,74 @@ void processFillSVOFile(const char* fillSVOFile) {
     qDebug("exiting now");
 }
 
+// sends the whole SVO through the packet encoder once per codec, and reports how small and how fast each one was
+void processBenchmarkCodecs(const char* benchmarkSVOFile) {
+    qDebug("benchmarkCodecs: %s", benchmarkSVOFile);
+
+    VoxelTree svo;
+    svo.readFromSVOFile(benchmarkSVOFile);
+    qDebug("Nodes after loading %lu nodes", svo.getOctreeElementsCount());
+
+    for (int codec = 0; codec < OCTREE_CODEC_COUNT; codec++) {
+        OctreePacketData packetData(true);
+        packetData.setCodec((OctreePacketCodec)codec);
+        OctreePacketData decodedData(true);
+
+        OctreeElementBag nodeBag;
+        nodeBag.insert(svo.getRoot());
+
+        int packets = 0;
+        quint64 uncompressedBytes = 0;
+        quint64 compressedBytes = 0;
+        quint64 decodeUsecs = 0;
+        quint64 compressUsecsBefore = OctreePacketData::getCompressContentTime();
+
+        while (!nodeBag.isEmpty()) {
+            OctreeElement* subTree = nodeBag.extract();
+            bool packetWasEmpty = !packetData.hasContent();
+
+            svo.lockForRead();
+            EncodeBitstreamParams params(INT_MAX, IGNORE_VIEW_FRUSTUM, WANT_COLOR, WANT_EXISTS_BITS);
+            int bytesWritten = svo.encodeTreeBitstream(subTree, &packetData, nodeBag, params);
+            svo.unlock();
+
+            bool didntFit = (bytesWritten == 0 && params.stopReason == EncodeBitstreamParams::DIDNT_FIT);
+            if (didntFit && packetWasEmpty) {
+                qDebug("subtree doesn't fit in an empty packet, giving up on this codec");
+                break;
+            }
+
+            // a full packet, or the last one, is finalized just as the server would send it
+            if ((didntFit || nodeBag.isEmpty()) && packetData.hasContent()) {
+                int finalizedSize = packetData.getFinalizedSize();
+                const unsigned char* finalizedData = packetData.getFinalizedData();
+
+                quint64 decodeStart = usecTimestampNow();
+                decodedData.loadFinalizedContent(finalizedData, finalizedSize);
+                decodeUsecs += usecTimestampNow() - decodeStart;
+
+                packets++;
+                uncompressedBytes += packetData.getUncompressedSize();
+                compressedBytes += finalizedSize;
+                packetData.reset();
+            }
+
+            if (didntFit) {
+                nodeBag.insert(subTree);
+            }
+        }
+
+        quint64 compressUsecs = OctreePacketData::getCompressContentTime() - compressUsecsBefore;
+        qDebug() << "codec:" << OctreePacketData::getCodecName((OctreePacketCodec)codec)
+            << "packets:" << packets
+            << "uncompressed bytes:" << uncompressedBytes
+            << "compressed bytes:" << compressedBytes
+            << "ratio:" << (compressedBytes > 0 ? (float)uncompressedBytes / (float)compressedBytes : 0.0f)
+            << "compress usecs:" << compressUsecs
+            << "decode usecs:" << decodeUsecs;
+    }
+}
+
 void unitTest(VoxelTree * tree);
 
 
@@ -324,6 +393,14 @@ int main(int argc, const char * argv[])
         return 0;
     }
 
+    // Handles sending an SVO through each of the octree packet codecs, to compare their size and speed.
+    const char* BENCHMARK_CODECS = "--benchmarkCodecs";
+    const char* benchmarkSVOFile = getCmdOption(argc, argv, BENCHMARK_CODECS);
+    if (benchmarkSVOFile) {
+        processBenchmarkCodecs(benchmarkSVOFile);
+        return 0;
+    }
+
     const char* DONT_CREATE_FILE = "--dontCreateSceneFile";
     bool dontCreateFile = cmdOptionExists(argc, argv, DONT_CREATE_FILE);
 